@@ -26,15 +26,39 @@ Abstract:
 #include <wmistr.h>
 #include <wmilib.h>
 #include <ntstrsafe.h>
-#include "trace.h"
+#include "Trace.h"
 #define RESHUB_USE_HELPER_ROUTINES
 #include <reshub.h>
-#include "spb.h"
+#include "Spb.h"
+#include "sm5714_telemetry.h"
+#include "sm5714_interface.h"
 
 //--------------------------------------------------------------------- Literals
 
 #define SM5714_BATTERY_TAG                 'StaB'
 
+//
+// Tunables read from the device's hardware key. Readers are served from the
+// telemetry ring while its newest sample is younger than the status cache
+// age, so that should exceed the sample period. A period of 0 stops the
+// background sampler, an age of 0 makes every query read the gauge.
+//
+
+#define SM5714_STATUS_CACHE_MAX_AGE_VALUE          L"StatusCacheMaxAgeMs"
+#define SM5714_STATUS_CACHE_DEFAULT_MAX_AGE_MS     2000
+
+#define SM5714_SAMPLE_PERIOD_VALUE                 L"SamplePeriodMs"
+#define SM5714_SAMPLE_DEFAULT_PERIOD_MS            1000
+
+//
+// Low-power sampling reads the gauge's averaged registers at a much longer
+// period; LowPowerSampling selects it from start
+//
+
+#define SM5714_LOW_POWER_SAMPLING_VALUE            L"LowPowerSampling"
+#define SM5714_LOW_POWER_SAMPLE_PERIOD_VALUE       L"LowPowerSamplePeriodMs"
+#define SM5714_LOW_POWER_DEFAULT_PERIOD_MS         60000
+
 /*
 * Rob Green, a member of the NTDEV list, provides the
 * following set of macros that'll keep you from having
@@ -82,6 +106,64 @@ typedef struct {
     UNICODE_STRING                  RegistryPath;
 } SM5714_BATTERY_GLOBAL_DATA, *PSM5714_BATTERY_GLOBAL_DATA;
 
+//
+// A battery class string as returned by QueryInformation, Length in bytes
+// including the terminator
+//
+
+typedef struct {
+    ULONG                           Length;
+    WCHAR                           Buffer[MAX_BATTERY_STRING_SIZE];
+} SM5714_BATTERY_STRING, *PSM5714_BATTERY_STRING;
+
+//
+// Bus operations used by the fuel gauge code. On device these forward to the
+// SPB I/O target (see SpbBusOps in Spb.c); the host build plugs in a
+// simulated fuel gauge instead so the gauge and miniclass logic can run
+// off-device.
+//
+
+typedef
+NTSTATUS
+SM5714_BUS_WRITE_READ(
+    _In_                        PVOID   BusContext,
+    _In_reads_(SendLength)      PVOID   SendData,
+    _In_                        USHORT  SendLength,
+    _In_reads_(CmdLength)       PVOID   ReadCmd,
+    _In_                        USHORT  CmdLength,
+    _Out_writes_(DataLength)    PVOID   Data,
+    _In_                        USHORT  DataLength,
+    _In_                        ULONG   DelayUs
+);
+
+//
+// One segment of a bus sequence. Segments are separated by a repeated START
+// and the whole list is issued as a single bus transaction, so values read
+// in one sequence come from the same burst.
+//
+
+#define SM5714_BUS_MAX_TRANSFERS        24
+
+typedef struct {
+    BOOLEAN                         Read;
+    PVOID                           Buffer;
+    USHORT                          Length;
+    ULONG                           DelayUs;
+} SM5714_BUS_TRANSFER, *PSM5714_BUS_TRANSFER;
+
+typedef
+NTSTATUS
+SM5714_BUS_SEQUENCE(
+    _In_                            PVOID                       BusContext,
+    _In_reads_(TransferCount)       const SM5714_BUS_TRANSFER*  Transfers,
+    _In_                            ULONG                       TransferCount
+);
+
+typedef struct {
+    SM5714_BUS_WRITE_READ*          WriteRead;
+    SM5714_BUS_SEQUENCE*            Sequence;
+} SM5714_BUS_OPS, *PSM5714_BUS_OPS;
+
 typedef struct {
     //
     // Device handle
@@ -102,7 +184,14 @@ typedef struct {
     SPB_CONTEXT I2CContext;
 
     //
-    // Battery state
+    // Bus used by the fuel gauge routines, normally SpbBusOps over I2CContext
+    //
+    const SM5714_BUS_OPS*           BusOps;
+    PVOID                           BusContext;
+
+    //
+    // Battery state. StateLock guards the tag and the configuration below
+    // and is never held across bus I/O.
     //
 
     WDFWAITLOCK                     StateLock;
@@ -112,6 +201,114 @@ typedef struct {
     ULONG                           FullChargedCapacity_mWh;
     UCHAR                           BatteryTechnology;
     ULONG                           DesignVoltage_mV;
+
+    //
+    // Static information, built at prepare-hardware time and also guarded
+    // by StateLock. Only the cycle count changes afterwards: a charge
+    // starting or ending sets CycleCountStale in the sampling path and the
+    // next work item reads the gauge's cycle word again.
+    //
+
+    BATTERY_INFORMATION             Information;
+    SM5714_BATTERY_STRING           UniqueId;
+    SM5714_BATTERY_STRING           DeviceName;
+    SM5714_BATTERY_STRING           ManufactureName;
+    SM5714_BATTERY_STRING           SerialNumber;
+    volatile LONG                   CycleCountStale;
+
+    //
+    // Telemetry ring, guarded by TelemetryLock. Readers take the newest
+    // sample while it is younger than StatusCacheMaxAge (interrupt time
+    // units) and sample the gauge themselves otherwise.
+    //
+
+    WDFWAITLOCK                     TelemetryLock;
+    SM5714_TELEMETRY_RING           Telemetry;
+
+    //
+    // Newest sample as published for lock-free readers, written under
+    // TelemetryLock. Allocated cache aligned from nonpaged pool.
+    //
+
+    WDFMEMORY                       TelemetrySnapshotMemory;
+    PSM5714_TELEMETRY_SNAPSHOT      TelemetrySnapshot;
+    ULONGLONG                       StatusCacheMaxAge;
+    volatile LONG64                 StatusCacheHits;
+    volatile LONG64                 StatusCacheMisses;
+
+    //
+    // Coulomb counter advanced with every telemetry sample, also guarded
+    // by TelemetryLock
+    //
+
+    SM5714_ENERGY_COUNTER           EnergyCounter;
+
+    //
+    // Filtered discharge rate behind BatteryEstimatedTime, also guarded by
+    // TelemetryLock
+    //
+
+    SM5714_DISCHARGE_RATE           DischargeRate;
+
+    //
+    // Battery class notification criteria, also guarded by TelemetryLock
+    //
+
+    SM5714_STATUS_NOTIFY            StatusNotify;
+
+    //
+    // Power state machine, also guarded by TelemetryLock
+    //
+
+    SM5714_POWER_STATE              PowerState;
+
+    //
+    // Charger interface of the PMIC driver, guarded by TelemetryLock.
+    // While connected its status stands in for the charger presence the
+    // class reports and for the averaged current. wdf.c finds the PMIC
+    // through a PnP notification and keeps it open as a remote target.
+    //
+
+    SM5714_PMIC_CHARGER_INTERFACE   Charger;
+    BOOLEAN                         ChargerConnected;
+    PVOID                           ChargerNotificationEntry;
+    WDFWORKITEM                     ChargerWorkItem;
+    WDFSTRING                       ChargerLink;
+    WDFIOTARGET                     ChargerTarget;
+
+    //
+    // Sampling mode, guarded by TelemetryLock. In low-power mode samples
+    // are taken every LowPowerSamplePeriodMs and readers accept samples up
+    // to twice that old.
+    //
+
+    SM5714_SAMPLING_MODE            SamplingMode;
+    ULONG                           LowPowerSamplePeriodMs;
+
+    //
+    // Background sampler: a periodic timer queueing a passive-level work
+    // item that reads the gauge into the telemetry ring. The PMIC driver
+    // queues the work item too when the charger changed; a change seen
+    // while the sampler is stopped stays pending until it starts again.
+    // SamplerLock orders that enqueue against the sampler stopping.
+    //
+
+    WDFTIMER                        SampleTimer;
+    WDFWORKITEM                     SampleWorkItem;
+    WDFWAITLOCK                     SamplerLock;
+    ULONG                           SamplePeriodMs;
+    volatile BOOLEAN                SamplerRunning;
+    volatile LONG                   ChargerChangePending;
+
+    //
+    // Fuel gauge alert interrupt (GpioInt), NULL when the BAT device
+    // declares none. The ISR collects the raw INTFG bits in PendingAlerts
+    // for its work item.
+    //
+
+    WDFINTERRUPT                    AlertInterrupt;
+    volatile LONG                   PendingAlerts;
+    volatile LONG64                 AlertCount;
 } SM5714_BATTERY_FDO_DATA, *PSM5714_BATTERY_FDO_DATA;
 
 //------------------------------------------------------ WDF Context Declaration
@@ -127,9 +324,143 @@ SM5714BatteryPrepareHardware(
     _In_ WDFDEVICE Device
 );
 
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SM5714BatteryRefreshCycleCount(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt
+);
+
 BCLASS_QUERY_TAG_CALLBACK SM5714BatteryQueryTag;
 BCLASS_QUERY_INFORMATION_CALLBACK SM5714BatteryQueryInformation;
 BCLASS_SET_INFORMATION_CALLBACK SM5714BatterySetInformation;
 BCLASS_QUERY_STATUS_CALLBACK SM5714BatteryQueryStatus;
 BCLASS_SET_STATUS_NOTIFY_CALLBACK SM5714BatterySetStatusNotify;
-BCLASS_DISABLE_STATUS_NOTIFY_CALLBACK SM5714BatteryDisableStatusNotify;
\ No newline at end of file
+BCLASS_DISABLE_STATUS_NOTIFY_CALLBACK SM5714BatteryDisableStatusNotify;
+
+//----------------------------------------------------------- Prototypes (wdf.c)
+
+SM5714_BATTERY_CHARGER_CHANGED SM5714BatteryChargerChanged;
+
+//--------------------------------------------- Prototypes (sm5714_telemetry.c)
+
+_IRQL_requires_(PASSIVE_LEVEL)
+NTSTATUS
+SM5714TelemetryCreateSnapshot(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt
+);
+
+SM5714_BATTERY_GET_TELEMETRY SM5714TelemetryInterfaceGetTelemetry;
+
+_IRQL_requires_(PASSIVE_LEVEL)
+NTSTATUS
+SM5714TelemetrySample(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt,
+    _Out_opt_ PSM5714_TELEMETRY_SAMPLE Sample
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+NTSTATUS
+SM5714TelemetryGetLatest(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt,
+    _Out_ PSM5714_TELEMETRY_SAMPLE Sample
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+BOOLEAN
+SM5714TelemetryGetDischarge(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt,
+    _Out_ PULONG Energy_mWh,
+    _Out_ PLONG Rate_mW,
+    _Out_ PBOOLEAN RateValid
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SM5714TelemetrySetSamplingMode(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt,
+    _In_ SM5714_SAMPLING_MODE Mode
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+ULONG
+SM5714TelemetrySamplePeriodMs(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SM5714TelemetryReset(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SM5714TelemetrySetStatusNotify(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt,
+    _In_opt_ PBATTERY_NOTIFY BatteryNotify
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SM5714TelemetryNotifyStatus(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt,
+    _In_ BOOLEAN Always
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SM5714TelemetrySetCharger(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt,
+    _In_ SM5714_CHARGER_PRESENCE Charger
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SM5714TelemetryConnectCharger(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt,
+    _In_opt_ const SM5714_PMIC_CHARGER_INTERFACE* Charger
+);
+
+//----------------------------------------------- Prototypes (sm5714_charger.c)
+
+_IRQL_requires_(PASSIVE_LEVEL)
+NTSTATUS
+SM5714ChargerCreate(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SM5714ChargerRegister(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SM5714ChargerUnregister(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt
+);
+
+//------------------------------------------------- Prototypes (sm5714_alert.c)
+
+_IRQL_requires_(PASSIVE_LEVEL)
+NTSTATUS
+SM5714AlertEnable(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+BOOLEAN
+SM5714AlertAcknowledge(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SM5714AlertProcess(
+    _In_ PSM5714_BATTERY_FDO_DATA DevExt
+);
+
+//-------------------------------------------------------------- Externs (Spb.c)
+
+extern const SM5714_BUS_OPS SpbBusOps;
@@ -35,16 +35,5 @@
 // Converts 8.8 fixed-point format into standard integer scaled by extend_orders
 #define FIXED_POINT_8_8_EXTEND_TO_INT(fp_value, extend_orders) ((((fp_value & 0xff00) >> 8) * extend_orders) + (((fp_value & 0xff) * extend_orders) / 256))
 
-// Read data register
-unsigned char readCmd = (unsigned char)SM5714_FG_REG_SRAM_RDATA;
-
-// 3 byte variables for passing to first SpbWriteRead sequence
-static const UCHAR write_state[3] = { (UCHAR)SM5714_FG_REG_SRAM_RADDR, (UCHAR)SM5714_FG_ADDR_SRAM_STATE, 0 };
-static const UCHAR write_cycle[3] = { (UCHAR)SM5714_FG_REG_SRAM_RADDR, (UCHAR)SM5714_FG_ADDR_SRAM_SOC_CYCLE, 0 };
-static const UCHAR write_temperature[3] = { (UCHAR)SM5714_FG_REG_SRAM_RADDR, (UCHAR)SM5714_FG_ADDR_SRAM_TEMPERATURE, 0 };
-static const UCHAR write_capacity[3] = { (UCHAR)SM5714_FG_REG_SRAM_RADDR, (UCHAR)SM5714_FG_ADDR_SRAM_SOC, 0 };
-static const UCHAR write_ocv[3] = { (UCHAR)SM5714_FG_REG_SRAM_RADDR, (UCHAR)SM5714_FG_ADDR_SRAM_OCV, 0 };
-static const UCHAR write_current[3] = { (UCHAR)SM5714_FG_REG_SRAM_RADDR, (UCHAR)SM5714_FG_ADDR_SRAM_CURRENT, 0 };
-
 #endif // SM5714BATTERY_REGS
 
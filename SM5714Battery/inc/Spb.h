@@ -22,11 +22,38 @@
 
 #include <wdm.h>
 #include <wdf.h>
+#include <spb.h>
 
 #define DEFAULT_SPB_BUFFER_SIZE 64
 
+//
+// Largest transfer list _SpbSequence can send, sized for the longest
+// SM5714_BUS_SEQUENCE the fuel gauge code issues
+//
+#define SPB_MAX_SEQUENCE_TRANSFERS 24
+
 #define SPB_POOL_TAG 'bpSB'
 
+//
+// Bus statistics of one SPB target. The counters are only touched with
+// interlocked operations, so they are updated as each sequence completes
+// and read at any IRQL without taking SpbLock. LatencyHistogram[n] counts
+// transfers that took [2^n, 2^(n+1)) us from send to completion; bucket 0
+// also takes the sub-microsecond ones and the last bucket everything
+// slower. The layout is the SM5714Battery_SpbStatistics WMI data block.
+//
+
+#define SPB_LATENCY_BUCKETS 16
+
+typedef struct _SPB_STATISTICS
+{
+	LONG64 Transactions;
+	LONG64 BytesTransferred;
+	LONG64 Errors;
+	LONG64 Timeouts;
+	LONG64 LatencyHistogram[SPB_LATENCY_BUCKETS];
+} SPB_STATISTICS;
+
 //
 // SPB (I2C) context
 //
@@ -38,8 +65,24 @@ typedef struct _SPB_CONTEXT
 	WDFMEMORY WriteMemory;
 	WDFMEMORY ReadMemory;
 	WDFWAITLOCK SpbLock;
+
+	//
+	// Request, transfer list and the WDFMEMORY describing it, created once
+	// in SpbTargetInitialize and reused for every sequence under SpbLock
+	//
+	WDFREQUEST SequenceRequest;
+	WDFMEMORY SequenceMemory;
+	SPB_TRANSFER_LIST_AND_ENTRIES(SPB_MAX_SEQUENCE_TRANSFERS) Sequence;
+
+	SPB_STATISTICS Statistics;
 } SPB_CONTEXT;
 
+VOID
+SpbGetStatistics(
+	_In_  SPB_CONTEXT* SpbContext,
+	_Out_ SPB_STATISTICS* Statistics
+);
+
 NTSTATUS
 SpbWriteRead(
 	_In_                            SPB_CONTEXT* SpbContext,
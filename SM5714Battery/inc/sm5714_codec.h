@@ -0,0 +1,88 @@
+/*++
+
+Module Name:
+
+	sm5714_codec.h
+
+Abstract:
+
+	Raw SRAM word codec of the SM5714 fuel gauge. Every field the driver
+	reads is described once by an SM5714_FG_FIELD and decoded with the same
+	shift-based fixed-point routine, in the driver and in host tools that
+	post-process recorded raw words.
+
+	The codec only needs the basic NT types, so it builds against the WDK
+	and against the host stand-in headers alike.
+
+--*/
+
+#pragma once
+
+//
+// Fields with a decoder. The order is the order of Sm5714FgFields.
+//
+
+typedef enum _SM5714_FG_FIELD_ID
+{
+	Sm5714FgFieldSoc,			// 0.1 %
+	Sm5714FgFieldOcv,			// mV
+	Sm5714FgFieldVbat,			// mV
+	Sm5714FgFieldCurrent,		// mA, negative while discharging
+	Sm5714FgFieldTemperature,	// 0.1 C
+	Sm5714FgFieldVbatAvg,		// mV
+	Sm5714FgFieldCurrentAvg,	// mA, negative while discharging
+	Sm5714FgFieldCount
+} SM5714_FG_FIELD_ID;
+
+//
+// A raw word is decoded as
+//
+//	magnitude = ((Raw & MagnitudeMask) * Scale) >> FractionBits
+//	value     = (Raw & SignMask) ? -magnitude : magnitude
+//
+// i.e. an unsigned fixed-point number with FractionBits fraction bits,
+// scaled to the output unit, with an optional sign-magnitude sign bit.
+// Bits outside MagnitudeMask and SignMask are ignored. MagnitudeMask * Scale
+// must fit in 32 bits.
+//
+
+typedef struct _SM5714_FG_FIELD
+{
+	UCHAR  SramAddress;
+	UCHAR  FractionBits;
+	USHORT MagnitudeMask;
+	USHORT SignMask;
+	USHORT Scale;
+} SM5714_FG_FIELD, *PSM5714_FG_FIELD;
+
+extern const SM5714_FG_FIELD Sm5714FgFields[Sm5714FgFieldCount];
+
+LONG
+sm5714_Codec_Decode(
+	SM5714_FG_FIELD_ID FieldId,
+	USHORT Raw
+);
+
+//
+// Integer part of the field in its native unit, without Scale (whole
+// degrees for the temperature, whole percent for the SoC)
+//
+
+LONG
+sm5714_Codec_DecodeWhole(
+	SM5714_FG_FIELD_ID FieldId,
+	USHORT Raw
+);
+
+//
+// Decodes Count raw words of one field. The loop is branch-free so the
+// compiler can vectorize it; results are identical to sm5714_Codec_Decode.
+//
+
+VOID
+sm5714_Codec_DecodeBatch(
+	SM5714_FG_FIELD_ID FieldId,
+	_In_reads_(Count) const USHORT* Raw,
+	ULONG Count,
+	_Out_writes_(Count) LONG* Values
+);
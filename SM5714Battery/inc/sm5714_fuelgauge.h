@@ -1,3 +1,54 @@
+//
+// Largest number of SRAM words sm5714_Read_Snapshot reads in one sequence
+//
+#define SM5714_FG_SNAPSHOT_MAX (SM5714_BUS_MAX_TRANSFERS / 3)
+
+NTSTATUS
+sm5714_Read_Snapshot(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	const UCHAR* Addresses,
+	ULONG Count,
+	PUSHORT RawValues
+);
+
+NTSTATUS
+sm5714_Read_Register(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	UCHAR Register,
+	PUSHORT Value
+);
+
+NTSTATUS
+sm5714_Write_Register(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	UCHAR Register,
+	USHORT Value
+);
+
+//
+// Decoders of the telemetry words, see Sm5714FgFields in sm5714_codec.c
+//
+
+LONG
+sm5714_Decode_Temperature(
+	USHORT rawTemp
+);
+
+ULONG
+sm5714_Decode_SoC(
+	USHORT rawCapacity
+);
+
+ULONG
+sm5714_Decode_Voltage(
+	USHORT rawOcv
+);
+
+LONG
+sm5714_Decode_Current(
+	USHORT rawCurr
+);
+
 
 NTSTATUS
 sm5714_Get_CycleCount(
@@ -0,0 +1,123 @@
+/*++
+
+Module Name:
+
+	sm5714_interface.h
+
+Abstract:
+
+	Direct-call interfaces between the SM5714 drivers. The battery driver
+	(fuel gauge) exports its newest sample to kernel consumers (thermal,
+	power meter, the PMIC driver) without an IRP per read; the PMIC driver
+	(charger) exports the charger status it read last, which the battery
+	driver uses in place of guessing from the current.
+
+	Both devices register a device interface of their GUID. A consumer
+	waits for it with IoRegisterPlugPlayNotification, opens it as a remote
+	I/O target and calls WdfIoTargetQueryForInterface once at
+	PASSIVE_LEVEL. The Get routines may then be called at IRQL <=
+	DISPATCH_LEVEL; they copy what the exporter published and never touch
+	the bus.
+
+	The interfaces are not reference counted. A consumer stops calling
+	them once the exporter's target is being removed.
+
+--*/
+
+#pragma once
+
+// {A511DAF1-DC3F-44E7-8138-2821E3C1480B}
+DEFINE_GUID(GUID_SM5714_BATTERY_TELEMETRY_INTERFACE,
+	0xa511daf1, 0xdc3f, 0x44e7, 0x81, 0x38, 0x28, 0x21, 0xe3, 0xc1, 0x48, 0x0b);
+
+#define SM5714_BATTERY_TELEMETRY_INTERFACE_VERSION	1
+
+typedef struct _SM5714_BATTERY_TELEMETRY
+{
+	ULONG     Version;		// Moves with every update of the record
+	BOOLEAN   Valid;		// FALSE until the first sample after a battery change
+	ULONGLONG Timestamp;	// KeQueryInterruptTime of the sample
+	ULONG     Capacity;		// SoC, 0.1 %
+	ULONG     Voltage;		// mV
+	LONG      Current;		// mA, negative while discharging
+	LONG      Temperature;	// 0.1 C
+	ULONG     Energy;		// mWh remaining
+	ULONG     PowerState;	// BATTERY_* flags
+	LONG      DischargeRate;	// mW, filtered, 0 until known
+} SM5714_BATTERY_TELEMETRY, *PSM5714_BATTERY_TELEMETRY;
+
+//
+// Copies the newest sample. Never waits for the bus or a lock: the record
+// is published by the sampler with a sequence count and the copy is
+// retried while an update is in progress.
+//
+
+typedef
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+SM5714_BATTERY_GET_TELEMETRY(
+	_In_ PVOID Context,
+	_Out_ PSM5714_BATTERY_TELEMETRY Telemetry
+);
+
+typedef SM5714_BATTERY_GET_TELEMETRY *PSM5714_BATTERY_GET_TELEMETRY;
+
+//
+// Called by the charger after its status changed, so the battery samples
+// right away instead of at its next period. The charger may hold its own
+// locks across the call, so the battery only queues the sample.
+//
+
+typedef
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SM5714_BATTERY_CHARGER_CHANGED(
+	_In_ PVOID Context
+);
+
+typedef SM5714_BATTERY_CHARGER_CHANGED *PSM5714_BATTERY_CHARGER_CHANGED;
+
+typedef struct _SM5714_BATTERY_TELEMETRY_INTERFACE
+{
+	INTERFACE InterfaceHeader;
+	PSM5714_BATTERY_GET_TELEMETRY GetTelemetry;
+	PSM5714_BATTERY_CHARGER_CHANGED ChargerChanged;
+} SM5714_BATTERY_TELEMETRY_INTERFACE, *PSM5714_BATTERY_TELEMETRY_INTERFACE;
+
+// {02A0D47C-31AF-43E0-8A13-D9D1C4D80E99}
+DEFINE_GUID(GUID_SM5714_PMIC_CHARGER_INTERFACE,
+	0x02a0d47c, 0x31af, 0x43e0, 0x8a, 0x13, 0xd9, 0xd1, 0xc4, 0xd8, 0x0e, 0x99);
+
+#define SM5714_PMIC_CHARGER_INTERFACE_VERSION	1
+
+typedef struct _SM5714_CHARGER_STATUS
+{
+	ULONG     Version;				// Moves with every update of the status
+	BOOLEAN   Valid;				// FALSE until the charger read its status
+	ULONGLONG Timestamp;			// KeQueryInterruptTime of the read
+	BOOLEAN   VbusPresent;			// Input power good
+	BOOLEAN   Charging;				// Charger is delivering current
+	BOOLEAN   Done;					// Charge terminated at the top-off current
+	ULONG     InputCurrentLimit;	// mA, as programmed
+	ULONG     ChargingCurrent;		// mA, as programmed
+} SM5714_CHARGER_STATUS, *PSM5714_CHARGER_STATUS;
+
+//
+// Copies the status the charger read last, lock free like GetTelemetry
+//
+
+typedef
+_IRQL_requires_max_(DISPATCH_LEVEL)
+VOID
+SM5714_PMIC_GET_CHARGER_STATUS(
+	_In_ PVOID Context,
+	_Out_ PSM5714_CHARGER_STATUS Status
+);
+
+typedef SM5714_PMIC_GET_CHARGER_STATUS *PSM5714_PMIC_GET_CHARGER_STATUS;
+
+typedef struct _SM5714_PMIC_CHARGER_INTERFACE
+{
+	INTERFACE InterfaceHeader;
+	PSM5714_PMIC_GET_CHARGER_STATUS GetChargerStatus;
+} SM5714_PMIC_CHARGER_INTERFACE, *PSM5714_PMIC_CHARGER_INTERFACE;
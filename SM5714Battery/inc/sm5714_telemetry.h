@@ -0,0 +1,205 @@
+/*++
+
+Module Name:
+
+	sm5714_telemetry.h
+
+Abstract:
+
+	Decoded fuel gauge samples kept in a fixed-size ring in the device
+	extension. The background sampler (wdf.c) fills the ring on its own
+	schedule; the battery class callbacks read from it.
+
+--*/
+
+#pragma once
+
+//
+// Ring capacity, must be a power of two
+//
+#define SM5714_TELEMETRY_RING_SIZE 64
+
+//
+// Normal sampling reads the instantaneous OCV and CURRENT words. Low-power
+// sampling reads the gauge's own averages (VBAT_AVG, CURRENT_AVG), which
+// stay steady over the long period between samples, in their place.
+//
+
+typedef enum _SM5714_SAMPLING_MODE
+{
+	Sm5714SamplingNormal,
+	Sm5714SamplingLowPower
+} SM5714_SAMPLING_MODE;
+
+typedef struct _SM5714_TELEMETRY_SAMPLE
+{
+	ULONGLONG Timestamp;	// KeQueryInterruptTime
+	ULONG     Capacity;		// SoC, 0.1 %
+	ULONG     Voltage;		// mV
+	LONG      Current;		// mA, negative while discharging
+	LONG      Temperature;	// 0.1 C
+	ULONG     Energy;		// mWh remaining, coulomb counted
+	ULONG     PowerState;	// BATTERY_* flags, debounced
+} SM5714_TELEMETRY_SAMPLE, *PSM5714_TELEMETRY_SAMPLE;
+
+typedef struct _SM5714_TELEMETRY_RING
+{
+	//
+	// Samples written since the last reset; the newest lives at
+	// Samples[(Count - 1) % SM5714_TELEMETRY_RING_SIZE]
+	//
+	ULONG Count;
+	SM5714_TELEMETRY_SAMPLE Samples[SM5714_TELEMETRY_RING_SIZE];
+} SM5714_TELEMETRY_RING, *PSM5714_TELEMETRY_RING;
+
+//
+// Newest sample with what readers need to judge it, republished under
+// TelemetryLock whenever one of them changes. Sequence is odd while an
+// update is in progress; readers copy the record without a lock and retry
+// when Sequence moved under them, so a sampler stuck on the bus never
+// holds up a status query. The snapshot lives in its own cache line of
+// nonpaged memory and can be read at DISPATCH_LEVEL, which is what the
+// direct-call interface (sm5714_interface.h) hands out.
+//
+
+typedef struct _SM5714_TELEMETRY_RECORD
+{
+	BOOLEAN   Valid;		// Sample holds the newest sample since the last reset
+	BOOLEAN   RateValid;	// Rate is seeded
+	SM5714_SAMPLING_MODE Mode;
+	LONG      Rate;			// mW, filtered discharge rate
+	SM5714_TELEMETRY_SAMPLE Sample;
+} SM5714_TELEMETRY_RECORD, *PSM5714_TELEMETRY_RECORD;
+
+typedef struct DECLSPEC_CACHEALIGN _SM5714_TELEMETRY_SNAPSHOT
+{
+	volatile LONG Sequence;
+	SM5714_TELEMETRY_RECORD Record;
+} SM5714_TELEMETRY_SNAPSHOT, *PSM5714_TELEMETRY_SNAPSHOT;
+
+C_ASSERT(sizeof(SM5714_TELEMETRY_SNAPSHOT) == SYSTEM_CACHE_ALIGNMENT_SIZE);
+
+//
+// Remaining energy integrated from voltage and current between samples
+// (trapezoidal, in uW * 100 ns), so the reported capacity moves with the
+// load rather than in whole SoC register steps. The integral is anchored
+// to SoC * FullChargedCapacity when there is no usable previous sample,
+// after a sampling gap longer than SM5714_ENERGY_MAX_GAP (or two low-power
+// sample periods in that mode), when it drifts more than
+// SM5714_ENERGY_MAX_DRIFT_PERMILLE of the full charge away from the
+// gauge, and once the battery has rested (|current| within
+// SM5714_ENERGY_REST_CURRENT_MA) for SM5714_ENERGY_REST_SETTLE, when the
+// gauge SoC is at its most accurate.
+//
+
+#define SM5714_ENERGY_REST_CURRENT_MA		20
+#define SM5714_ENERGY_REST_SETTLE			(120ULL * 10000000ULL)
+#define SM5714_ENERGY_MAX_GAP				(30ULL * 10000000ULL)
+#define SM5714_ENERGY_MAX_DRIFT_PERMILLE	30
+
+//
+// uW * 100 ns in one mWh
+//
+#define SM5714_ENERGY_UNITS_PER_MWH			36000000000000LL
+
+typedef struct _SM5714_ENERGY_COUNTER
+{
+	LONGLONG  Energy;		// uW * 100 ns
+	BOOLEAN   Resting;
+	BOOLEAN   RestAnchored;	// Already anchored during this rest
+	ULONGLONG RestSince;	// Timestamp of the first sample of the rest
+	ULONG     Anchors;
+} SM5714_ENERGY_COUNTER, *PSM5714_ENERGY_COUNTER;
+
+//
+// Discharge power filtered with an exponential moving average of time
+// constant SM5714_DISCHARGE_RATE_TAU, for BatteryEstimatedTime. The filter
+// is seeded from the gauge's own averaged current (CURRENT_AVG) on the
+// first sample and after a gap longer than SM5714_ENERGY_MAX_GAP, so the
+// estimate does not start from a single instantaneous reading.
+//
+
+#define SM5714_DISCHARGE_RATE_TAU			(60ULL * 10000000ULL)
+
+//
+// Filtered rates below this are reported as an unknown time
+//
+#define SM5714_DISCHARGE_RATE_MIN_MW		10
+
+typedef struct _SM5714_DISCHARGE_RATE
+{
+	LONGLONG  Rate;			// uW, positive while discharging
+	ULONGLONG Updated;		// Timestamp of the last sample filtered in
+	BOOLEAN   Seeded;
+} SM5714_DISCHARGE_RATE, *PSM5714_DISCHARGE_RATE;
+
+//
+// Power state reported by QueryStatus, worked out with every sample from
+// the charger presence the battery class reports and the averaged
+// current. The current is averaged over SM5714_POWER_CURRENT_TAU,
+// starting from the gauge's CURRENT_AVG. Within
+// +/-SM5714_POWER_CHARGING_CURRENT_MA and without charger information
+// the last direction holds. A new direction is only
+// reported once SM5714_POWER_STATE_DEBOUNCE consecutive samples agree on
+// it, or right away when the charger presence changed. BATTERY_CRITICAL
+// is set while discharging at SM5714_POWER_CRITICAL_SOC or less and
+// cleared above SM5714_POWER_CRITICAL_CLEAR_SOC.
+//
+
+#define SM5714_POWER_CURRENT_TAU			(10ULL * 10000000ULL)
+#define SM5714_POWER_CHARGING_CURRENT_MA	20
+#define SM5714_POWER_STATE_DEBOUNCE			2
+#define SM5714_POWER_CRITICAL_SOC			30		// 0.1 %
+#define SM5714_POWER_CRITICAL_CLEAR_SOC		40		// 0.1 %
+
+//
+// First sample without charger information inside the band: the battery
+// is taken to be on line from this charge current up
+//
+
+#define SM5714_POWER_ON_LINE_CURRENT_MA		8
+
+typedef enum _SM5714_CHARGER_PRESENCE
+{
+	Sm5714ChargerUnknown,
+	Sm5714ChargerAbsent,
+	Sm5714ChargerPresent
+} SM5714_CHARGER_PRESENCE;
+
+typedef struct _SM5714_POWER_STATE
+{
+	ULONG     State;			// BATTERY_* flags
+	ULONG     Candidate;		// Direction the recent samples point to
+	ULONG     CandidateSamples;
+	LONG      AverageCurrent;	// mA
+	ULONGLONG Updated;			// Timestamp of the last sample
+	SM5714_CHARGER_PRESENCE Charger;	// As last reported
+	SM5714_CHARGER_PRESENCE Applied;	// As State was worked out with
+	BOOLEAN   Valid;
+	ULONG     Transitions;
+} SM5714_POWER_STATE, *PSM5714_POWER_STATE;
+
+//
+// Status notification criteria set by the battery class, checked against
+// every sample. A change of power state or a capacity outside
+// [LowCapacity, HighCapacity] disarms them until the class sets new ones.
+// Once a threshold was reported crossed, the capacity has to come back
+// across it by SM5714_STATUS_NOTIFY_HYSTERESIS_PERMILLE of the full charge
+// before that threshold is reported again, so a reading wandering around
+// it does not notify every time the class re-arms.
+//
+
+#define SM5714_STATUS_NOTIFY_HYSTERESIS_PERMILLE	2
+
+typedef struct _SM5714_STATUS_NOTIFY
+{
+	BOOLEAN   Armed;
+	BOOLEAN   Pending;		// Crossed, the class has not been told yet
+	BOOLEAN   Outside;		// Crossed is reported, not crossed back yet
+	BOOLEAN   Below;		// Crossed is a LowCapacity, else a HighCapacity
+	ULONG     Crossed;		// mWh
+	ULONG     PowerState;
+	ULONG     LowCapacity;	// mWh
+	ULONG     HighCapacity;	// mWh
+	ULONG     Notifications;
+} SM5714_STATUS_NOTIFY, *PSM5714_STATUS_NOTIFY;
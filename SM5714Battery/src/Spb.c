@@ -22,14 +22,75 @@
 
 --*/
 
-#include "..\inc\SM5714Battery.h"
-#include "..\inc\Spb.h"
+#include "../inc/SM5714Battery.h"
+#include "../inc/Spb.h"
 #include <spb.tmh>
 #include <reshub.h>
 #include <spb.h>
 
 #define I2C_VERBOSE_LOGGING 0
 
+static
+NTSTATUS
+_SpbSequence(
+	_In_                        SPB_CONTEXT* SpbContext,
+	_In_                        ULONG        TransferCount,
+	_In_                        ULONG        Timeout
+);
+
+static
+VOID
+SpbRecordTransfer(
+	_In_ SPB_CONTEXT* SpbContext,
+	_In_ NTSTATUS     Status,
+	_In_ ULONG        BytesTransferred,
+	_In_ ULONGLONG    SendTime
+)
+/*++
+
+  Routine Description:
+
+	This helper routine accounts one completed transfer in
+	SpbContext->Statistics. Callable at IRQL <= DISPATCH_LEVEL.
+
+  Arguments:
+
+	SpbContext       - Pointer to the current device context
+	Status           - Final status of the transfer
+	BytesTransferred - Bytes the controller reported moved over the bus
+	SendTime         - Interrupt time at which the transfer was sent
+
+  Return Value:
+
+	None
+
+--*/
+{
+	SPB_STATISTICS* statistics = &SpbContext->Statistics;
+	ULONGLONG latencyUs = (KeQueryInterruptTime() - SendTime) / 10;
+	ULONG bucket = 0;
+
+	while (latencyUs > 1 && bucket < SPB_LATENCY_BUCKETS - 1)
+	{
+		latencyUs >>= 1;
+		bucket++;
+	}
+
+	InterlockedIncrement64(&statistics->Transactions);
+	InterlockedAdd64(&statistics->BytesTransferred, BytesTransferred);
+	InterlockedIncrement64(&statistics->LatencyHistogram[bucket]);
+
+	if (!NT_SUCCESS(Status))
+	{
+		InterlockedIncrement64(&statistics->Errors);
+
+		if (Status == STATUS_IO_TIMEOUT)
+		{
+			InterlockedIncrement64(&statistics->Timeouts);
+		}
+	}
+}
+
 NTSTATUS
 SpbDoWriteDataSynchronously(
 	IN SPB_CONTEXT* SpbContext,
@@ -61,6 +122,8 @@ SpbDoWriteDataSynchronously(
 	ULONG length;
 	WDFMEMORY memory;
 	WDF_MEMORY_DESCRIPTOR memoryDescriptor;
+	ULONG_PTR bytesWritten = 0;
+	ULONGLONG sendTime;
 	NTSTATUS status;
 
 	//
@@ -78,7 +141,7 @@ SpbDoWriteDataSynchronously(
 			SPB_POOL_TAG,
 			length,
 			&memory,
-			&buffer);
+			(PVOID*)&buffer);
 
 		if (!NT_SUCCESS(status))
 		{
@@ -125,13 +188,17 @@ SpbDoWriteDataSynchronously(
 	DbgPrintEx(DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "\n");
 #endif
 
+	sendTime = KeQueryInterruptTime();
+
 	status = WdfIoTargetSendWriteSynchronously(
 		SpbContext->SpbIoTarget,
 		NULL,
 		&memoryDescriptor,
 		NULL,
 		NULL,
-		NULL);
+		&bytesWritten);
+
+	SpbRecordTransfer(SpbContext, status, (ULONG)bytesWritten, sendTime);
 
 	if (!NT_SUCCESS(status))
 	{
@@ -208,7 +275,8 @@ SpbReadDataSynchronously(
   Routine Description:
 
 	This helper routine abstracts creating and sending an I/O
-	request (I2C Read) to the Spb I/O target.
+	request (I2C Read) to the Spb I/O target. The address pointer write
+	and the read are sent as one sequence, joined by a repeated start.
 
   Arguments:
 
@@ -223,36 +291,14 @@ SpbReadDataSynchronously(
 
 --*/
 {
+	PUCHAR addressBuffer;
 	PUCHAR buffer;
 	WDFMEMORY memory;
-	WDF_MEMORY_DESCRIPTOR memoryDescriptor;
 	NTSTATUS status;
-	ULONG_PTR bytesRead;
 
 	WdfWaitLockAcquire(SpbContext->SpbLock, NULL);
 
 	memory = NULL;
-	status = STATUS_INVALID_PARAMETER;
-	bytesRead = 0;
-
-	//
-	// Read transactions start by writing an address pointer
-	//
-	status = SpbDoWriteDataSynchronously(
-		SpbContext,
-		Address,
-		NULL,
-		0);
-
-	if (!NT_SUCCESS(status))
-	{
-		Trace(
-			TRACE_LEVEL_ERROR,
-			SM5714_BATTERY_ERROR,
-			"Error setting address pointer for Spb read - 0x%08lX",
-			status);
-		goto exit;
-	}
 
 	if (Length > DEFAULT_SPB_BUFFER_SIZE)
 	{
@@ -262,7 +308,7 @@ SpbReadDataSynchronously(
 			SPB_POOL_TAG,
 			Length,
 			&memory,
-			&buffer);
+			(PVOID*)&buffer);
 
 		if (!NT_SUCCESS(status))
 		{
@@ -273,33 +319,39 @@ SpbReadDataSynchronously(
 				status);
 			goto exit;
 		}
-
-		WDF_MEMORY_DESCRIPTOR_INIT_HANDLE(
-			&memoryDescriptor,
-			memory,
-			NULL);
 	}
 	else
 	{
 		buffer = (PUCHAR)WdfMemoryGetBuffer(SpbContext->ReadMemory, NULL);
+	}
 
-		WDF_MEMORY_DESCRIPTOR_INIT_BUFFER(
-			&memoryDescriptor,
-			(PVOID)buffer,
+	//
+	// Read transactions start by writing an address pointer
+	//
+	addressBuffer = (PUCHAR)WdfMemoryGetBuffer(SpbContext->WriteMemory, NULL);
+	RtlCopyMemory(addressBuffer, &Address, sizeof(Address));
+
+	PSPB_TRANSFER_LIST sequence = &(SpbContext->Sequence.List);
+
+	{
+		ULONG index = 0;
+
+		sequence->Transfers[index] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
+			SpbTransferDirectionToDevice,
+			0,
+			addressBuffer,
+			sizeof(Address));
+
+		sequence->Transfers[index + 1] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
+			SpbTransferDirectionFromDevice,
+			0,
+			buffer,
 			Length);
 	}
 
+	status = _SpbSequence(SpbContext, 2, 0);
 
-	status = WdfIoTargetSendReadSynchronously(
-		SpbContext->SpbIoTarget,
-		NULL,
-		&memoryDescriptor,
-		NULL,
-		NULL,
-		&bytesRead);
-
-	if (!NT_SUCCESS(status) ||
-		bytesRead != Length)
+	if (!NT_SUCCESS(status))
 	{
 		Trace(
 			TRACE_LEVEL_ERROR,
@@ -335,23 +387,24 @@ exit:
 	return status;
 }
 
+static
 NTSTATUS
 _SpbSequence(
 	_In_                        SPB_CONTEXT* SpbContext,
-	_In_reads_(SequenceLength)  PVOID        Sequence,
-	_In_                        SIZE_T       SequenceLength,
-	_Out_                       PULONG       BytesReturned,
+	_In_                        ULONG        TransferCount,
 	_In_                        ULONG        Timeout
 )
 /*++
 
   Routine Description:
-	This routine forwards a sequence request to the SPB I/O target
+	This routine forwards the transfer list built in SpbContext->Sequence
+	to the SPB I/O target, reusing the request and memory objects created
+	by SpbTargetInitialize, and accounts it in the bus statistics. A short
+	transfer is reported as STATUS_DEVICE_PROTOCOL_ERROR. The caller must
+	hold SpbLock.
   Arguments:
-	FxIoTarget      - The SPB IoTarget to which to send the IOCTL/Read/Write
-	Sequence        - Pointer to a list of sequence transfers
-	SequenceLength  - Length of sequence transfers
-	BytesReturned   - The number of bytes transferred in the actual transaction
+	SpbContext      - Pointer to the current device context
+	TransferCount   - Number of entries filled in SpbContext->Sequence
 	Timeout         - The timeout associated with this transfer
 						Default is HIDI2C_REQUEST_DEFAULT_TIMEOUT second
 						0 means no timeout
@@ -359,81 +412,88 @@ _SpbSequence(
 	NTSTATUS Status indicating success or failure
 --*/
 {
+	PSPB_TRANSFER_LIST sequence = &(SpbContext->Sequence.List);
+	ULONG expectedLength = 0;
+	ULONG_PTR bytes = 0;
+	ULONGLONG sendTime;
 	NTSTATUS status;
 
-	WdfWaitLockAcquire(SpbContext->SpbLock, NULL);
+	NT_ASSERT(TransferCount != 0 && TransferCount <= SPB_MAX_SEQUENCE_TRANSFERS);
+
+	SPB_TRANSFER_LIST_INIT(sequence, TransferCount);
+
+	for (ULONG index = 0; index < TransferCount; index++)
+	{
+		expectedLength += sequence->Transfers[index].Buffer.Simple.BufferCb;
+	}
 
 	//
-	// Create preallocated WDFMEMORY.
+	// Describe only the entries in use; the controller checks the input
+	// length against TransferCount.
 	//
-	WDFMEMORY memorySequence = NULL;
+	WDFMEMORY_OFFSET sequenceOffsets;
+	sequenceOffsets.BufferOffset = 0;
+	sequenceOffsets.BufferLength = FIELD_OFFSET(SPB_TRANSFER_LIST, Transfers) +
+		TransferCount * sizeof(SPB_TRANSFER_LIST_ENTRY);
 
-	WDF_OBJECT_ATTRIBUTES attributes;
-	WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+	WDF_MEMORY_DESCRIPTOR memoryDescriptor;
+	WDF_MEMORY_DESCRIPTOR_INIT_HANDLE(
+		&memoryDescriptor,
+		SpbContext->SequenceMemory,
+		&sequenceOffsets);
 
-	status = WdfMemoryCreatePreallocated(
-		&attributes,
-		Sequence,
-		SequenceLength,
-		&memorySequence);
+	//
+	// The request was sent before, reinitialize it for this sequence
+	//
+	WDF_REQUEST_REUSE_PARAMS reuseParams;
+	WDF_REQUEST_REUSE_PARAMS_INIT(&reuseParams, WDF_REQUEST_REUSE_NO_FLAGS, STATUS_SUCCESS);
+
+	status = WdfRequestReuse(SpbContext->SequenceRequest, &reuseParams);
 
 	if (!NT_SUCCESS(status))
 	{
 		Trace(
 			TRACE_LEVEL_ERROR,
 			SM5714_BATTERY_ERROR,
-			"WdfMemoryCreatePreallocated failed creating memory for sequence"
+			"WdfRequestReuse failed for sequence request "
 			"status:%!STATUS!",
 			status);
 
-		goto exit;
+		return status;
 	}
 
-	WDF_MEMORY_DESCRIPTOR memoryDescriptor;
-	WDF_MEMORY_DESCRIPTOR_INIT_HANDLE(
-		&memoryDescriptor,
-		memorySequence,
-		NULL);
-
-	ULONG_PTR bytes = 0;
-
-	if (Timeout == 0)
-	{
-		//
-		// Send the SPB sequence IOCTL without a timeout set
-		//
+	WDF_REQUEST_SEND_OPTIONS sendOptions;
+	PWDF_REQUEST_SEND_OPTIONS options = NULL;
 
-		status = WdfIoTargetSendIoctlSynchronously(
-			SpbContext->SpbIoTarget,
-			NULL,
-			IOCTL_SPB_EXECUTE_SEQUENCE,
-			&memoryDescriptor,
-			NULL,
-			NULL,
-			&bytes);
-	}
-	else
+	if (Timeout != 0)
 	{
 		//
 		// Set a request timeout
 		//
-		WDF_REQUEST_SEND_OPTIONS sendOptions;
 		WDF_REQUEST_SEND_OPTIONS_INIT(&sendOptions, WDF_REQUEST_SEND_OPTION_TIMEOUT);
 		sendOptions.Timeout = WDF_REL_TIMEOUT_IN_SEC(Timeout);
+		options = &sendOptions;
+	}
 
-		//
-		// Send the SPB sequence IOCTL.
-		//
+	//
+	// Send the SPB sequence IOCTL.
+	//
 
-		status = WdfIoTargetSendIoctlSynchronously(
-			SpbContext->SpbIoTarget,
-			NULL,
-			IOCTL_SPB_EXECUTE_SEQUENCE,
-			&memoryDescriptor,
-			NULL,
-			&sendOptions,
-			&bytes);
-	}
+	sendTime = KeQueryInterruptTime();
+
+	status = WdfIoTargetSendIoctlSynchronously(
+		SpbContext->SpbIoTarget,
+		SpbContext->SequenceRequest,
+		IOCTL_SPB_EXECUTE_SEQUENCE,
+		&memoryDescriptor,
+		NULL,
+		options,
+		&bytes);
+
+	//
+	// The controller needs to support querying for actual bytes
+	// for each transaction
+	//
 
 	if (!NT_SUCCESS(status))
 	{
@@ -443,22 +503,22 @@ _SpbSequence(
 			"Failed sending SPB Sequence IOCTL bytes:%lu status:%!STATUS!",
 			(ULONG)bytes,
 			status);
-
-		goto exit;
+	}
+	else if (bytes < expectedLength)
+	{
+		status = STATUS_DEVICE_PROTOCOL_ERROR;
+		Trace(
+			TRACE_LEVEL_ERROR,
+			SM5714_BATTERY_ERROR,
+			"SpbSequence returned with 0x%lu bytes expected:0x%lu bytes "
+			"status:%!STATUS!",
+			(ULONG)bytes,
+			expectedLength,
+			status);
 	}
 
-	//
-	// Copy the number of bytes transmitted over the bus
-	// The controller needs to support querying for actual bytes
-	// for each transaction
-	//
-
-	*BytesReturned = (ULONG)bytes;
-
-exit:
+	SpbRecordTransfer(SpbContext, status, (ULONG)bytes, sendTime);
 
-	WdfWaitLockRelease(SpbContext->SpbLock);
-	WdfObjectDelete(memorySequence);
 	return status;
 }
 
@@ -501,10 +561,12 @@ SpbWriteRead(
 	//BufferListFirst[0].BufferCb = SendLength;
 
 	//
-	// Build the SPB sequence
+	// Build the SPB sequence in the context; it stays in use until
+	// _SpbSequence returns, so hold SpbLock across both.
 	//
-	SPB_TRANSFER_LIST_AND_ENTRIES(3)    sequence;
-	SPB_TRANSFER_LIST_INIT(&(sequence.List), 3);
+	WdfWaitLockAcquire(SpbContext->SpbLock, NULL);
+
+	PSPB_TRANSFER_LIST sequence = &(SpbContext->Sequence.List);
 
 	{
 		//
@@ -515,19 +577,19 @@ SpbWriteRead(
 
 		ULONG index = 0;
 
-		sequence.List.Transfers[index] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
+		sequence->Transfers[index] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
 			SpbTransferDirectionToDevice,
 			0,
 			SendData,
 			SendLength);
 
-		sequence.List.Transfers[index + 1] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
+		sequence->Transfers[index + 1] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
 			SpbTransferDirectionToDevice,
 			0,
 			ReadCmd,
 			CmdLength);
 
-		sequence.List.Transfers[index + 2] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
+		sequence->Transfers[index + 2] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
 			SpbTransferDirectionFromDevice,
 			DelayUs,
 			Data,
@@ -557,8 +619,9 @@ SpbWriteRead(
 	//
 	// Send the read as a Sequence request to the SPB target
 	// 
-	ULONG bytesReturned = 0;
-	status = _SpbSequence(SpbContext, &sequence, sizeof(sequence), &bytesReturned, 100);
+	status = _SpbSequence(SpbContext, 3, 100);
+
+	WdfWaitLockRelease(SpbContext->SpbLock);
 
 	if (!NT_SUCCESS(status))
 	{
@@ -583,31 +646,152 @@ SpbWriteRead(
 	DbgPrintEx(DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "\n");
 #endif
 
-	//
-	// Check if this is a "short transaction" i.e. the sequence
-	// resulted in lesser bytes transmitted/received than expected
-	//
-	ULONG expectedLength = SendLength + DataLength;
-	if (bytesReturned < expectedLength)
+exit:
+
+	return status;
+}
+
+static
+NTSTATUS
+SpbBusWriteRead(
+	_In_                            PVOID           BusContext,
+	_In_reads_(SendLength)          PVOID           SendData,
+	_In_                            USHORT          SendLength,
+	_In_reads_(CmdLength)			PVOID			ReadCmd,
+	_In_							USHORT			CmdLength,
+	_Out_writes_(DataLength)        PVOID           Data,
+	_In_                            USHORT          DataLength,
+	_In_                            ULONG           DelayUs
+)
+/*++
+
+  Routine Description:
+	SM5714_BUS_OPS adapter forwarding to SpbWriteRead
+  Arguments:
+	BusContext      -       Pointer to the SPB_CONTEXT bound to the bus
+	Remaining arguments are passed through unchanged
+  Return Value:
+	NTSTATUS Status indicating success or failure
+--*/
+{
+	return SpbWriteRead(
+		(SPB_CONTEXT*)BusContext,
+		SendData,
+		SendLength,
+		ReadCmd,
+		CmdLength,
+		Data,
+		DataLength,
+		DelayUs);
+}
+
+static
+NTSTATUS
+SpbBusSequence(
+	_In_                            PVOID                       BusContext,
+	_In_reads_(TransferCount)       const SM5714_BUS_TRANSFER*  Transfers,
+	_In_                            ULONG                       TransferCount
+)
+/*++
+
+  Routine Description:
+	SM5714_BUS_OPS adapter sending a list of transfers to the SPB I/O
+	target as a single IOCTL_SPB_EXECUTE_SEQUENCE
+  Arguments:
+	BusContext      -       Pointer to the SPB_CONTEXT bound to the bus
+	Transfers               The transfers, in bus order
+	TransferCount           Number of transfers, at most SM5714_BUS_MAX_TRANSFERS
+  Return Value:
+	NTSTATUS Status indicating success or failure
+--*/
+{
+	SPB_CONTEXT* SpbContext = (SPB_CONTEXT*)BusContext;
+	NTSTATUS status;
+
+	NT_ASSERT(KeGetCurrentIrql() == PASSIVE_LEVEL);
+
+	if (TransferCount == 0 || TransferCount > SM5714_BUS_MAX_TRANSFERS)
+	{
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	WdfWaitLockAcquire(SpbContext->SpbLock, NULL);
+
+	PSPB_TRANSFER_LIST sequence = &(SpbContext->Sequence.List);
+
+	for (ULONG index = 0; index < TransferCount; index++)
+	{
+		sequence->Transfers[index] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
+			Transfers[index].Read ? SpbTransferDirectionFromDevice : SpbTransferDirectionToDevice,
+			Transfers[index].DelayUs,
+			Transfers[index].Buffer,
+			Transfers[index].Length);
+	}
+
+	status = _SpbSequence(SpbContext, TransferCount, 100);
+
+	WdfWaitLockRelease(SpbContext->SpbLock);
+
+	if (!NT_SUCCESS(status))
 	{
-		status = STATUS_DEVICE_PROTOCOL_ERROR;
 		Trace(
 			TRACE_LEVEL_ERROR,
 			SM5714_BATTERY_ERROR,
-			"SpbSequence returned with 0x%lu bytes expected:0x%lu bytes "
+			"SpbSequence failed sending a %lu entry sequence "
 			"status:%!STATUS!",
-			bytesReturned,
-			expectedLength,
+			TransferCount,
 			status);
-
-		goto exit;
 	}
 
-exit:
-
 	return status;
 }
 
+C_ASSERT(SM5714_BUS_MAX_TRANSFERS <= SPB_MAX_SEQUENCE_TRANSFERS);
+
+const SM5714_BUS_OPS SpbBusOps =
+{
+	SpbBusWriteRead,
+	SpbBusSequence
+};
+
+VOID
+SpbGetStatistics(
+	_In_  SPB_CONTEXT* SpbContext,
+	_Out_ SPB_STATISTICS* Statistics
+)
+/*++
+
+  Routine Description:
+
+	This routine copies the bus statistics of the SPB target. Each counter
+	is read atomically but the copy is not a consistent snapshot of all of
+	them; transfers completing meanwhile may be partially included.
+	Callable at IRQL <= DISPATCH_LEVEL.
+
+  Arguments:
+
+	SpbContext - Pointer to the current device context
+	Statistics - Receives the counters
+
+  Return Value:
+
+	None
+
+--*/
+{
+	SPB_STATISTICS* counters = &SpbContext->Statistics;
+
+	Statistics->Transactions = ReadNoFence64(&counters->Transactions);
+	Statistics->BytesTransferred = ReadNoFence64(&counters->BytesTransferred);
+	Statistics->Errors = ReadNoFence64(&counters->Errors);
+	Statistics->Timeouts = ReadNoFence64(&counters->Timeouts);
+
+	for (ULONG bucket = 0; bucket < SPB_LATENCY_BUCKETS; bucket++)
+	{
+		Statistics->LatencyHistogram[bucket] = ReadNoFence64(&counters->LatencyHistogram[bucket]);
+	}
+}
+
 VOID
 SpbTargetDeinitialize(
 	IN WDFDEVICE FxDevice,
@@ -638,6 +822,16 @@ SpbTargetDeinitialize(
 	//
 	// Free any SPB_CONTEXT allocations here
 	//
+	if (SpbContext->SequenceRequest != NULL)
+	{
+		WdfObjectDelete(SpbContext->SequenceRequest);
+	}
+
+	if (SpbContext->SequenceMemory != NULL)
+	{
+		WdfObjectDelete(SpbContext->SequenceMemory);
+	}
+
 	if (SpbContext->SpbLock != NULL)
 	{
 		WdfObjectDelete(SpbContext->SpbLock);
@@ -802,6 +996,48 @@ SpbTargetInitialize(
 		goto exit;
 	}
 
+	//
+	// Create the request and the memory object over SpbContext->Sequence
+	// that every sequence is sent with, so the read path does not allocate
+	// framework objects per transaction
+	//
+	WDF_OBJECT_ATTRIBUTES_INIT(&objectAttributes);
+	objectAttributes.ParentObject = SpbContext->SpbIoTarget;
+
+	status = WdfRequestCreate(
+		&objectAttributes,
+		SpbContext->SpbIoTarget,
+		&SpbContext->SequenceRequest);
+
+	if (!NT_SUCCESS(status))
+	{
+		Trace(
+			TRACE_LEVEL_ERROR,
+			SM5714_BATTERY_ERROR,
+			"Error creating Spb sequence request - 0x%08lX",
+			status);
+		goto exit;
+	}
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&objectAttributes);
+	objectAttributes.ParentObject = FxDevice;
+
+	status = WdfMemoryCreatePreallocated(
+		&objectAttributes,
+		&SpbContext->Sequence,
+		sizeof(SpbContext->Sequence),
+		&SpbContext->SequenceMemory);
+
+	if (!NT_SUCCESS(status))
+	{
+		Trace(
+			TRACE_LEVEL_ERROR,
+			SM5714_BATTERY_ERROR,
+			"Error creating Spb sequence memory - 0x%08lX",
+			status);
+		goto exit;
+	}
+
 exit:
 
 	if (!NT_SUCCESS(status))
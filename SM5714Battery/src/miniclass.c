@@ -17,10 +17,11 @@ Abstract:
 
 //--------------------------------------------------------------------- Includes
 
-#include "..\inc\SM5714Battery.h"
+#include "../inc/SM5714Battery.h"
 #include "usbfnbase.h"
 #include "miniclass.tmh"
-#include "..\inc\sm5714_fuelgauge.h"
+#include "../inc/SM5714Battery_regs.h"
+#include "../inc/sm5714_fuelgauge.h"
 
 //------------------------------------------------------------------- Prototypes
 
@@ -30,6 +31,20 @@ SM5714BatteryUpdateTag(
 	_Inout_ PSM5714_BATTERY_FDO_DATA DevExt
 );
 
+static
+VOID
+SM5714BatteryBuildInformation(
+	_Inout_ PSM5714_BATTERY_FDO_DATA DevExt,
+	_In_ ULONG CycleCount
+);
+
+static
+BOOLEAN
+SM5714BatteryTagMatches(
+	_In_ PSM5714_BATTERY_FDO_DATA DevExt,
+	_In_ ULONG BatteryTag
+);
+
 BCLASS_QUERY_TAG_CALLBACK SM5714BatteryQueryTag;
 BCLASS_QUERY_INFORMATION_CALLBACK SM5714BatteryQueryInformation;
 BCLASS_SET_INFORMATION_CALLBACK SM5714BatterySetInformation;
@@ -41,6 +56,8 @@ BCLASS_DISABLE_STATUS_NOTIFY_CALLBACK SM5714BatteryDisableStatusNotify;
 
 #pragma alloc_text(PAGE, SM5714BatteryPrepareHardware)
 #pragma alloc_text(PAGE, SM5714BatteryUpdateTag)
+#pragma alloc_text(PAGE, SM5714BatteryRefreshCycleCount)
+#pragma alloc_text(PAGE, SM5714BatteryTagMatches)
 #pragma alloc_text(PAGE, SM5714BatteryQueryTag)
 #pragma alloc_text(PAGE, SM5714BatteryQueryInformation)
 #pragma alloc_text(PAGE, SM5714BatteryQueryStatus)
@@ -74,6 +91,7 @@ Return Value:
 {
 
 	PSM5714_BATTERY_FDO_DATA DevExt;
+	ULONG CycleCount = 0;
 	NTSTATUS Status = STATUS_SUCCESS;
 
 	PAGED_CODE();
@@ -81,8 +99,16 @@ Return Value:
 
 	DevExt = GetDeviceExtension(Device);
 
+	//
+	// Read outside StateLock like any other bus access. A failed read
+	// leaves the count at 0 until the next sampler or alert pass retries it.
+	//
+
+	Status = sm5714_Get_CycleCount(DevExt, &CycleCount);
+	InterlockedExchange(&DevExt->CycleCountStale, NT_SUCCESS(Status) ? FALSE : TRUE);
 
 	WdfWaitLockAcquire(DevExt->StateLock, NULL);
+	SM5714BatteryBuildInformation(DevExt, CycleCount);
 	SM5714BatteryUpdateTag(DevExt);
 	WdfWaitLockRelease(DevExt->StateLock);
 
@@ -116,6 +142,8 @@ Return Value:
 
 	PAGED_CODE();
 
+	SM5714TelemetryReset(DevExt);
+
 	DevExt->BatteryTag += 1;
 	if (DevExt->BatteryTag == BATTERY_TAG_INVALID) {
 		DevExt->BatteryTag += 1;
@@ -124,6 +152,33 @@ Return Value:
 	return;
 }
 
+static
+BOOLEAN
+SM5714BatteryTagMatches(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	ULONG BatteryTag
+)
+
+/*++
+
+Routine Description:
+
+	StateLock is only held to check the tag; callbacks read telemetry, and
+	may wait for the bus, after dropping it, so a stalled transfer never
+	holds up QueryTag or another callback.
+
+--*/
+
+{
+	BOOLEAN Matches;
+
+	WdfWaitLockAcquire(DevExt->StateLock, NULL);
+	Matches = (BatteryTag == DevExt->BatteryTag);
+	WdfWaitLockRelease(DevExt->StateLock);
+
+	return Matches;
+}
+
 _Use_decl_annotations_
 NTSTATUS
 SM5714BatteryQueryTag(
@@ -171,31 +226,66 @@ Return Value:
 	return Status;
 }
 
+static
 NTSTATUS
-SM5714BatteryQueryBatteryInformation(PSM5714_BATTERY_FDO_DATA DevExt, PBATTERY_INFORMATION BatteryInformationResult)
+SM5714BatterySetStringLength(
+	_Inout_ PSM5714_BATTERY_STRING String
+)
 {
-	ULONG    CycleCount;
+	size_t Length;
 	NTSTATUS Status;
 
+	Status = RtlStringCbLengthW(String->Buffer, sizeof(String->Buffer), &Length);
+	if (!NT_SUCCESS(Status))
+	{
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "RtlStringCbLengthW failed with Status = 0x%08lX\n", Status);
+		String->Length = 0;
+		return Status;
+	}
+
+	String->Length = (ULONG)(Length + sizeof(WCHAR));
+	return STATUS_SUCCESS;
+}
+
+static
+VOID
+SM5714BatteryBuildInformation(
+	_Inout_ PSM5714_BATTERY_FDO_DATA DevExt,
+	_In_ ULONG CycleCount
+)
+
+/*++
+
+Routine Description:
+
+	Builds the static information levels once so QueryInformation only
+	copies them out. Called with StateLock held.
+
+--*/
+
+{
+	PBATTERY_INFORMATION Information;
+
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Entering %!FUNC!\n");
 
+	Information = &DevExt->Information;
+	RtlZeroMemory(Information, sizeof(*Information));
+
 	// Set up battery info (chemistry, capacity in mWh, etc.)
-	BatteryInformationResult->Capabilities = BATTERY_SYSTEM_BATTERY;
-	BatteryInformationResult->Technology = DevExt->BatteryTechnology;
+	Information->Capabilities = BATTERY_SYSTEM_BATTERY;
+	Information->Technology = DevExt->BatteryTechnology;
 
 	BYTE LION[4] = {'L','I','O','N'};
-	RtlCopyMemory(BatteryInformationResult->Chemistry, LION, 4);
-
-	BatteryInformationResult->DesignedCapacity = DevExt->DesignedCapacity_mWh;
-	BatteryInformationResult->FullChargedCapacity = DevExt->FullChargedCapacity_mWh;
+	RtlCopyMemory(Information->Chemistry, LION, 4);
 
-	BatteryInformationResult->DefaultAlert1 = BatteryInformationResult->FullChargedCapacity * 7 / 100; // 7% of total capacity for error
-	BatteryInformationResult->DefaultAlert2 = BatteryInformationResult->FullChargedCapacity * 9 / 100; // 9% of total capacity for warning
-	BatteryInformationResult->CriticalBias = 0;
+	Information->DesignedCapacity = DevExt->DesignedCapacity_mWh;
+	Information->FullChargedCapacity = DevExt->FullChargedCapacity_mWh;
 
-	sm5714_Get_CycleCount(DevExt, &CycleCount);
+	Information->DefaultAlert1 = Information->FullChargedCapacity * 7 / 100; // 7% of total capacity for error
+	Information->DefaultAlert2 = Information->FullChargedCapacity * 9 / 100; // 9% of total capacity for warning
+	Information->CriticalBias = 0;
 
-	BatteryInformationResult->CycleCount = CycleCount;
+	Information->CycleCount = CycleCount;
 
 	Trace(
 		TRACE_LEVEL_INFORMATION,
@@ -209,22 +299,95 @@ SM5714BatteryQueryBatteryInformation(PSM5714_BATTERY_FDO_DATA DevExt, PBATTERY_I
 		"DefaultAlert2: %d \n"
 		"CriticalBias: %d \n"
 		"CycleCount: %d\n",
-		BatteryInformationResult->Capabilities,
-		BatteryInformationResult->Technology,
-		BatteryInformationResult->DesignedCapacity,
-		BatteryInformationResult->FullChargedCapacity,
-		BatteryInformationResult->DefaultAlert1,
-		BatteryInformationResult->DefaultAlert2,
-		BatteryInformationResult->CriticalBias,
-		BatteryInformationResult->CycleCount);
+		Information->Capabilities,
+		Information->Technology,
+		Information->DesignedCapacity,
+		Information->FullChargedCapacity,
+		Information->DefaultAlert1,
+		Information->DefaultAlert2,
+		Information->CriticalBias,
+		Information->CycleCount);
+
+	swprintf_s(DevExt->UniqueId.Buffer, ARRAYSIZE(DevExt->UniqueId.Buffer), L"%c%c%c%c%c%c%c%c",
+		'S',
+		'M',
+		'5',
+		'7',
+		'1',
+		'4',
+		'F',
+		'G');
+
+	SM5714BatterySetStringLength(&DevExt->UniqueId);
+	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "BatteryUniqueID: %S\n", DevExt->UniqueId.Buffer);
+
+	swprintf_s(DevExt->ManufactureName.Buffer, ARRAYSIZE(DevExt->ManufactureName.Buffer), L"%c%c",
+		0x53,  // S
+		0x53   // S
+	);
+
+	SM5714BatterySetStringLength(&DevExt->ManufactureName);
+	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "BatteryManufactureName: %S\n", DevExt->ManufactureName.Buffer);
+
+	swprintf_s(DevExt->DeviceName.Buffer, ARRAYSIZE(DevExt->DeviceName.Buffer), L"%c%c%c%c%c%c",
+		0x53,  // S
+		0x4D,  // M
+		0x35,  // 5
+		0x37,  // 7
+		0x31,  // 1
+		0x34   // 4
+	);
+
+	SM5714BatterySetStringLength(&DevExt->DeviceName);
+	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "BatteryDeviceName: %S\n", DevExt->DeviceName.Buffer);
+
+	swprintf_s(DevExt->SerialNumber.Buffer, ARRAYSIZE(DevExt->SerialNumber.Buffer), L"%u", (UINT32)5714);
+
+	SM5714BatterySetStringLength(&DevExt->SerialNumber);
+	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "BatterySerialNumber: %S\n", DevExt->SerialNumber.Buffer);
+
+	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Leaving %!FUNC!\n");
+}
 
-	Status = STATUS_SUCCESS;
-Exit:
-	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Leaving %!FUNC!: Status = 0x%08lX\n", Status);
-	return Status;
+_Use_decl_annotations_
+VOID
+SM5714BatteryRefreshCycleCount(
+	PSM5714_BATTERY_FDO_DATA DevExt
+)
+
+/*++
+
+Routine Description:
+
+	Reads the cycle count again after the sampling path saw a charge start
+	or end. Called from the sampler and alert work items, never with
+	StateLock held.
+
+--*/
+
+{
+	ULONG CycleCount = 0;
+	NTSTATUS Status;
+
+	PAGED_CODE();
+
+	if (InterlockedExchange(&DevExt->CycleCountStale, FALSE) == FALSE) {
+		return;
+	}
+
+	Status = sm5714_Get_CycleCount(DevExt, &CycleCount);
+	if (!NT_SUCCESS(Status)) {
+		InterlockedExchange(&DevExt->CycleCountStale, TRUE);
+		return;
+	}
+
+	WdfWaitLockAcquire(DevExt->StateLock, NULL);
+	DevExt->Information.CycleCount = CycleCount;
+	WdfWaitLockRelease(DevExt->StateLock);
+
+	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "CycleCount: %u\n", CycleCount);
 }
 
-/*
 NTSTATUS
 SM5714BatteryQueryBatteryEstimatedTime(
 	PSM5714_BATTERY_FDO_DATA DevExt,
@@ -232,78 +395,53 @@ SM5714BatteryQueryBatteryEstimatedTime(
 	PULONG ResultValue
 )
 {
-	NTSTATUS Status = STATUS_SUCCESS;
-	UCHAR Flags = 0;
-	UINT16 ETA = 0;
+	ULONG Energy = 0;
+	LONG Rate = 0;
+	BOOLEAN RateValid = FALSE;
 
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Entering %!FUNC!\n");
 
-	if (AtRate == 0)
+	//
+	// Answered from the telemetry ring and the filtered discharge rate
+	// only; the shell polls this level and it must not cost a bus read.
+	// A non-zero AtRate is in mW, negative while discharging, and replaces
+	// the filtered rate, so it is answered before the filter is seeded.
+	//
+
+	*ResultValue = BATTERY_UNKNOWN_TIME;
+
+	if (SM5714TelemetryGetDischarge(DevExt, &Energy, &Rate, &RateValid))
 	{
-		Status = SpbReadDataSynchronously(&DevExt->I2CContext, 0x0A, &Flags, 2);
-		if (!NT_SUCCESS(Status))
+		if (AtRate != 0)
 		{
-			Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "SpbReadDataSynchronously failed with Status = 0x%08lX\n", Status);
-			goto Exit;
+			//
+			// -MINLONG does not fit a LONG; any rate that high is
+			// as good as MAXLONG for the estimate
+			//
+			Rate = (AtRate < -MAXLONG) ? MAXLONG : -AtRate;
+			RateValid = TRUE;
 		}
 
-		if (Flags & (1 << 0) || Flags & (1 << 1))
+		if (RateValid && Rate >= SM5714_DISCHARGE_RATE_MIN_MW)
 		{
-			Status = SpbReadDataSynchronously(&DevExt->I2CContext, 0x16, &ETA, 2);
-			if (!NT_SUCCESS(Status))
-			{
-				Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "SpbReadDataSynchronously failed with Status = 0x%08lX\n", Status);
-				goto Exit;
-			}
-
-			if (ETA == 0xFFFF)
-			{
-				*ResultValue = BATTERY_UNKNOWN_TIME;
-
-				Trace(
-					TRACE_LEVEL_INFORMATION,
-					SM5714_BATTERY_TRACE,
-					"BatteryEstimatedTime: BATTERY_UNKNOWN_TIME\n");
-			}
-			else
-			{
-				*ResultValue = ETA * 60; // Seconds
-
-				Trace(
-					TRACE_LEVEL_INFORMATION,
-					SM5714_BATTERY_TRACE,
-					"BatteryEstimatedTime: %d seconds\n",
-					*ResultValue);
-			}
-		}
-		else
-		{
-			*ResultValue = BATTERY_UNKNOWN_TIME;
-
-			Trace(
-				TRACE_LEVEL_INFORMATION,
-				SM5714_BATTERY_TRACE,
-				"BatteryEstimatedTime: BATTERY_UNKNOWN_TIME\n");
+			*ResultValue = (ULONG)((ULONGLONG)Energy * 3600 / (ULONG)Rate); // Seconds
 		}
 	}
-	else
-	{
-		*ResultValue = BATTERY_UNKNOWN_TIME;
 
-		Trace(
-			TRACE_LEVEL_INFORMATION,
-			SM5714_BATTERY_TRACE,
-			"BatteryEstimatedTime: BATTERY_UNKNOWN_TIME for AtRate = %d\n",
-			AtRate);
-	}
+	Trace(
+		TRACE_LEVEL_INFORMATION,
+		SM5714_BATTERY_TRACE,
+		"BatteryEstimatedTime: %u seconds for AtRate = %d (%u mWh at %d mW)\n",
+		*ResultValue,
+		AtRate,
+		Energy,
+		Rate);
 
-Exit:
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE,
 		"Leaving %!FUNC!: Status = 0x%08lX\n",
-		Status);
-	return Status;
+		STATUS_SUCCESS);
+	return STATUS_SUCCESS;
 }
-*/
 
 _Use_decl_annotations_
 NTSTATUS
@@ -359,11 +497,10 @@ Return Value:
 	NTSTATUS Status;
 
 	BATTERY_REPORTING_SCALE ReportingScale = { 0 };
-	BATTERY_INFORMATION BatteryInformationResult = { 0 };
-	WCHAR StringResult[MAX_BATTERY_STRING_SIZE] = { 0 };
+	BATTERY_INFORMATION BatteryInformationResult;
 	BATTERY_MANUFACTURE_DATE ManufactureDate = { 0 };
 
-	unsigned short rawTemp = 0;
+	SM5714_TELEMETRY_SAMPLE Sample;
 	int Temperature = 0;
 	USHORT DateData = 0;
 
@@ -371,8 +508,7 @@ Return Value:
 	PAGED_CODE();
 
 	DevExt = (PSM5714_BATTERY_FDO_DATA)Context;
-	WdfWaitLockAcquire(DevExt->StateLock, NULL);
-	if (BatteryTag != DevExt->BatteryTag) {
+	if (!SM5714BatteryTagMatches(DevExt, BatteryTag)) {
 		Status = STATUS_NO_SUCH_DEVICE;
 		goto QueryInformationEnd;
 	}
@@ -387,19 +523,20 @@ Return Value:
 	Status = STATUS_INVALID_DEVICE_REQUEST;
 	switch (Level) {
 	case BatteryInformation:
-		Status = SM5714BatteryQueryBatteryInformation(DevExt, &BatteryInformationResult);
-		if (!NT_SUCCESS(Status))
-		{
-			Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "SM5714BatteryQueryBatteryInformation failed with Status = 0x%08lX\n", Status);
-			goto Exit;
-		}
+
+		//
+		// The cycle count may be refreshed under StateLock meanwhile
+		//
+
+		WdfWaitLockAcquire(DevExt->StateLock, NULL);
+		BatteryInformationResult = DevExt->Information;
+		WdfWaitLockRelease(DevExt->StateLock);
 
 		ReturnBuffer = &BatteryInformationResult;
 		ReturnBufferLength = sizeof(BATTERY_INFORMATION);
 		Status = STATUS_SUCCESS;
 		break;
 
-	/*
 	case BatteryEstimatedTime:
 		Status = SM5714BatteryQueryBatteryEstimatedTime(DevExt, AtRate, &ResultValue);
 		if (!NT_SUCCESS(Status))
@@ -412,96 +549,33 @@ Return Value:
 		ReturnBufferLength = sizeof(ResultValue);
 		Status = STATUS_SUCCESS;
 		break;
-	*/
 
-	case BatteryUniqueID:
-
-		swprintf_s(StringResult, sizeof(StringResult) / sizeof(WCHAR), L"%c%c%c%c%c%c%c%c",
-			'S',
-			'M',
-			'5',
-			'7',
-			'1',
-			'4',
-			'F',
-			'G');
-
-		Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "BatteryUniqueID: %S\n", StringResult);
-
-		Status = RtlStringCbLengthW(StringResult, sizeof(StringResult), &ReturnBufferLength);
-		if (!NT_SUCCESS(Status))
-		{
-			Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "RtlStringCbLengthW failed with Status = 0x%08lX\n", Status);
-			goto Exit;
-		}
+	//
+	// The strings are built at prepare-hardware time, before the class
+	// can query them, and do not change afterwards
+	//
 
-		ReturnBuffer = StringResult;
-		ReturnBufferLength += sizeof(WCHAR);
+	case BatteryUniqueID:
+		ReturnBuffer = DevExt->UniqueId.Buffer;
+		ReturnBufferLength = DevExt->UniqueId.Length;
 		Status = STATUS_SUCCESS;
 		break;
 
-
 	case BatteryManufactureName:
-
-		swprintf_s(StringResult, sizeof(StringResult) / sizeof(WCHAR), L"%c%c",
-			0x53,  // S
-			0x53   // S
-		);
-
-		Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "BatteryManufactureName: %S\n", StringResult);
-
-		Status = RtlStringCbLengthW(StringResult, sizeof(StringResult), &ReturnBufferLength);
-		if (!NT_SUCCESS(Status))
-		{
-			Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "RtlStringCbLengthW failed with Status = 0x%08lX\n", Status);
-			goto Exit;
-		}
-
-		ReturnBuffer = StringResult;
-		ReturnBufferLength += sizeof(WCHAR);
+		ReturnBuffer = DevExt->ManufactureName.Buffer;
+		ReturnBufferLength = DevExt->ManufactureName.Length;
 		Status = STATUS_SUCCESS;
 		break;
 
 	case BatteryDeviceName:
-
-		swprintf_s(StringResult, sizeof(StringResult) / sizeof(WCHAR), L"%c%c%c%c%c%c",
-			0x53,  // S
-			0x4D,  // M
-			0x35,  // 5
-			0x37,  // 7
-			0x31,  // 1
-			0x34   // 4
-		);
-
-		Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "BatteryDeviceName: %S\n", StringResult);
-
-		Status = RtlStringCbLengthW(StringResult, sizeof(StringResult), &ReturnBufferLength);
-		if (!NT_SUCCESS(Status))
-		{
-			Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "RtlStringCbLengthW failed with Status = 0x%08lX\n", Status);
-			goto Exit;
-		}
-
-		ReturnBuffer = StringResult;
-		ReturnBufferLength += sizeof(WCHAR);
+		ReturnBuffer = DevExt->DeviceName.Buffer;
+		ReturnBufferLength = DevExt->DeviceName.Length;
 		Status = STATUS_SUCCESS;
 		break;
 
 	case BatterySerialNumber:
-
-		swprintf_s(StringResult, sizeof(StringResult) / sizeof(WCHAR), L"%u", (UINT32)5714);
-
-		Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "BatterySerialNumber: %S\n", StringResult);
-
-		Status = RtlStringCbLengthW(StringResult, sizeof(StringResult), &ReturnBufferLength);
-		if (!NT_SUCCESS(Status))
-		{
-			Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "RtlStringCbLengthW failed with Status = 0x%08lX\n", Status);
-			goto Exit;
-		}
-
-		ReturnBuffer = StringResult;
-		ReturnBufferLength += sizeof(WCHAR);
+		ReturnBuffer = DevExt->SerialNumber.Buffer;
+		ReturnBufferLength = DevExt->SerialNumber.Length;
 		Status = STATUS_SUCCESS;
 		break;
 
@@ -530,7 +604,12 @@ Return Value:
 
 	case BatteryTemperature:
 
-		sm5714_Get_BatteryTemperature(DevExt, &Temperature);
+		Status = SM5714TelemetryGetLatest(DevExt, &Sample);
+		if (!NT_SUCCESS(Status)) {
+			goto Exit;
+		}
+
+		Temperature = Sample.Temperature / 10;
 
 		Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Battery temperature: %d C\n", Temperature);
 
@@ -562,7 +641,6 @@ Exit:
 	}
 
 QueryInformationEnd:
-	WdfWaitLockRelease(DevExt->StateLock);
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Leaving %!FUNC!: Status = 0x%08lX\n", Status);
 	return Status;
 }
@@ -609,36 +687,32 @@ Return Value:
 	PAGED_CODE();
 
 	DevExt = (PSM5714_BATTERY_FDO_DATA)Context;
-	WdfWaitLockAcquire(DevExt->StateLock, NULL);
-	if (BatteryTag != DevExt->BatteryTag) {
+	if (!SM5714BatteryTagMatches(DevExt, BatteryTag)) {
 		Status = STATUS_NO_SUCH_DEVICE;
 		goto QueryStatusEnd;
 	}
 
-	// Fetch State of Charge
-	unsigned int     Capacity = 0;
-	sm5714_Get_BatterySoC(DevExt, &Capacity);
+	//
+	// State of Charge, Voltage(mV) and Current (mA) come from the newest
+	// telemetry sample; the gauge is only read here if the background
+	// sampler has fallen behind the configured cache age
+	//
+	SM5714_TELEMETRY_SAMPLE Sample;
 
-	// Fetch Voltage(mV)
-	unsigned int     Voltage = 0;
-	sm5714_Get_BatteryVoltage(DevExt, &Voltage);
+	Status = SM5714TelemetryGetLatest(DevExt, &Sample);
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "Failed to read battery status snapshot. Status=0x%08lX\n", Status);
+		goto QueryStatusEnd;
+	}
 
-	// Fetch Current (mA) over I2C
-	int     Current = 0;
-	sm5714_Get_BatteryCurrent(DevExt, &Current);
+	unsigned int     Voltage = Sample.Voltage;
+	int     Current = Sample.Current;
 	DbgPrintEx(DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "CURRENT: %d mA\n", Current);
 
 	//
-	// Fetch battery power state (use a dirty workaround for now)
+	// Power state as debounced by the sampling path
 	//
-	if (Current >= 8) {
-		Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "BATTERY_POWER_ON_LINE\n");
-		BatteryStatus->PowerState = BATTERY_POWER_ON_LINE;
-	}
-	else {
-		Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "BATTERY_DISCHARGING\n");
-		BatteryStatus->PowerState = BATTERY_DISCHARGING;
-	}
+	BatteryStatus->PowerState = Sample.PowerState;
 
 	/*
 	 * BatteryStatus expects:
@@ -647,8 +721,8 @@ Return Value:
 	 * - Rate in mW (signed)
 	 */
 
-	// mW
-	BatteryStatus->Capacity = (ULONG)Capacity * DevExt->FullChargedCapacity_mWh / (ULONG)1000;
+	// mWh, coulomb counted between samples and anchored to the SoC
+	BatteryStatus->Capacity = Sample.Energy;
 	// mV
 	BatteryStatus->Voltage = (ULONG)Voltage;
 	// mW (Signed)
@@ -671,7 +745,6 @@ Return Value:
 	Status = STATUS_SUCCESS;
 
 QueryStatusEnd:
-	WdfWaitLockRelease(DevExt->StateLock);
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Leaving %!FUNC!: Status = 0x%08lX\n", Status);
 	return Status;
 }
@@ -694,6 +767,10 @@ Routine Description:
 	The battery class driver will serialize all requests it issues to
 	the miniport for a given battery.
 
+	The criteria are checked against every telemetry sample, and the
+	sampler notifies the class once they are met (see
+	SM5714TelemetryNotifyStatus), so the class does not have to poll.
+
 Arguments:
 
 	Context - Supplies the miniport context value for battery
@@ -713,22 +790,24 @@ Return Value:
 	PSM5714_BATTERY_FDO_DATA DevExt;
 	NTSTATUS Status;
 
-	UNREFERENCED_PARAMETER(BatteryNotify);
-
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Entering %!FUNC!\n");
 	PAGED_CODE();
 
 	DevExt = (PSM5714_BATTERY_FDO_DATA)Context;
-	WdfWaitLockAcquire(DevExt->StateLock, NULL);
-	if (BatteryTag != DevExt->BatteryTag) {
+	if (!SM5714BatteryTagMatches(DevExt, BatteryTag)) {
 		Status = STATUS_NO_SUCH_DEVICE;
 		goto SetStatusNotifyEnd;
 	}
 
-	Status = STATUS_NOT_SUPPORTED;
+	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "BATTERY_NOTIFY: PowerState: %d LowCapacity: %d HighCapacity: %d\n",
+		BatteryNotify->PowerState,
+		BatteryNotify->LowCapacity,
+		BatteryNotify->HighCapacity);
+
+	SM5714TelemetrySetStatusNotify(DevExt, BatteryNotify);
+	Status = STATUS_SUCCESS;
 
 SetStatusNotifyEnd:
-	WdfWaitLockRelease(DevExt->StateLock);
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Leaving %!FUNC!: Status = 0x%08lX\n", Status);
 	return Status;
 }
@@ -759,14 +838,16 @@ Return Value:
 --*/
 
 {
+	PSM5714_BATTERY_FDO_DATA DevExt;
 	NTSTATUS Status;
 
-	UNREFERENCED_PARAMETER(Context);
-
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Entering %!FUNC!\n");
 	PAGED_CODE();
 
-	Status = STATUS_NOT_SUPPORTED;
+	DevExt = (PSM5714_BATTERY_FDO_DATA)Context;
+	SM5714TelemetrySetStatusNotify(DevExt, NULL);
+
+	Status = STATUS_SUCCESS;
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Leaving %!FUNC!: Status = 0x%08lX\n", Status);
 	return Status;
 }
@@ -816,8 +897,7 @@ Return Value:
 	PAGED_CODE();
 
 	DevExt = (PSM5714_BATTERY_FDO_DATA)Context;
-	WdfWaitLockAcquire(DevExt->StateLock, NULL);
-	if (BatteryTag != DevExt->BatteryTag) {
+	if (!SM5714BatteryTagMatches(DevExt, BatteryTag)) {
 		Status = STATUS_NO_SUCH_DEVICE;
 		goto SetInformationEnd;
 	}
@@ -846,6 +926,11 @@ Return Value:
 
 		Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_INFO, "SM5714Battery : Set MaxCurrentDraw = %u mA\n", ChargingSource->MaxCurrent);
 
+		//
+		// A source that may not draw any current is a detached one
+		//
+		SM5714TelemetrySetCharger(DevExt, (ChargingSource->MaxCurrent != 0) ? Sm5714ChargerPresent : Sm5714ChargerAbsent);
+
 		Status = STATUS_SUCCESS;
 	}
 	else if (Level == BatteryCriticalBias)
@@ -879,6 +964,8 @@ Return Value:
 			UsbFnPortType = (USBFN_PORT_TYPE)(UINT64)UsbChargerStatus->PowerSourceInformation;
 
 			Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_INFO, "SM5714Battery : UsbFnPortType = %d\n", UsbFnPortType);
+
+			SM5714TelemetrySetCharger(DevExt, (UsbChargerStatus->MaxCurrent != 0) ? Sm5714ChargerPresent : Sm5714ChargerAbsent);
 		}
 
 		Status = STATUS_SUCCESS;
@@ -889,7 +976,6 @@ Return Value:
 	}
 
 SetInformationEnd:
-	WdfWaitLockRelease(DevExt->StateLock);
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Leaving %!FUNC!: Status = 0x%08lX\n", Status);
 	return Status;
 }
\ No newline at end of file
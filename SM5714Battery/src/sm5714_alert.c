@@ -0,0 +1,133 @@
+/*++
+
+Module Name:
+
+	sm5714_alert.c
+
+Abstract:
+
+	Fuel gauge alerts on the GpioInt of the BAT device. The gauge latches
+	its alerts in INTFG and asserts the line; the passive-level ISR
+	(wdf.c) reads INTFG, which releases it, and its work item takes a fresh
+	telemetry sample and has the battery class query the status again.
+
+	Nothing in the tree documents the bits of INTFG and INTFG_MASK, so the
+	driver neither programs the mask nor decodes the sources: the gauge
+	raises whatever the platform unmasked, and any bit counts. The line is
+	declared shared, so an empty INTFG means another device raised it.
+
+--*/
+
+#include "../inc/SM5714Battery.h"
+#include "../inc/SM5714Battery_regs.h"
+#include "../inc/sm5714_fuelgauge.h"
+#include "sm5714_alert.tmh"
+
+#pragma alloc_text(PAGE, SM5714AlertEnable)
+#pragma alloc_text(PAGE, SM5714AlertAcknowledge)
+#pragma alloc_text(PAGE, SM5714AlertProcess)
+
+_Use_decl_annotations_
+NTSTATUS
+SM5714AlertEnable(
+	PSM5714_BATTERY_FDO_DATA DevExt
+)
+
+/*++
+
+Routine Description:
+
+	Drops whatever INTFG latched while nobody listened.
+
+--*/
+
+{
+	USHORT Stale = 0;
+	NTSTATUS Status;
+
+	PAGED_CODE();
+
+	Status = sm5714_Read_Register(DevExt, SM5714_FG_REG_INTFG, &Stale);
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "Failed to clear INTFG. Status=0x%08lX\n", Status);
+		return Status;
+	}
+
+	InterlockedExchange(&DevExt->PendingAlerts, 0);
+
+	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Fuel gauge alerts enabled, stale INTFG 0x%04X\n", Stale);
+	return STATUS_SUCCESS;
+}
+
+_Use_decl_annotations_
+BOOLEAN
+SM5714AlertAcknowledge(
+	PSM5714_BATTERY_FDO_DATA DevExt
+)
+
+/*++
+
+Routine Description:
+
+	Reads and thereby clears INTFG, adding its sources to PendingAlerts.
+
+Return Value:
+
+	TRUE when the gauge had an alert latched.
+
+--*/
+
+{
+	USHORT Sources = 0;
+	NTSTATUS Status;
+
+	PAGED_CODE();
+
+	Status = sm5714_Read_Register(DevExt, SM5714_FG_REG_INTFG, &Sources);
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "Failed to read INTFG. Status=0x%08lX\n", Status);
+		return FALSE;
+	}
+
+	if (Sources == 0) {
+		return FALSE;
+	}
+
+	InterlockedOr(&DevExt->PendingAlerts, Sources);
+	return TRUE;
+}
+
+_Use_decl_annotations_
+VOID
+SM5714AlertProcess(
+	PSM5714_BATTERY_FDO_DATA DevExt
+)
+
+/*++
+
+Routine Description:
+
+	Handles the alerts acknowledged since the last call: samples the gauge
+	so the status query that follows is served from the ring, then
+	notifies the battery class.
+
+--*/
+
+{
+	LONG Sources;
+
+	PAGED_CODE();
+
+	Sources = InterlockedExchange(&DevExt->PendingAlerts, 0);
+	if (Sources == 0) {
+		return;
+	}
+
+	InterlockedIncrement64(&DevExt->AlertCount);
+
+	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Fuel gauge alert, INTFG 0x%04X\n", Sources);
+
+	SM5714TelemetrySample(DevExt, NULL);
+	SM5714TelemetryNotifyStatus(DevExt, TRUE);
+	SM5714BatteryRefreshCycleCount(DevExt);
+}
@@ -0,0 +1,368 @@
+/*++
+
+Module Name:
+
+	sm5714_charger.c
+
+Abstract:
+
+	Connection to the charger interface of the SM5714 PMIC driver. The PMIC
+	registers a device interface of GUID_SM5714_PMIC_CHARGER_INTERFACE; its
+	arrival queues a work item that opens the PMIC as a remote I/O target
+	and queries the direct-call interface, which every telemetry sample
+	then reads instead of the averaged current. A removal of the PMIC
+	disconnects it again and the battery falls back to the class's charger
+	report and the current.
+
+--*/
+
+#include "../inc/SM5714Battery.h"
+#include <initguid.h>
+#include <wdmguid.h>
+#include "sm5714_charger.tmh"
+
+static DRIVER_NOTIFICATION_CALLBACK_ROUTINE SM5714ChargerInterfaceChange;
+static EVT_WDF_WORKITEM SM5714ChargerWorkItem;
+static EVT_WDF_IO_TARGET_QUERY_REMOVE SM5714ChargerTargetQueryRemove;
+static EVT_WDF_IO_TARGET_REMOVE_CANCELED SM5714ChargerTargetRemoveCanceled;
+static EVT_WDF_IO_TARGET_REMOVE_COMPLETE SM5714ChargerTargetRemoveComplete;
+
+#pragma alloc_text(PAGE, SM5714ChargerCreate)
+#pragma alloc_text(PAGE, SM5714ChargerRegister)
+#pragma alloc_text(PAGE, SM5714ChargerUnregister)
+#pragma alloc_text(PAGE, SM5714ChargerInterfaceChange)
+#pragma alloc_text(PAGE, SM5714ChargerWorkItem)
+#pragma alloc_text(PAGE, SM5714ChargerTargetQueryRemove)
+#pragma alloc_text(PAGE, SM5714ChargerTargetRemoveCanceled)
+#pragma alloc_text(PAGE, SM5714ChargerTargetRemoveComplete)
+
+//
+// Queries the interface on the open target and hands it to the telemetry
+// code, then queues a sample that uses it
+//
+
+static
+VOID
+SM5714ChargerConnect(
+	_In_ PSM5714_BATTERY_FDO_DATA DevExt
+)
+{
+	SM5714_PMIC_CHARGER_INTERFACE Charger;
+	NTSTATUS Status;
+
+	PAGED_CODE();
+
+	RtlZeroMemory(&Charger, sizeof(Charger));
+	Status = WdfIoTargetQueryForInterface(DevExt->ChargerTarget,
+		&GUID_SM5714_PMIC_CHARGER_INTERFACE,
+		(PINTERFACE)&Charger,
+		sizeof(Charger),
+		SM5714_PMIC_CHARGER_INTERFACE_VERSION,
+		NULL);
+
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_ERROR, "WdfIoTargetQueryForInterface(charger) Failed. Status 0x%x\n", Status);
+		return;
+	}
+
+	SM5714TelemetryConnectCharger(DevExt, &Charger);
+	SM5714BatteryChargerChanged(DevExt);
+}
+
+_Use_decl_annotations_
+NTSTATUS
+SM5714ChargerCreate(
+	PSM5714_BATTERY_FDO_DATA DevExt
+)
+
+/*++
+
+Routine Description:
+
+	Creates the work item that opens the PMIC, parented to the device.
+
+--*/
+
+{
+	WDF_WORKITEM_CONFIG WorkItemConfig;
+	WDF_OBJECT_ATTRIBUTES Attributes;
+	NTSTATUS Status;
+
+	PAGED_CODE();
+
+	WDF_WORKITEM_CONFIG_INIT(&WorkItemConfig, SM5714ChargerWorkItem);
+	WorkItemConfig.AutomaticSerialization = FALSE;
+	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
+	Attributes.ParentObject = DevExt->Device;
+	Status = WdfWorkItemCreate(&WorkItemConfig, &Attributes, &DevExt->ChargerWorkItem);
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_ERROR, "WdfWorkItemCreate(ChargerWorkItem) Failed. Status 0x%x\n", Status);
+	}
+
+	return Status;
+}
+
+_Use_decl_annotations_
+VOID
+SM5714ChargerRegister(
+	PSM5714_BATTERY_FDO_DATA DevExt
+)
+
+/*++
+
+Routine Description:
+
+	Starts watching for the PMIC's charger interface. A PMIC that is
+	already started is reported right away. Failure only leaves the
+	battery on the class's charger report.
+
+--*/
+
+{
+	NTSTATUS Status;
+
+	PAGED_CODE();
+
+	Status = IoRegisterPlugPlayNotification(EventCategoryDeviceInterfaceChange,
+		PNPNOTIFY_DEVICE_INTERFACE_INCLUDE_EXISTING_INTERFACES,
+		(PVOID)&GUID_SM5714_PMIC_CHARGER_INTERFACE,
+		WdfDriverWdmGetDriverObject(WdfDeviceGetDriver(DevExt->Device)),
+		SM5714ChargerInterfaceChange,
+		DevExt,
+		&DevExt->ChargerNotificationEntry);
+
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_WARN, "IoRegisterPlugPlayNotification(charger) Failed. Status 0x%x\n", Status);
+		DevExt->ChargerNotificationEntry = NULL;
+	}
+}
+
+_Use_decl_annotations_
+VOID
+SM5714ChargerUnregister(
+	PSM5714_BATTERY_FDO_DATA DevExt
+)
+
+/*++
+
+Routine Description:
+
+	Stops watching for the PMIC and closes it. No interface call is in
+	flight or can start once this returns.
+
+--*/
+
+{
+	WDFSTRING Link;
+
+	PAGED_CODE();
+
+	if (DevExt->ChargerNotificationEntry != NULL) {
+		IoUnregisterPlugPlayNotificationEx(DevExt->ChargerNotificationEntry);
+		DevExt->ChargerNotificationEntry = NULL;
+	}
+
+	WdfWorkItemFlush(DevExt->ChargerWorkItem);
+
+	Link = (WDFSTRING)InterlockedExchangePointer((PVOID volatile*)&DevExt->ChargerLink, NULL);
+	if (Link != NULL) {
+		WdfObjectDelete(Link);
+	}
+
+	SM5714TelemetryConnectCharger(DevExt, NULL);
+
+	if (DevExt->ChargerTarget != NULL) {
+		WdfObjectDelete(DevExt->ChargerTarget);
+		DevExt->ChargerTarget = NULL;
+	}
+}
+
+_Use_decl_annotations_
+NTSTATUS
+SM5714ChargerInterfaceChange(
+	PVOID NotificationStructure,
+	PVOID Context
+)
+
+/*++
+
+Routine Description:
+
+	Device interface notification for the PMIC. Opening a device from
+	inside the notification can deadlock PnP, so arrivals only record the
+	symbolic link for the work item. Removals are handled by the target's
+	own callbacks.
+
+--*/
+
+{
+	PDEVICE_INTERFACE_CHANGE_NOTIFICATION Notification;
+	PSM5714_BATTERY_FDO_DATA DevExt = (PSM5714_BATTERY_FDO_DATA)Context;
+	WDF_OBJECT_ATTRIBUTES Attributes;
+	WDFSTRING Link;
+	WDFSTRING Previous;
+	NTSTATUS Status;
+
+	PAGED_CODE();
+
+	Notification = (PDEVICE_INTERFACE_CHANGE_NOTIFICATION)NotificationStructure;
+	if (!IsEqualGUID(&Notification->Event, &GUID_DEVICE_INTERFACE_ARRIVAL)) {
+		return STATUS_SUCCESS;
+	}
+
+	//
+	// There is one PMIC; another arrival while it is open is ignored
+	//
+
+	if (DevExt->ChargerTarget != NULL) {
+		return STATUS_SUCCESS;
+	}
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
+	Attributes.ParentObject = DevExt->Device;
+	Status = WdfStringCreate(Notification->SymbolicLinkName, &Attributes, &Link);
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_ERROR, "WdfStringCreate(charger) Failed. Status 0x%x\n", Status);
+		return STATUS_SUCCESS;
+	}
+
+	Previous = (WDFSTRING)InterlockedExchangePointer((PVOID volatile*)&DevExt->ChargerLink, Link);
+	if (Previous != NULL) {
+		WdfObjectDelete(Previous);
+	}
+
+	WdfWorkItemEnqueue(DevExt->ChargerWorkItem);
+	return STATUS_SUCCESS;
+}
+
+_Use_decl_annotations_
+VOID
+SM5714ChargerWorkItem(
+	WDFWORKITEM WorkItem
+)
+
+/*++
+
+Routine Description:
+
+	Opens the PMIC named by the last arrival as a remote I/O target and
+	connects its charger interface.
+
+--*/
+
+{
+	PSM5714_BATTERY_FDO_DATA DevExt;
+	WDF_IO_TARGET_OPEN_PARAMS OpenParams;
+	WDF_OBJECT_ATTRIBUTES Attributes;
+	UNICODE_STRING Name;
+	WDFIOTARGET Target;
+	WDFSTRING Link;
+	NTSTATUS Status;
+
+	PAGED_CODE();
+
+	DevExt = GetDeviceExtension(WdfWorkItemGetParentObject(WorkItem));
+
+	Link = (WDFSTRING)InterlockedExchangePointer((PVOID volatile*)&DevExt->ChargerLink, NULL);
+	if (Link == NULL || DevExt->ChargerTarget != NULL) {
+		goto ChargerWorkItemEnd;
+	}
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
+	Attributes.ParentObject = DevExt->Device;
+	Status = WdfIoTargetCreate(DevExt->Device, &Attributes, &Target);
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_ERROR, "WdfIoTargetCreate(charger) Failed. Status 0x%x\n", Status);
+		goto ChargerWorkItemEnd;
+	}
+
+	WdfStringGetUnicodeString(Link, &Name);
+	WDF_IO_TARGET_OPEN_PARAMS_INIT_OPEN_BY_NAME(&OpenParams, &Name, STANDARD_RIGHTS_READ);
+	OpenParams.EvtIoTargetQueryRemove = SM5714ChargerTargetQueryRemove;
+	OpenParams.EvtIoTargetRemoveCanceled = SM5714ChargerTargetRemoveCanceled;
+	OpenParams.EvtIoTargetRemoveComplete = SM5714ChargerTargetRemoveComplete;
+
+	Status = WdfIoTargetOpen(Target, &OpenParams);
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_ERROR, "WdfIoTargetOpen(charger) Failed. Status 0x%x\n", Status);
+		WdfObjectDelete(Target);
+		goto ChargerWorkItemEnd;
+	}
+
+	DevExt->ChargerTarget = Target;
+	SM5714ChargerConnect(DevExt);
+
+ChargerWorkItemEnd:
+	if (Link != NULL) {
+		WdfObjectDelete(Link);
+	}
+}
+
+_Use_decl_annotations_
+NTSTATUS
+SM5714ChargerTargetQueryRemove(
+	WDFIOTARGET IoTarget
+)
+{
+	PSM5714_BATTERY_FDO_DATA DevExt;
+
+	PAGED_CODE();
+
+	DevExt = GetDeviceExtension(WdfIoTargetGetDevice(IoTarget));
+	SM5714TelemetryConnectCharger(DevExt, NULL);
+	SM5714BatteryChargerChanged(DevExt);
+	WdfIoTargetCloseForQueryRemove(IoTarget);
+	return STATUS_SUCCESS;
+}
+
+_Use_decl_annotations_
+VOID
+SM5714ChargerTargetRemoveCanceled(
+	WDFIOTARGET IoTarget
+)
+{
+	PSM5714_BATTERY_FDO_DATA DevExt;
+	WDF_IO_TARGET_OPEN_PARAMS OpenParams;
+	NTSTATUS Status;
+
+	PAGED_CODE();
+
+	DevExt = GetDeviceExtension(WdfIoTargetGetDevice(IoTarget));
+
+	WDF_IO_TARGET_OPEN_PARAMS_INIT_REOPEN(&OpenParams);
+	Status = WdfIoTargetOpen(IoTarget, &OpenParams);
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_ERROR, "WdfIoTargetOpen(charger, reopen) Failed. Status 0x%x\n", Status);
+		DevExt->ChargerTarget = NULL;
+		WdfObjectDelete(IoTarget);
+		return;
+	}
+
+	SM5714ChargerConnect(DevExt);
+}
+
+_Use_decl_annotations_
+VOID
+SM5714ChargerTargetRemoveComplete(
+	WDFIOTARGET IoTarget
+)
+
+/*++
+
+Routine Description:
+
+	The PMIC is gone, after a query-remove or by surprise. A new arrival
+	opens it again.
+
+--*/
+
+{
+	PSM5714_BATTERY_FDO_DATA DevExt;
+
+	PAGED_CODE();
+
+	DevExt = GetDeviceExtension(WdfIoTargetGetDevice(IoTarget));
+	SM5714TelemetryConnectCharger(DevExt, NULL);
+	DevExt->ChargerTarget = NULL;
+	WdfObjectDelete(IoTarget);
+}
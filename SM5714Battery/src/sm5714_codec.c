@@ -0,0 +1,91 @@
+/*++
+
+Module Name:
+
+	sm5714_codec.c
+
+Abstract:
+
+	Descriptors and decoders for the raw SRAM words of the SM5714 fuel
+	gauge. See sm5714_codec.h for the encoding.
+
+--*/
+
+#include <wdm.h>
+#include "../inc/SM5714Battery_regs.h"
+#include "../inc/sm5714_codec.h"
+
+//
+// SoC is 8.8 in percent, reported in 0.1 %. OCV and VBAT are 3.11 in
+// volts and the current 2.11 in amperes with a sign bit, all reported in
+// milli units. The temperature is 7.8 in degrees with a sign bit; only the
+// upper nibble of its fraction is significant, and it is reported in 0.1 C.
+//
+
+const SM5714_FG_FIELD Sm5714FgFields[Sm5714FgFieldCount] =
+{
+	// SramAddress                          Frac  MagnitudeMask  SignMask  Scale
+	{ SM5714_FG_ADDR_SRAM_SOC,              8,    0xFFFF,        0x0000,   10 },
+	{ SM5714_FG_ADDR_SRAM_OCV,              11,   0x3FFF,        0x0000,   1000 },
+	{ SM5714_FG_ADDR_SRAM_VBAT,             11,   0x3FFF,        0x0000,   1000 },
+	{ SM5714_FG_ADDR_SRAM_CURRENT,          11,   0x1FFF,        0x8000,   1000 },
+	{ SM5714_FG_ADDR_SRAM_TEMPERATURE,      8,    0x7FF0,        0x8000,   10 },
+	{ SM5714_FG_ADDR_SRAM_VBAT_AVG,         11,   0x3FFF,        0x0000,   1000 },
+	{ SM5714_FG_ADDR_SRAM_CURRENT_AVG,      11,   0x1FFF,        0x8000,   1000 },
+};
+
+LONG
+sm5714_Codec_Decode(
+	SM5714_FG_FIELD_ID FieldId,
+	USHORT Raw
+)
+{
+	const SM5714_FG_FIELD* Field = &Sm5714FgFields[FieldId];
+	LONG Magnitude;
+
+	Magnitude = (LONG)(((ULONG)(Raw & Field->MagnitudeMask) * Field->Scale) >> Field->FractionBits);
+
+	return (Raw & Field->SignMask) ? -Magnitude : Magnitude;
+}
+
+LONG
+sm5714_Codec_DecodeWhole(
+	SM5714_FG_FIELD_ID FieldId,
+	USHORT Raw
+)
+{
+	const SM5714_FG_FIELD* Field = &Sm5714FgFields[FieldId];
+	LONG Magnitude;
+
+	Magnitude = (LONG)((ULONG)(Raw & Field->MagnitudeMask) >> Field->FractionBits);
+
+	return (Raw & Field->SignMask) ? -Magnitude : Magnitude;
+}
+
+VOID
+sm5714_Codec_DecodeBatch(
+	SM5714_FG_FIELD_ID FieldId,
+	const USHORT* Raw,
+	ULONG Count,
+	LONG* Values
+)
+{
+	const ULONG MagnitudeMask = Sm5714FgFields[FieldId].MagnitudeMask;
+	const ULONG SignMask = Sm5714FgFields[FieldId].SignMask;
+	const ULONG Scale = Sm5714FgFields[FieldId].Scale;
+	const ULONG FractionBits = Sm5714FgFields[FieldId].FractionBits;
+	ULONG i;
+
+	//
+	// Negate through (m ^ s) - s with s = 0 or -1 instead of a branch, so
+	// every iteration is the same straight-line integer sequence
+	//
+
+	for (i = 0; i < Count; i++) {
+		ULONG Word = Raw[i];
+		LONG Magnitude = (LONG)(((Word & MagnitudeMask) * Scale) >> FractionBits);
+		LONG Sign = -(LONG)((Word & SignMask) != 0);
+
+		Values[i] = (Magnitude ^ Sign) - Sign;
+	}
+}
@@ -1,9 +1,155 @@
-#include "..\inc\SM5714Battery.h"
-#include "..\inc\Spb.h"
-#include "..\inc\SM5714Battery_regs.h"
-#include "..\inc\sm5714_fuelgauge.h"
+#include "../inc/SM5714Battery.h"
+#include "../inc/Spb.h"
+#include "../inc/SM5714Battery_regs.h"
+#include "../inc/sm5714_fuelgauge.h"
+#include "../inc/sm5714_codec.h"
 #include "sm5714_fuelgauge.tmh"
 
+static
+NTSTATUS
+sm5714_Read_Sram(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	UCHAR Address,
+	PUSHORT RawValue
+)
+{
+	//
+	// SRAM words are read indirectly: latch the address in SRAM_RADDR,
+	// then read the 16-bit word back through SRAM_RDATA.
+	//
+	UCHAR writeAddr[3] = { (UCHAR)SM5714_FG_REG_SRAM_RADDR, Address, 0 };
+	UCHAR readCmd = (UCHAR)SM5714_FG_REG_SRAM_RDATA;
+
+	return DevExt->BusOps->WriteRead(DevExt->BusContext, writeAddr, sizeof(writeAddr), &readCmd, sizeof(readCmd), RawValue, sizeof(*RawValue), 0);
+}
+
+NTSTATUS
+sm5714_Read_Snapshot(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	const UCHAR* Addresses,
+	ULONG Count,
+	PUSHORT RawValues
+)
+{
+	//
+	// Every SRAM word costs the same RADDR write, RDATA pointer write and
+	// 2-byte read as sm5714_Read_Sram, but all of them are chained with
+	// repeated STARTs into a single sequence so the values are sampled
+	// in one bus burst.
+	//
+	SM5714_BUS_TRANSFER transfers[SM5714_FG_SNAPSHOT_MAX * 3];
+	UCHAR writeAddr[SM5714_FG_SNAPSHOT_MAX][3];
+	UCHAR readCmd = (UCHAR)SM5714_FG_REG_SRAM_RDATA;
+	ULONG i;
+
+	if (Count == 0 || Count > SM5714_FG_SNAPSHOT_MAX)
+	{
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	for (i = 0; i < Count; i++)
+	{
+		writeAddr[i][0] = (UCHAR)SM5714_FG_REG_SRAM_RADDR;
+		writeAddr[i][1] = Addresses[i];
+		writeAddr[i][2] = 0;
+
+		transfers[i * 3].Read = FALSE;
+		transfers[i * 3].Buffer = writeAddr[i];
+		transfers[i * 3].Length = sizeof(writeAddr[i]);
+		transfers[i * 3].DelayUs = 0;
+
+		transfers[i * 3 + 1].Read = FALSE;
+		transfers[i * 3 + 1].Buffer = &readCmd;
+		transfers[i * 3 + 1].Length = sizeof(readCmd);
+		transfers[i * 3 + 1].DelayUs = 0;
+
+		transfers[i * 3 + 2].Read = TRUE;
+		transfers[i * 3 + 2].Buffer = &RawValues[i];
+		transfers[i * 3 + 2].Length = sizeof(RawValues[i]);
+		transfers[i * 3 + 2].DelayUs = 0;
+	}
+
+	return DevExt->BusOps->Sequence(DevExt->BusContext, transfers, Count * 3);
+}
+
+NTSTATUS
+sm5714_Read_Register(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	UCHAR Register,
+	PUSHORT Value
+)
+{
+	//
+	// Register pointer write, then the word back after a repeated START
+	//
+	SM5714_BUS_TRANSFER transfers[2];
+
+	transfers[0].Read = FALSE;
+	transfers[0].Buffer = &Register;
+	transfers[0].Length = sizeof(Register);
+	transfers[0].DelayUs = 0;
+
+	transfers[1].Read = TRUE;
+	transfers[1].Buffer = Value;
+	transfers[1].Length = sizeof(*Value);
+	transfers[1].DelayUs = 0;
+
+	return DevExt->BusOps->Sequence(DevExt->BusContext, transfers, ARRAYSIZE(transfers));
+}
+
+NTSTATUS
+sm5714_Write_Register(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	UCHAR Register,
+	USHORT Value
+)
+{
+	//
+	// Register pointer followed by the word, LSB first
+	//
+	UCHAR writeData[3] = { Register, (UCHAR)(Value & 0xFF), (UCHAR)(Value >> 8) };
+	SM5714_BUS_TRANSFER transfer;
+
+	transfer.Read = FALSE;
+	transfer.Buffer = writeData;
+	transfer.Length = sizeof(writeData);
+	transfer.DelayUs = 0;
+
+	return DevExt->BusOps->Sequence(DevExt->BusContext, &transfer, 1);
+}
+
+LONG
+sm5714_Decode_Temperature(
+	USHORT rawTemp
+)
+{
+	return sm5714_Codec_Decode(Sm5714FgFieldTemperature, rawTemp);
+}
+
+ULONG
+sm5714_Decode_SoC(
+	USHORT rawCapacity
+)
+{
+	return (ULONG)sm5714_Codec_Decode(Sm5714FgFieldSoc, rawCapacity);
+}
+
+ULONG
+sm5714_Decode_Voltage(
+	USHORT rawOcv
+)
+{
+	return (ULONG)sm5714_Codec_Decode(Sm5714FgFieldOcv, rawOcv);
+}
+
+LONG
+sm5714_Decode_Current(
+	USHORT rawCurr
+)
+{
+	return sm5714_Codec_Decode(Sm5714FgFieldCurrent, rawCurr);
+}
+
 NTSTATUS
 sm5714_Get_CycleCount(
 	PSM5714_BATTERY_FDO_DATA DevExt,
@@ -14,7 +160,7 @@ sm5714_Get_CycleCount(
 	int			   Cycle = 0;
 	unsigned short rawCycle = 0;
 
-	Status = SpbWriteRead(&DevExt->I2CContext, (PVOID)write_cycle, sizeof(write_cycle), &readCmd, sizeof(readCmd), &rawCycle, sizeof(rawCycle), 0);
+	Status = sm5714_Read_Sram(DevExt, SM5714_FG_ADDR_SRAM_SOC_CYCLE, &rawCycle);
 	if (!NT_SUCCESS(Status))
 	{
 		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "Failed to SPB write/read raw cycle count. Status=0x%08lX\n", Status);
@@ -43,25 +189,14 @@ sm5714_Get_BatteryTemperature(
 {
 	NTSTATUS Status;
 	unsigned short rawTemp = 0;
-	int			   Temp = 0;
 
-	Status = SpbWriteRead(&DevExt->I2CContext, (PVOID)write_temperature, sizeof(write_temperature), &readCmd, sizeof(readCmd), &rawTemp, sizeof(rawTemp), 0);
+	Status = sm5714_Read_Sram(DevExt, SM5714_FG_ADDR_SRAM_TEMPERATURE, &rawTemp);
 	if (!NT_SUCCESS(Status))
 	{
 		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "Failed to SPB write/read raw battery temperature. Status=0x%08lX\n", Status);
 	}
 
-	if (rawTemp < 0) {
-		Temp = 0;
-	}
-	else {
-		Temp = ((rawTemp & 0x7fff) >> 8) * 10;                  //integer bit
-		Temp = Temp + (((rawTemp & 0x00f0) * 10) / 256); // integer + fractional bit
-		if (rawTemp & 0x8000)
-			Temp *= -1;
-	}
-
-	*Temperature = (ULONG)Temp / (ULONG)10;
+	*Temperature = (ULONG)sm5714_Codec_DecodeWhole(Sm5714FgFieldTemperature, rawTemp);
 
 
 Exit:
@@ -78,13 +213,13 @@ sm5714_Get_BatterySoC(
 	NTSTATUS Status;
 	unsigned short rawCapacity = 0;
 
-	Status = SpbWriteRead(&DevExt->I2CContext, (PVOID)write_capacity, sizeof(write_capacity), &readCmd, sizeof(readCmd), &rawCapacity, sizeof(rawCapacity), 0);
+	Status = sm5714_Read_Sram(DevExt, SM5714_FG_ADDR_SRAM_SOC, &rawCapacity);
 	if (!NT_SUCCESS(Status))
 	{
 		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "Failed to SPB write/read raw State of Charge. Status=0x%08lX\n", Status);
 	}
 
-	*Capacity = FIXED_POINT_8_8_EXTEND_TO_INT((unsigned short)rawCapacity, 10);
+	*Capacity = sm5714_Decode_SoC(rawCapacity);
 
 
 Exit:
@@ -99,24 +234,15 @@ sm5714_Get_BatteryVoltage(
 )
 {
 	NTSTATUS Status;
-	unsigned int   Volt = 0;
 	unsigned short rawOcv = 0;
 
-	Status = SpbWriteRead(&DevExt->I2CContext, (PVOID)write_ocv, sizeof(write_ocv), &readCmd, sizeof(readCmd), &rawOcv, sizeof(rawOcv), 0);
+	Status = sm5714_Read_Sram(DevExt, SM5714_FG_ADDR_SRAM_OCV, &rawOcv);
 	if (!NT_SUCCESS(Status))
 	{
 		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "Failed to SPB write/read raw voltage. Status=0x%08lX\n", Status);
 	}
 
-	if (rawOcv < 0) {
-		Volt = 4000;
-	}
-	else {
-		Volt = ((rawOcv & 0x3800) >> 11) * 1000;         //integer;
-		Volt = Volt + (((rawOcv & 0x07ff) * 1000) / 2048); // integer + fractional
-	}
-
-	*Voltage = Volt;
+	*Voltage = sm5714_Decode_Voltage(rawOcv);
 
 Exit:
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Leaving %!FUNC!: Status = 0x%08lX\n", Status);
@@ -130,20 +256,14 @@ sm5714_Get_BatteryCurrent(
 )
 {
 	NTSTATUS Status;
-	int   Curr = 0;
 	unsigned short rawCurr = 0;
 
-	Status = SpbWriteRead(&DevExt->I2CContext, (PVOID)write_current, sizeof(write_current), &readCmd, sizeof(readCmd), &rawCurr, sizeof(rawCurr), 0);
+	Status = sm5714_Read_Sram(DevExt, SM5714_FG_ADDR_SRAM_CURRENT, &rawCurr);
 	if (!NT_SUCCESS(Status))
 	{
 		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "Failed to SPB write/read raw current. Status=0x%08lX\n", Status);
 	}
-	Curr = ((rawCurr & 0x1800) >> 11) * 1000; //integer;
-	Curr = Curr + (((rawCurr & 0x07ff) * 1000) / 2048); // integer + fractional
-	if (rawCurr & 0x8000)
-		Curr *= -1;
-
-	*Current = Curr;
+	*Current = sm5714_Decode_Current(rawCurr);
 
 
 Exit:
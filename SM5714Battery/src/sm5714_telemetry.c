@@ -0,0 +1,997 @@
+/*++
+
+Module Name:
+
+	sm5714_telemetry.c
+
+Abstract:
+
+	Telemetry ring of decoded fuel gauge samples. Samples are taken in one
+	bus sequence each and pushed by the background sampler or, when the
+	ring has gone stale, by the reader that needed a fresh value. Each push
+	also advances the coulomb counter, the discharge rate filter and the
+	power state machine, and checks the battery class notification
+	criteria. While the PMIC driver's charger interface is connected, its
+	status decides charger presence and charging instead. The newest
+	sample is then republished in a sequence-counted snapshot that the
+	class callbacks read without taking a lock.
+
+--*/
+
+#include "../inc/SM5714Battery.h"
+#include "../inc/SM5714Battery_regs.h"
+#include "../inc/sm5714_fuelgauge.h"
+#include "../inc/sm5714_codec.h"
+#include "sm5714_telemetry.tmh"
+
+C_ASSERT((SM5714_TELEMETRY_RING_SIZE & (SM5714_TELEMETRY_RING_SIZE - 1)) == 0);
+
+#define SM5714_TELEMETRY_RING_MASK (SM5714_TELEMETRY_RING_SIZE - 1)
+
+#pragma alloc_text(PAGE, SM5714TelemetryCreateSnapshot)
+#pragma alloc_text(PAGE, SM5714TelemetrySample)
+#pragma alloc_text(PAGE, SM5714TelemetryGetLatest)
+#pragma alloc_text(PAGE, SM5714TelemetryGetDischarge)
+#pragma alloc_text(PAGE, SM5714TelemetrySetSamplingMode)
+#pragma alloc_text(PAGE, SM5714TelemetrySamplePeriodMs)
+#pragma alloc_text(PAGE, SM5714TelemetryReset)
+#pragma alloc_text(PAGE, SM5714TelemetrySetStatusNotify)
+#pragma alloc_text(PAGE, SM5714TelemetryNotifyStatus)
+#pragma alloc_text(PAGE, SM5714TelemetrySetCharger)
+#pragma alloc_text(PAGE, SM5714TelemetryConnectCharger)
+
+//
+// Longest interval between two samples that is still integrated across,
+// called with TelemetryLock held
+//
+
+static
+ULONGLONG
+SM5714TelemetryMaxGap(
+	_In_ PSM5714_BATTERY_FDO_DATA DevExt
+)
+{
+	ULONGLONG LowPowerGap;
+
+	if (DevExt->SamplingMode != Sm5714SamplingLowPower) {
+		return SM5714_ENERGY_MAX_GAP;
+	}
+
+	LowPowerGap = 2 * (ULONGLONG)MILLISECONDS(DevExt->LowPowerSamplePeriodMs);
+	return (LowPowerGap > SM5714_ENERGY_MAX_GAP) ? LowPowerGap : SM5714_ENERGY_MAX_GAP;
+}
+
+//
+// Republishes the snapshot from the ring and the filters, called with
+// TelemetryLock held, which serializes the writers. The odd Sequence
+// window runs at DISPATCH_LEVEL: a reader at DISPATCH_LEVEL preempting it
+// on the same CPU would spin forever. Kept out of line so the raised part
+// stays in nonpaged code.
+//
+
+static
+DECLSPEC_NOINLINE
+VOID
+SM5714TelemetryPublish(
+	_Inout_ PSM5714_BATTERY_FDO_DATA DevExt
+)
+{
+	PSM5714_TELEMETRY_SNAPSHOT Snapshot = DevExt->TelemetrySnapshot;
+	KIRQL OldIrql;
+
+	KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
+	InterlockedIncrement(&Snapshot->Sequence);
+
+	Snapshot->Record.Valid = (DevExt->Telemetry.Count != 0);
+	if (Snapshot->Record.Valid) {
+		Snapshot->Record.Sample = DevExt->Telemetry.Samples[(DevExt->Telemetry.Count - 1) & SM5714_TELEMETRY_RING_MASK];
+	}
+
+	Snapshot->Record.RateValid = DevExt->DischargeRate.Seeded;
+	Snapshot->Record.Rate = (LONG)(DevExt->DischargeRate.Rate / 1000);
+	Snapshot->Record.Mode = DevExt->SamplingMode;
+
+	InterlockedIncrement(&Snapshot->Sequence);
+	KeLowerIrql(OldIrql);
+}
+
+//
+// Copies the record without taking TelemetryLock, retrying while a writer
+// is in the middle of it. Nonpaged, callable at DISPATCH_LEVEL; returns
+// the (even) sequence count the copy was taken at.
+//
+
+static
+LONG
+SM5714TelemetryReadSnapshot(
+	_In_ PSM5714_BATTERY_FDO_DATA DevExt,
+	_Out_ PSM5714_TELEMETRY_RECORD Record
+)
+{
+	PSM5714_TELEMETRY_SNAPSHOT Snapshot = DevExt->TelemetrySnapshot;
+	LONG Sequence;
+
+	for (;;) {
+		Sequence = ReadAcquire(&Snapshot->Sequence);
+		if ((Sequence & 1) == 0) {
+			RtlCopyMemory(Record, &Snapshot->Record, sizeof(*Record));
+			KeMemoryBarrier();
+			if (ReadNoFence(&Snapshot->Sequence) == Sequence) {
+				return Sequence;
+			}
+		}
+
+		YieldProcessor();
+	}
+}
+
+static
+VOID
+SM5714EnergyIntegrate(
+	_Inout_ PSM5714_ENERGY_COUNTER Counter,
+	_In_opt_ const SM5714_TELEMETRY_SAMPLE* Previous,
+	_Inout_ PSM5714_TELEMETRY_SAMPLE Sample,
+	_In_ ULONG FullChargedCapacity_mWh,
+	_In_ ULONGLONG MaxGap
+)
+
+/*++
+
+Routine Description:
+
+	Advances the coulomb counter from Previous to Sample and stores the
+	remaining energy in Sample->Energy. See SM5714_ENERGY_COUNTER.
+
+--*/
+
+{
+	LONGLONG Full;
+	LONGLONG Gauge;
+	LONGLONG Drift;
+	LONGLONG PreviousPower;
+	LONGLONG Power;
+	ULONGLONG Elapsed;
+	BOOLEAN Anchor = FALSE;
+
+	Full = (LONGLONG)FullChargedCapacity_mWh * SM5714_ENERGY_UNITS_PER_MWH;
+	Gauge = (LONGLONG)FullChargedCapacity_mWh * (SM5714_ENERGY_UNITS_PER_MWH / 1000) * Sample->Capacity;
+
+	if (Previous == NULL ||
+		Sample->Timestamp < Previous->Timestamp ||
+		Sample->Timestamp - Previous->Timestamp > MaxGap) {
+
+		Anchor = TRUE;
+
+	} else {
+
+		//
+		// mA * mV is uW; the trapezoid over the interval covers a load
+		// that changed between the two samples
+		//
+
+		Elapsed = Sample->Timestamp - Previous->Timestamp;
+		PreviousPower = (LONGLONG)Previous->Current * (LONGLONG)Previous->Voltage;
+		Power = (LONGLONG)Sample->Current * (LONGLONG)Sample->Voltage;
+		Counter->Energy += (PreviousPower + Power) * (LONGLONG)Elapsed / 2;
+	}
+
+	if (Sample->Current > SM5714_ENERGY_REST_CURRENT_MA ||
+		Sample->Current < -SM5714_ENERGY_REST_CURRENT_MA) {
+
+		Counter->Resting = FALSE;
+		Counter->RestAnchored = FALSE;
+
+	} else if (!Counter->Resting) {
+		Counter->Resting = TRUE;
+		Counter->RestSince = Sample->Timestamp;
+
+	} else if (!Counter->RestAnchored &&
+			   Sample->Timestamp - Counter->RestSince >= SM5714_ENERGY_REST_SETTLE) {
+
+		Counter->RestAnchored = TRUE;
+		Anchor = TRUE;
+	}
+
+	Drift = Counter->Energy - Gauge;
+	if (Drift < 0) {
+		Drift = -Drift;
+	}
+
+	if (Drift > Full / 1000 * SM5714_ENERGY_MAX_DRIFT_PERMILLE) {
+		Anchor = TRUE;
+	}
+
+	if (Anchor) {
+		Counter->Energy = Gauge;
+		Counter->Anchors += 1;
+	}
+
+	if (Counter->Energy < 0) {
+		Counter->Energy = 0;
+	} else if (Counter->Energy > Full) {
+		Counter->Energy = Full;
+	}
+
+	Sample->Energy = (ULONG)(Counter->Energy / SM5714_ENERGY_UNITS_PER_MWH);
+}
+
+static
+BOOLEAN
+SM5714DischargeRateNeedsSeed(
+	_In_ const SM5714_DISCHARGE_RATE* Filter,
+	_In_ ULONGLONG Now,
+	_In_ ULONGLONG MaxGap
+)
+{
+	return !Filter->Seeded ||
+		Now < Filter->Updated ||
+		Now - Filter->Updated > MaxGap;
+}
+
+static
+VOID
+SM5714DischargeRateUpdate(
+	_Inout_ PSM5714_DISCHARGE_RATE Filter,
+	_In_ const SM5714_TELEMETRY_SAMPLE* Sample,
+	_In_opt_ const LONG* AverageCurrent,
+	_In_ ULONGLONG MaxGap
+)
+
+/*++
+
+Routine Description:
+
+	Filters the power of Sample into the discharge rate, or seeds the
+	filter with AverageCurrent when it was read for that purpose. A filter
+	that needs a seed without one (the sampler raced another sampler that
+	seeded in between) restarts from the instantaneous power.
+
+--*/
+
+{
+	LONGLONG Power;
+	ULONGLONG Elapsed;
+
+	Power = -(LONGLONG)Sample->Current * (LONGLONG)Sample->Voltage;
+
+	if (AverageCurrent != NULL) {
+		Filter->Rate = -(LONGLONG)*AverageCurrent * (LONGLONG)Sample->Voltage;
+		Filter->Seeded = TRUE;
+
+	} else if (SM5714DischargeRateNeedsSeed(Filter, Sample->Timestamp, MaxGap)) {
+		Filter->Rate = Power;
+		Filter->Seeded = TRUE;
+
+	} else {
+
+		//
+		// alpha = dt / (tau + dt) keeps the time constant independent of
+		// how often samples arrive
+		//
+
+		Elapsed = Sample->Timestamp - Filter->Updated;
+		Filter->Rate += (Power - Filter->Rate) * (LONGLONG)Elapsed / (LONGLONG)(SM5714_DISCHARGE_RATE_TAU + Elapsed);
+	}
+
+	Filter->Updated = Sample->Timestamp;
+}
+
+#define SM5714_POWER_DIRECTION_FLAGS	(BATTERY_POWER_ON_LINE | BATTERY_CHARGING | BATTERY_DISCHARGING)
+#define SM5714_POWER_STATE_FLAGS		(SM5714_POWER_DIRECTION_FLAGS | BATTERY_CRITICAL)
+
+//
+// Copies the PMIC's charger status, called with TelemetryLock held. FALSE
+// while no charger interface is connected or the charger has not read its
+// status yet.
+//
+
+static
+BOOLEAN
+SM5714TelemetryReadCharger(
+	_In_ PSM5714_BATTERY_FDO_DATA DevExt,
+	_Out_ PSM5714_CHARGER_STATUS ChargerStatus
+)
+{
+	if (!DevExt->ChargerConnected) {
+		RtlZeroMemory(ChargerStatus, sizeof(*ChargerStatus));
+		return FALSE;
+	}
+
+	DevExt->Charger.GetChargerStatus(DevExt->Charger.InterfaceHeader.Context, ChargerStatus);
+	return ChargerStatus->Valid;
+}
+
+static
+ULONG
+SM5714PowerStateUpdate(
+	_Inout_ PSM5714_POWER_STATE Machine,
+	_In_ const SM5714_TELEMETRY_SAMPLE* Sample,
+	_In_opt_ const LONG* GaugeAverageCurrent,
+	_In_opt_ const SM5714_CHARGER_STATUS* ChargerStatus,
+	_In_ ULONGLONG MaxGap
+)
+
+/*++
+
+Routine Description:
+
+	Advances the power state machine by one sample, called with
+	TelemetryLock held. The average restarts from GaugeAverageCurrent when
+	it was read, or from the sample's current when it is needed and was
+	not. ChargerStatus, when the PMIC's is known, decides presence and
+	charging in place of the class's report and the average. Without it
+	the direction comes from the average alone: the tree has no source
+	for the bits of the gauge's SRAM_STATE word, so it is not read.
+
+Return Value:
+
+	The BATTERY_* power state to report with the sample.
+
+--*/
+
+{
+	ULONGLONG Elapsed;
+	ULONG Direction;
+	BOOLEAN Critical;
+	BOOLEAN Charging;
+
+	Elapsed = Sample->Timestamp - Machine->Updated;
+
+	if (GaugeAverageCurrent != NULL) {
+		Machine->AverageCurrent = *GaugeAverageCurrent;
+	} else if (!Machine->Valid || Sample->Timestamp < Machine->Updated || Elapsed > MaxGap) {
+		Machine->AverageCurrent = Sample->Current;
+	} else {
+		Machine->AverageCurrent += (LONG)(((LONGLONG)Sample->Current - Machine->AverageCurrent) * (LONGLONG)Elapsed /
+			(LONGLONG)(SM5714_POWER_CURRENT_TAU + Elapsed));
+	}
+
+	Machine->Updated = Sample->Timestamp;
+
+	if (ChargerStatus != NULL) {
+		Machine->Charger = ChargerStatus->VbusPresent ? Sm5714ChargerPresent : Sm5714ChargerAbsent;
+		Charging = ChargerStatus->Charging && !ChargerStatus->Done;
+	} else {
+		Charging = Machine->AverageCurrent >= SM5714_POWER_CHARGING_CURRENT_MA;
+	}
+
+	if (Machine->Charger == Sm5714ChargerAbsent) {
+		Direction = BATTERY_DISCHARGING;
+
+	} else if (Charging) {
+		Direction = BATTERY_POWER_ON_LINE | BATTERY_CHARGING;
+
+	} else if (Machine->Charger == Sm5714ChargerPresent) {
+		Direction = BATTERY_POWER_ON_LINE;
+
+	} else if (Machine->AverageCurrent <= -SM5714_POWER_CHARGING_CURRENT_MA) {
+		Direction = BATTERY_DISCHARGING;
+
+	} else if (Machine->Valid) {
+
+		//
+		// Resting: a battery that stopped charging is full on the charger
+		//
+
+		Direction = (Machine->State & BATTERY_POWER_ON_LINE) ? BATTERY_POWER_ON_LINE : BATTERY_DISCHARGING;
+
+	} else {
+		Direction = (Machine->AverageCurrent >= SM5714_POWER_ON_LINE_CURRENT_MA) ? BATTERY_POWER_ON_LINE : BATTERY_DISCHARGING;
+	}
+
+	if (!Machine->Valid || Machine->Charger != Machine->Applied) {
+		Machine->State = Direction;
+		Machine->CandidateSamples = 0;
+
+	} else if (Direction == (Machine->State & SM5714_POWER_DIRECTION_FLAGS)) {
+		Machine->CandidateSamples = 0;
+
+	} else {
+		if (Direction != Machine->Candidate || Machine->CandidateSamples == 0) {
+			Machine->Candidate = Direction;
+			Machine->CandidateSamples = 0;
+		}
+
+		Machine->CandidateSamples += 1;
+		if (Machine->CandidateSamples >= SM5714_POWER_STATE_DEBOUNCE) {
+			Machine->State = Direction | (Machine->State & BATTERY_CRITICAL);
+			Machine->CandidateSamples = 0;
+			Machine->Transitions += 1;
+		}
+	}
+
+	Machine->Applied = Machine->Charger;
+	Machine->Valid = TRUE;
+
+	Critical = FALSE;
+	if ((Machine->State & BATTERY_DISCHARGING) != 0) {
+		Critical = (Sample->Capacity <= SM5714_POWER_CRITICAL_SOC) ||
+			((Machine->State & BATTERY_CRITICAL) != 0 && Sample->Capacity <= SM5714_POWER_CRITICAL_CLEAR_SOC);
+	}
+
+	Machine->State = (Machine->State & SM5714_POWER_DIRECTION_FLAGS) | (Critical ? BATTERY_CRITICAL : 0);
+	return Machine->State;
+}
+
+//
+// TRUE when Sample meets the armed notification criteria, called with
+// TelemetryLock held for every sample so the capacity is seen crossing
+// back while the class has not re-armed yet
+//
+
+static
+BOOLEAN
+SM5714StatusNotifyCrossed(
+	_Inout_ PSM5714_STATUS_NOTIFY Notify,
+	_In_ const SM5714_TELEMETRY_SAMPLE* Sample,
+	_In_ ULONG FullChargedCapacity
+)
+{
+	ULONG Hysteresis;
+
+	if (Notify->Outside) {
+		Hysteresis = (ULONG)((ULONGLONG)FullChargedCapacity * SM5714_STATUS_NOTIFY_HYSTERESIS_PERMILLE / 1000);
+		if (Notify->Below ?
+			(Sample->Energy >= Notify->Crossed && Sample->Energy - Notify->Crossed >= Hysteresis) :
+			(Sample->Energy <= Notify->Crossed && Notify->Crossed - Sample->Energy >= Hysteresis)) {
+
+			Notify->Outside = FALSE;
+		}
+	}
+
+	if (!Notify->Armed) {
+		return FALSE;
+	}
+
+	//
+	// Only the bits QueryStatus reports can change, anything else the
+	// class asks about would notify on every sample
+	//
+
+	if (Sample->PowerState != (Notify->PowerState & SM5714_POWER_STATE_FLAGS)) {
+		return TRUE;
+	}
+
+	//
+	// A threshold at or beyond the one already reported is not news; one
+	// further out is
+	//
+
+	if (Sample->Energy < Notify->LowCapacity) {
+		if (Notify->Outside && Notify->Below && Notify->LowCapacity >= Notify->Crossed) {
+			return FALSE;
+		}
+
+		Notify->Outside = TRUE;
+		Notify->Below = TRUE;
+		Notify->Crossed = Notify->LowCapacity;
+		return TRUE;
+	}
+
+	if (Sample->Energy > Notify->HighCapacity) {
+		if (Notify->Outside && !Notify->Below && Notify->HighCapacity <= Notify->Crossed) {
+			return FALSE;
+		}
+
+		Notify->Outside = TRUE;
+		Notify->Below = FALSE;
+		Notify->Crossed = Notify->HighCapacity;
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+_Use_decl_annotations_
+NTSTATUS
+SM5714TelemetryCreateSnapshot(
+	PSM5714_BATTERY_FDO_DATA DevExt
+)
+
+/*++
+
+Routine Description:
+
+	Allocates the published snapshot, parented to the device. Called once
+	before anything samples.
+
+--*/
+
+{
+	WDF_OBJECT_ATTRIBUTES Attributes;
+	PVOID Buffer;
+	NTSTATUS Status;
+
+	PAGED_CODE();
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
+	Attributes.ParentObject = DevExt->Device;
+
+	Status = WdfMemoryCreate(&Attributes,
+		NonPagedPoolNxCacheAligned,
+		SM5714_BATTERY_TAG,
+		sizeof(SM5714_TELEMETRY_SNAPSHOT),
+		&DevExt->TelemetrySnapshotMemory,
+		&Buffer);
+
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "Failed to allocate the telemetry snapshot. Status=0x%08lX\n", Status);
+		return Status;
+	}
+
+	RtlZeroMemory(Buffer, sizeof(SM5714_TELEMETRY_SNAPSHOT));
+	DevExt->TelemetrySnapshot = (PSM5714_TELEMETRY_SNAPSHOT)Buffer;
+	return STATUS_SUCCESS;
+}
+
+_Use_decl_annotations_
+VOID
+SM5714TelemetryInterfaceGetTelemetry(
+	PVOID Context,
+	PSM5714_BATTERY_TELEMETRY Telemetry
+)
+
+/*++
+
+Routine Description:
+
+	GetTelemetry of the direct-call interface. Nonpaged and lock free, so
+	consumers may call it at DISPATCH_LEVEL.
+
+--*/
+
+{
+	PSM5714_BATTERY_FDO_DATA DevExt = (PSM5714_BATTERY_FDO_DATA)Context;
+	SM5714_TELEMETRY_RECORD Record;
+	LONG Sequence;
+
+	Sequence = SM5714TelemetryReadSnapshot(DevExt, &Record);
+
+	RtlZeroMemory(Telemetry, sizeof(*Telemetry));
+	Telemetry->Version = (ULONG)Sequence / 2;
+	Telemetry->Valid = Record.Valid;
+	if (!Record.Valid) {
+		return;
+	}
+
+	Telemetry->Timestamp = Record.Sample.Timestamp;
+	Telemetry->Capacity = Record.Sample.Capacity;
+	Telemetry->Voltage = Record.Sample.Voltage;
+	Telemetry->Current = Record.Sample.Current;
+	Telemetry->Temperature = Record.Sample.Temperature;
+	Telemetry->Energy = Record.Sample.Energy;
+	Telemetry->PowerState = Record.Sample.PowerState;
+	Telemetry->DischargeRate = Record.RateValid ? Record.Rate : 0;
+}
+
+_Use_decl_annotations_
+NTSTATUS
+SM5714TelemetrySample(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	PSM5714_TELEMETRY_SAMPLE Sample
+)
+{
+	//
+	// Normal samples read CURRENT_AVG only while the discharge rate filter
+	// or the power state average needs a seed; low-power samples read it
+	// anyway and seed from their own current.
+	//
+
+	static const UCHAR NormalAddresses[] = {
+		SM5714_FG_ADDR_SRAM_SOC,
+		SM5714_FG_ADDR_SRAM_OCV,
+		SM5714_FG_ADDR_SRAM_CURRENT,
+		SM5714_FG_ADDR_SRAM_TEMPERATURE,
+	};
+	static const UCHAR LowPowerAddresses[] = {
+		SM5714_FG_ADDR_SRAM_SOC,
+		SM5714_FG_ADDR_SRAM_VBAT_AVG,
+		SM5714_FG_ADDR_SRAM_CURRENT_AVG,
+		SM5714_FG_ADDR_SRAM_TEMPERATURE,
+	};
+	UCHAR Addresses[ARRAYSIZE(NormalAddresses) + 1];
+	USHORT RawValues[ARRAYSIZE(Addresses)] = { 0 };
+	SM5714_TELEMETRY_SAMPLE NewSample;
+	SM5714_CHARGER_STATUS ChargerStatus;
+	SM5714_SAMPLING_MODE Mode;
+	ULONGLONG MaxGap;
+	LONG AverageCurrent = 0;
+	ULONG Count;
+	BOOLEAN Average;
+	BOOLEAN ChargerKnown;
+	BOOLEAN Seed;
+	BOOLEAN Charging;
+	NTSTATUS Status;
+
+	PAGED_CODE();
+
+	C_ASSERT(ARRAYSIZE(NormalAddresses) == ARRAYSIZE(LowPowerAddresses));
+
+	WdfWaitLockAcquire(DevExt->TelemetryLock, NULL);
+	Mode = DevExt->SamplingMode;
+	Seed = SM5714DischargeRateNeedsSeed(&DevExt->DischargeRate, KeQueryInterruptTime(), SM5714TelemetryMaxGap(DevExt));
+	Average = (Mode == Sm5714SamplingLowPower) || Seed || !DevExt->PowerState.Valid;
+	ChargerKnown = SM5714TelemetryReadCharger(DevExt, &ChargerStatus);
+	WdfWaitLockRelease(DevExt->TelemetryLock);
+
+	if (Mode == Sm5714SamplingLowPower) {
+		RtlCopyMemory(Addresses, LowPowerAddresses, sizeof(LowPowerAddresses));
+	} else {
+		RtlCopyMemory(Addresses, NormalAddresses, sizeof(NormalAddresses));
+	}
+
+	Count = ARRAYSIZE(NormalAddresses);
+	if (Average && Mode != Sm5714SamplingLowPower) {
+		Addresses[Count++] = SM5714_FG_ADDR_SRAM_CURRENT_AVG;
+	}
+
+	Status = sm5714_Read_Snapshot(DevExt, Addresses, Count, RawValues);
+
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_TRACE, "Failed to read telemetry snapshot. Status=0x%08lX\n", Status);
+		return Status;
+	}
+
+	NewSample.Timestamp = KeQueryInterruptTime();
+	NewSample.Capacity = sm5714_Decode_SoC(RawValues[0]);
+	NewSample.Temperature = sm5714_Decode_Temperature(RawValues[3]);
+
+	if (Mode == Sm5714SamplingLowPower) {
+		NewSample.Voltage = (ULONG)sm5714_Codec_Decode(Sm5714FgFieldVbatAvg, RawValues[1]);
+		NewSample.Current = sm5714_Codec_Decode(Sm5714FgFieldCurrentAvg, RawValues[2]);
+		AverageCurrent = NewSample.Current;
+	} else {
+		NewSample.Voltage = sm5714_Decode_Voltage(RawValues[1]);
+		NewSample.Current = sm5714_Decode_Current(RawValues[2]);
+		if (Average) {
+			AverageCurrent = sm5714_Codec_Decode(Sm5714FgFieldCurrentAvg, RawValues[ARRAYSIZE(NormalAddresses)]);
+		}
+	}
+
+	WdfWaitLockAcquire(DevExt->TelemetryLock, NULL);
+	MaxGap = SM5714TelemetryMaxGap(DevExt);
+	Charging = DevExt->PowerState.Valid && (DevExt->PowerState.State & BATTERY_CHARGING) != 0;
+	NewSample.PowerState = SM5714PowerStateUpdate(&DevExt->PowerState,
+		&NewSample,
+		Average ? &AverageCurrent : NULL,
+		ChargerKnown ? &ChargerStatus : NULL,
+		MaxGap);
+
+	//
+	// A charge starting or ending is where the gauge moves its cycle
+	// count; the work items read it again (SM5714BatteryRefreshCycleCount)
+	//
+
+	if (Charging != ((NewSample.PowerState & BATTERY_CHARGING) != 0)) {
+		InterlockedExchange(&DevExt->CycleCountStale, TRUE);
+	}
+
+	SM5714EnergyIntegrate(&DevExt->EnergyCounter,
+		(DevExt->Telemetry.Count != 0) ? &DevExt->Telemetry.Samples[(DevExt->Telemetry.Count - 1) & SM5714_TELEMETRY_RING_MASK] : NULL,
+		&NewSample,
+		DevExt->FullChargedCapacity_mWh,
+		MaxGap);
+
+	SM5714DischargeRateUpdate(&DevExt->DischargeRate, &NewSample, Seed ? &AverageCurrent : NULL, MaxGap);
+
+	DevExt->Telemetry.Samples[DevExt->Telemetry.Count & SM5714_TELEMETRY_RING_MASK] = NewSample;
+	DevExt->Telemetry.Count += 1;
+
+	//
+	// The class is told from the sampler and alert work items only; a
+	// sample taken inside a class callback is about to be reported anyway
+	//
+
+	if (SM5714StatusNotifyCrossed(&DevExt->StatusNotify, &NewSample, DevExt->FullChargedCapacity_mWh)) {
+		DevExt->StatusNotify.Armed = FALSE;
+		DevExt->StatusNotify.Pending = TRUE;
+	}
+
+	SM5714TelemetryPublish(DevExt);
+	WdfWaitLockRelease(DevExt->TelemetryLock);
+
+	if (Sample != NULL) {
+		*Sample = NewSample;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+_Use_decl_annotations_
+NTSTATUS
+SM5714TelemetryGetLatest(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	PSM5714_TELEMETRY_SAMPLE Sample
+)
+{
+	SM5714_TELEMETRY_RECORD Record;
+	ULONGLONG Now;
+	ULONGLONG MaxAge;
+	BOOLEAN Fresh = FALSE;
+
+	PAGED_CODE();
+
+	SM5714TelemetryReadSnapshot(DevExt, &Record);
+	Now = KeQueryInterruptTime();
+
+	if (Record.Valid) {
+
+		//
+		// A low-power sampler is trusted for two of its periods, otherwise
+		// every poll between its samples would read the gauge again
+		//
+
+		MaxAge = DevExt->StatusCacheMaxAge;
+		if (Record.Mode == Sm5714SamplingLowPower && MaxAge != 0 &&
+			MaxAge < 2 * (ULONGLONG)MILLISECONDS(DevExt->LowPowerSamplePeriodMs)) {
+
+			MaxAge = 2 * (ULONGLONG)MILLISECONDS(DevExt->LowPowerSamplePeriodMs);
+		}
+
+		*Sample = Record.Sample;
+		Fresh = (Now - Sample->Timestamp) < MaxAge;
+	}
+
+	if (Fresh) {
+		InterlockedIncrement64(&DevExt->StatusCacheHits);
+		return STATUS_SUCCESS;
+	}
+
+	InterlockedIncrement64(&DevExt->StatusCacheMisses);
+	return SM5714TelemetrySample(DevExt, Sample);
+}
+
+_Use_decl_annotations_
+BOOLEAN
+SM5714TelemetryGetDischarge(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	PULONG Energy_mWh,
+	PLONG Rate_mW,
+	PBOOLEAN RateValid
+)
+
+/*++
+
+Routine Description:
+
+	Returns the remaining energy of the newest sample and the filtered
+	discharge rate, without touching the bus however old they are. The
+	rate is 0 and RateValid FALSE until the filter has been seeded.
+
+Return Value:
+
+	FALSE when nothing has been sampled since the last reset.
+
+--*/
+
+{
+	SM5714_TELEMETRY_RECORD Record;
+	BOOLEAN Valid = FALSE;
+
+	PAGED_CODE();
+
+	*Energy_mWh = 0;
+	*Rate_mW = 0;
+	*RateValid = FALSE;
+
+	SM5714TelemetryReadSnapshot(DevExt, &Record);
+	if (Record.Valid) {
+		*Energy_mWh = Record.Sample.Energy;
+		if (Record.RateValid) {
+			*Rate_mW = Record.Rate;
+			*RateValid = TRUE;
+		}
+
+		Valid = TRUE;
+	}
+
+	return Valid;
+}
+
+_Use_decl_annotations_
+VOID
+SM5714TelemetrySetSamplingMode(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	SM5714_SAMPLING_MODE Mode
+)
+
+/*++
+
+Routine Description:
+
+	Selects what the next samples read. The ring, the coulomb counter and
+	the rate filter carry over; only the caller's timer changes period.
+
+--*/
+
+{
+	PAGED_CODE();
+
+	WdfWaitLockAcquire(DevExt->TelemetryLock, NULL);
+	DevExt->SamplingMode = Mode;
+	SM5714TelemetryPublish(DevExt);
+	WdfWaitLockRelease(DevExt->TelemetryLock);
+
+	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Sampling mode %d, period %lu ms\n", Mode, SM5714TelemetrySamplePeriodMs(DevExt));
+}
+
+_Use_decl_annotations_
+ULONG
+SM5714TelemetrySamplePeriodMs(
+	PSM5714_BATTERY_FDO_DATA DevExt
+)
+{
+	ULONG PeriodMs;
+
+	PAGED_CODE();
+
+	WdfWaitLockAcquire(DevExt->TelemetryLock, NULL);
+	PeriodMs = (DevExt->SamplingMode == Sm5714SamplingLowPower) ? DevExt->LowPowerSamplePeriodMs : DevExt->SamplePeriodMs;
+	WdfWaitLockRelease(DevExt->TelemetryLock);
+
+	return PeriodMs;
+}
+
+_Use_decl_annotations_
+VOID
+SM5714TelemetryReset(
+	PSM5714_BATTERY_FDO_DATA DevExt
+)
+{
+	PAGED_CODE();
+
+	WdfWaitLockAcquire(DevExt->TelemetryLock, NULL);
+	DevExt->Telemetry.Count = 0;
+	DevExt->DischargeRate.Seeded = FALSE;
+	DevExt->StatusNotify.Armed = FALSE;
+	DevExt->StatusNotify.Pending = FALSE;
+	DevExt->StatusNotify.Outside = FALSE;
+	DevExt->PowerState.Valid = FALSE;
+	SM5714TelemetryPublish(DevExt);
+	WdfWaitLockRelease(DevExt->TelemetryLock);
+}
+
+_Use_decl_annotations_
+VOID
+SM5714TelemetrySetStatusNotify(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	PBATTERY_NOTIFY BatteryNotify
+)
+
+/*++
+
+Routine Description:
+
+	Arms the notification criteria, or disarms them when BatteryNotify is
+	NULL. Either way a crossing the class has not been told about yet is
+	dropped: the class sets criteria right after reading the status.
+
+--*/
+
+{
+	PAGED_CODE();
+
+	WdfWaitLockAcquire(DevExt->TelemetryLock, NULL);
+	DevExt->StatusNotify.Pending = FALSE;
+
+	if (BatteryNotify != NULL) {
+		DevExt->StatusNotify.PowerState = BatteryNotify->PowerState;
+		DevExt->StatusNotify.LowCapacity = BatteryNotify->LowCapacity;
+		DevExt->StatusNotify.HighCapacity = BatteryNotify->HighCapacity;
+		DevExt->StatusNotify.Armed = TRUE;
+	} else {
+		DevExt->StatusNotify.Armed = FALSE;
+	}
+	WdfWaitLockRelease(DevExt->TelemetryLock);
+}
+
+_Use_decl_annotations_
+VOID
+SM5714TelemetryNotifyStatus(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	BOOLEAN Always
+)
+
+/*++
+
+Routine Description:
+
+	Calls BatteryClassStatusNotify when a sample crossed the notification
+	criteria since the last call, or unconditionally with Always. Must not
+	be called from a battery class callback.
+
+--*/
+
+{
+	BOOLEAN Notify;
+
+	PAGED_CODE();
+
+	WdfWaitLockAcquire(DevExt->TelemetryLock, NULL);
+	Notify = Always || DevExt->StatusNotify.Pending;
+	DevExt->StatusNotify.Pending = FALSE;
+	if (Notify) {
+		DevExt->StatusNotify.Notifications += 1;
+	}
+	WdfWaitLockRelease(DevExt->TelemetryLock);
+
+	if (!Notify) {
+		return;
+	}
+
+	WdfWaitLockAcquire(DevExt->ClassInitLock, NULL);
+	if (DevExt->ClassHandle != NULL) {
+		BatteryClassStatusNotify(DevExt->ClassHandle);
+	}
+	WdfWaitLockRelease(DevExt->ClassInitLock);
+}
+
+_Use_decl_annotations_
+VOID
+SM5714TelemetrySetCharger(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	SM5714_CHARGER_PRESENCE Charger
+)
+
+/*++
+
+Routine Description:
+
+	Records whether a charger is attached and, when that changed, samples
+	right away so the next status shows it without waiting for the
+	sampler or the debounce. Ignored while the PMIC's charger interface is
+	connected, whose status is first hand.
+
+--*/
+
+{
+	BOOLEAN Changed;
+
+	PAGED_CODE();
+
+	WdfWaitLockAcquire(DevExt->TelemetryLock, NULL);
+	Changed = !DevExt->ChargerConnected && (DevExt->PowerState.Charger != Charger);
+	if (Changed) {
+		DevExt->PowerState.Charger = Charger;
+	}
+	WdfWaitLockRelease(DevExt->TelemetryLock);
+
+	if (Changed) {
+		SM5714TelemetrySample(DevExt, NULL);
+	}
+}
+
+_Use_decl_annotations_
+VOID
+SM5714TelemetryConnectCharger(
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	const SM5714_PMIC_CHARGER_INTERFACE* Charger
+)
+
+/*++
+
+Routine Description:
+
+	Starts taking charger presence and charging from the PMIC's charger
+	interface, or stops when Charger is NULL and falls back to the class's
+	report and the gauge. Takes effect with the next sample; the caller
+	queues one right away.
+
+--*/
+
+{
+	PAGED_CODE();
+
+	WdfWaitLockAcquire(DevExt->TelemetryLock, NULL);
+	if (Charger != NULL) {
+		DevExt->Charger = *Charger;
+		DevExt->ChargerConnected = TRUE;
+	} else {
+		RtlZeroMemory(&DevExt->Charger, sizeof(DevExt->Charger));
+		DevExt->ChargerConnected = FALSE;
+		DevExt->PowerState.Charger = Sm5714ChargerUnknown;
+	}
+	WdfWaitLockRelease(DevExt->TelemetryLock);
+
+	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "PMIC charger interface %s\n", (Charger != NULL) ? "connected" : "disconnected");
+}
@@ -17,7 +17,8 @@ Abstract:
 
 //--------------------------------------------------------------------- Includes
 
-#include "..\inc\SM5714Battery.h"
+#include <initguid.h>
+#include "../inc/SM5714Battery.h"
 #include "wdf.tmh"
 #include <acpiioct.h>
 #include <wdm.h>
@@ -28,6 +29,8 @@ DRIVER_INITIALIZE DriverEntry;
 EVT_WDF_DRIVER_DEVICE_ADD SM5714BatteryDriverDeviceAdd;
 EVT_WDF_DEVICE_SELF_MANAGED_IO_INIT  SM5714BatterySelfManagedIoInit;
 EVT_WDF_DEVICE_SELF_MANAGED_IO_CLEANUP  SM5714BatterySelfManagedIoCleanup;
+EVT_WDF_DEVICE_SELF_MANAGED_IO_SUSPEND  SM5714BatterySelfManagedIoSuspend;
+EVT_WDF_DEVICE_SELF_MANAGED_IO_RESTART  SM5714BatterySelfManagedIoRestart;
 EVT_WDF_DEVICE_QUERY_STOP SM5714BatteryQueryStop;
 EVT_WDF_DEVICE_PREPARE_HARDWARE SM5714BatteryDevicePrepareHardware;
 EVT_WDFDEVICE_WDM_IRP_PREPROCESS SM5714BatteryWdmIrpPreprocessDeviceControl;
@@ -36,12 +39,61 @@ WMI_QUERY_REGINFO_CALLBACK SM5714BatteryQueryWmiRegInfo;
 WMI_QUERY_DATABLOCK_CALLBACK SM5714BatteryQueryWmiDataBlock;
 EVT_WDF_DRIVER_UNLOAD SM5714BatteryEvtDriverUnload;
 EVT_WDF_OBJECT_CONTEXT_CLEANUP SM5714BatteryEvtDriverContextCleanup;
+EVT_WDF_TIMER SM5714BatterySampleTimer;
+EVT_WDF_WORKITEM SM5714BatterySampleWorkItem;
+EVT_WDF_INTERRUPT_ISR SM5714BatteryAlertIsr;
+EVT_WDF_INTERRUPT_WORKITEM SM5714BatteryAlertWorkItem;
+EVT_WDF_INTERRUPT_ENABLE SM5714BatteryAlertInterruptEnable;
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SM5714BatteryReadSettings(
+	_In_ WDFDEVICE Device,
+	_Inout_ PSM5714_BATTERY_FDO_DATA DevExt
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+NTSTATUS
+SM5714BatteryCreateSampler(
+	_In_ WDFDEVICE Device,
+	_Inout_ PSM5714_BATTERY_FDO_DATA DevExt
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SM5714BatteryStartSampler(
+	_In_ PSM5714_BATTERY_FDO_DATA DevExt
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+NTSTATUS
+SM5714BatteryAddTelemetryInterface(
+	_In_ WDFDEVICE Device,
+	_In_ PSM5714_BATTERY_FDO_DATA DevExt
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+VOID
+SM5714BatteryStopSampler(
+	_In_ PSM5714_BATTERY_FDO_DATA DevExt
+);
+
+_IRQL_requires_(PASSIVE_LEVEL)
+NTSTATUS
+SM5714BatteryCreateAlertInterrupt(
+	_In_ WDFDEVICE Device,
+	_Inout_ PSM5714_BATTERY_FDO_DATA DevExt,
+	_In_ PCM_PARTIAL_RESOURCE_DESCRIPTOR InterruptRaw,
+	_In_ PCM_PARTIAL_RESOURCE_DESCRIPTOR InterruptTranslated
+);
 
 //---------------------------------------------------------------------- Pragmas
 
 #pragma alloc_text(INIT, DriverEntry)
 #pragma alloc_text(PAGE, SM5714BatterySelfManagedIoInit)
 #pragma alloc_text(PAGE, SM5714BatterySelfManagedIoCleanup)
+#pragma alloc_text(PAGE, SM5714BatterySelfManagedIoSuspend)
+#pragma alloc_text(PAGE, SM5714BatterySelfManagedIoRestart)
 #pragma alloc_text(PAGE, SM5714BatteryQueryStop)
 #pragma alloc_text(PAGE, SM5714BatteryDriverDeviceAdd)
 #pragma alloc_text(PAGE, SM5714BatteryDevicePrepareHardware)
@@ -51,6 +103,37 @@ EVT_WDF_OBJECT_CONTEXT_CLEANUP SM5714BatteryEvtDriverContextCleanup;
 #pragma alloc_text(PAGE, SM5714BatteryQueryWmiDataBlock)
 #pragma alloc_text(PAGE, SM5714BatteryEvtDriverUnload)
 #pragma alloc_text(PAGE, SM5714BatteryEvtDriverContextCleanup)
+#pragma alloc_text(PAGE, SM5714BatteryReadSettings)
+#pragma alloc_text(PAGE, SM5714BatteryCreateSampler)
+#pragma alloc_text(PAGE, SM5714BatteryAddTelemetryInterface)
+#pragma alloc_text(PAGE, SM5714BatteryStartSampler)
+#pragma alloc_text(PAGE, SM5714BatteryStopSampler)
+#pragma alloc_text(PAGE, SM5714BatterySampleWorkItem)
+#pragma alloc_text(PAGE, SM5714BatteryChargerChanged)
+#pragma alloc_text(PAGE, SM5714BatteryCreateAlertInterrupt)
+#pragma alloc_text(PAGE, SM5714BatteryAlertIsr)
+#pragma alloc_text(PAGE, SM5714BatteryAlertWorkItem)
+#pragma alloc_text(PAGE, SM5714BatteryAlertInterruptEnable)
+
+//---------------------------------------------------------------------- Globals
+
+//
+// WMI data blocks published by the miniclass. The battery class driver adds
+// its own blocks after these and hands back STATUS_WMI_GUID_NOT_FOUND for
+// indices it does not own. The layouts are described in SM5714Battery.mof.
+//
+
+// {3B42156A-36BF-4041-8A97-3F876CCF2E24}
+static const GUID SM5714BatterySpbStatisticsGuid =
+	{ 0x3b42156a, 0x36bf, 0x4041, { 0x8a, 0x97, 0x3f, 0x87, 0x6c, 0xcf, 0x2e, 0x24 } };
+
+#define SM5714_WMI_SPB_STATISTICS_INDEX    0
+
+static WMIGUIDREGINFO SM5714BatteryWmiGuidList[] = {
+	{ &SM5714BatterySpbStatisticsGuid, 1, 0 }
+};
+
+#define SM5714_WMI_MOF_RESOURCE_NAME       L"MofResource"
 
 //-------------------------------------------------------------------- Functions
 
@@ -128,6 +211,461 @@ Sm5714FetchCapacities(
 	return status;
 }
 
+_Use_decl_annotations_
+VOID
+SM5714BatteryReadSettings(
+	WDFDEVICE Device,
+	PSM5714_BATTERY_FDO_DATA DevExt
+)
+
+/*++
+
+Routine Description:
+
+	Reads the tunables from the device's hardware registry key. Values that
+	are missing or unreadable keep their defaults.
+
+Arguments:
+
+	Device - Supplies a handle to the framework device object.
+
+	DevExt - Supplies the device extension receiving the settings.
+
+Return Value:
+
+	None
+
+--*/
+
+{
+	DECLARE_CONST_UNICODE_STRING(MaxAgeValueName, SM5714_STATUS_CACHE_MAX_AGE_VALUE);
+	DECLARE_CONST_UNICODE_STRING(PeriodValueName, SM5714_SAMPLE_PERIOD_VALUE);
+	DECLARE_CONST_UNICODE_STRING(LowPowerValueName, SM5714_LOW_POWER_SAMPLING_VALUE);
+	DECLARE_CONST_UNICODE_STRING(LowPowerPeriodValueName, SM5714_LOW_POWER_SAMPLE_PERIOD_VALUE);
+	WDFKEY Key;
+	ULONG MaxAgeMs = SM5714_STATUS_CACHE_DEFAULT_MAX_AGE_MS;
+	ULONG PeriodMs = SM5714_SAMPLE_DEFAULT_PERIOD_MS;
+	ULONG LowPower = 0;
+	ULONG LowPowerPeriodMs = SM5714_LOW_POWER_DEFAULT_PERIOD_MS;
+	NTSTATUS Status;
+
+	PAGED_CODE();
+
+	Status = WdfDeviceOpenRegistryKey(
+		Device,
+		PLUGPLAY_REGKEY_DEVICE,
+		KEY_READ,
+		WDF_NO_OBJECT_ATTRIBUTES,
+		&Key);
+
+	if (NT_SUCCESS(Status)) {
+		Status = WdfRegistryQueryULong(Key, &MaxAgeValueName, &MaxAgeMs);
+		if (!NT_SUCCESS(Status)) {
+			MaxAgeMs = SM5714_STATUS_CACHE_DEFAULT_MAX_AGE_MS;
+		}
+
+		Status = WdfRegistryQueryULong(Key, &PeriodValueName, &PeriodMs);
+		if (!NT_SUCCESS(Status)) {
+			PeriodMs = SM5714_SAMPLE_DEFAULT_PERIOD_MS;
+		}
+
+		Status = WdfRegistryQueryULong(Key, &LowPowerValueName, &LowPower);
+		if (!NT_SUCCESS(Status)) {
+			LowPower = 0;
+		}
+
+		Status = WdfRegistryQueryULong(Key, &LowPowerPeriodValueName, &LowPowerPeriodMs);
+		if (!NT_SUCCESS(Status) || LowPowerPeriodMs == 0) {
+			LowPowerPeriodMs = SM5714_LOW_POWER_DEFAULT_PERIOD_MS;
+		}
+
+		WdfRegistryClose(Key);
+	}
+
+	DevExt->StatusCacheMaxAge = MILLISECONDS(MaxAgeMs);
+	DevExt->SamplePeriodMs = PeriodMs;
+	DevExt->LowPowerSamplePeriodMs = LowPowerPeriodMs;
+	DevExt->SamplingMode = (LowPower != 0) ? Sm5714SamplingLowPower : Sm5714SamplingNormal;
+	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Status cache max age %lu ms, sample period %lu ms, low-power period %lu ms%s\n",
+		MaxAgeMs, PeriodMs, LowPowerPeriodMs, (LowPower != 0) ? " (selected)" : "");
+}
+
+_Use_decl_annotations_
+NTSTATUS
+SM5714BatteryAddTelemetryInterface(
+	WDFDEVICE Device,
+	PSM5714_BATTERY_FDO_DATA DevExt
+)
+
+/*++
+
+Routine Description:
+
+	Exposes the telemetry snapshot through the direct-call interface of
+	sm5714_interface.h. The framework copies the structure into every
+	IRP_MN_QUERY_INTERFACE for its GUID; the device interface of the same
+	GUID lets the PMIC driver find the battery.
+
+--*/
+
+{
+	SM5714_BATTERY_TELEMETRY_INTERFACE Interface;
+	WDF_QUERY_INTERFACE_CONFIG QueryInterfaceConfig;
+	NTSTATUS Status;
+
+	PAGED_CODE();
+
+	RtlZeroMemory(&Interface, sizeof(Interface));
+	Interface.InterfaceHeader.Size = sizeof(Interface);
+	Interface.InterfaceHeader.Version = SM5714_BATTERY_TELEMETRY_INTERFACE_VERSION;
+	Interface.InterfaceHeader.Context = DevExt;
+	Interface.InterfaceHeader.InterfaceReference = WdfDeviceInterfaceReferenceNoOp;
+	Interface.InterfaceHeader.InterfaceDereference = WdfDeviceInterfaceDereferenceNoOp;
+	Interface.GetTelemetry = SM5714TelemetryInterfaceGetTelemetry;
+	Interface.ChargerChanged = SM5714BatteryChargerChanged;
+
+	WDF_QUERY_INTERFACE_CONFIG_INIT(&QueryInterfaceConfig,
+		(PINTERFACE)&Interface,
+		&GUID_SM5714_BATTERY_TELEMETRY_INTERFACE,
+		NULL);
+
+	Status = WdfDeviceAddQueryInterface(Device, &QueryInterfaceConfig);
+	if (!NT_SUCCESS(Status)) {
+		return Status;
+	}
+
+	return WdfDeviceCreateDeviceInterface(Device, &GUID_SM5714_BATTERY_TELEMETRY_INTERFACE, NULL);
+}
+
+_Use_decl_annotations_
+NTSTATUS
+SM5714BatteryCreateSampler(
+	WDFDEVICE Device,
+	PSM5714_BATTERY_FDO_DATA DevExt
+)
+
+/*++
+
+Routine Description:
+
+	Creates the background sampler: a one-shot timer that queues a work
+	item, which reads the gauge into the telemetry ring at PASSIVE_LEVEL
+	and re-arms the timer with the period of the current sampling mode.
+	With a sample period of 0 there is no timer, and the work item only
+	runs for charger changes.
+
+Arguments:
+
+	Device - Supplies a handle to the framework device object.
+
+	DevExt - Supplies the device extension receiving the sampler.
+
+Return Value:
+
+	NTSTATUS
+
+--*/
+
+{
+	WDF_TIMER_CONFIG TimerConfig;
+	WDF_WORKITEM_CONFIG WorkItemConfig;
+	WDF_OBJECT_ATTRIBUTES Attributes;
+	NTSTATUS Status;
+
+	PAGED_CODE();
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
+	Attributes.ParentObject = Device;
+	Status = WdfWaitLockCreate(&Attributes, &DevExt->SamplerLock);
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_ERROR, "WdfWaitLockCreate(SamplerLock) Failed. Status 0x%x\n", Status);
+		return Status;
+	}
+
+	//
+	// The device runs its callbacks at PASSIVE_LEVEL, so both objects opt
+	// out of automatic serialization; the work item only touches the
+	// telemetry ring, which has its own lock.
+	//
+
+	WDF_WORKITEM_CONFIG_INIT(&WorkItemConfig, SM5714BatterySampleWorkItem);
+	WorkItemConfig.AutomaticSerialization = FALSE;
+	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
+	Attributes.ParentObject = Device;
+	Status = WdfWorkItemCreate(&WorkItemConfig, &Attributes, &DevExt->SampleWorkItem);
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_ERROR, "WdfWorkItemCreate(SampleWorkItem) Failed. Status 0x%x\n", Status);
+		return Status;
+	}
+
+	if (DevExt->SamplePeriodMs == 0) {
+		return STATUS_SUCCESS;
+	}
+
+	WDF_TIMER_CONFIG_INIT(&TimerConfig, SM5714BatterySampleTimer);
+	TimerConfig.AutomaticSerialization = FALSE;
+	TimerConfig.TolerableDelay = DevExt->SamplePeriodMs / 4;
+	WDF_OBJECT_ATTRIBUTES_INIT(&Attributes);
+	Attributes.ParentObject = Device;
+	Attributes.ExecutionLevel = WdfExecutionLevelDispatch;
+	Status = WdfTimerCreate(&TimerConfig, &Attributes, &DevExt->SampleTimer);
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_ERROR, "WdfTimerCreate(SampleTimer) Failed. Status 0x%x\n", Status);
+		return Status;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+_Use_decl_annotations_
+VOID
+SM5714BatteryStartSampler(
+	PSM5714_BATTERY_FDO_DATA DevExt
+)
+
+/*++
+
+Routine Description:
+
+	Starts the timer, or samples right away when the charger changed while
+	the sampler was stopped; the work item then arms the timer.
+
+--*/
+
+{
+	PAGED_CODE();
+
+	if (DevExt->SampleWorkItem == NULL) {
+		return;
+	}
+
+	WdfWaitLockAcquire(DevExt->SamplerLock, NULL);
+	DevExt->SamplerRunning = TRUE;
+	if (DevExt->ChargerChangePending != 0) {
+		WdfWorkItemEnqueue(DevExt->SampleWorkItem);
+	} else if (DevExt->SampleTimer != NULL) {
+		WdfTimerStart(DevExt->SampleTimer, WDF_REL_TIMEOUT_IN_MS(SM5714TelemetrySamplePeriodMs(DevExt)));
+	}
+	WdfWaitLockRelease(DevExt->SamplerLock);
+}
+
+_Use_decl_annotations_
+VOID
+SM5714BatteryStopSampler(
+	PSM5714_BATTERY_FDO_DATA DevExt
+)
+
+/*++
+
+Routine Description:
+
+	Stops the timer and waits for a queued or running sample to finish, so
+	no bus access is in flight once this returns. Clearing SamplerRunning
+	under SamplerLock keeps SM5714BatteryChargerChanged from queueing a
+	sample after the flush. A work item that saw the sampler still running
+	may re-arm the timer before the flush returns, hence the second stop.
+
+--*/
+
+{
+	PAGED_CODE();
+
+	if (DevExt->SampleWorkItem == NULL) {
+		return;
+	}
+
+	WdfWaitLockAcquire(DevExt->SamplerLock, NULL);
+	DevExt->SamplerRunning = FALSE;
+	WdfWaitLockRelease(DevExt->SamplerLock);
+
+	if (DevExt->SampleTimer != NULL) {
+		WdfTimerStop(DevExt->SampleTimer, TRUE);
+	}
+
+	WdfWorkItemFlush(DevExt->SampleWorkItem);
+	if (DevExt->SampleTimer != NULL) {
+		WdfTimerStop(DevExt->SampleTimer, TRUE);
+	}
+}
+
+_Use_decl_annotations_
+VOID
+SM5714BatterySampleTimer(
+	WDFTIMER Timer
+)
+{
+	PSM5714_BATTERY_FDO_DATA DevExt;
+
+	DevExt = GetDeviceExtension(WdfTimerGetParentObject(Timer));
+
+	//
+	// The work item re-arms the timer once its sample is taken, so a slow
+	// bus stretches the period instead of piling samples up.
+	//
+
+	WdfWorkItemEnqueue(DevExt->SampleWorkItem);
+}
+
+_Use_decl_annotations_
+VOID
+SM5714BatterySampleWorkItem(
+	WDFWORKITEM WorkItem
+)
+{
+	PSM5714_BATTERY_FDO_DATA DevExt;
+
+	PAGED_CODE();
+
+	DevExt = GetDeviceExtension(WdfWorkItemGetParentObject(WorkItem));
+	InterlockedExchange(&DevExt->ChargerChangePending, 0);
+	if (NT_SUCCESS(SM5714TelemetrySample(DevExt, NULL))) {
+		SM5714TelemetryNotifyStatus(DevExt, FALSE);
+		SM5714BatteryRefreshCycleCount(DevExt);
+	}
+
+	if (DevExt->SamplerRunning && DevExt->SampleTimer != NULL) {
+		WdfTimerStart(DevExt->SampleTimer, WDF_REL_TIMEOUT_IN_MS(SM5714TelemetrySamplePeriodMs(DevExt)));
+	}
+}
+
+_Use_decl_annotations_
+VOID
+SM5714BatteryChargerChanged(
+	PVOID Context
+)
+
+/*++
+
+Routine Description:
+
+	ChargerChanged of the direct-call interface: the PMIC read a new
+	charger status. Queues the sampler work item so an attach or detach
+	reaches the class without waiting out the period, which may be minutes
+	in low-power mode. The PMIC calls this with its data lock held, from
+	its D0 entry and interrupt paths, so nothing here touches the bus or
+	the battery class. While the sampler is stopped the change is only
+	recorded, and SM5714BatteryStartSampler samples for it.
+
+--*/
+
+{
+	PSM5714_BATTERY_FDO_DATA DevExt = (PSM5714_BATTERY_FDO_DATA)Context;
+
+	PAGED_CODE();
+
+	WdfWaitLockAcquire(DevExt->SamplerLock, NULL);
+	InterlockedExchange(&DevExt->ChargerChangePending, 1);
+	if (DevExt->SamplerRunning) {
+		WdfWorkItemEnqueue(DevExt->SampleWorkItem);
+	}
+	WdfWaitLockRelease(DevExt->SamplerLock);
+}
+
+_Use_decl_annotations_
+NTSTATUS
+SM5714BatteryCreateAlertInterrupt(
+	WDFDEVICE Device,
+	PSM5714_BATTERY_FDO_DATA DevExt,
+	PCM_PARTIAL_RESOURCE_DESCRIPTOR InterruptRaw,
+	PCM_PARTIAL_RESOURCE_DESCRIPTOR InterruptTranslated
+)
+
+/*++
+
+Routine Description:
+
+	Connects the fuel gauge alert line. INTFG is read over I2C, so the ISR
+	runs at PASSIVE_LEVEL and hands the alert to a work item.
+
+	The sampling mode stays as the registry selected it. The gauge's low
+	SoC and low voltage alarm levels are not programmed, so the alerts do
+	not cover the battery's critical and low levels, and only the sampler
+	does.
+
+--*/
+
+{
+	WDF_INTERRUPT_CONFIG InterruptConfig;
+	NTSTATUS Status;
+
+	PAGED_CODE();
+
+	WDF_INTERRUPT_CONFIG_INIT(&InterruptConfig, SM5714BatteryAlertIsr, NULL);
+	InterruptConfig.PassiveHandling = TRUE;
+	InterruptConfig.EvtInterruptWorkItem = SM5714BatteryAlertWorkItem;
+	InterruptConfig.EvtInterruptEnable = SM5714BatteryAlertInterruptEnable;
+	InterruptConfig.InterruptRaw = InterruptRaw;
+	InterruptConfig.InterruptTranslated = InterruptTranslated;
+
+	Status = WdfInterruptCreate(Device, &InterruptConfig, WDF_NO_OBJECT_ATTRIBUTES, &DevExt->AlertInterrupt);
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_ERROR, SM5714_BATTERY_ERROR, "WdfInterruptCreate(AlertInterrupt) Failed. Status 0x%x\n", Status);
+		DevExt->AlertInterrupt = NULL;
+		return Status;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+_Use_decl_annotations_
+BOOLEAN
+SM5714BatteryAlertIsr(
+	WDFINTERRUPT Interrupt,
+	ULONG MessageID
+)
+{
+	PSM5714_BATTERY_FDO_DATA DevExt;
+
+	UNREFERENCED_PARAMETER(MessageID);
+	PAGED_CODE();
+
+	DevExt = GetDeviceExtension(WdfInterruptGetDevice(Interrupt));
+
+	//
+	// Reading INTFG releases the line; an empty one belongs to whoever
+	// else shares it
+	//
+
+	if (!SM5714AlertAcknowledge(DevExt)) {
+		return FALSE;
+	}
+
+	WdfInterruptQueueWorkItemForIsr(Interrupt);
+	return TRUE;
+}
+
+_Use_decl_annotations_
+VOID
+SM5714BatteryAlertWorkItem(
+	WDFINTERRUPT Interrupt,
+	WDFOBJECT AssociatedObject
+)
+{
+	UNREFERENCED_PARAMETER(Interrupt);
+	PAGED_CODE();
+
+	SM5714AlertProcess(GetDeviceExtension(AssociatedObject));
+}
+
+_Use_decl_annotations_
+NTSTATUS
+SM5714BatteryAlertInterruptEnable(
+	WDFINTERRUPT Interrupt,
+	WDFDEVICE AssociatedDevice
+)
+{
+	UNREFERENCED_PARAMETER(Interrupt);
+	PAGED_CODE();
+
+	//
+	// Without alerts the sampler still reports everything, only later, so
+	// a failed INTFG read does not fail D0
+	//
+
+	SM5714AlertEnable(GetDeviceExtension(AssociatedDevice));
+	return STATUS_SUCCESS;
+}
+
 _Use_decl_annotations_
 NTSTATUS
 DriverEntry(
@@ -265,6 +803,8 @@ Return Value:
 	PnpPowerCallbacks.EvtDevicePrepareHardware = SM5714BatteryDevicePrepareHardware;
 	PnpPowerCallbacks.EvtDeviceSelfManagedIoInit = SM5714BatterySelfManagedIoInit;
 	PnpPowerCallbacks.EvtDeviceSelfManagedIoCleanup = SM5714BatterySelfManagedIoCleanup;
+	PnpPowerCallbacks.EvtDeviceSelfManagedIoSuspend = SM5714BatterySelfManagedIoSuspend;
+	PnpPowerCallbacks.EvtDeviceSelfManagedIoRestart = SM5714BatterySelfManagedIoRestart;
 	PnpPowerCallbacks.EvtDeviceQueryStop = SM5714BatteryQueryStop;
 	WdfDeviceInitSetPnpPowerEventCallbacks(DeviceInit, &PnpPowerCallbacks);
 
@@ -343,6 +883,38 @@ Return Value:
 		goto DriverDeviceAddEnd;
 	}
 
+	WDF_OBJECT_ATTRIBUTES_INIT(&LockAttributes);
+	LockAttributes.ParentObject = DeviceHandle;
+	Status = WdfWaitLockCreate(&LockAttributes, &DevExt->TelemetryLock);
+
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_ERROR, "WdfWaitLockCreate(TelemetryLock) Failed. Status 0x%x\n", Status);
+		goto DriverDeviceAddEnd;
+	}
+
+	Status = SM5714TelemetryCreateSnapshot(DevExt);
+	if (!NT_SUCCESS(Status)) {
+		goto DriverDeviceAddEnd;
+	}
+
+	Status = SM5714BatteryAddTelemetryInterface(DeviceHandle, DevExt);
+	if (!NT_SUCCESS(Status)) {
+		Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_ERROR, "SM5714BatteryAddTelemetryInterface() Failed. Status 0x%x\n", Status);
+		goto DriverDeviceAddEnd;
+	}
+
+	Status = SM5714ChargerCreate(DevExt);
+	if (!NT_SUCCESS(Status)) {
+		goto DriverDeviceAddEnd;
+	}
+
+	SM5714BatteryReadSettings(DeviceHandle, DevExt);
+
+	Status = SM5714BatteryCreateSampler(DeviceHandle, DevExt);
+	if (!NT_SUCCESS(Status)) {
+		goto DriverDeviceAddEnd;
+	}
+
 DriverDeviceAddEnd:
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Leaving %!FUNC!: Status = 0x%08lX\n", Status);
 	return Status;
@@ -415,8 +987,8 @@ Return Value:
 	// WMI requests.
 	//
 
-	DevExt->WmiLibContext.GuidCount = 0;
-	DevExt->WmiLibContext.GuidList = NULL;
+	DevExt->WmiLibContext.GuidCount = ARRAYSIZE(SM5714BatteryWmiGuidList);
+	DevExt->WmiLibContext.GuidList = SM5714BatteryWmiGuidList;
 	DevExt->WmiLibContext.QueryWmiRegInfo = SM5714BatteryQueryWmiRegInfo;
 	DevExt->WmiLibContext.QueryWmiDataBlock = SM5714BatteryQueryWmiDataBlock;
 	DevExt->WmiLibContext.SetWmiDataBlock = NULL;
@@ -435,6 +1007,9 @@ Return Value:
 		Status = STATUS_SUCCESS;
 	}
 
+	SM5714BatteryStartSampler(DevExt);
+	SM5714ChargerRegister(DevExt);
+
 DevicePrepareHardwareEnd:
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Leaving %!FUNC!: Status = 0x%08lX\n", Status);
 	return Status;
@@ -472,6 +1047,9 @@ Return Value:
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Entering %!FUNC!\n");
 	PAGED_CODE();
 
+	SM5714ChargerUnregister(GetDeviceExtension(Device));
+	SM5714BatteryStopSampler(GetDeviceExtension(Device));
+
 	DeviceObject = WdfDeviceWdmGetDeviceObject(Device);
 	Status = IoWMIRegistrationControl(DeviceObject, WMIREG_ACTION_DEREGISTER);
 	if (!NT_SUCCESS(Status)) {
@@ -491,6 +1069,66 @@ Return Value:
 	return;
 }
 
+_Use_decl_annotations_
+NTSTATUS
+SM5714BatterySelfManagedIoSuspend(
+	WDFDEVICE Device
+)
+
+/*++
+
+Routine Description:
+
+	Called before the device leaves D0. Stops the background sampler so the
+	gauge is not read while the I2C controller may be powered down.
+
+Arguments:
+
+	Device - Supplies a handle to a framework device object.
+
+Return Value:
+
+	NTSTATUS
+
+--*/
+
+{
+	PAGED_CODE();
+
+	SM5714BatteryStopSampler(GetDeviceExtension(Device));
+	return STATUS_SUCCESS;
+}
+
+_Use_decl_annotations_
+NTSTATUS
+SM5714BatterySelfManagedIoRestart(
+	WDFDEVICE Device
+)
+
+/*++
+
+Routine Description:
+
+	Called when the device returns to D0 after a suspend. Restarts the
+	background sampler.
+
+Arguments:
+
+	Device - Supplies a handle to a framework device object.
+
+Return Value:
+
+	NTSTATUS
+
+--*/
+
+{
+	PAGED_CODE();
+
+	SM5714BatteryStartSampler(GetDeviceExtension(Device));
+	return STATUS_SUCCESS;
+}
+
 _Use_decl_annotations_
 NTSTATUS
 SM5714BatteryQueryStop(
@@ -588,6 +1226,7 @@ Return Value:
 	PSM5714_BATTERY_FDO_DATA devContext = GetDeviceExtension(Device);
 
 	devContext->Device = Device;
+	devContext->AlertInterrupt = NULL;
 
 	//
 	// Get the resouce hub connection ID for our I2C driver
@@ -629,6 +1268,28 @@ Return Value:
 		goto exit;
 	}
 
+	devContext->BusOps = &SpbBusOps;
+	devContext->BusContext = &devContext->I2CContext;
+
+	//
+	// The alert GpioInt is optional; without it the sampler keeps polling
+	//
+	for (i = 0; i < resourceCount; i++)
+	{
+		res = WdfCmResourceListGetDescriptor(ResourcesTranslated, i);
+		resRaw = WdfCmResourceListGetDescriptor(ResourcesRaw, i);
+
+		if (res->Type == CmResourceTypeInterrupt)
+		{
+			if (!NT_SUCCESS(SM5714BatteryCreateAlertInterrupt(Device, devContext, resRaw, res)))
+			{
+				Trace(TRACE_LEVEL_WARNING, SM5714_BATTERY_TRACE, "Fuel gauge alerts unavailable, polling only\n");
+			}
+
+			break;
+		}
+	}
+
 	status = Sm5714FetchCapacities(Device,
 		&devContext->DesignedCapacity_mWh,
 		&devContext->FullChargedCapacity_mWh,
@@ -875,7 +1536,6 @@ Return Value:
 	PSM5714_BATTERY_GLOBAL_DATA GlobalData;
 	NTSTATUS Status;
 
-	UNREFERENCED_PARAMETER(MofResourceName);
 	UNREFERENCED_PARAMETER(InstanceName);
 
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Entering %!FUNC!\n");
@@ -885,6 +1545,7 @@ Return Value:
 	GlobalData = GetGlobalData(WdfGetDriver());
 	*RegFlags = WMIREG_FLAG_INSTANCE_PDO;
 	*RegistryPath = &GlobalData->RegistryPath;
+	RtlInitUnicodeString(MofResourceName, SM5714_WMI_MOF_RESOURCE_NAME);
 	*Pdo = WdfDeviceWdmGetPhysicalDevice(Device);
 	Status = STATUS_SUCCESS;
 	Trace(TRACE_LEVEL_INFORMATION, SM5714_BATTERY_TRACE, "Leaving %!FUNC!: Status = 0x%08lX\n", Status);
@@ -982,8 +1643,31 @@ Return Value:
 		BufferAvail,
 		Buffer);
 
-	if (Status == STATUS_WMI_GUID_NOT_FOUND) {
+	if (Status != STATUS_WMI_GUID_NOT_FOUND) {
+		goto SM5714BatteryQueryWmiDataBlockEnd;
+	}
+
+	switch (GuidIndex) {
+	case SM5714_WMI_SPB_STATISTICS_INDEX:
+
+		//
+		// The counters are lock-free, so the block can be filled without
+		// touching the bus or any of the driver locks.
+		//
+
+		if (BufferAvail < sizeof(SPB_STATISTICS)) {
+			Status = WmiCompleteRequest(DeviceObject, Irp, STATUS_BUFFER_TOO_SMALL, sizeof(SPB_STATISTICS), IO_NO_INCREMENT);
+			break;
+		}
+
+		SpbGetStatistics(&DevExt->I2CContext, (SPB_STATISTICS*)Buffer);
+		*InstanceLengthArray = sizeof(SPB_STATISTICS);
+		Status = WmiCompleteRequest(DeviceObject, Irp, STATUS_SUCCESS, sizeof(SPB_STATISTICS), IO_NO_INCREMENT);
+		break;
+
+	default:
 		Status = WmiCompleteRequest(DeviceObject, Irp, STATUS_WMI_GUID_NOT_FOUND, 0, IO_NO_INCREMENT);
+		break;
 	}
 
 SM5714BatteryQueryWmiDataBlockEnd:
@@ -1,11 +1,29 @@
-#include "..\Common\registers.h"
-#include "..\Common\spbhelper.h"
+#include "../Common/registers.h"
+#include "../Common/spbhelper.h"
 #include "charger.h"
-#include "..\Common\driver.h"
+#include "../Common/driver.h"
+#include "../Common/interface.h"
 
 static ULONG DebugLevel = 100;
 static ULONG DebugCatagories = DBG_INIT || DBG_PNP || DBG_IOCTL;
 
+//
+// Registers only the driver changes, so their cached value stays right.
+// INT and STATUS follow the hardware and always go to the bus.
+//
+static const SPB_REG_RANGE charger_nonvolatile_regs[] = {
+    { SM5714_CHG_REG_INTMSK1, SM5714_CHG_REG_INTMSK5 },
+    { SM5714_CHG_REG_CNTL1, SM5714_CHG_REG_CNTL1 },
+    { SM5714_CHG_REG_VBUSCNTL, SM5714_CHG_REG_VBUSCNTL },
+    { SM5714_CHG_REG_CHGCNTL2, SM5714_CHG_REG_CHGCNTL2 },
+    { SM5714_CHG_REG_CHGCNTL4, SM5714_CHG_REG_CHGCNTL5 },
+};
+
+int charger_reg_cache_init(_In_ PDEVICE_CONTEXT pDevice)
+{
+    return reg_cache_init(pDevice, 0, charger_nonvolatile_regs, ARRAYSIZE(charger_nonvolatile_regs));
+}
+
 int set_autostop(_In_ PDEVICE_CONTEXT pDevice, bool enable)
 {
     // bit 6 controls autostop.
@@ -82,15 +100,134 @@ int charger_probe(_In_ PDEVICE_CONTEXT pDevice)
 int enable_charging(_In_ PDEVICE_CONTEXT pDevice, bool enable)
 {
     unsigned short mask = (0x1 << 3);  // mask for bit 3 = 0x08
+    NTSTATUS status;
     if (enable) {
         unsigned short val = (1 << 3);     // Set bit 3 to 1
         Print(DEBUG_LEVEL_INFO, DBG_INIT, "Start charging\n");
-        return update_reg(pDevice, 0, SM5714_CHG_REG_CNTL1, mask, val);
+        status = update_reg(pDevice, 0, SM5714_CHG_REG_CNTL1, mask, val);
     }
     else {
         unsigned short val = 0; // Clear bit 3 to disable charging
         Print(DEBUG_LEVEL_INFO, DBG_INIT, "Stop charging\n");
-        return update_reg(pDevice, 0, SM5714_CHG_REG_CNTL1, mask, val);
+        status = update_reg(pDevice, 0, SM5714_CHG_REG_CNTL1, mask, val);
+    }
+
+    if (NT_SUCCESS(status)) {
+        charger_update_status(pDevice);
+    }
+
+    return status;
+}
+
+int charger_update_status(_In_ PDEVICE_CONTEXT pDevice)
+{
+    // Reads STATUS1..STATUS5 in one transfer and publishes them through the
+    // charger interface, which the battery driver reads instead of the gauge.
+    SM5714_CHARGER_STATUS chargerStatus;
+    SM5714_BATTERY_TELEMETRY telemetry;
+    SM5714_STATUS_BANK bank;
+    NTSTATUS status;
+
+    status = read_status_bank(pDevice, 0, SM5714_CHG_REG_STATUS1, &bank);
+    if (!NT_SUCCESS(status)) {
+        Print(DEBUG_LEVEL_ERROR, DBG_IOCTL, "Error reading charger status - %x\n", status);
+        return status;
+    }
+
+    RtlZeroMemory(&chargerStatus, sizeof(chargerStatus));
+    chargerStatus.Timestamp = KeQueryInterruptTime();
+    chargerStatus.VbusPresent = (bank.Status1 & SM5714_CHG_STATUS1_VBUSPOK) ? TRUE : FALSE;
+    chargerStatus.Charging = (bank.Status2 & SM5714_CHG_STATUS2_CHGON) ? TRUE : FALSE;
+    chargerStatus.Done = (bank.Status2 & (SM5714_CHG_STATUS2_TOPOFF | SM5714_CHG_STATUS2_DONE)) ? TRUE : FALSE;
+    chargerStatus.InputCurrentLimit = pDevice->InputCurrentLimit;
+    chargerStatus.ChargingCurrent = pDevice->ChargingCurrent;
+
+    PmicPublishChargerStatus(pDevice, &chargerStatus);
+
+    if (PmicGetBatteryTelemetry(pDevice, &telemetry)) {
+        Print(DEBUG_LEVEL_INFO, DBG_INIT, "Charger: VBUS %s, %s, battery %lu.%lu %%, %ld.%ld C\n",
+            chargerStatus.VbusPresent ? "present" : "absent",
+            chargerStatus.Done ? "done" : (chargerStatus.Charging ? "charging" : "not charging"),
+            telemetry.Capacity / 10, telemetry.Capacity % 10,
+            telemetry.Temperature / 10, (telemetry.Temperature < 0 ? -telemetry.Temperature : telemetry.Temperature) % 10);
+    }
+    else {
+        Print(DEBUG_LEVEL_INFO, DBG_INIT, "Charger: VBUS %s, %s\n",
+            chargerStatus.VbusPresent ? "present" : "absent",
+            chargerStatus.Done ? "done" : (chargerStatus.Charging ? "charging" : "not charging"));
+    }
+
+    return status;
+}
+
+//
+// INTMSK1 and INTMSK2 as one 16-bit pair: VBUS sources in the low byte,
+// charge state sources in the high byte
+//
+#define CHG_INT_SOURCES (SM5714_CHG_INT1_VBUS | (SM5714_CHG_INT2_CHARGE << 8))
+
+int charger_interrupt_enable(_In_ PDEVICE_CONTEXT pDevice)
+{
+    SM5714_INT_BANK stale;
+    NTSTATUS status;
+
+    // Drop the edges latched while the line was off. The status read after
+    // unmasking covers anything that changed in between.
+    status = read_int_bank(pDevice, 0, SM5714_CHG_REG_INT1, &stale);
+    if (NT_SUCCESS(status)) {
+        status = update_reg(pDevice, 0, SM5714_CHG_REG_INTMSK1, CHG_INT_SOURCES, 0);
+    }
+
+    if (!NT_SUCCESS(status)) {
+        Print(DEBUG_LEVEL_ERROR, DBG_PNP, "Error unmasking charger interrupts - %x\n", status);
+        return status;
+    }
+
+    InterlockedExchange64(&pDevice->ChargerPendingInts, 0);
+    return charger_update_status(pDevice);
+}
+
+int charger_interrupt_disable(_In_ PDEVICE_CONTEXT pDevice)
+{
+    return update_reg(pDevice, 0, SM5714_CHG_REG_INTMSK1, CHG_INT_SOURCES, CHG_INT_SOURCES);
+}
+
+bool charger_interrupt_ack(_In_ PDEVICE_CONTEXT pDevice)
+{
+    // Called from the passive-level ISR. Reading the INT bank releases the
+    // line; an empty bank means the interrupt came from the fuel gauge,
+    // which shares it.
+    SM5714_INT_BANK bank;
+    ULONGLONG ints;
+
+    if (!NT_SUCCESS(read_int_bank(pDevice, 0, SM5714_CHG_REG_INT1, &bank))) {
+        return false;
+    }
+
+    ints = SM5714_INT_BANK_BITS(&bank);
+    if (ints == 0) {
+        return false;
     }
 
-}
\ No newline at end of file
+    InterlockedOr64(&pDevice->ChargerPendingInts, (LONG64)ints);
+    return true;
+}
+
+void charger_interrupt_process(_In_ PDEVICE_CONTEXT pDevice)
+{
+    ULONGLONG ints = (ULONGLONG)InterlockedExchange64(&pDevice->ChargerPendingInts, 0);
+    unsigned char int1 = (unsigned char)(ints & 0xFF);
+    unsigned char int2 = (unsigned char)((ints >> 8) & 0xFF);
+
+    if (int1 & SM5714_CHG_INT1_VBUS) {
+        Print(DEBUG_LEVEL_INFO, DBG_PNP, "Charger: VBUS changed, INT1 %02x\n", int1);
+    }
+
+    if (int2 & SM5714_CHG_INT2_CHARGE) {
+        Print(DEBUG_LEVEL_INFO, DBG_PNP, "Charger: charge state changed, INT2 %02x\n", int2);
+    }
+
+    if ((int1 & SM5714_CHG_INT1_VBUS) || (int2 & SM5714_CHG_INT2_CHARGE)) {
+        charger_update_status(pDevice);
+    }
+}
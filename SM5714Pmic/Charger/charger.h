@@ -1,14 +1,20 @@
 #ifndef _CHARGER_H_
 #define _CHARGER_H_
 
-#include "..\Common\driver.h"
+#include "../Common/driver.h"
 
 // Function prototypes
+int charger_reg_cache_init(_In_ PDEVICE_CONTEXT pDevice);
 int set_autostop(_In_ PDEVICE_CONTEXT pDevice, bool enable);
 int set_input_current_limit(_In_ PDEVICE_CONTEXT pDevice, unsigned int mA);
 int set_charging_current(_In_ PDEVICE_CONTEXT pDevice, unsigned int mA);
 int set_topoff_current(_In_ PDEVICE_CONTEXT pDevice, unsigned int mA);
 int charger_probe(_In_ PDEVICE_CONTEXT pDevice);
 int enable_charging(_In_ PDEVICE_CONTEXT pDevice, bool enable);
+int charger_update_status(_In_ PDEVICE_CONTEXT pDevice);
+int charger_interrupt_enable(_In_ PDEVICE_CONTEXT pDevice);
+int charger_interrupt_disable(_In_ PDEVICE_CONTEXT pDevice);
+bool charger_interrupt_ack(_In_ PDEVICE_CONTEXT pDevice);
+void charger_interrupt_process(_In_ PDEVICE_CONTEXT pDevice);
 
 #endif // _CHARGER_H_
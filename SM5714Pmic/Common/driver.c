@@ -1,12 +1,19 @@
 #include "driver.h"
 #include "..\Charger\charger.h"
 #include "..\TypeC\typec.h"
+#include "interface.h"
+#include "spbhelper.h"
 
 static ULONG DebugLevel = 100;
 static ULONG DebugCatagories = DBG_INIT || DBG_PNP || DBG_IOCTL;
 
 #define GET_INTEGER(_arg_) (*(PULONG UNALIGNED)((_arg_)->Data))
 
+EVT_WDF_INTERRUPT_ISR OnInterruptIsr;
+EVT_WDF_INTERRUPT_WORKITEM OnInterruptWorkItem;
+EVT_WDF_INTERRUPT_ENABLE OnInterruptEnable;
+EVT_WDF_INTERRUPT_DISABLE OnInterruptDisable;
+
 static
 NTSTATUS
 FetchPmicConfig(
@@ -90,6 +97,127 @@ DriverEntry(
     return status;
 }
 
+static
+NTSTATUS
+CreatePmicInterrupt(
+    _In_  WDFDEVICE                        FxDevice,
+    _In_  PCM_PARTIAL_RESOURCE_DESCRIPTOR  InterruptRaw,
+    _In_  PCM_PARTIAL_RESOURCE_DESCRIPTOR  InterruptTranslated,
+    _Out_ WDFINTERRUPT*                    Interrupt
+)
+{
+    // INTn is read over I2C, so the ISR runs at PASSIVE_LEVEL and hands
+    // the decoded bits to a work item
+    WDF_INTERRUPT_CONFIG interruptConfig;
+    NTSTATUS status;
+
+    WDF_INTERRUPT_CONFIG_INIT(&interruptConfig, OnInterruptIsr, NULL);
+    interruptConfig.PassiveHandling = TRUE;
+    interruptConfig.EvtInterruptWorkItem = OnInterruptWorkItem;
+    interruptConfig.EvtInterruptEnable = OnInterruptEnable;
+    interruptConfig.EvtInterruptDisable = OnInterruptDisable;
+    interruptConfig.InterruptRaw = InterruptRaw;
+    interruptConfig.InterruptTranslated = InterruptTranslated;
+
+    status = WdfInterruptCreate(FxDevice, &interruptConfig, WDF_NO_OBJECT_ATTRIBUTES, Interrupt);
+    if (!NT_SUCCESS(status))
+    {
+        Print(DEBUG_LEVEL_ERROR, DBG_PNP, "WdfInterruptCreate failed 0x%x\n", status);
+        *Interrupt = NULL;
+    }
+
+    return status;
+}
+
+BOOLEAN
+OnInterruptIsr(
+    _In_  WDFINTERRUPT  Interrupt,
+    _In_  ULONG         MessageID
+)
+{
+    PDEVICE_CONTEXT pDevice = GetDeviceContext(WdfInterruptGetDevice(Interrupt));
+    bool pending;
+
+    UNREFERENCED_PARAMETER(MessageID);
+
+    if (Interrupt == pDevice->InterruptObject)
+    {
+        pending = charger_interrupt_ack(pDevice);
+    }
+    else
+    {
+        pending = typec_interrupt_ack(pDevice);
+    }
+
+    if (!pending)
+    {
+        return FALSE;
+    }
+
+    WdfInterruptQueueWorkItemForIsr(Interrupt);
+    return TRUE;
+}
+
+VOID
+OnInterruptWorkItem(
+    _In_  WDFINTERRUPT  Interrupt,
+    _In_  WDFOBJECT     AssociatedObject
+)
+{
+    PDEVICE_CONTEXT pDevice = GetDeviceContext(AssociatedObject);
+
+    if (Interrupt == pDevice->InterruptObject)
+    {
+        charger_interrupt_process(pDevice);
+    }
+    else
+    {
+        typec_interrupt_process(pDevice);
+    }
+}
+
+NTSTATUS
+OnInterruptEnable(
+    _In_  WDFINTERRUPT  Interrupt,
+    _In_  WDFDEVICE     AssociatedDevice
+)
+{
+    PDEVICE_CONTEXT pDevice = GetDeviceContext(AssociatedDevice);
+
+    // Without events the charger still works from D0 entry on, so a
+    // source that refuses its mask does not fail the power up
+    if (Interrupt == pDevice->InterruptObject)
+    {
+        charger_interrupt_enable(pDevice);
+    }
+    else
+    {
+        typec_interrupt_enable(pDevice);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+OnInterruptDisable(
+    _In_  WDFINTERRUPT  Interrupt,
+    _In_  WDFDEVICE     AssociatedDevice
+)
+{
+    PDEVICE_CONTEXT pDevice = GetDeviceContext(AssociatedDevice);
+
+    if (Interrupt == pDevice->InterruptObject)
+    {
+        charger_interrupt_disable(pDevice);
+    }
+    else
+    {
+        typec_interrupt_disable(pDevice);
+    }
+
+    return STATUS_SUCCESS;
+}
+
 NTSTATUS
 OnPrepareHardware(
     _In_  WDFDEVICE     FxDevice,
@@ -100,7 +228,8 @@ OnPrepareHardware(
 
 Routine Description:
 
-This routine caches the SPB resource connection ID.
+This routine caches the SPB resource connection ID and connects the
+charger and USBPD interrupts.
 
 Arguments:
 
@@ -120,7 +249,9 @@ Status
     NTSTATUS status = STATUS_INSUFFICIENT_RESOURCES;
     pDevice->SpbContextCount = 0;  // Start with zero IC handles
 
-    UNREFERENCED_PARAMETER(FxResourcesRaw);
+    // GpioInt resources in _CRS order: charger, then USBPD
+    ULONG interruptIndex[ARRAYSIZE(pDevice->SpbContexts)];
+    ULONG interruptCount = 0;
 
     //
     // Parse the peripheral's resources.
@@ -137,6 +268,15 @@ Status
             continue;
         }
 
+        if (pDescriptor->Type == CmResourceTypeInterrupt)
+        {
+            if (interruptCount < ARRAYSIZE(interruptIndex))
+            {
+                interruptIndex[interruptCount++] = i;
+            }
+            continue;
+        }
+
         if (pDescriptor->Type == CmResourceTypeConnection &&
             pDescriptor->u.Connection.Class == CM_RESOURCE_CONNECTION_CLASS_SERIAL &&
             pDescriptor->u.Connection.Type == CM_RESOURCE_CONNECTION_TYPE_SERIAL_I2C)
@@ -173,6 +313,44 @@ Status
         status = STATUS_NOT_FOUND;
     }
 
+    // Cache the registers only the driver writes: index 0 is the charger,
+    // 1 the USBPD port controller
+    if (NT_SUCCESS(status))
+    {
+        status = charger_reg_cache_init(pDevice);
+        if (NT_SUCCESS(status) && pDevice->SpbContextCount > 1)
+        {
+            status = typec_reg_cache_init(pDevice);
+        }
+
+        if (!NT_SUCCESS(status))
+        {
+            Print(DEBUG_LEVEL_ERROR, DBG_PNP, "Error creating register cache - %x\n", status);
+        }
+    }
+
+    // Each interrupt needs the bus of its source to be acknowledged. Both
+    // are optional: without them the status is only read at D0 entry.
+    if (NT_SUCCESS(status))
+    {
+        WDFINTERRUPT* interrupts[ARRAYSIZE(interruptIndex)] =
+            { &pDevice->InterruptObject, &pDevice->TypeCInterruptObject };
+
+        for (ULONG i = 0; i < interruptCount && i < pDevice->SpbContextCount; i++)
+        {
+            CreatePmicInterrupt(
+                FxDevice,
+                WdfCmResourceListGetDescriptor(FxResourcesRaw, interruptIndex[i]),
+                WdfCmResourceListGetDescriptor(FxResourcesTranslated, interruptIndex[i]),
+                interrupts[i]);
+        }
+    }
+
+    // Battery telemetry is optional, the charger works without it
+    if (NT_SUCCESS(status))
+    {
+        PmicInterfaceRegister(pDevice);
+    }
 
 
     return status;
@@ -202,6 +380,12 @@ Status
     PDEVICE_CONTEXT pDevice = GetDeviceContext(FxDevice);
     UNREFERENCED_PARAMETER(FxResourcesTranslated);
 
+    PmicInterfaceUnregister(pDevice);
+
+    // The framework deletes interrupts created in prepare hardware
+    pDevice->InterruptObject = NULL;
+    pDevice->TypeCInterruptObject = NULL;
+
     // Deinitialize each SPB_CONTEXT in the array
     for (ULONG i = 0; i < pDevice->SpbContextCount; i++)
     {
@@ -241,6 +425,17 @@ Status
     NTSTATUS status = STATUS_SUCCESS;
     Print(DEBUG_LEVEL_INFO, DBG_PNP, "OnD0Entry called\n");
 
+    // Put back what the driver wrote in case the PMIC lost it while the
+    // device was off, so the cached values match the slaves again
+    for (ULONG i = 0; i < pDevice->SpbContextCount; i++)
+    {
+        status = reg_cache_sync(pDevice, i);
+        if (!NT_SUCCESS(status))
+        {
+            reg_cache_invalidate(pDevice, i);
+        }
+    }
+
     status = FetchPmicConfig(FxDevice, pDevice);
     if (!NT_SUCCESS(status))
     {
@@ -274,13 +469,6 @@ Status
         goto exit;
     }
 
-    status = WdfWaitLockCreate(WDF_NO_OBJECT_ATTRIBUTES, &pDevice->DataLock);
-	if (!NT_SUCCESS(status))
-	{
-		Print(DEBUG_LEVEL_ERROR, DBG_IOCTL, "Error creating Data Waitlock - %!STATUS!", status);
-		goto exit;
-	}
-
 exit:
     return status;
 }
@@ -317,10 +505,11 @@ Status
         enable_charging(pDevice, false);
     }
 
-    if (pDevice->DataLock != NULL)
+    for (ULONG i = 0; i < pDevice->SpbContextCount; i++)
     {
-        WdfObjectDelete(pDevice->DataLock);
+        reg_cache_dump(pDevice, i);
     }
+
     return status;
 }
 
@@ -397,6 +586,25 @@ EvtDeviceAdd(
     devContext = GetDeviceContext(device);
     devContext->FxDevice = device;
 
+    //
+    // DataLock lives as long as the device: the charger status it guards
+    // is read through the charger interface in any power state
+    //
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = device;
+    status = WdfWaitLockCreate(&attributes, &devContext->DataLock);
+    if (!NT_SUCCESS(status))
+    {
+        Print(DEBUG_LEVEL_ERROR, DBG_PNP, "WdfWaitLockCreate failed 0x%x\n", status);
+        return status;
+    }
+
+    status = PmicInterfaceCreate(device, devContext);
+    if (!NT_SUCCESS(status))
+    {
+        return status;
+    }
+
     WDF_IO_QUEUE_CONFIG_INIT(&queueConfig, WdfIoQueueDispatchManual);
 
     queueConfig.PowerManaged = WdfFalse;
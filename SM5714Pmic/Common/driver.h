@@ -16,6 +16,7 @@
 #include <ntstrsafe.h>
 
 #include "spb.h"
+#include "../../SM5714Battery/inc/sm5714_interface.h"
 
 //
 // String definitions
@@ -34,7 +35,8 @@ typedef struct _DEVICE_CONTEXT
 {
 
 	WDFDEVICE FxDevice;
-	WDFINTERRUPT InterruptObject;
+	WDFINTERRUPT InterruptObject;        // Charger GpioInt
+	WDFINTERRUPT TypeCInterruptObject;   // USBPD GpioInt
 	WDFQUEUE ReportQueue;
 	SPB_CONTEXT     SpbContexts[2];
 	ULONG           SpbContextCount;
@@ -46,6 +48,34 @@ typedef struct _DEVICE_CONTEXT
 	ULONG                           ChargingCurrent;     // mA
 	ULONG                           TopoffCurrent;       // mA
 
+	//
+	// Charger status exported to the battery driver. Written under
+	// DataLock, at DISPATCH_LEVEL while ChargerStatusSequence is odd, so
+	// the interface can copy it without a lock at up to DISPATCH_LEVEL.
+	//
+	volatile LONG                   ChargerStatusSequence;
+	SM5714_CHARGER_STATUS           ChargerStatus;
+
+	//
+	// Telemetry interface of the battery driver, guarded by DataLock.
+	// interface.c finds the battery through a PnP notification and keeps
+	// it open as a remote target.
+	//
+	SM5714_BATTERY_TELEMETRY_INTERFACE BatteryInterface;
+	BOOLEAN                         BatteryConnected;
+	PVOID                           BatteryNotificationEntry;
+	WDFWORKITEM                     BatteryWorkItem;
+	WDFSTRING                       BatteryLink;
+	WDFIOTARGET                     BatteryTarget;
+
+	//
+	// INTn bytes read by the passive-level ISRs and not handled yet, INT1
+	// in the low byte. The interrupt work items drain them.
+	//
+	volatile LONG64                 ChargerPendingInts;
+	volatile LONG64                 TypeCPendingInts;
+	BOOLEAN                         TypeCAttached;
+
 } DEVICE_CONTEXT, *PDEVICE_CONTEXT;
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(DEVICE_CONTEXT, GetDeviceContext)
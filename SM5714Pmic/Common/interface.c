@@ -0,0 +1,484 @@
+#include "interface.h"
+#include <wdmguid.h>
+
+static ULONG DebugLevel = 100;
+static ULONG DebugCatagories = DBG_INIT || DBG_PNP || DBG_IOCTL;
+
+static DRIVER_NOTIFICATION_CALLBACK_ROUTINE PmicBatteryInterfaceChange;
+static EVT_WDF_WORKITEM PmicBatteryWorkItem;
+static EVT_WDF_IO_TARGET_QUERY_REMOVE PmicBatteryQueryRemove;
+static EVT_WDF_IO_TARGET_REMOVE_CANCELED PmicBatteryRemoveCanceled;
+static EVT_WDF_IO_TARGET_REMOVE_COMPLETE PmicBatteryRemoveComplete;
+static SM5714_PMIC_GET_CHARGER_STATUS PmicGetChargerStatus;
+
+//
+// GetChargerStatus of the charger interface. Copies the published status
+// without a lock, retrying while PmicPublishChargerStatus is in the middle
+// of it; callable at DISPATCH_LEVEL.
+//
+static
+VOID
+PmicGetChargerStatus(
+    _In_ PVOID Context,
+    _Out_ PSM5714_CHARGER_STATUS Status
+)
+{
+    PDEVICE_CONTEXT pDevice = (PDEVICE_CONTEXT)Context;
+    LONG sequence;
+
+    for (;;)
+    {
+        sequence = ReadAcquire(&pDevice->ChargerStatusSequence);
+        if ((sequence & 1) == 0)
+        {
+            RtlCopyMemory(Status, &pDevice->ChargerStatus, sizeof(*Status));
+            KeMemoryBarrier();
+            if (ReadNoFence(&pDevice->ChargerStatusSequence) == sequence)
+            {
+                Status->Version = (ULONG)sequence / 2;
+                return;
+            }
+        }
+
+        YieldProcessor();
+    }
+}
+
+VOID
+PmicPublishChargerStatus(
+    _In_ PDEVICE_CONTEXT pDevice,
+    _In_ const SM5714_CHARGER_STATUS* Status
+)
+/*++
+
+Routine Description:
+
+Publishes a charger status read from the PMIC and, when anything but the
+timestamp changed, tells a connected battery driver so it samples now.
+
+--*/
+{
+    SM5714_CHARGER_STATUS published;
+    BOOLEAN changed;
+    KIRQL oldIrql;
+
+    PAGED_CODE();
+
+    published = *Status;
+    published.Valid = TRUE;
+
+    WdfWaitLockAcquire(pDevice->DataLock, NULL);
+
+    changed = !pDevice->ChargerStatus.Valid ||
+        pDevice->ChargerStatus.VbusPresent != Status->VbusPresent ||
+        pDevice->ChargerStatus.Charging != Status->Charging ||
+        pDevice->ChargerStatus.Done != Status->Done ||
+        pDevice->ChargerStatus.InputCurrentLimit != Status->InputCurrentLimit ||
+        pDevice->ChargerStatus.ChargingCurrent != Status->ChargingCurrent;
+
+    //
+    // PmicGetChargerStatus may run at DISPATCH_LEVEL and spins while the
+    // sequence is odd, so this window must not be preempted on its CPU
+    //
+    KeRaiseIrql(DISPATCH_LEVEL, &oldIrql);
+    InterlockedIncrement(&pDevice->ChargerStatusSequence);
+    pDevice->ChargerStatus = published;
+    InterlockedIncrement(&pDevice->ChargerStatusSequence);
+    KeLowerIrql(oldIrql);
+
+    //
+    // Called with DataLock held so the battery cannot be disconnected
+    // under the call; it only reads the status back lock free
+    //
+    if (changed && pDevice->BatteryConnected)
+    {
+        pDevice->BatteryInterface.ChargerChanged(pDevice->BatteryInterface.InterfaceHeader.Context);
+    }
+
+    WdfWaitLockRelease(pDevice->DataLock);
+}
+
+BOOLEAN
+PmicGetBatteryTelemetry(
+    _In_ PDEVICE_CONTEXT pDevice,
+    _Out_ PSM5714_BATTERY_TELEMETRY Telemetry
+)
+/*++
+
+Routine Description:
+
+Copies the battery driver's newest fuel gauge sample. Returns FALSE while
+the battery is not connected or has no sample yet.
+
+--*/
+{
+    BOOLEAN valid = FALSE;
+
+    PAGED_CODE();
+
+    RtlZeroMemory(Telemetry, sizeof(*Telemetry));
+
+    WdfWaitLockAcquire(pDevice->DataLock, NULL);
+    if (pDevice->BatteryConnected)
+    {
+        pDevice->BatteryInterface.GetTelemetry(pDevice->BatteryInterface.InterfaceHeader.Context, Telemetry);
+        valid = Telemetry->Valid;
+    }
+    WdfWaitLockRelease(pDevice->DataLock);
+
+    return valid;
+}
+
+static
+VOID
+PmicBatteryConnect(
+    _In_ PDEVICE_CONTEXT pDevice
+)
+{
+    SM5714_BATTERY_TELEMETRY_INTERFACE batteryInterface;
+    NTSTATUS status;
+
+    PAGED_CODE();
+
+    RtlZeroMemory(&batteryInterface, sizeof(batteryInterface));
+    status = WdfIoTargetQueryForInterface(pDevice->BatteryTarget,
+        &GUID_SM5714_BATTERY_TELEMETRY_INTERFACE,
+        (PINTERFACE)&batteryInterface,
+        sizeof(batteryInterface),
+        SM5714_BATTERY_TELEMETRY_INTERFACE_VERSION,
+        NULL);
+
+    if (!NT_SUCCESS(status))
+    {
+        Print(DEBUG_LEVEL_ERROR, DBG_PNP, "WdfIoTargetQueryForInterface(battery) failed 0x%x\n", status);
+        return;
+    }
+
+    WdfWaitLockAcquire(pDevice->DataLock, NULL);
+    pDevice->BatteryInterface = batteryInterface;
+    pDevice->BatteryConnected = TRUE;
+
+    //
+    // The battery may have started after the charger status was read
+    //
+    if (pDevice->ChargerStatus.Valid)
+    {
+        pDevice->BatteryInterface.ChargerChanged(pDevice->BatteryInterface.InterfaceHeader.Context);
+    }
+    WdfWaitLockRelease(pDevice->DataLock);
+
+    Print(DEBUG_LEVEL_INFO, DBG_PNP, "Battery telemetry interface connected\n");
+}
+
+static
+VOID
+PmicBatteryDisconnect(
+    _In_ PDEVICE_CONTEXT pDevice
+)
+{
+    PAGED_CODE();
+
+    WdfWaitLockAcquire(pDevice->DataLock, NULL);
+    pDevice->BatteryConnected = FALSE;
+    RtlZeroMemory(&pDevice->BatteryInterface, sizeof(pDevice->BatteryInterface));
+    WdfWaitLockRelease(pDevice->DataLock);
+}
+
+NTSTATUS
+PmicInterfaceCreate(
+    _In_ WDFDEVICE FxDevice,
+    _In_ PDEVICE_CONTEXT pDevice
+)
+/*++
+
+Routine Description:
+
+Exports the charger interface, registers the device interface the battery
+driver looks for and creates the work item that opens the battery.
+
+--*/
+{
+    SM5714_PMIC_CHARGER_INTERFACE chargerInterface;
+    WDF_QUERY_INTERFACE_CONFIG queryInterfaceConfig;
+    WDF_WORKITEM_CONFIG workItemConfig;
+    WDF_OBJECT_ATTRIBUTES attributes;
+    NTSTATUS status;
+
+    PAGED_CODE();
+
+    RtlZeroMemory(&chargerInterface, sizeof(chargerInterface));
+    chargerInterface.InterfaceHeader.Size = sizeof(chargerInterface);
+    chargerInterface.InterfaceHeader.Version = SM5714_PMIC_CHARGER_INTERFACE_VERSION;
+    chargerInterface.InterfaceHeader.Context = pDevice;
+    chargerInterface.InterfaceHeader.InterfaceReference = WdfDeviceInterfaceReferenceNoOp;
+    chargerInterface.InterfaceHeader.InterfaceDereference = WdfDeviceInterfaceDereferenceNoOp;
+    chargerInterface.GetChargerStatus = PmicGetChargerStatus;
+
+    WDF_QUERY_INTERFACE_CONFIG_INIT(&queryInterfaceConfig,
+        (PINTERFACE)&chargerInterface,
+        &GUID_SM5714_PMIC_CHARGER_INTERFACE,
+        NULL);
+
+    status = WdfDeviceAddQueryInterface(FxDevice, &queryInterfaceConfig);
+    if (!NT_SUCCESS(status))
+    {
+        Print(DEBUG_LEVEL_ERROR, DBG_PNP, "WdfDeviceAddQueryInterface failed 0x%x\n", status);
+        return status;
+    }
+
+    status = WdfDeviceCreateDeviceInterface(FxDevice, &GUID_SM5714_PMIC_CHARGER_INTERFACE, NULL);
+    if (!NT_SUCCESS(status))
+    {
+        Print(DEBUG_LEVEL_ERROR, DBG_PNP, "WdfDeviceCreateDeviceInterface failed 0x%x\n", status);
+        return status;
+    }
+
+    WDF_WORKITEM_CONFIG_INIT(&workItemConfig, PmicBatteryWorkItem);
+    workItemConfig.AutomaticSerialization = FALSE;
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = FxDevice;
+    status = WdfWorkItemCreate(&workItemConfig, &attributes, &pDevice->BatteryWorkItem);
+    if (!NT_SUCCESS(status))
+    {
+        Print(DEBUG_LEVEL_ERROR, DBG_PNP, "WdfWorkItemCreate failed 0x%x\n", status);
+    }
+
+    return status;
+}
+
+VOID
+PmicInterfaceRegister(
+    _In_ PDEVICE_CONTEXT pDevice
+)
+/*++
+
+Routine Description:
+
+Starts watching for the battery driver's telemetry interface. A battery
+that is already started is reported right away. Failure only leaves the
+charger without battery telemetry.
+
+--*/
+{
+    NTSTATUS status;
+
+    PAGED_CODE();
+
+    status = IoRegisterPlugPlayNotification(EventCategoryDeviceInterfaceChange,
+        PNPNOTIFY_DEVICE_INTERFACE_INCLUDE_EXISTING_INTERFACES,
+        (PVOID)&GUID_SM5714_BATTERY_TELEMETRY_INTERFACE,
+        WdfDriverWdmGetDriverObject(WdfDeviceGetDriver(pDevice->FxDevice)),
+        PmicBatteryInterfaceChange,
+        pDevice,
+        &pDevice->BatteryNotificationEntry);
+
+    if (!NT_SUCCESS(status))
+    {
+        Print(DEBUG_LEVEL_ERROR, DBG_PNP, "IoRegisterPlugPlayNotification(battery) failed 0x%x\n", status);
+        pDevice->BatteryNotificationEntry = NULL;
+    }
+}
+
+VOID
+PmicInterfaceUnregister(
+    _In_ PDEVICE_CONTEXT pDevice
+)
+/*++
+
+Routine Description:
+
+Stops watching for the battery and closes it. No call into the battery is
+in flight or can start once this returns.
+
+--*/
+{
+    WDFSTRING link;
+
+    PAGED_CODE();
+
+    if (pDevice->BatteryNotificationEntry != NULL)
+    {
+        IoUnregisterPlugPlayNotificationEx(pDevice->BatteryNotificationEntry);
+        pDevice->BatteryNotificationEntry = NULL;
+    }
+
+    WdfWorkItemFlush(pDevice->BatteryWorkItem);
+
+    link = (WDFSTRING)InterlockedExchangePointer((PVOID volatile*)&pDevice->BatteryLink, NULL);
+    if (link != NULL)
+    {
+        WdfObjectDelete(link);
+    }
+
+    PmicBatteryDisconnect(pDevice);
+
+    if (pDevice->BatteryTarget != NULL)
+    {
+        WdfObjectDelete(pDevice->BatteryTarget);
+        pDevice->BatteryTarget = NULL;
+    }
+}
+
+static
+NTSTATUS
+PmicBatteryInterfaceChange(
+    _In_ PVOID NotificationStructure,
+    _Inout_opt_ PVOID Context
+)
+/*++
+
+Routine Description:
+
+Device interface notification for the battery. Opening a device from
+inside the notification can deadlock PnP, so an arrival only records the
+symbolic link for the work item; removals come through the target's own
+callbacks.
+
+--*/
+{
+    PDEVICE_INTERFACE_CHANGE_NOTIFICATION notification;
+    PDEVICE_CONTEXT pDevice = (PDEVICE_CONTEXT)Context;
+    WDF_OBJECT_ATTRIBUTES attributes;
+    WDFSTRING link;
+    WDFSTRING previous;
+    NTSTATUS status;
+
+    PAGED_CODE();
+
+    notification = (PDEVICE_INTERFACE_CHANGE_NOTIFICATION)NotificationStructure;
+    if (!IsEqualGUID(&notification->Event, &GUID_DEVICE_INTERFACE_ARRIVAL) ||
+        pDevice->BatteryTarget != NULL)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = pDevice->FxDevice;
+    status = WdfStringCreate(notification->SymbolicLinkName, &attributes, &link);
+    if (!NT_SUCCESS(status))
+    {
+        Print(DEBUG_LEVEL_ERROR, DBG_PNP, "WdfStringCreate(battery) failed 0x%x\n", status);
+        return STATUS_SUCCESS;
+    }
+
+    previous = (WDFSTRING)InterlockedExchangePointer((PVOID volatile*)&pDevice->BatteryLink, link);
+    if (previous != NULL)
+    {
+        WdfObjectDelete(previous);
+    }
+
+    WdfWorkItemEnqueue(pDevice->BatteryWorkItem);
+    return STATUS_SUCCESS;
+}
+
+static
+VOID
+PmicBatteryWorkItem(
+    _In_ WDFWORKITEM WorkItem
+)
+{
+    PDEVICE_CONTEXT pDevice;
+    WDF_IO_TARGET_OPEN_PARAMS openParams;
+    WDF_OBJECT_ATTRIBUTES attributes;
+    UNICODE_STRING name;
+    WDFIOTARGET target;
+    WDFSTRING link;
+    NTSTATUS status;
+
+    PAGED_CODE();
+
+    pDevice = GetDeviceContext(WdfWorkItemGetParentObject(WorkItem));
+
+    link = (WDFSTRING)InterlockedExchangePointer((PVOID volatile*)&pDevice->BatteryLink, NULL);
+    if (link == NULL)
+    {
+        return;
+    }
+
+    if (pDevice->BatteryTarget != NULL)
+    {
+        goto exit;
+    }
+
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = pDevice->FxDevice;
+    status = WdfIoTargetCreate(pDevice->FxDevice, &attributes, &target);
+    if (!NT_SUCCESS(status))
+    {
+        Print(DEBUG_LEVEL_ERROR, DBG_PNP, "WdfIoTargetCreate(battery) failed 0x%x\n", status);
+        goto exit;
+    }
+
+    WdfStringGetUnicodeString(link, &name);
+    WDF_IO_TARGET_OPEN_PARAMS_INIT_OPEN_BY_NAME(&openParams, &name, STANDARD_RIGHTS_READ);
+    openParams.EvtIoTargetQueryRemove = PmicBatteryQueryRemove;
+    openParams.EvtIoTargetRemoveCanceled = PmicBatteryRemoveCanceled;
+    openParams.EvtIoTargetRemoveComplete = PmicBatteryRemoveComplete;
+
+    status = WdfIoTargetOpen(target, &openParams);
+    if (!NT_SUCCESS(status))
+    {
+        Print(DEBUG_LEVEL_ERROR, DBG_PNP, "WdfIoTargetOpen(battery) failed 0x%x\n", status);
+        WdfObjectDelete(target);
+        goto exit;
+    }
+
+    pDevice->BatteryTarget = target;
+    PmicBatteryConnect(pDevice);
+
+exit:
+    WdfObjectDelete(link);
+}
+
+static
+NTSTATUS
+PmicBatteryQueryRemove(
+    _In_ WDFIOTARGET IoTarget
+)
+{
+    PAGED_CODE();
+
+    PmicBatteryDisconnect(GetDeviceContext(WdfIoTargetGetDevice(IoTarget)));
+    WdfIoTargetCloseForQueryRemove(IoTarget);
+    return STATUS_SUCCESS;
+}
+
+static
+VOID
+PmicBatteryRemoveCanceled(
+    _In_ WDFIOTARGET IoTarget
+)
+{
+    PDEVICE_CONTEXT pDevice = GetDeviceContext(WdfIoTargetGetDevice(IoTarget));
+    WDF_IO_TARGET_OPEN_PARAMS openParams;
+    NTSTATUS status;
+
+    PAGED_CODE();
+
+    WDF_IO_TARGET_OPEN_PARAMS_INIT_REOPEN(&openParams);
+    status = WdfIoTargetOpen(IoTarget, &openParams);
+    if (!NT_SUCCESS(status))
+    {
+        Print(DEBUG_LEVEL_ERROR, DBG_PNP, "WdfIoTargetOpen(battery, reopen) failed 0x%x\n", status);
+        pDevice->BatteryTarget = NULL;
+        WdfObjectDelete(IoTarget);
+        return;
+    }
+
+    PmicBatteryConnect(pDevice);
+}
+
+static
+VOID
+PmicBatteryRemoveComplete(
+    _In_ WDFIOTARGET IoTarget
+)
+{
+    PDEVICE_CONTEXT pDevice = GetDeviceContext(WdfIoTargetGetDevice(IoTarget));
+
+    PAGED_CODE();
+
+    PmicBatteryDisconnect(pDevice);
+    pDevice->BatteryTarget = NULL;
+    WdfObjectDelete(IoTarget);
+}
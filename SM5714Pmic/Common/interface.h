@@ -0,0 +1,40 @@
+#ifndef _INTERFACE_H_
+#define _INTERFACE_H_
+
+#include "driver.h"
+
+//
+// Direct-call interfaces shared with the SM5714 battery driver, see
+// sm5714_interface.h. The PMIC exports its charger status and consumes
+// the battery's telemetry.
+//
+
+NTSTATUS
+PmicInterfaceCreate(
+	_In_ WDFDEVICE FxDevice,
+	_In_ PDEVICE_CONTEXT pDevice
+);
+
+VOID
+PmicInterfaceRegister(
+	_In_ PDEVICE_CONTEXT pDevice
+);
+
+VOID
+PmicInterfaceUnregister(
+	_In_ PDEVICE_CONTEXT pDevice
+);
+
+VOID
+PmicPublishChargerStatus(
+	_In_ PDEVICE_CONTEXT pDevice,
+	_In_ const SM5714_CHARGER_STATUS* Status
+);
+
+BOOLEAN
+PmicGetBatteryTelemetry(
+	_In_ PDEVICE_CONTEXT pDevice,
+	_Out_ PSM5714_BATTERY_TELEMETRY Telemetry
+);
+
+#endif // _INTERFACE_H_
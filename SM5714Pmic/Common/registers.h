@@ -4,6 +4,19 @@
 //
 // Charger Register definitions
 //
+enum chg_int_regs {
+    SM5714_CHG_REG_INT1         = 0x01,
+    SM5714_CHG_REG_INT2         = 0x02,
+    SM5714_CHG_REG_INT3         = 0x03,
+    SM5714_CHG_REG_INT4         = 0x04,
+    SM5714_CHG_REG_INT5         = 0x05,
+    SM5714_CHG_REG_INTMSK1      = 0x07,
+    SM5714_CHG_REG_INTMSK2      = 0x08,
+    SM5714_CHG_REG_INTMSK3      = 0x09,
+    SM5714_CHG_REG_INTMSK4      = 0x0A,
+    SM5714_CHG_REG_INTMSK5      = 0x0B,
+};
+
 enum chg_status_regs {
     SM5714_CHG_REG_STATUS1      = 0x0D,
     SM5714_CHG_REG_STATUS2      = 0x0E,
@@ -12,6 +25,23 @@ enum chg_status_regs {
     SM5714_CHG_REG_STATUS5      = 0x11,
 };
 
+//
+// Charger status bits, as the vendor kernel driver decodes them
+//
+#define SM5714_CHG_STATUS1_VBUSPOK      (0x1 << 0)
+#define SM5714_CHG_STATUS1_VBUSUVLO     (0x1 << 1)
+#define SM5714_CHG_STATUS1_VBUSOVP      (0x1 << 2)
+#define SM5714_CHG_STATUS2_CHGON        (0x1 << 2)
+#define SM5714_CHG_STATUS2_TOPOFF       (0x1 << 3)
+#define SM5714_CHG_STATUS2_DONE         (0x1 << 5)
+
+//
+// INTn latches the edges of the STATUSn bits and clears on read; a set
+// INTMSKn bit keeps its source off the interrupt line
+//
+#define SM5714_CHG_INT1_VBUS            (SM5714_CHG_STATUS1_VBUSPOK | SM5714_CHG_STATUS1_VBUSUVLO | SM5714_CHG_STATUS1_VBUSOVP)
+#define SM5714_CHG_INT2_CHARGE          (SM5714_CHG_STATUS2_CHGON | SM5714_CHG_STATUS2_TOPOFF | SM5714_CHG_STATUS2_DONE)
+
 enum chg_cntl_regs {
     SM5714_CHG_REG_CNTL1 = 0x13,
     SM5714_CHG_REG_VBUSCNTL = 0x15,
@@ -104,4 +134,12 @@ enum typec_usbpd_reg {
 	SM5714_REG_PD_STATE5 = 0xDA
 };
 
+//
+// USBPD INT1/STATUS1 bits, as the vendor kernel driver decodes them. INTn
+// clears on read; a set INT_MASKn bit keeps its source off the line.
+//
+#define SM5714_REG_INT_STATUS1_VBUSPOK  (0x1 << 0)
+#define SM5714_REG_INT_STATUS1_ATTACH   (0x1 << 2)
+#define SM5714_REG_INT_STATUS1_DETACH   (0x1 << 3)
+
 #endif
\ No newline at end of file
@@ -312,22 +312,23 @@ NTSTATUS Status indicating success or failure
 	return status;
 }
 
+static
 NTSTATUS
 _SpbSequence(
 	_In_                        SPB_CONTEXT* SpbContext,
-	_In_reads_(SequenceLength)  PVOID        Sequence,
-	_In_                        SIZE_T       SequenceLength,
+	_In_                        ULONG        TransferCount,
 	_Out_                       PULONG       BytesReturned,
 	_In_                        ULONG        Timeout
 )
 /*++
 
   Routine Description:
-	This routine forwards a sequence request to the SPB I/O target
+	This routine forwards the transfer list built in SpbContext->Sequence
+	to the SPB I/O target, reusing the request and memory objects created
+	by SpbTargetInitialize. The caller must hold SpbLock.
   Arguments:
-	FxIoTarget      - The SPB IoTarget to which to send the IOCTL/Read/Write
-	Sequence        - Pointer to a list of sequence transfers
-	SequenceLength  - Length of sequence transfers
+	SpbContext      - Pointer to the current device context
+	TransferCount   - Number of entries filled in SpbContext->Sequence
 	BytesReturned   - The number of bytes transferred in the actual transaction
 	Timeout         - The timeout associated with this transfer
 						Default is HIDI2C_REQUEST_DEFAULT_TIMEOUT second
@@ -338,34 +339,35 @@ _SpbSequence(
 {
 	NTSTATUS status;
 
-	WdfWaitLockAcquire(SpbContext->SpbLock, NULL);
+	NT_ASSERT(TransferCount != 0 && TransferCount <= SPB_MAX_SEQUENCE_TRANSFERS);
+
+	SPB_TRANSFER_LIST_INIT(&(SpbContext->Sequence.List), TransferCount);
 
 	//
-	// Create preallocated WDFMEMORY.
-	//    
-	WDFMEMORY memorySequence = NULL;
+	// Describe only the entries in use
+	//
+	WDFMEMORY_OFFSET sequenceOffsets;
+	sequenceOffsets.BufferOffset = 0;
+	sequenceOffsets.BufferLength = FIELD_OFFSET(SPB_TRANSFER_LIST, Transfers) +
+		TransferCount * sizeof(SPB_TRANSFER_LIST_ENTRY);
 
-	WDF_OBJECT_ATTRIBUTES attributes;
-	WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+	WDF_MEMORY_DESCRIPTOR memoryDescriptor;
+	WDF_MEMORY_DESCRIPTOR_INIT_HANDLE(
+		&memoryDescriptor,
+		SpbContext->SequenceMemory,
+		&sequenceOffsets);
 
-	status = WdfMemoryCreatePreallocated(
-		&attributes,
-		Sequence,
-		SequenceLength,
-		&memorySequence);
+	WDF_REQUEST_REUSE_PARAMS reuseParams;
+	WDF_REQUEST_REUSE_PARAMS_INIT(&reuseParams, WDF_REQUEST_REUSE_NO_FLAGS, STATUS_SUCCESS);
+
+	status = WdfRequestReuse(SpbContext->SequenceRequest, &reuseParams);
 
 	if (!NT_SUCCESS(status))
 	{
-		Print(DEBUG_LEVEL_ERROR, DBG_IOCTL, "WdfMemoryCreatePreallocated failed creating memory for sequence" "status:%!STATUS!", status);
+		Print(DEBUG_LEVEL_ERROR, DBG_IOCTL, "WdfRequestReuse failed for sequence request " "status:%!STATUS!", status);
 		goto exit;
 	}
 
-	WDF_MEMORY_DESCRIPTOR memoryDescriptor;
-	WDF_MEMORY_DESCRIPTOR_INIT_HANDLE(
-		&memoryDescriptor,
-		memorySequence,
-		NULL);
-
 	ULONG_PTR bytes = 0;
 
 	if (Timeout == 0)
@@ -376,7 +378,7 @@ _SpbSequence(
 
 		status = WdfIoTargetSendIoctlSynchronously(
 			SpbContext->SpbIoTarget,
-			NULL,
+			SpbContext->SequenceRequest,
 			IOCTL_SPB_EXECUTE_SEQUENCE,
 			&memoryDescriptor,
 			NULL,
@@ -398,7 +400,7 @@ _SpbSequence(
 
 		status = WdfIoTargetSendIoctlSynchronously(
 			SpbContext->SpbIoTarget,
-			NULL,
+			SpbContext->SequenceRequest,
 			IOCTL_SPB_EXECUTE_SEQUENCE,
 			&memoryDescriptor,
 			NULL,
@@ -422,8 +424,6 @@ _SpbSequence(
 
 exit:
 
-	WdfWaitLockRelease(SpbContext->SpbLock);
-	WdfObjectDelete(memorySequence);
 	return status;
 }
 
@@ -492,10 +492,12 @@ SpbWriteRead(
 	//BufferListFirst[0].BufferCb = SendLength;
 
 	//
-	// Build the SPB sequence
+	// Build the SPB sequence in the context; it stays in use until
+	// _SpbSequence returns, so hold SpbLock across both.
 	//
-	SPB_TRANSFER_LIST_AND_ENTRIES(2)    sequence;
-	SPB_TRANSFER_LIST_INIT(&(sequence.List), 2);
+	WdfWaitLockAcquire(SpbContext->SpbLock, NULL);
+
+	PSPB_TRANSFER_LIST sequence = &(SpbContext->Sequence.List);
 
 	{
 		//
@@ -506,13 +508,13 @@ SpbWriteRead(
 
 		ULONG index = 0;
 
-		sequence.List.Transfers[index] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
+		sequence->Transfers[index] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
 			SpbTransferDirectionToDevice,
 			0,
 			SendData,
 			SendLength);
 
-		sequence.List.Transfers[index + 1] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
+		sequence->Transfers[index + 1] = SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
 			SpbTransferDirectionFromDevice,
 			DelayUs,
 			Data,
@@ -523,7 +525,9 @@ SpbWriteRead(
 	// Send the read as a Sequence request to the SPB target
 	// 
 	ULONG bytesReturned = 0;
-	status = _SpbSequence(SpbContext, &sequence, sizeof(sequence), &bytesReturned, 100);
+	status = _SpbSequence(SpbContext, 2, &bytesReturned, 100);
+
+	WdfWaitLockRelease(SpbContext->SpbLock);
 
 	if (!NT_SUCCESS(status))
 	{
@@ -706,6 +710,16 @@ NTSTATUS Status indicating success or failure
 	//
 	// Free any SPB_CONTEXT allocations here
 	//
+	if (SpbContext->SequenceRequest != NULL)
+	{
+		WdfObjectDelete(SpbContext->SequenceRequest);
+	}
+
+	if (SpbContext->SequenceMemory != NULL)
+	{
+		WdfObjectDelete(SpbContext->SequenceMemory);
+	}
+
 	if (SpbContext->SpbLock != NULL)
 	{
 		WdfObjectDelete(SpbContext->SpbLock);
@@ -845,6 +859,40 @@ NTSTATUS Status indicating success or failure
 		goto exit;
 	}
 
+	//
+	// Create the request and the memory object over SpbContext->Sequence
+	// that every sequence is sent with, so register reads do not allocate
+	// framework objects per transaction
+	//
+	WDF_OBJECT_ATTRIBUTES_INIT(&objectAttributes);
+	objectAttributes.ParentObject = SpbContext->SpbIoTarget;
+
+	status = WdfRequestCreate(
+		&objectAttributes,
+		SpbContext->SpbIoTarget,
+		&SpbContext->SequenceRequest);
+
+	if (!NT_SUCCESS(status))
+	{
+		Print(DEBUG_LEVEL_ERROR, DBG_IOCTL, "Error creating Spb sequence request - %!STATUS!", status);
+		goto exit;
+	}
+
+	WDF_OBJECT_ATTRIBUTES_INIT(&objectAttributes);
+	objectAttributes.ParentObject = FxDevice;
+
+	status = WdfMemoryCreatePreallocated(
+		&objectAttributes,
+		&SpbContext->Sequence,
+		sizeof(SpbContext->Sequence),
+		&SpbContext->SequenceMemory);
+
+	if (!NT_SUCCESS(status))
+	{
+		Print(DEBUG_LEVEL_ERROR, DBG_IOCTL, "Error creating Spb sequence memory - %!STATUS!", status);
+		goto exit;
+	}
+
 exit:
 
 	if (!NT_SUCCESS(status))
@@ -22,10 +22,34 @@ Revision History:
 
 #include <wdm.h>
 #include <wdf.h>
+#include <spb.h>
 
 #define DEFAULT_SPB_BUFFER_SIZE 64
+
+//
+// Largest transfer list _SpbSequence can send (SpbWriteRead uses two)
+//
+#define SPB_MAX_SEQUENCE_TRANSFERS 2
 #define RESHUB_USE_HELPER_ROUTINES
 
+//
+// Shadow of a slave's registers, kept by spbhelper.c. Registers outside
+// Cacheable are volatile and always go to the bus. A cacheable register
+// is Valid once it was read or written and Dirty once the driver wrote
+// it, so its settings can be written back after the slave lost them.
+// Without Lock (reg_cache_init not called) every register is volatile.
+//
+typedef struct _SPB_REG_CACHE
+{
+	WDFWAITLOCK Lock;
+	UCHAR Values[256];
+	ULONG Cacheable[256 / 32];
+	ULONG Valid[256 / 32];
+	ULONG Dirty[256 / 32];
+	ULONG Hits;
+	ULONG Misses;
+} SPB_REG_CACHE;
+
 //
 // SPB (I2C) context
 //
@@ -37,6 +61,16 @@ typedef struct _SPB_CONTEXT
 	WDFMEMORY WriteMemory;
 	WDFMEMORY ReadMemory;
 	WDFWAITLOCK SpbLock;
+
+	//
+	// Request, transfer list and the WDFMEMORY describing it, created once
+	// in SpbTargetInitialize and reused for every sequence under SpbLock
+	//
+	WDFREQUEST SequenceRequest;
+	WDFMEMORY SequenceMemory;
+	SPB_TRANSFER_LIST_AND_ENTRIES(SPB_MAX_SEQUENCE_TRANSFERS) Sequence;
+
+	SPB_REG_CACHE RegCache;
 } SPB_CONTEXT;
 
 NTSTATUS
@@ -1,5 +1,138 @@
 #include "spbhelper.h"
 
+static ULONG DebugLevel = 100;
+static ULONG DebugCatagories = DBG_INIT || DBG_PNP || DBG_IOCTL;
+
+#define REG_MAP_TEST(_map_, _reg_)  (((_map_)[(_reg_) >> 5] >> ((_reg_) & 31)) & 1)
+#define REG_MAP_SET(_map_, _reg_)   ((_map_)[(_reg_) >> 5] |= 1UL << ((_reg_) & 31))
+
+static BOOLEAN reg_cache_hit(
+    SPB_REG_CACHE*  cache,
+    unsigned char   reg,
+    unsigned short  length
+)
+{
+    unsigned short i;
+
+    if (cache->Lock == NULL)
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < length; i++)
+    {
+        if (reg + i > 0xFF || !REG_MAP_TEST(cache->Valid, reg + i))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static void reg_cache_store(
+    SPB_REG_CACHE*       cache,
+    unsigned char        reg,
+    const unsigned char* data,
+    unsigned short       length,
+    BOOLEAN              written
+)
+{
+    unsigned short i;
+
+    if (cache->Lock == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < length && reg + i <= 0xFF; i++)
+    {
+        if (REG_MAP_TEST(cache->Cacheable, reg + i))
+        {
+            cache->Values[reg + i] = data[i];
+            REG_MAP_SET(cache->Valid, reg + i);
+            if (written)
+            {
+                REG_MAP_SET(cache->Dirty, reg + i);
+            }
+        }
+    }
+}
+
+static void reg_cache_lock(SPB_REG_CACHE* cache)
+{
+    if (cache->Lock != NULL)
+    {
+        WdfWaitLockAcquire(cache->Lock, NULL);
+    }
+}
+
+static void reg_cache_unlock(SPB_REG_CACHE* cache)
+{
+    if (cache->Lock != NULL)
+    {
+        WdfWaitLockRelease(cache->Lock);
+    }
+}
+
+// Reads length registers from reg on, from the cache when all of them are
+// cached and from the bus otherwise. Called with the cache lock held.
+static NTSTATUS reg_read_locked(
+    SPB_CONTEXT*    spbCtx,
+    unsigned char   reg,
+    unsigned char*  data,
+    unsigned short  length
+)
+{
+    SPB_REG_CACHE* cache = &spbCtx->RegCache;
+    unsigned char reg_addr = reg;
+    NTSTATUS status;
+
+    if (reg_cache_hit(cache, reg, length))
+    {
+        RtlCopyMemory(data, &cache->Values[reg], length);
+        cache->Hits++;
+        return STATUS_SUCCESS;
+    }
+
+    status = SpbWriteRead(spbCtx, &reg_addr, sizeof(reg_addr), data, length, 0);
+    if (NT_SUCCESS(status))
+    {
+        reg_cache_store(cache, reg, data, length, FALSE);
+    }
+
+    if (cache->Lock != NULL)
+    {
+        cache->Misses++;
+    }
+
+    return status;
+}
+
+// Writes length registers from reg on in one transfer. Called with the
+// cache lock held.
+static NTSTATUS reg_write_locked(
+    SPB_CONTEXT*         spbCtx,
+    unsigned char        reg,
+    const unsigned char* data,
+    unsigned short       length
+)
+{
+    unsigned char buf[1 + 256];
+    NTSTATUS status;
+
+    buf[0] = reg;
+    RtlCopyMemory(&buf[1], data, length);
+
+    status = SpbWriteDataSynchronously(spbCtx, buf, 1 + length);
+    if (NT_SUCCESS(status))
+    {
+        reg_cache_store(&spbCtx->RegCache, reg, data, length, TRUE);
+    }
+
+    return status;
+}
+
 NTSTATUS write_reg(
     PDEVICE_CONTEXT pDevice,
     unsigned long   spbIndex,
@@ -7,15 +140,18 @@ NTSTATUS write_reg(
     unsigned short  data
 )
 {
-    unsigned char buf[3];
+    unsigned char buf[2];
+    NTSTATUS status;
 
-    // Set register address
-    buf[0] = reg;
     // Little-endian format: LSB sent first
-    buf[1] = data & 0xFF;
-    buf[2] = (data >> 8) & 0xFF;
+    buf[0] = data & 0xFF;
+    buf[1] = (data >> 8) & 0xFF;
+
     SPB_CONTEXT* spbCtx = &pDevice->SpbContexts[spbIndex];
-    return SpbWriteDataSynchronously(spbCtx, buf, sizeof(buf));
+    reg_cache_lock(&spbCtx->RegCache);
+    status = reg_write_locked(spbCtx, reg, buf, sizeof(buf));
+    reg_cache_unlock(&spbCtx->RegCache);
+    return status;
 }
 
 NTSTATUS read_reg(
@@ -25,11 +161,12 @@ NTSTATUS read_reg(
     unsigned short* data // Read 2 bytes
 ) {
     NTSTATUS status;
-    unsigned char reg_addr = reg;
-    unsigned char read_buf[2];
+    unsigned char read_buf[2] = { 0 };
 
     SPB_CONTEXT* spbCtx = &pDevice->SpbContexts[spbIndex];
-    status = SpbWriteRead(spbCtx, &reg_addr, sizeof(reg_addr), read_buf, sizeof(read_buf), 0);
+    reg_cache_lock(&spbCtx->RegCache);
+    status = reg_read_locked(spbCtx, reg, read_buf, sizeof(read_buf));
+    reg_cache_unlock(&spbCtx->RegCache);
 
     // Combine 2 bytes into a 16-bit (LSB first)
     *data = ((unsigned short)read_buf[1] << 8) | read_buf[0];
@@ -44,24 +181,255 @@ NTSTATUS update_reg(
     unsigned short  val)
 {
     NTSTATUS status;
-    unsigned short current;
-    unsigned short new_val;
+    unsigned char current[2];
+    unsigned char new_val[2];
+    unsigned char byte_mask[2];
+    unsigned char byte_val[2];
+    unsigned char first = reg;
+    unsigned short length = 0;
+    unsigned short i;
+    BOOLEAN changed = FALSE;
+
+    // Only the bytes the mask covers are read and written, so the other
+    // register of the pair is left alone
+    if (mask & 0xFF)
+    {
+        byte_mask[length] = mask & 0xFF;
+        byte_val[length] = val & 0xFF;
+        length++;
+    }
+    else
+    {
+        first = reg + 1;
+    }
+
+    if (mask & 0xFF00)
+    {
+        byte_mask[length] = (mask >> 8) & 0xFF;
+        byte_val[length] = (val >> 8) & 0xFF;
+        length++;
+    }
+
+    if (length == 0)
+    {
+        return STATUS_SUCCESS;
+    }
 
-    // Read current 16-bit value
-    status = read_reg(pDevice, spbIndex, reg, &current);
+    SPB_CONTEXT* spbCtx = &pDevice->SpbContexts[spbIndex];
+    reg_cache_lock(&spbCtx->RegCache);
+
+    // Read current value, from the cache when it holds it
+    status = reg_read_locked(spbCtx, first, current, length);
+    if (!NT_SUCCESS(status))
+    {
+        goto exit;
+    }
 
     // Clear the bits defined by mask, then OR in (val & mask).
-    new_val = (current & ~mask) | (val & mask);
+    for (i = 0; i < length; i++)
+    {
+        new_val[i] = (current[i] & ~byte_mask[i]) | (byte_val[i] & byte_mask[i]);
+        changed |= (new_val[i] != current[i]);
+    }
 
     // If there's no change, return success
-    if (current == new_val)
+    if (!changed)
     {
-        status = STATUS_SUCCESS;
-        return status;
+        goto exit;
     }
 
     // Write back the modified value
-    status = write_reg(pDevice, spbIndex, reg, new_val);
+    status = reg_write_locked(spbCtx, first, new_val, length);
+
+exit:
+    reg_cache_unlock(&spbCtx->RegCache);
+    return status;
+}
+
+NTSTATUS read_bank(
+    PDEVICE_CONTEXT pDevice,
+    unsigned long   spbIndex,
+    unsigned char   reg,    // Write 1 byte
+    unsigned char*  data,   // Read length bytes, reg first
+    unsigned short  length
+)
+{
+    // The register pointer auto-increments after every byte, so a longer
+    // read returns the registers that follow reg in one transfer
+    NTSTATUS status;
+
+    SPB_CONTEXT* spbCtx = &pDevice->SpbContexts[spbIndex];
+    reg_cache_lock(&spbCtx->RegCache);
+    status = reg_read_locked(spbCtx, reg, data, length);
+    reg_cache_unlock(&spbCtx->RegCache);
+    return status;
+}
+
+NTSTATUS read_int_bank(
+    PDEVICE_CONTEXT  pDevice,
+    unsigned long    spbIndex,
+    unsigned char    reg,    // INT1
+    SM5714_INT_BANK* ints
+)
+{
+    // Reading clears all five INT registers
+    C_ASSERT(sizeof(SM5714_INT_BANK) == 5);
+
+    RtlZeroMemory(ints, sizeof(*ints));
+    return read_bank(pDevice, spbIndex, reg, (unsigned char*)ints, sizeof(*ints));
+}
+
+NTSTATUS read_status_bank(
+    PDEVICE_CONTEXT     pDevice,
+    unsigned long       spbIndex,
+    unsigned char       reg,    // STATUS1
+    SM5714_STATUS_BANK* status
+)
+{
+    C_ASSERT(sizeof(SM5714_STATUS_BANK) == 5);
+
+    RtlZeroMemory(status, sizeof(*status));
+    return read_bank(pDevice, spbIndex, reg, (unsigned char*)status, sizeof(*status));
+}
+
+NTSTATUS reg_cache_init(
+    PDEVICE_CONTEXT     pDevice,
+    unsigned long       spbIndex,
+    const SPB_REG_RANGE* ranges,   // Non-volatile registers
+    unsigned long       count
+)
+{
+    SPB_REG_CACHE* cache = &pDevice->SpbContexts[spbIndex].RegCache;
+    WDF_OBJECT_ATTRIBUTES attributes;
+    NTSTATUS status;
+    unsigned long i;
+    unsigned int r;
+
+    // The lock outlives release and prepare hardware, like the device
+    if (cache->Lock == NULL)
+    {
+        WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+        attributes.ParentObject = pDevice->FxDevice;
+        status = WdfWaitLockCreate(&attributes, &cache->Lock);
+        if (!NT_SUCCESS(status))
+        {
+            Print(DEBUG_LEVEL_ERROR, DBG_INIT, "WdfWaitLockCreate failed 0x%x\n", status);
+            cache->Lock = NULL;
+            return status;
+        }
+    }
+
+    WdfWaitLockAcquire(cache->Lock, NULL);
+
+    RtlZeroMemory(cache->Cacheable, sizeof(cache->Cacheable));
+    RtlZeroMemory(cache->Valid, sizeof(cache->Valid));
+    RtlZeroMemory(cache->Dirty, sizeof(cache->Dirty));
+    cache->Hits = 0;
+    cache->Misses = 0;
+
+    for (i = 0; i < count; i++)
+    {
+        for (r = ranges[i].First; r <= ranges[i].Last; r++)
+        {
+            REG_MAP_SET(cache->Cacheable, r);
+        }
+    }
+
+    WdfWaitLockRelease(cache->Lock);
+    return STATUS_SUCCESS;
+}
+
+void reg_cache_invalidate(
+    PDEVICE_CONTEXT pDevice,
+    unsigned long   spbIndex
+)
+{
+    SPB_REG_CACHE* cache = &pDevice->SpbContexts[spbIndex].RegCache;
+
+    reg_cache_lock(cache);
+    RtlZeroMemory(cache->Valid, sizeof(cache->Valid));
+    RtlZeroMemory(cache->Dirty, sizeof(cache->Dirty));
+    reg_cache_unlock(cache);
+}
+
+NTSTATUS reg_cache_sync(
+    PDEVICE_CONTEXT pDevice,
+    unsigned long   spbIndex
+)
+{
+    // Writes the registers the driver set back to the slave, one transfer
+    // per run of them. Every other cached value may be stale: the slave
+    // reset it if it lost power, so it is dropped and read again on use.
+    SPB_CONTEXT* spbCtx = &pDevice->SpbContexts[spbIndex];
+    SPB_REG_CACHE* cache = &spbCtx->RegCache;
+    NTSTATUS status = STATUS_SUCCESS;
+    unsigned int first;
+    unsigned int i;
+    unsigned int r;
+
+    if (cache->Lock == NULL)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    WdfWaitLockAcquire(cache->Lock, NULL);
+
+    for (i = 0; i < ARRAYSIZE(cache->Valid); i++)
+    {
+        cache->Valid[i] &= cache->Dirty[i];
+    }
+
+    for (r = 0; r <= 0xFF && NT_SUCCESS(status); r++)
+    {
+        if (!REG_MAP_TEST(cache->Dirty, r))
+        {
+            continue;
+        }
+
+        first = r;
+        while (r + 1 <= 0xFF && REG_MAP_TEST(cache->Dirty, r + 1))
+        {
+            r++;
+        }
+
+        status = reg_write_locked(spbCtx, (unsigned char)first, &cache->Values[first], (unsigned short)(r - first + 1));
+    }
+
+    WdfWaitLockRelease(cache->Lock);
+
+    if (!NT_SUCCESS(status))
+    {
+        Print(DEBUG_LEVEL_ERROR, DBG_PNP, "Register cache sync failed on SPB %lu - %x\n", spbIndex, status);
+    }
 
     return status;
-}
\ No newline at end of file
+}
+
+void reg_cache_dump(
+    PDEVICE_CONTEXT pDevice,
+    unsigned long   spbIndex
+)
+{
+    SPB_REG_CACHE* cache = &pDevice->SpbContexts[spbIndex].RegCache;
+    unsigned int r;
+
+    if (cache->Lock == NULL)
+    {
+        return;
+    }
+
+    WdfWaitLockAcquire(cache->Lock, NULL);
+
+    Print(DEBUG_LEVEL_VERBOSE, DBG_PNP, "Register cache SPB %lu: %lu hits, %lu misses\n", spbIndex, cache->Hits, cache->Misses);
+
+    // One line per cached register, * marks the ones the driver wrote
+    for (r = 0; r <= 0xFF; r++)
+    {
+        if (REG_MAP_TEST(cache->Valid, r))
+        {
+            Print(DEBUG_LEVEL_VERBOSE, DBG_PNP, "  %02x: %02x%s\n", r, cache->Values[r], REG_MAP_TEST(cache->Dirty, r) ? " *" : "");
+        }
+    }
+
+    WdfWaitLockRelease(cache->Lock);
+}
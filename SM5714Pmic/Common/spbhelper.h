@@ -29,4 +29,97 @@ update_reg(
 	unsigned short val
 );
 
+//
+// Register banks read in one auto-incrementing transfer. INT1..INT5 sit at
+// 0x01-0x05 on both the charger and the USBPD slave, STATUS1..STATUS5 at
+// 0x0D-0x11 on the charger and 0x0B-0x0F on USBPD.
+//
+typedef struct _SM5714_INT_BANK
+{
+	unsigned char Int1;
+	unsigned char Int2;
+	unsigned char Int3;
+	unsigned char Int4;
+	unsigned char Int5;
+} SM5714_INT_BANK;
+
+typedef struct _SM5714_STATUS_BANK
+{
+	unsigned char Status1;
+	unsigned char Status2;
+	unsigned char Status3;
+	unsigned char Status4;
+	unsigned char Status5;
+} SM5714_STATUS_BANK;
+
+// INT1..INT5 as one mask, INT1 in the low byte
+#define SM5714_INT_BANK_BITS(_bank_) \
+	((ULONGLONG)(_bank_)->Int1 | ((ULONGLONG)(_bank_)->Int2 << 8) | ((ULONGLONG)(_bank_)->Int3 << 16) | \
+	 ((ULONGLONG)(_bank_)->Int4 << 24) | ((ULONGLONG)(_bank_)->Int5 << 32))
+
+NTSTATUS
+read_bank(
+	PDEVICE_CONTEXT pDevice,
+	unsigned long spbIndex,
+	unsigned char reg,
+	unsigned char* data,
+	unsigned short length
+);
+
+NTSTATUS
+read_int_bank(
+	PDEVICE_CONTEXT pDevice,
+	unsigned long spbIndex,
+	unsigned char reg,
+	SM5714_INT_BANK* ints
+);
+
+NTSTATUS
+read_status_bank(
+	PDEVICE_CONTEXT pDevice,
+	unsigned long spbIndex,
+	unsigned char reg,
+	SM5714_STATUS_BANK* status
+);
+
+//
+// Register cache. reg_cache_init marks the slave's non-volatile registers;
+// reads of those are served from the cache once it holds them, and
+// update_reg skips the write when the masked value does not change.
+// reg_cache_sync writes the registers the driver set back after the slave
+// lost power and forgets the rest, reg_cache_invalidate forgets every
+// cached value.
+//
+typedef struct _SPB_REG_RANGE
+{
+	unsigned char First;
+	unsigned char Last;
+} SPB_REG_RANGE;
+
+NTSTATUS
+reg_cache_init(
+	PDEVICE_CONTEXT pDevice,
+	unsigned long spbIndex,
+	const SPB_REG_RANGE* ranges,
+	unsigned long count
+);
+
+void
+reg_cache_invalidate(
+	PDEVICE_CONTEXT pDevice,
+	unsigned long spbIndex
+);
+
+NTSTATUS
+reg_cache_sync(
+	PDEVICE_CONTEXT pDevice,
+	unsigned long spbIndex
+);
+
+void
+reg_cache_dump(
+	PDEVICE_CONTEXT pDevice,
+	unsigned long spbIndex
+);
+
 #endif // SM5714_H
@@ -1,6 +1,7 @@
 #include "..\Common\registers.h"
 #include "..\Common\spbhelper.h"
 #include "typec.h"
+#include "..\Charger\charger.h"
 
 static ULONG DebugLevel = 100;
 static ULONG DebugCatagories = DBG_INIT || DBG_PNP || DBG_IOCTL;
@@ -15,4 +16,99 @@ void msleep(ULONG msec) {
 	udelay(msec * 1000);
 }
 
+//
+// INT1 sources serviced by the driver; the PD message sources in INT2..INT5
+// stay masked until the PD state machine is ported
+//
+#define TYPEC_INT1_SOURCES (SM5714_REG_INT_STATUS1_VBUSPOK | SM5714_REG_INT_STATUS1_ATTACH | SM5714_REG_INT_STATUS1_DETACH)
+
+//
+// Only the interrupt masks are owned by the driver so far; everything else
+// on the port controller goes to the bus
+//
+static const SPB_REG_RANGE typec_nonvolatile_regs[] = {
+	{ SM5714_REG_INT_MASK1, SM5714_REG_INT_MASK5 },
+};
+
+int typec_reg_cache_init(_In_ PDEVICE_CONTEXT pDevice)
+{
+	return reg_cache_init(pDevice, 1, typec_nonvolatile_regs, ARRAYSIZE(typec_nonvolatile_regs));
+}
+
+static int typec_update_attach(_In_ PDEVICE_CONTEXT pDevice)
+{
+	SM5714_STATUS_BANK bank;
+	NTSTATUS status;
+
+	status = read_status_bank(pDevice, 1, SM5714_REG_STATUS1, &bank);
+	if (!NT_SUCCESS(status)) {
+		Print(DEBUG_LEVEL_ERROR, DBG_IOCTL, "Error reading USBPD status - %x\n", status);
+		return status;
+	}
+
+	pDevice->TypeCAttached = (bank.Status1 & SM5714_REG_INT_STATUS1_ATTACH) ? TRUE : FALSE;
+	Print(DEBUG_LEVEL_INFO, DBG_PNP, "Type-C: %s\n", pDevice->TypeCAttached ? "attached" : "detached");
+	return status;
+}
+
+int typec_interrupt_enable(_In_ PDEVICE_CONTEXT pDevice)
+{
+	SM5714_INT_BANK stale;
+	NTSTATUS status;
+
+	status = read_int_bank(pDevice, 1, SM5714_REG_INT1, &stale);
+	if (NT_SUCCESS(status)) {
+		status = update_reg(pDevice, 1, SM5714_REG_INT_MASK1, TYPEC_INT1_SOURCES, 0);
+	}
+
+	if (!NT_SUCCESS(status)) {
+		Print(DEBUG_LEVEL_ERROR, DBG_PNP, "Error unmasking USBPD interrupts - %x\n", status);
+		return status;
+	}
+
+	InterlockedExchange64(&pDevice->TypeCPendingInts, 0);
+	return typec_update_attach(pDevice);
+}
+
+int typec_interrupt_disable(_In_ PDEVICE_CONTEXT pDevice)
+{
+	return update_reg(pDevice, 1, SM5714_REG_INT_MASK1, TYPEC_INT1_SOURCES, TYPEC_INT1_SOURCES);
+}
+
+bool typec_interrupt_ack(_In_ PDEVICE_CONTEXT pDevice)
+{
+	// Called from the passive-level ISR; reading the INT bank releases the line
+	SM5714_INT_BANK bank;
+	ULONGLONG ints;
+
+	if (!NT_SUCCESS(read_int_bank(pDevice, 1, SM5714_REG_INT1, &bank))) {
+		return false;
+	}
+
+	ints = SM5714_INT_BANK_BITS(&bank);
+	if (ints == 0) {
+		return false;
+	}
+
+	InterlockedOr64(&pDevice->TypeCPendingInts, (LONG64)ints);
+	return true;
+}
+
+void typec_interrupt_process(_In_ PDEVICE_CONTEXT pDevice)
+{
+	ULONGLONG ints = (ULONGLONG)InterlockedExchange64(&pDevice->TypeCPendingInts, 0);
+	unsigned char int1 = (unsigned char)(ints & 0xFF);
+
+	if (!(int1 & TYPEC_INT1_SOURCES)) {
+		return;
+	}
+
+	Print(DEBUG_LEVEL_INFO, DBG_PNP, "Type-C: INT1 %02x\n", int1);
+	typec_update_attach(pDevice);
+
+	// The charger sees VBUS a little later than the port controller; its
+	// own interrupt follows, this read only gets the status out sooner
+	charger_update_status(pDevice);
+}
+
 // Work in progress
\ No newline at end of file
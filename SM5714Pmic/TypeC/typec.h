@@ -4,8 +4,13 @@
 #include "..\Common\driver.h"
 
 // Function prototypes
+int typec_reg_cache_init(_In_ PDEVICE_CONTEXT pDevice);
 int manual_JIGON(_In_ PDEVICE_CONTEXT pDevice);
 int TYPE_C_ATTACH_DRP(_In_ PDEVICE_CONTEXT pDevice);
 int check_usb_killer(_In_ PDEVICE_CONTEXT pDevice);
 int set_enable_pd_function(_In_ PDEVICE_CONTEXT pDevice);
+int typec_interrupt_enable(_In_ PDEVICE_CONTEXT pDevice);
+int typec_interrupt_disable(_In_ PDEVICE_CONTEXT pDevice);
+bool typec_interrupt_ack(_In_ PDEVICE_CONTEXT pDevice);
+void typec_interrupt_process(_In_ PDEVICE_CONTEXT pDevice);
 #endif // _TYPEC_H_
@@ -0,0 +1,76 @@
+/*++
+
+Module Name:
+
+    sm5714_decode.h
+
+Abstract:
+
+    Bulk decoder for recorded fuel gauge traces: arrays of raw SRAM words of
+    one field (SoC, OCV, current, temperature, ...) decoded to the units of
+    the driver's codec (sm5714_codec.h).
+
+    The same descriptor drives an SSE2, an AVX2 and a NEON kernel as well as
+    the scalar sm5714_Codec_DecodeBatch loop; all of them produce the same
+    values as sm5714_Codec_Decode bit for bit. Sm5714DecodeTrace picks the
+    widest kernel the CPU supports.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+#include "../../SM5714Battery/inc/sm5714_codec.h"
+
+typedef enum _SM5714_DECODE_KERNEL {
+    Sm5714DecodeKernelScalar,
+    Sm5714DecodeKernelSse2,
+    Sm5714DecodeKernelAvx2,
+    Sm5714DecodeKernelNeon,
+    Sm5714DecodeKernelCount
+} SM5714_DECODE_KERNEL;
+
+PCSTR
+Sm5714DecodeKernelName(
+    _In_ SM5714_DECODE_KERNEL Kernel
+    );
+
+//
+// TRUE when the kernel is compiled in and the CPU running it supports it
+//
+
+BOOLEAN
+Sm5714DecodeKernelSupported(
+    _In_ SM5714_DECODE_KERNEL Kernel
+    );
+
+SM5714_DECODE_KERNEL
+Sm5714DecodeBestKernel(
+    VOID
+    );
+
+//
+// Decodes Count raw words of FieldId with the given kernel, which must be
+// supported. Neither buffer needs any particular alignment.
+//
+
+VOID
+Sm5714DecodeTraceWithKernel(
+    _In_ SM5714_DECODE_KERNEL Kernel,
+    _In_ SM5714_FG_FIELD_ID FieldId,
+    _In_reads_(Count) const USHORT* Raw,
+    _In_ SIZE_T Count,
+    _Out_writes_(Count) LONG* Values
+    );
+
+VOID
+Sm5714DecodeTrace(
+    _In_ SM5714_FG_FIELD_ID FieldId,
+    _In_reads_(Count) const USHORT* Raw,
+    _In_ SIZE_T Count,
+    _Out_writes_(Count) LONG* Values
+    );
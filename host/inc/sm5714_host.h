@@ -0,0 +1,76 @@
+/*++
+
+Module Name:
+
+    sm5714_host.h
+
+Abstract:
+
+    Host harness for running the SM5714 battery miniclass and fuel gauge
+    code off-device against the fuel gauge simulator.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#include "../../SM5714Battery/inc/SM5714Battery.h"
+#include "sm5714_sim.h"
+
+//--------------------------------------------------------------- Simulated bus
+
+//
+// Battery bus ops backed by the fuel gauge simulator; BusContext is a
+// PSM5714_SIM. Every call is one transaction and is charged its wire time.
+//
+
+extern const SM5714_BUS_OPS HostSimBusOps;
+
+//
+// Registers the simulator as the SPB controller behind the resource hub
+// ConnectionId, so SpbTargetInitialize can open it and SpbBusOps reach it
+// through the host I/O target.
+//
+
+#define HOST_SIM_SPB_CONNECTION_ID  0x0000000100000071LL
+
+NTSTATUS
+HostSimSpbRegister(
+    _In_ PSM5714_SIM Sim,
+    _In_ LARGE_INTEGER ConnectionId
+    );
+
+//-------------------------------------------------------------- Battery device
+
+//
+// Creates a battery device the way SM5714BatteryDriverDeviceAdd and
+// SM5714BatteryDevicePrepareHardware do on target, using the capacities of
+// the README's BATT ACPI sample, and binds it to the given bus.
+//
+
+NTSTATUS
+HostBatteryCreate(
+    _In_ const SM5714_BUS_OPS* BusOps,
+    _In_ PVOID BusContext,
+    _Out_ WDFDEVICE* Device
+    );
+
+//
+// Same as HostBatteryCreate, but binds the device to SpbBusOps over an SPB
+// target opened through ConnectionId, as SM5714BatteryDevicePrepareHardware
+// does with the I2C connection resource.
+//
+
+NTSTATUS
+HostBatteryCreateOnSpb(
+    _In_ LARGE_INTEGER ConnectionId,
+    _Out_ WDFDEVICE* Device
+    );
+
+VOID
+HostBatteryDestroy(
+    _In_ WDFDEVICE Device
+    );
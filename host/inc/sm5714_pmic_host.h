@@ -0,0 +1,111 @@
+/*++
+
+Module Name:
+
+    sm5714_pmic_host.h
+
+Abstract:
+
+    Host harness for running the SM5714 PMIC driver's register helpers and
+    charger code (spbhelper.c and charger.c over its own spb.c) against a simulator of the PMIC's two
+    I2C slaves, the charger (0x49) and the USBPD port controller (0x33).
+
+    PMIC registers are bytes behind an 8-bit pointer that advances after
+    every byte read or written, so one long read returns a whole bank.
+    INT1..INT5 (0x01-0x05 on both slaves) clear on read. Transactions are
+    charged the wire time of the fuel gauge simulator's timing model.
+
+    The PMIC and battery drivers both define SPB_CONTEXT, so this header
+    must not be included together with sm5714_host.h.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#include "../../SM5714Pmic/Common/spbhelper.h"
+#include "../../SM5714Pmic/Common/registers.h"
+#include "../../SM5714Pmic/Charger/charger.h"
+#include "sm5714_sim.h"
+
+#define SM5714_PMIC_SIM_CHARGER_ADDRESS 0x49
+#define SM5714_PMIC_SIM_USBPD_ADDRESS   0x33
+
+//
+// Resource hub connection IDs the slaves are registered behind, in the
+// order of the PMIC's _CRS
+//
+
+#define HOST_PMIC_CHARGER_CONNECTION_ID 0x0000000200000049LL
+#define HOST_PMIC_USBPD_CONNECTION_ID   0x0000000200000033LL
+
+typedef struct _SM5714_PMIC_SIM {
+    UCHAR               Registers[256];
+    UCHAR               Defaults[256];      // Reset values, see Sm5714PmicSimPowerLoss
+    UCHAR               Pointer;
+
+    SM5714_SIM_TIMING   Timing;
+    SM5714_SIM_STATS    Stats;
+} SM5714_PMIC_SIM, *PSM5714_PMIC_SIM;
+
+//
+// Clears the register file and selects the fuel gauge simulator's
+// fast-mode timing.
+//
+
+VOID
+Sm5714PmicSimInitialize(
+    _Out_ PSM5714_PMIC_SIM Sim
+    );
+
+//
+// Loses power: every register goes back to its value in Defaults, which
+// is all zeroes unless the caller loaded other reset values.
+//
+
+VOID
+Sm5714PmicSimPowerLoss(
+    _Inout_ PSM5714_PMIC_SIM Sim
+    );
+
+//
+// Executes a single bus transaction made of SegmentCount address phases.
+// A write segment sets the pointer from its first byte and writes the
+// rest; a read segment returns bytes from the pointer on.
+//
+
+NTSTATUS
+Sm5714PmicSimTransfer(
+    _Inout_ PSM5714_PMIC_SIM Sim,
+    _In_reads_(SegmentCount) const SM5714_SIM_SEGMENT* Segments,
+    _In_ ULONG SegmentCount
+    );
+
+//
+// Registers the slave as the SPB controller behind ConnectionId, so the
+// PMIC's SpbTargetInitialize can open it.
+//
+
+NTSTATUS
+HostPmicSimSpbRegister(
+    _In_ PSM5714_PMIC_SIM Sim,
+    _In_ LARGE_INTEGER ConnectionId
+    );
+
+//
+// Creates a PMIC device context with both SPB contexts opened the way
+// OnPrepareHardware opens them: index 0 on the charger, 1 on USBPD.
+//
+
+NTSTATUS
+HostPmicCreate(
+    _Out_ WDFDEVICE* Device
+    );
+
+VOID
+HostPmicDestroy(
+    _In_ WDFDEVICE Device
+    );
@@ -0,0 +1,130 @@
+/*++
+
+Module Name:
+
+    sm5714_sim.h
+
+Abstract:
+
+    Register-level simulator of the SM5714 fuel gauge (I2C slave 0x71).
+
+    The gauge exposes 16-bit registers addressed by an 8-bit pointer; words
+    travel LSB first. Battery telemetry lives in an internal SRAM reached
+    indirectly: a write of the word address to SRAM_RADDR (0x8C) latches it,
+    after which SRAM_RDATA (0x8D) reads back the word. SRAM_WADDR/WDATA work
+    the same way for writes.
+
+    Every transaction is charged its I2C wire time: START, one address byte
+    plus ACK per segment, a repeated START between segments, nine bit times
+    per data byte (eight data bits plus ACK/NACK), STOP and the bus free time
+    before the next START.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+
+#define SM5714_SIM_FG_ADDRESS       0x71
+#define SM5714_SIM_FG_DEVICE_ID     0x0001
+
+//
+// Fast-mode (400 kHz) wire timing in nanoseconds. START, repeated START and
+// STOP are each charged one SCL period, which covers their setup and hold
+// times; BusFree is t(BUF), the minimum idle time between STOP and START.
+//
+
+typedef struct _SM5714_SIM_TIMING {
+    ULONG   BusClockHz;
+    ULONG   StartNs;
+    ULONG   RepeatedStartNs;
+    ULONG   StopNs;
+    ULONG   BusFreeNs;
+} SM5714_SIM_TIMING, *PSM5714_SIM_TIMING;
+
+typedef struct _SM5714_SIM_STATS {
+    ULONGLONG   Transactions;       // START ... STOP
+    ULONGLONG   Segments;           // address phases, incl. repeated STARTs
+    ULONGLONG   BytesWritten;
+    ULONGLONG   BytesRead;
+    ULONGLONG   SramReads;          // words returned through SRAM_RDATA
+    ULONGLONG   BusTimeNs;
+} SM5714_SIM_STATS, *PSM5714_SIM_STATS;
+
+//
+// One address phase of a transaction. Segments after the first are
+// preceded by a repeated START. DelayUs is held on the bus before the
+// segment, matching SPB_TRANSFER_LIST_ENTRY.DelayInUs.
+//
+
+typedef struct _SM5714_SIM_SEGMENT {
+    BOOLEAN     Read;
+    PUCHAR      Buffer;
+    ULONG       Length;
+    ULONG       DelayUs;
+} SM5714_SIM_SEGMENT, *PSM5714_SIM_SEGMENT;
+
+typedef struct _SM5714_SIM {
+    USHORT              Registers[256];
+    USHORT              Sram[256];
+    UCHAR               Pointer;
+    UCHAR               SramReadAddress;
+    UCHAR               SramWriteAddress;
+
+    SM5714_SIM_TIMING   Timing;
+    SM5714_SIM_STATS    Stats;
+} SM5714_SIM, *PSM5714_SIM;
+
+//
+// Resets the register file, loads a nominal discharging battery into SRAM
+// and selects fast-mode timing.
+//
+
+VOID
+Sm5714SimInitialize(
+    _Out_ PSM5714_SIM Sim
+    );
+
+//
+// Executes a single bus transaction made of SegmentCount address phases.
+//
+
+NTSTATUS
+Sm5714SimTransfer(
+    _Inout_ PSM5714_SIM Sim,
+    _In_reads_(SegmentCount) const SM5714_SIM_SEGMENT* Segments,
+    _In_ ULONG SegmentCount
+    );
+
+//
+// Wire time of one transaction with the given segment lengths, without
+// executing it.
+//
+
+ULONGLONG
+Sm5714SimTransactionTimeNs(
+    _In_ const SM5714_SIM_TIMING* Timing,
+    _In_reads_(SegmentCount) const SM5714_SIM_SEGMENT* Segments,
+    _In_ ULONG SegmentCount
+    );
+
+VOID
+Sm5714SimResetStats(
+    _Inout_ PSM5714_SIM Sim
+    );
+
+//
+// Latches Sources in INTFG. The sim gives the bits no meaning and ignores
+// INTFG_MASK. Returns TRUE when the alert line is asserted afterwards, i.e.
+// INTFG holds anything.
+//
+
+BOOLEAN
+Sm5714SimRaiseAlert(
+    _Inout_ PSM5714_SIM Sim,
+    _In_ USHORT Sources
+    );
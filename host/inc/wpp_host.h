@@ -0,0 +1,24 @@
+/*++
+
+Module Name:
+
+    wpp_host.h
+
+Abstract:
+
+    Included by the generated *.tmh stand-ins in the host build. WPP trace
+    calls compile away; their format strings use WPP-only conversions such
+    as %!STATUS! that the C runtime cannot format.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#define Trace(...) ((void)0)
+
+#define WPP_INIT_TRACING(DriverObject, RegistryPath) ((void)0)
+#define WPP_CLEANUP(DriverObject) ((void)0)
@@ -0,0 +1,179 @@
+/*++
+
+Module Name:
+
+    battery.c
+
+Abstract:
+
+    Host harness that instantiates the SM5714 battery device context.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#include "../inc/sm5714_host.h"
+
+static
+NTSTATUS
+HostBatteryAllocate(
+    _Out_ WDFDEVICE* Device
+    )
+{
+    WDF_OBJECT_ATTRIBUTES DeviceAttributes;
+    PSM5714_BATTERY_FDO_DATA DevExt;
+    WDFDEVICE DeviceHandle;
+    NTSTATUS Status;
+
+    WDF_OBJECT_ATTRIBUTES_INIT(&DeviceAttributes);
+    WDF_OBJECT_ATTRIBUTES_SET_CONTEXT_TYPE(&DeviceAttributes, SM5714_BATTERY_FDO_DATA);
+
+    Status = HostWdfDeviceCreate(&DeviceAttributes, &DeviceHandle);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    DevExt = GetDeviceExtension(DeviceHandle);
+    DevExt->Device = DeviceHandle;
+    DevExt->BatteryTag = BATTERY_TAG_INVALID;
+
+    //
+    // Stands in for the handle BatteryClassInitializeDevice returns, so
+    // alerts reach the host BatteryClassStatusNotify, which only counts.
+    //
+
+    DevExt->ClassHandle = DevExt;
+
+    Status = WdfWaitLockCreate(WDF_NO_OBJECT_ATTRIBUTES, &DevExt->ClassInitLock);
+    if (!NT_SUCCESS(Status)) {
+        goto Exit;
+    }
+
+    Status = WdfWaitLockCreate(WDF_NO_OBJECT_ATTRIBUTES, &DevExt->StateLock);
+    if (!NT_SUCCESS(Status)) {
+        goto Exit;
+    }
+
+    Status = WdfWaitLockCreate(WDF_NO_OBJECT_ATTRIBUTES, &DevExt->TelemetryLock);
+    if (!NT_SUCCESS(Status)) {
+        goto Exit;
+    }
+
+    Status = SM5714TelemetryCreateSnapshot(DevExt);
+    if (!NT_SUCCESS(Status)) {
+        goto Exit;
+    }
+
+    //
+    // BATT method values from the README ACPI sample
+    //
+
+    DevExt->DesignedCapacity_mWh = 19800;
+    DevExt->FullChargedCapacity_mWh = 19228;
+    DevExt->BatteryTechnology = 1;
+    DevExt->DesignVoltage_mV = 4500;
+
+    DevExt->StatusCacheMaxAge = MILLISECONDS(SM5714_STATUS_CACHE_DEFAULT_MAX_AGE_MS);
+
+    //
+    // There is no timer on the host; tools drive the sampler by calling
+    // SM5714TelemetrySample every SM5714TelemetrySamplePeriodMs of virtual
+    // time.
+    //
+
+    DevExt->SamplePeriodMs = SM5714_SAMPLE_DEFAULT_PERIOD_MS;
+    DevExt->LowPowerSamplePeriodMs = SM5714_LOW_POWER_DEFAULT_PERIOD_MS;
+
+Exit:
+    if (!NT_SUCCESS(Status)) {
+        HostBatteryDestroy(DeviceHandle);
+        return Status;
+    }
+
+    *Device = DeviceHandle;
+    return Status;
+}
+
+NTSTATUS
+HostBatteryCreate(
+    _In_ const SM5714_BUS_OPS* BusOps,
+    _In_ PVOID BusContext,
+    _Out_ WDFDEVICE* Device
+    )
+{
+    PSM5714_BATTERY_FDO_DATA DevExt;
+    WDFDEVICE DeviceHandle;
+    NTSTATUS Status;
+
+    Status = HostBatteryAllocate(&DeviceHandle);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    DevExt = GetDeviceExtension(DeviceHandle);
+    DevExt->BusOps = BusOps;
+    DevExt->BusContext = BusContext;
+
+    SM5714BatteryPrepareHardware(DeviceHandle);
+
+    *Device = DeviceHandle;
+    return Status;
+}
+
+NTSTATUS
+HostBatteryCreateOnSpb(
+    _In_ LARGE_INTEGER ConnectionId,
+    _Out_ WDFDEVICE* Device
+    )
+{
+    PSM5714_BATTERY_FDO_DATA DevExt;
+    WDFDEVICE DeviceHandle;
+    NTSTATUS Status;
+
+    Status = HostBatteryAllocate(&DeviceHandle);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    DevExt = GetDeviceExtension(DeviceHandle);
+    DevExt->I2CContext.I2cResHubId = ConnectionId;
+
+    Status = SpbTargetInitialize(DeviceHandle, &DevExt->I2CContext);
+    if (!NT_SUCCESS(Status)) {
+        HostBatteryDestroy(DeviceHandle);
+        return Status;
+    }
+
+    DevExt->BusOps = &SpbBusOps;
+    DevExt->BusContext = &DevExt->I2CContext;
+
+    SM5714BatteryPrepareHardware(DeviceHandle);
+
+    *Device = DeviceHandle;
+    return Status;
+}
+
+VOID
+HostBatteryDestroy(
+    _In_ WDFDEVICE Device
+    )
+{
+    PSM5714_BATTERY_FDO_DATA DevExt = GetDeviceExtension(Device);
+
+    //
+    // On target the SPB I/O target is parented to the device
+    //
+
+    if (DevExt->BusOps == &SpbBusOps) {
+        SpbTargetDeinitialize(Device, &DevExt->I2CContext);
+    }
+
+    WdfObjectDelete(DevExt->I2CContext.SpbIoTarget);
+    WdfObjectDelete(DevExt->TelemetrySnapshotMemory);
+    WdfObjectDelete(DevExt->TelemetryLock);
+    WdfObjectDelete(DevExt->StateLock);
+    WdfObjectDelete(DevExt->ClassInitLock);
+    WdfObjectDelete(Device);
+}
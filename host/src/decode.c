@@ -0,0 +1,295 @@
+/*++
+
+Module Name:
+
+    decode.c
+
+Abstract:
+
+    SIMD kernels of the bulk trace decoder. Each kernel evaluates the codec
+    expression of sm5714_codec.h on a vector of raw words:
+
+        magnitude = ((raw & MagnitudeMask) * Scale) >> FractionBits
+        value     = (magnitude ^ neg) - neg, neg = -1 if raw & SignMask
+
+    Both the masked word and Scale fit in 16 bits, so the x86 kernels form
+    the 32-bit product from the low and high halves of 16 x 16 bit
+    multiplies and interleave them; NEON has a widening multiply. Words left
+    over after the last full vector go through sm5714_Codec_DecodeBatch.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#include "../inc/sm5714_decode.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SM5714_DECODE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#define SM5714_DECODE_NEON 1
+#include <arm_neon.h>
+#endif
+
+static const PCSTR Sm5714DecodeKernelNames[Sm5714DecodeKernelCount] = {
+    "scalar",
+    "sse2",
+    "avx2",
+    "neon",
+};
+
+//
+// sm5714_Codec_DecodeBatch takes a ULONG count; traces can be longer
+//
+
+static
+VOID
+Sm5714DecodeScalar(
+    _In_ SM5714_FG_FIELD_ID FieldId,
+    _In_reads_(Count) const USHORT* Raw,
+    _In_ SIZE_T Count,
+    _Out_writes_(Count) LONG* Values
+    )
+{
+    const SIZE_T Chunk = 0x40000000;
+    SIZE_T Length;
+
+    while (Count != 0) {
+        Length = (Count < Chunk) ? Count : Chunk;
+        sm5714_Codec_DecodeBatch(FieldId, Raw, (ULONG)Length, Values);
+        Raw += Length;
+        Values += Length;
+        Count -= Length;
+    }
+}
+
+#if SM5714_DECODE_X86
+
+static
+VOID
+Sm5714DecodeSse2(
+    _In_ SM5714_FG_FIELD_ID FieldId,
+    _In_reads_(Count) const USHORT* Raw,
+    _In_ SIZE_T Count,
+    _Out_writes_(Count) LONG* Values
+    )
+{
+    const SM5714_FG_FIELD* Field = &Sm5714FgFields[FieldId];
+    const __m128i Mask = _mm_set1_epi16((SHORT)Field->MagnitudeMask);
+    const __m128i SignMask = _mm_set1_epi16((SHORT)Field->SignMask);
+    const __m128i Scale = _mm_set1_epi16((SHORT)Field->Scale);
+    const __m128i Shift = _mm_cvtsi32_si128(Field->FractionBits);
+    const __m128i Zero = _mm_setzero_si128();
+    const __m128i Ones = _mm_cmpeq_epi16(Zero, Zero);
+    SIZE_T i;
+
+    for (i = 0; i + 8 <= Count; i += 8) {
+        __m128i Word = _mm_loadu_si128((const __m128i*)(Raw + i));
+        __m128i Magnitude = _mm_and_si128(Word, Mask);
+        __m128i ProductLo = _mm_mullo_epi16(Magnitude, Scale);
+        __m128i ProductHi = _mm_mulhi_epu16(Magnitude, Scale);
+        __m128i Neg = _mm_xor_si128(_mm_cmpeq_epi16(_mm_and_si128(Word, SignMask), Zero), Ones);
+        __m128i Neg0 = _mm_unpacklo_epi16(Neg, Neg);
+        __m128i Neg1 = _mm_unpackhi_epi16(Neg, Neg);
+        __m128i Value0 = _mm_srl_epi32(_mm_unpacklo_epi16(ProductLo, ProductHi), Shift);
+        __m128i Value1 = _mm_srl_epi32(_mm_unpackhi_epi16(ProductLo, ProductHi), Shift);
+
+        Value0 = _mm_sub_epi32(_mm_xor_si128(Value0, Neg0), Neg0);
+        Value1 = _mm_sub_epi32(_mm_xor_si128(Value1, Neg1), Neg1);
+
+        _mm_storeu_si128((__m128i*)(Values + i), Value0);
+        _mm_storeu_si128((__m128i*)(Values + i + 4), Value1);
+    }
+
+    sm5714_Codec_DecodeBatch(FieldId, Raw + i, (ULONG)(Count - i), Values + i);
+}
+
+//
+// Same as the SSE2 kernel on 16 words. The 256-bit unpacks work within each
+// 128-bit lane, so the two result vectors are put back in order with a
+// cross-lane permute before the store.
+//
+
+__attribute__((target("avx2")))
+static
+VOID
+Sm5714DecodeAvx2(
+    _In_ SM5714_FG_FIELD_ID FieldId,
+    _In_reads_(Count) const USHORT* Raw,
+    _In_ SIZE_T Count,
+    _Out_writes_(Count) LONG* Values
+    )
+{
+    const SM5714_FG_FIELD* Field = &Sm5714FgFields[FieldId];
+    const __m256i Mask = _mm256_set1_epi16((SHORT)Field->MagnitudeMask);
+    const __m256i SignMask = _mm256_set1_epi16((SHORT)Field->SignMask);
+    const __m256i Scale = _mm256_set1_epi16((SHORT)Field->Scale);
+    const __m128i Shift = _mm_cvtsi32_si128(Field->FractionBits);
+    const __m256i Zero = _mm256_setzero_si256();
+    const __m256i Ones = _mm256_cmpeq_epi16(Zero, Zero);
+    SIZE_T i;
+
+    for (i = 0; i + 16 <= Count; i += 16) {
+        __m256i Word = _mm256_loadu_si256((const __m256i*)(Raw + i));
+        __m256i Magnitude = _mm256_and_si256(Word, Mask);
+        __m256i ProductLo = _mm256_mullo_epi16(Magnitude, Scale);
+        __m256i ProductHi = _mm256_mulhi_epu16(Magnitude, Scale);
+        __m256i Neg = _mm256_xor_si256(_mm256_cmpeq_epi16(_mm256_and_si256(Word, SignMask), Zero), Ones);
+        __m256i NegLo = _mm256_unpacklo_epi16(Neg, Neg);
+        __m256i NegHi = _mm256_unpackhi_epi16(Neg, Neg);
+        __m256i ValueLo = _mm256_srl_epi32(_mm256_unpacklo_epi16(ProductLo, ProductHi), Shift);
+        __m256i ValueHi = _mm256_srl_epi32(_mm256_unpackhi_epi16(ProductLo, ProductHi), Shift);
+
+        ValueLo = _mm256_sub_epi32(_mm256_xor_si256(ValueLo, NegLo), NegLo);
+        ValueHi = _mm256_sub_epi32(_mm256_xor_si256(ValueHi, NegHi), NegHi);
+
+        _mm256_storeu_si256((__m256i*)(Values + i), _mm256_permute2x128_si256(ValueLo, ValueHi, 0x20));
+        _mm256_storeu_si256((__m256i*)(Values + i + 8), _mm256_permute2x128_si256(ValueLo, ValueHi, 0x31));
+    }
+
+    sm5714_Codec_DecodeBatch(FieldId, Raw + i, (ULONG)(Count - i), Values + i);
+}
+
+#endif // SM5714_DECODE_X86
+
+#if SM5714_DECODE_NEON
+
+static
+VOID
+Sm5714DecodeNeon(
+    _In_ SM5714_FG_FIELD_ID FieldId,
+    _In_reads_(Count) const USHORT* Raw,
+    _In_ SIZE_T Count,
+    _Out_writes_(Count) LONG* Values
+    )
+{
+    const SM5714_FG_FIELD* Field = &Sm5714FgFields[FieldId];
+    const uint16x8_t Mask = vdupq_n_u16(Field->MagnitudeMask);
+    const uint16x8_t SignMask = vdupq_n_u16(Field->SignMask);
+    const uint16x4_t Scale = vdup_n_u16(Field->Scale);
+    const int32x4_t Shift = vdupq_n_s32(-(int32_t)Field->FractionBits);
+    SIZE_T i;
+
+    for (i = 0; i + 8 <= Count; i += 8) {
+        uint16x8_t Word = vld1q_u16(Raw + i);
+        uint16x8_t Magnitude = vandq_u16(Word, Mask);
+        int16x8_t Neg = vreinterpretq_s16_u16(vtstq_u16(Word, SignMask));
+        int32x4_t Neg0 = vmovl_s16(vget_low_s16(Neg));
+        int32x4_t Neg1 = vmovl_s16(vget_high_s16(Neg));
+        int32x4_t Value0 = vreinterpretq_s32_u32(vshlq_u32(vmull_u16(vget_low_u16(Magnitude), Scale), Shift));
+        int32x4_t Value1 = vreinterpretq_s32_u32(vshlq_u32(vmull_u16(vget_high_u16(Magnitude), Scale), Shift));
+
+        Value0 = vsubq_s32(veorq_s32(Value0, Neg0), Neg0);
+        Value1 = vsubq_s32(veorq_s32(Value1, Neg1), Neg1);
+
+        vst1q_s32(Values + i, Value0);
+        vst1q_s32(Values + i + 4, Value1);
+    }
+
+    sm5714_Codec_DecodeBatch(FieldId, Raw + i, (ULONG)(Count - i), Values + i);
+}
+
+#endif // SM5714_DECODE_NEON
+
+PCSTR
+Sm5714DecodeKernelName(
+    _In_ SM5714_DECODE_KERNEL Kernel
+    )
+{
+    return (Kernel < Sm5714DecodeKernelCount) ? Sm5714DecodeKernelNames[Kernel] : "unknown";
+}
+
+BOOLEAN
+Sm5714DecodeKernelSupported(
+    _In_ SM5714_DECODE_KERNEL Kernel
+    )
+{
+    switch (Kernel) {
+    case Sm5714DecodeKernelScalar:
+        return TRUE;
+
+#if SM5714_DECODE_X86
+    case Sm5714DecodeKernelSse2:
+        return __builtin_cpu_supports("sse2") ? TRUE : FALSE;
+
+    case Sm5714DecodeKernelAvx2:
+        return __builtin_cpu_supports("avx2") ? TRUE : FALSE;
+#endif
+
+#if SM5714_DECODE_NEON
+    case Sm5714DecodeKernelNeon:
+        return TRUE;
+#endif
+
+    default:
+        return FALSE;
+    }
+}
+
+SM5714_DECODE_KERNEL
+Sm5714DecodeBestKernel(
+    VOID
+    )
+{
+    static const SM5714_DECODE_KERNEL Preference[] = {
+        Sm5714DecodeKernelAvx2,
+        Sm5714DecodeKernelNeon,
+        Sm5714DecodeKernelSse2,
+    };
+    ULONG i;
+
+    for (i = 0; i < ARRAYSIZE(Preference); i++) {
+        if (Sm5714DecodeKernelSupported(Preference[i])) {
+            return Preference[i];
+        }
+    }
+
+    return Sm5714DecodeKernelScalar;
+}
+
+VOID
+Sm5714DecodeTraceWithKernel(
+    _In_ SM5714_DECODE_KERNEL Kernel,
+    _In_ SM5714_FG_FIELD_ID FieldId,
+    _In_reads_(Count) const USHORT* Raw,
+    _In_ SIZE_T Count,
+    _Out_writes_(Count) LONG* Values
+    )
+{
+    switch (Kernel) {
+#if SM5714_DECODE_X86
+    case Sm5714DecodeKernelSse2:
+        Sm5714DecodeSse2(FieldId, Raw, Count, Values);
+        break;
+
+    case Sm5714DecodeKernelAvx2:
+        Sm5714DecodeAvx2(FieldId, Raw, Count, Values);
+        break;
+#endif
+
+#if SM5714_DECODE_NEON
+    case Sm5714DecodeKernelNeon:
+        Sm5714DecodeNeon(FieldId, Raw, Count, Values);
+        break;
+#endif
+
+    default:
+        Sm5714DecodeScalar(FieldId, Raw, Count, Values);
+        break;
+    }
+}
+
+VOID
+Sm5714DecodeTrace(
+    _In_ SM5714_FG_FIELD_ID FieldId,
+    _In_reads_(Count) const USHORT* Raw,
+    _In_ SIZE_T Count,
+    _Out_writes_(Count) LONG* Values
+    )
+{
+    Sm5714DecodeTraceWithKernel(Sm5714DecodeBestKernel(), FieldId, Raw, Count, Values);
+}
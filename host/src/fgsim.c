@@ -0,0 +1,254 @@
+/*++
+
+Module Name:
+
+    fgsim.c
+
+Abstract:
+
+    Register-level SM5714 fuel gauge simulator with I2C wire-time
+    accounting. See host/inc/sm5714_sim.h for the protocol model.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#include "../inc/sm5714_sim.h"
+#include "../../SM5714Battery/inc/SM5714Battery_regs.h"
+
+//
+// Eight data bits plus the ACK/NACK slot
+//
+
+#define SM5714_SIM_BITS_PER_BYTE    9
+
+static
+USHORT
+Sm5714SimRegisterRead(
+    _Inout_ PSM5714_SIM Sim,
+    _In_ UCHAR Register
+    )
+{
+    USHORT Value;
+
+    switch (Register) {
+    case SM5714_FG_REG_SRAM_RDATA:
+        Sim->Stats.SramReads += 1;
+        return Sim->Sram[Sim->SramReadAddress];
+
+    case SM5714_FG_REG_INTFG:
+        //
+        // Read to clear, which releases the alert line
+        //
+        Value = Sim->Registers[Register];
+        Sim->Registers[Register] = 0;
+        return Value;
+
+    default:
+        return Sim->Registers[Register];
+    }
+}
+
+static
+VOID
+Sm5714SimRegisterWrite(
+    _Inout_ PSM5714_SIM Sim,
+    _In_ UCHAR Register,
+    _In_ USHORT Value
+    )
+{
+    switch (Register) {
+    case SM5714_FG_REG_DEVICE_ID:
+    case SM5714_FG_REG_STATUS:
+    case SM5714_FG_REG_INTFG:
+    case SM5714_FG_REG_SRAM_RDATA:
+        //
+        // Read-only
+        //
+        break;
+
+    case SM5714_FG_REG_SRAM_RADDR:
+        Sim->SramReadAddress = (UCHAR)(Value & 0xFF);
+        Sim->Registers[Register] = Value;
+        break;
+
+    case SM5714_FG_REG_SRAM_WADDR:
+        Sim->SramWriteAddress = (UCHAR)(Value & 0xFF);
+        Sim->Registers[Register] = Value;
+        break;
+
+    case SM5714_FG_REG_SRAM_WDATA:
+        Sim->Sram[Sim->SramWriteAddress] = Value;
+        break;
+
+    default:
+        Sim->Registers[Register] = Value;
+        break;
+    }
+}
+
+//
+// A write segment carries the register pointer followed by whole words,
+// LSB first; the pointer advances after each word. A trailing odd byte is
+// dropped, as the gauge only commits a register once both halves arrived.
+//
+
+static
+VOID
+Sm5714SimWriteSegment(
+    _Inout_ PSM5714_SIM Sim,
+    _In_reads_(Length) const UCHAR* Buffer,
+    _In_ ULONG Length
+    )
+{
+    ULONG i;
+
+    Sim->Pointer = Buffer[0];
+
+    for (i = 1; i + 1 < Length; i += 2) {
+        Sm5714SimRegisterWrite(Sim, Sim->Pointer, (USHORT)(Buffer[i] | (Buffer[i + 1] << 8)));
+        Sim->Pointer++;
+    }
+}
+
+//
+// A read segment returns words from the current pointer, LSB first, and
+// advances the pointer after each complete word.
+//
+
+static
+VOID
+Sm5714SimReadSegment(
+    _Inout_ PSM5714_SIM Sim,
+    _Out_writes_(Length) PUCHAR Buffer,
+    _In_ ULONG Length
+    )
+{
+    USHORT word = 0;
+    ULONG i;
+
+    for (i = 0; i < Length; i++) {
+        if ((i & 1) == 0) {
+            word = Sm5714SimRegisterRead(Sim, Sim->Pointer);
+            Buffer[i] = (UCHAR)(word & 0xFF);
+        } else {
+            Buffer[i] = (UCHAR)(word >> 8);
+            Sim->Pointer++;
+        }
+    }
+}
+
+VOID
+Sm5714SimInitialize(
+    _Out_ PSM5714_SIM Sim
+    )
+{
+    RtlZeroMemory(Sim, sizeof(*Sim));
+
+    Sim->Timing.BusClockHz = 400000;
+    Sim->Timing.StartNs = 2500;
+    Sim->Timing.RepeatedStartNs = 2500;
+    Sim->Timing.StopNs = 2500;
+    Sim->Timing.BusFreeNs = 1300;
+
+    Sim->Registers[SM5714_FG_REG_DEVICE_ID] = SM5714_SIM_FG_DEVICE_ID;
+
+    //
+    // 3.9 V, 85.5 %, discharging at 350 mA, 28.5 C, 66 cycles
+    //
+
+    Sim->Sram[SM5714_FG_ADDR_SRAM_SOC] = 0x5580;
+    Sim->Sram[SM5714_FG_ADDR_SRAM_OCV] = 0x1F33;
+    Sim->Sram[SM5714_FG_ADDR_SRAM_VBAT] = 0x1F33;
+    Sim->Sram[SM5714_FG_ADDR_SRAM_VSYS] = 0x1F33;
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT] = 0x82CD;
+    Sim->Sram[SM5714_FG_ADDR_SRAM_TEMPERATURE] = 0x1C80;
+    Sim->Sram[SM5714_FG_ADDR_SRAM_VBAT_AVG] = 0x1F33;
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT_AVG] = 0x82CD;
+    Sim->Sram[SM5714_FG_ADDR_SRAM_STATE] = 0x0000;
+    Sim->Sram[SM5714_FG_ADDR_SRAM_SOC_CYCLE] = 0x0042;
+}
+
+ULONGLONG
+Sm5714SimTransactionTimeNs(
+    _In_ const SM5714_SIM_TIMING* Timing,
+    _In_reads_(SegmentCount) const SM5714_SIM_SEGMENT* Segments,
+    _In_ ULONG SegmentCount
+    )
+{
+    ULONGLONG bitNs = 1000000000ULL / Timing->BusClockHz;
+    ULONGLONG timeNs;
+    ULONG i;
+
+    timeNs = Timing->StartNs;
+
+    for (i = 0; i < SegmentCount; i++) {
+        if (i != 0) {
+            timeNs += Timing->RepeatedStartNs;
+        }
+
+        timeNs += (ULONGLONG)Segments[i].DelayUs * 1000;
+        timeNs += (1 + (ULONGLONG)Segments[i].Length) * SM5714_SIM_BITS_PER_BYTE * bitNs;
+    }
+
+    timeNs += Timing->StopNs + Timing->BusFreeNs;
+
+    return timeNs;
+}
+
+NTSTATUS
+Sm5714SimTransfer(
+    _Inout_ PSM5714_SIM Sim,
+    _In_reads_(SegmentCount) const SM5714_SIM_SEGMENT* Segments,
+    _In_ ULONG SegmentCount
+    )
+{
+    ULONG i;
+
+    if (SegmentCount == 0) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    for (i = 0; i < SegmentCount; i++) {
+        if (Segments[i].Buffer == NULL || Segments[i].Length == 0) {
+            return STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    for (i = 0; i < SegmentCount; i++) {
+        if (Segments[i].Read) {
+            Sm5714SimReadSegment(Sim, Segments[i].Buffer, Segments[i].Length);
+            Sim->Stats.BytesRead += Segments[i].Length;
+        } else {
+            Sm5714SimWriteSegment(Sim, Segments[i].Buffer, Segments[i].Length);
+            Sim->Stats.BytesWritten += Segments[i].Length;
+        }
+    }
+
+    Sim->Stats.Transactions += 1;
+    Sim->Stats.Segments += SegmentCount;
+    Sim->Stats.BusTimeNs += Sm5714SimTransactionTimeNs(&Sim->Timing, Segments, SegmentCount);
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+Sm5714SimResetStats(
+    _Inout_ PSM5714_SIM Sim
+    )
+{
+    RtlZeroMemory(&Sim->Stats, sizeof(Sim->Stats));
+}
+
+BOOLEAN
+Sm5714SimRaiseAlert(
+    _Inout_ PSM5714_SIM Sim,
+    _In_ USHORT Sources
+    )
+{
+    Sim->Registers[SM5714_FG_REG_INTFG] |= Sources;
+
+    return (Sim->Registers[SM5714_FG_REG_INTFG] != 0) ? TRUE : FALSE;
+}
@@ -0,0 +1,110 @@
+/*++
+
+Module Name:
+
+    pmic.c
+
+Abstract:
+
+    Host harness that instantiates the SM5714 PMIC device context, and
+    stand-ins for the battery driver interface charger.c reports through.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#include "../inc/sm5714_pmic_host.h"
+#include "../../SM5714Pmic/Common/interface.h"
+
+NTSTATUS
+HostPmicCreate(
+    _Out_ WDFDEVICE* Device
+    )
+{
+    static const LONGLONG ConnectionIds[] = {
+        HOST_PMIC_CHARGER_CONNECTION_ID,
+        HOST_PMIC_USBPD_CONNECTION_ID
+    };
+
+    WDF_OBJECT_ATTRIBUTES DeviceAttributes;
+    PDEVICE_CONTEXT pDevice;
+    WDFDEVICE DeviceHandle;
+    NTSTATUS Status;
+    ULONG i;
+
+    C_ASSERT(ARRAYSIZE(ConnectionIds) == ARRAYSIZE(((PDEVICE_CONTEXT)0)->SpbContexts));
+
+    WDF_OBJECT_ATTRIBUTES_INIT(&DeviceAttributes);
+    WDF_OBJECT_ATTRIBUTES_SET_CONTEXT_TYPE(&DeviceAttributes, DEVICE_CONTEXT);
+
+    Status = HostWdfDeviceCreate(&DeviceAttributes, &DeviceHandle);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    pDevice = GetDeviceContext(DeviceHandle);
+    pDevice->FxDevice = DeviceHandle;
+
+    for (i = 0; i < ARRAYSIZE(ConnectionIds); i++) {
+        pDevice->SpbContexts[i].I2cResHubId.QuadPart = ConnectionIds[i];
+
+        Status = SpbTargetInitialize(DeviceHandle, &pDevice->SpbContexts[i]);
+        if (!NT_SUCCESS(Status)) {
+            HostPmicDestroy(DeviceHandle);
+            return Status;
+        }
+
+        pDevice->SpbContextCount++;
+    }
+
+    *Device = DeviceHandle;
+    return Status;
+}
+
+VOID
+HostPmicDestroy(
+    _In_ WDFDEVICE Device
+    )
+{
+    PDEVICE_CONTEXT pDevice = GetDeviceContext(Device);
+    ULONG i;
+
+    //
+    // On target the SPB I/O targets are parented to the device
+    //
+
+    for (i = 0; i < pDevice->SpbContextCount; i++) {
+        SpbTargetDeinitialize(Device, &pDevice->SpbContexts[i]);
+        WdfObjectDelete(pDevice->SpbContexts[i].SpbIoTarget);
+    }
+
+    WdfObjectDelete(Device);
+}
+
+//
+// No battery driver on the host: the charger status is only kept in the
+// device context and there is never any telemetry
+//
+
+VOID
+PmicPublishChargerStatus(
+    _In_ PDEVICE_CONTEXT pDevice,
+    _In_ const SM5714_CHARGER_STATUS* Status
+    )
+{
+    pDevice->ChargerStatus = *Status;
+}
+
+BOOLEAN
+PmicGetBatteryTelemetry(
+    _In_ PDEVICE_CONTEXT pDevice,
+    _Out_ PSM5714_BATTERY_TELEMETRY Telemetry
+    )
+{
+    UNREFERENCED_PARAMETER(pDevice);
+
+    RtlZeroMemory(Telemetry, sizeof(*Telemetry));
+    return FALSE;
+}
@@ -0,0 +1,244 @@
+/*++
+
+Module Name:
+
+    pmicsim.c
+
+Abstract:
+
+    Register-level simulator of one SM5714 PMIC I2C slave, and its
+    registration as an SPB controller. See host/inc/sm5714_pmic_host.h for
+    the protocol model.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#include "../inc/sm5714_pmic_host.h"
+#include <reshub.h>
+
+//
+// INT1..INT5 are at the same addresses on the charger and USBPD slaves
+//
+
+C_ASSERT((int)SM5714_CHG_REG_INT1 == (int)SM5714_REG_INT1 && (int)SM5714_CHG_REG_INT5 == (int)SM5714_REG_INT5);
+
+static
+BOOLEAN
+Sm5714PmicSimIsInt(
+    _In_ UCHAR Register
+    )
+{
+    return (Register >= SM5714_REG_INT1 && Register <= SM5714_REG_INT5) ? TRUE : FALSE;
+}
+
+VOID
+Sm5714PmicSimInitialize(
+    _Out_ PSM5714_PMIC_SIM Sim
+    )
+{
+    static SM5714_SIM Gauge;
+
+    RtlZeroMemory(Sim, sizeof(*Sim));
+
+    //
+    // Same bus, same timing as the gauge
+    //
+
+    Sm5714SimInitialize(&Gauge);
+    Sim->Timing = Gauge.Timing;
+}
+
+VOID
+Sm5714PmicSimPowerLoss(
+    _Inout_ PSM5714_PMIC_SIM Sim
+    )
+{
+    RtlCopyMemory(Sim->Registers, Sim->Defaults, sizeof(Sim->Registers));
+    Sim->Pointer = 0;
+}
+
+NTSTATUS
+Sm5714PmicSimTransfer(
+    _Inout_ PSM5714_PMIC_SIM Sim,
+    _In_reads_(SegmentCount) const SM5714_SIM_SEGMENT* Segments,
+    _In_ ULONG SegmentCount
+    )
+{
+    ULONG i;
+    ULONG j;
+
+    if (SegmentCount == 0) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    for (i = 0; i < SegmentCount; i++) {
+        if (Segments[i].Buffer == NULL || Segments[i].Length == 0) {
+            return STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    for (i = 0; i < SegmentCount; i++) {
+        if (Segments[i].Read) {
+            for (j = 0; j < Segments[i].Length; j++) {
+                Segments[i].Buffer[j] = Sim->Registers[Sim->Pointer];
+
+                //
+                // Read to clear, which releases the interrupt line
+                //
+
+                if (Sm5714PmicSimIsInt(Sim->Pointer)) {
+                    Sim->Registers[Sim->Pointer] = 0;
+                }
+
+                Sim->Pointer++;
+            }
+
+            Sim->Stats.BytesRead += Segments[i].Length;
+        } else {
+            Sim->Pointer = Segments[i].Buffer[0];
+
+            for (j = 1; j < Segments[i].Length; j++) {
+                if (!Sm5714PmicSimIsInt(Sim->Pointer)) {
+                    Sim->Registers[Sim->Pointer] = Segments[i].Buffer[j];
+                }
+
+                Sim->Pointer++;
+            }
+
+            Sim->Stats.BytesWritten += Segments[i].Length;
+        }
+    }
+
+    Sim->Stats.Transactions += 1;
+    Sim->Stats.Segments += SegmentCount;
+    Sim->Stats.BusTimeNs += Sm5714SimTransactionTimeNs(&Sim->Timing, Segments, SegmentCount);
+
+    return STATUS_SUCCESS;
+}
+
+static
+NTSTATUS
+HostPmicSimSpbTransfer(
+    _In_ PVOID Context,
+    _In_ BOOLEAN Read,
+    _Inout_updates_bytes_(Length) PVOID Buffer,
+    _In_ size_t Length,
+    _Out_ PULONG_PTR BytesTransferred
+    )
+{
+    PSM5714_PMIC_SIM Sim = (PSM5714_PMIC_SIM)Context;
+    SM5714_SIM_SEGMENT Segment;
+    ULONGLONG BusTimeNs;
+    NTSTATUS Status;
+
+    *BytesTransferred = 0;
+
+    Segment.Read = Read;
+    Segment.Buffer = (PUCHAR)Buffer;
+    Segment.Length = (ULONG)Length;
+    Segment.DelayUs = 0;
+
+    BusTimeNs = Sim->Stats.BusTimeNs;
+
+    Status = Sm5714PmicSimTransfer(Sim, &Segment, 1);
+    if (NT_SUCCESS(Status)) {
+        *BytesTransferred = Length;
+    }
+
+    HostAdvanceInterruptTime((Sim->Stats.BusTimeNs - BusTimeNs) / 100);
+
+    return Status;
+}
+
+static
+NTSTATUS
+HostPmicSimSpbIoctl(
+    _In_ PVOID Context,
+    _In_ ULONG IoctlCode,
+    _In_reads_bytes_(InputLength) PVOID InputBuffer,
+    _In_ size_t InputLength,
+    _Out_ PULONG_PTR BytesReturned
+    )
+{
+    SM5714_SIM_SEGMENT Segments[SPB_MAX_SEQUENCE_TRANSFERS];
+    PSM5714_PMIC_SIM Sim = (PSM5714_PMIC_SIM)Context;
+    PSPB_TRANSFER_LIST List = (PSPB_TRANSFER_LIST)InputBuffer;
+    ULONGLONG BusTimeNs;
+    ULONG_PTR Bytes = 0;
+    NTSTATUS Status;
+    ULONG i;
+
+    *BytesReturned = 0;
+
+    if (IoctlCode != IOCTL_SPB_EXECUTE_SEQUENCE) {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    //
+    // Same checks SpbCx applies before handing a sequence to the controller
+    //
+
+    if (InputLength < sizeof(SPB_TRANSFER_LIST) ||
+        List->Size != sizeof(SPB_TRANSFER_LIST) ||
+        List->TransferCount == 0 ||
+        List->TransferCount > ARRAYSIZE(Segments) ||
+        InputLength < FIELD_OFFSET(SPB_TRANSFER_LIST, Transfers) +
+            List->TransferCount * sizeof(SPB_TRANSFER_LIST_ENTRY)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    for (i = 0; i < List->TransferCount; i++) {
+        const SPB_TRANSFER_LIST_ENTRY* Entry = &List->Transfers[i];
+
+        if (Entry->Buffer.Format != SpbTransferBufferFormatSimple) {
+            return STATUS_NOT_SUPPORTED;
+        }
+
+        Segments[i].Read = (Entry->Direction == SpbTransferDirectionFromDevice);
+        Segments[i].Buffer = (PUCHAR)Entry->Buffer.Simple.Buffer;
+        Segments[i].Length = Entry->Buffer.Simple.BufferCb;
+        Segments[i].DelayUs = Entry->DelayInUs;
+
+        Bytes += Entry->Buffer.Simple.BufferCb;
+    }
+
+    BusTimeNs = Sim->Stats.BusTimeNs;
+
+    Status = Sm5714PmicSimTransfer(Sim, Segments, List->TransferCount);
+    if (NT_SUCCESS(Status)) {
+        *BytesReturned = Bytes;
+    }
+
+    HostAdvanceInterruptTime((Sim->Stats.BusTimeNs - BusTimeNs) / 100);
+
+    return Status;
+}
+
+static const HOST_IO_TARGET_OPS HostPmicSimSpbTargetOps =
+{
+    HostPmicSimSpbTransfer,
+    HostPmicSimSpbIoctl
+};
+
+NTSTATUS
+HostPmicSimSpbRegister(
+    _In_ PSM5714_PMIC_SIM Sim,
+    _In_ LARGE_INTEGER ConnectionId
+    )
+{
+    UNICODE_STRING DeviceName;
+    WCHAR DeviceNameBuffer[RESOURCE_HUB_PATH_SIZE];
+    NTSTATUS Status;
+
+    RtlInitEmptyUnicodeString(&DeviceName, DeviceNameBuffer, sizeof(DeviceNameBuffer));
+
+    Status = RESOURCE_HUB_CREATE_PATH_FROM_ID(&DeviceName, ConnectionId.LowPart, ConnectionId.HighPart);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    return HostIoTargetRegister(&DeviceName, &HostPmicSimSpbTargetOps, Sim);
+}
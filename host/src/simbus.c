@@ -0,0 +1,216 @@
+/*++
+
+Module Name:
+
+    simbus.c
+
+Abstract:
+
+    SM5714_BUS_OPS over the fuel gauge simulator. Each call is issued as one
+    bus transaction with the same segments SpbWriteRead puts into its
+    SPB_TRANSFER_LIST: the send buffer, the read command and the read.
+
+    The simulator can also be registered as the SPB controller behind a
+    resource hub connection ID, so the driver's own Spb.c runs against it
+    through the host I/O target.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#include "../inc/sm5714_host.h"
+#include <spb.h>
+
+static
+NTSTATUS
+HostSimBusWriteRead(
+    _In_                        PVOID   BusContext,
+    _In_reads_(SendLength)      PVOID   SendData,
+    _In_                        USHORT  SendLength,
+    _In_reads_(CmdLength)       PVOID   ReadCmd,
+    _In_                        USHORT  CmdLength,
+    _Out_writes_(DataLength)    PVOID   Data,
+    _In_                        USHORT  DataLength,
+    _In_                        ULONG   DelayUs
+    )
+{
+    SM5714_SIM_SEGMENT Segments[3];
+
+    Segments[0].Read = FALSE;
+    Segments[0].Buffer = (PUCHAR)SendData;
+    Segments[0].Length = SendLength;
+    Segments[0].DelayUs = DelayUs;
+
+    Segments[1].Read = FALSE;
+    Segments[1].Buffer = (PUCHAR)ReadCmd;
+    Segments[1].Length = CmdLength;
+    Segments[1].DelayUs = 0;
+
+    Segments[2].Read = TRUE;
+    Segments[2].Buffer = (PUCHAR)Data;
+    Segments[2].Length = DataLength;
+    Segments[2].DelayUs = 0;
+
+    return Sm5714SimTransfer((PSM5714_SIM)BusContext, Segments, ARRAYSIZE(Segments));
+}
+
+static
+NTSTATUS
+HostSimBusSequence(
+    _In_                        PVOID                       BusContext,
+    _In_reads_(TransferCount)   const SM5714_BUS_TRANSFER*  Transfers,
+    _In_                        ULONG                       TransferCount
+    )
+{
+    SM5714_SIM_SEGMENT Segments[SM5714_BUS_MAX_TRANSFERS];
+    ULONG i;
+
+    if (TransferCount == 0 || TransferCount > SM5714_BUS_MAX_TRANSFERS) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    for (i = 0; i < TransferCount; i++) {
+        Segments[i].Read = Transfers[i].Read;
+        Segments[i].Buffer = (PUCHAR)Transfers[i].Buffer;
+        Segments[i].Length = Transfers[i].Length;
+        Segments[i].DelayUs = Transfers[i].DelayUs;
+    }
+
+    return Sm5714SimTransfer((PSM5714_SIM)BusContext, Segments, TransferCount);
+}
+
+const SM5714_BUS_OPS HostSimBusOps =
+{
+    HostSimBusWriteRead,
+    HostSimBusSequence
+};
+
+static
+NTSTATUS
+HostSimSpbTransfer(
+    _In_ PVOID Context,
+    _In_ BOOLEAN Read,
+    _Inout_updates_bytes_(Length) PVOID Buffer,
+    _In_ size_t Length,
+    _Out_ PULONG_PTR BytesTransferred
+    )
+{
+    PSM5714_SIM Sim = (PSM5714_SIM)Context;
+    SM5714_SIM_SEGMENT Segment;
+    ULONGLONG BusTimeNs;
+    NTSTATUS Status;
+
+    *BytesTransferred = 0;
+
+    Segment.Read = Read;
+    Segment.Buffer = (PUCHAR)Buffer;
+    Segment.Length = (ULONG)Length;
+    Segment.DelayUs = 0;
+
+    BusTimeNs = Sim->Stats.BusTimeNs;
+
+    Status = Sm5714SimTransfer(Sim, &Segment, 1);
+    if (NT_SUCCESS(Status)) {
+        *BytesTransferred = Length;
+    }
+
+    HostAdvanceInterruptTime((Sim->Stats.BusTimeNs - BusTimeNs) / 100);
+
+    return Status;
+}
+
+static
+NTSTATUS
+HostSimSpbIoctl(
+    _In_ PVOID Context,
+    _In_ ULONG IoctlCode,
+    _In_reads_bytes_(InputLength) PVOID InputBuffer,
+    _In_ size_t InputLength,
+    _Out_ PULONG_PTR BytesReturned
+    )
+{
+    SM5714_SIM_SEGMENT Segments[SM5714_BUS_MAX_TRANSFERS];
+    PSM5714_SIM Sim = (PSM5714_SIM)Context;
+    PSPB_TRANSFER_LIST List = (PSPB_TRANSFER_LIST)InputBuffer;
+    ULONGLONG BusTimeNs;
+    ULONG_PTR Bytes = 0;
+    NTSTATUS Status;
+    ULONG i;
+
+    *BytesReturned = 0;
+
+    if (IoctlCode != IOCTL_SPB_EXECUTE_SEQUENCE) {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    //
+    // Same checks SpbCx applies before handing a sequence to the controller
+    //
+
+    if (InputLength < sizeof(SPB_TRANSFER_LIST) ||
+        List->Size != sizeof(SPB_TRANSFER_LIST) ||
+        List->TransferCount == 0 ||
+        List->TransferCount > ARRAYSIZE(Segments) ||
+        InputLength < FIELD_OFFSET(SPB_TRANSFER_LIST, Transfers) +
+            List->TransferCount * sizeof(SPB_TRANSFER_LIST_ENTRY)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    for (i = 0; i < List->TransferCount; i++) {
+        const SPB_TRANSFER_LIST_ENTRY* Entry = &List->Transfers[i];
+
+        if (Entry->Buffer.Format != SpbTransferBufferFormatSimple) {
+            return STATUS_NOT_SUPPORTED;
+        }
+
+        Segments[i].Read = (Entry->Direction == SpbTransferDirectionFromDevice);
+        Segments[i].Buffer = (PUCHAR)Entry->Buffer.Simple.Buffer;
+        Segments[i].Length = Entry->Buffer.Simple.BufferCb;
+        Segments[i].DelayUs = Entry->DelayInUs;
+
+        Bytes += Entry->Buffer.Simple.BufferCb;
+    }
+
+    BusTimeNs = Sim->Stats.BusTimeNs;
+
+    Status = Sm5714SimTransfer(Sim, Segments, List->TransferCount);
+    if (NT_SUCCESS(Status)) {
+        *BytesReturned = Bytes;
+    }
+
+    //
+    // The controller holds the request for the wire time of the sequence
+    //
+
+    HostAdvanceInterruptTime((Sim->Stats.BusTimeNs - BusTimeNs) / 100);
+
+    return Status;
+}
+
+static const HOST_IO_TARGET_OPS HostSimSpbTargetOps =
+{
+    HostSimSpbTransfer,
+    HostSimSpbIoctl
+};
+
+NTSTATUS
+HostSimSpbRegister(
+    _In_ PSM5714_SIM Sim,
+    _In_ LARGE_INTEGER ConnectionId
+    )
+{
+    UNICODE_STRING DeviceName;
+    WCHAR DeviceNameBuffer[RESOURCE_HUB_PATH_SIZE];
+    NTSTATUS Status;
+
+    RtlInitEmptyUnicodeString(&DeviceName, DeviceNameBuffer, sizeof(DeviceNameBuffer));
+
+    Status = RESOURCE_HUB_CREATE_PATH_FROM_ID(&DeviceName, ConnectionId.LowPart, ConnectionId.HighPart);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    return HostIoTargetRegister(&DeviceName, &HostSimSpbTargetOps, Sim);
+}
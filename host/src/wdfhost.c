@@ -0,0 +1,680 @@
+/*++
+
+Module Name:
+
+    wdfhost.c
+
+Abstract:
+
+    Minimal user-mode implementation of the KMDF objects declared in
+    host/wdk/wdf.h. Every object is a heap block with a fixed header followed
+    by its typed context, so GetDeviceExtension and friends work unchanged.
+
+    I/O targets opened by name dispatch to devices registered through
+    HostIoTargetRegister; requests complete synchronously in the caller.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#include <wdf.h>
+#include <batclass.h>
+#include <pthread.h>
+
+typedef enum _HOST_WDF_OBJECT_TYPE {
+    HostWdfObjectDevice,
+    HostWdfObjectWaitLock,
+    HostWdfObjectMemory,
+    HostWdfObjectRequest,
+    HostWdfObjectIoTarget,
+} HOST_WDF_OBJECT_TYPE;
+
+typedef struct _HOST_IO_TARGET_ENTRY {
+    WCHAR                       Name[64];
+    const HOST_IO_TARGET_OPS*   Ops;
+    PVOID                       Context;
+} HOST_IO_TARGET_ENTRY;
+
+typedef struct _HOST_WDF_OBJECT {
+    HOST_WDF_OBJECT_TYPE            Type;
+    PFN_WDF_OBJECT_CONTEXT_CLEANUP  EvtCleanupCallback;
+    PCWDF_OBJECT_CONTEXT_TYPE_INFO  ContextTypeInfo;
+    PVOID                           Context;
+    union {
+        pthread_mutex_t             Mutex;
+
+        struct {
+            PVOID                   Buffer;
+            size_t                  Size;
+            BOOLEAN                 Preallocated;
+        } Memory;
+
+        struct {
+            //
+            // KMDF requires WdfRequestReuse between two sends of the
+            // same request; the host fails the second send instead.
+            //
+            BOOLEAN                 Sent;
+        } Request;
+
+        struct {
+            const HOST_IO_TARGET_ENTRY* Device;
+        } IoTarget;
+    } u;
+} HOST_WDF_OBJECT;
+
+#define HOST_IO_TARGET_MAX_DEVICES  4
+
+static HOST_IO_TARGET_ENTRY HostIoTargets[HOST_IO_TARGET_MAX_DEVICES];
+static ULONGLONG HostObjectAllocations;
+static ULONGLONG HostInterruptTime;
+static ULONGLONG HostStatusNotifications;
+
+static
+WDFOBJECT
+HostWdfObjectAllocate(
+    _In_ HOST_WDF_OBJECT_TYPE Type,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes
+    )
+{
+    size_t contextSize = 0;
+    HOST_WDF_OBJECT* object;
+
+    if (Attributes != NULL && Attributes->ContextTypeInfo != NULL) {
+        contextSize = Attributes->ContextTypeInfo->ContextSize;
+        if (Attributes->ContextSizeOverride > contextSize) {
+            contextSize = Attributes->ContextSizeOverride;
+        }
+    }
+
+    object = calloc(1, sizeof(HOST_WDF_OBJECT) + contextSize);
+    if (object == NULL) {
+        return NULL;
+    }
+
+    __atomic_fetch_add(&HostObjectAllocations, 1, __ATOMIC_RELAXED);
+
+    object->Type = Type;
+    if (Attributes != NULL) {
+        object->EvtCleanupCallback = Attributes->EvtCleanupCallback;
+        object->ContextTypeInfo = Attributes->ContextTypeInfo;
+    }
+
+    if (contextSize != 0) {
+        object->Context = object + 1;
+    }
+
+    return object;
+}
+
+PVOID
+WdfObjectGetTypedContextWorker(
+    _In_ WDFOBJECT Handle,
+    _In_ PCWDF_OBJECT_CONTEXT_TYPE_INFO TypeInfo
+    )
+{
+    UNREFERENCED_PARAMETER(TypeInfo);
+
+    return Handle->Context;
+}
+
+VOID
+WdfObjectDelete(
+    _In_ WDFOBJECT Object
+    )
+{
+    if (Object == NULL) {
+        return;
+    }
+
+    if (Object->EvtCleanupCallback != NULL) {
+        Object->EvtCleanupCallback(Object);
+    }
+
+    if (Object->Type == HostWdfObjectWaitLock) {
+        pthread_mutex_destroy(&Object->u.Mutex);
+    }
+
+    if (Object->Type == HostWdfObjectMemory && !Object->u.Memory.Preallocated) {
+        free(Object->u.Memory.Buffer);
+    }
+
+    free(Object);
+}
+
+NTSTATUS
+WdfWaitLockCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES LockAttributes,
+    _Out_ WDFWAITLOCK* Lock
+    )
+{
+    WDFWAITLOCK lock;
+
+    lock = HostWdfObjectAllocate(HostWdfObjectWaitLock, LockAttributes);
+    if (lock == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    pthread_mutex_init(&lock->u.Mutex, NULL);
+    *Lock = lock;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfWaitLockAcquire(
+    _In_ WDFWAITLOCK Lock,
+    _In_opt_ PLONGLONG Timeout
+    )
+{
+    if (Timeout != NULL && *Timeout == 0) {
+        return (pthread_mutex_trylock(&Lock->u.Mutex) == 0) ? STATUS_SUCCESS : STATUS_TIMEOUT;
+    }
+
+    pthread_mutex_lock(&Lock->u.Mutex);
+    return STATUS_SUCCESS;
+}
+
+VOID
+WdfWaitLockRelease(
+    _In_ WDFWAITLOCK Lock
+    )
+{
+    pthread_mutex_unlock(&Lock->u.Mutex);
+}
+
+NTSTATUS
+WdfMemoryCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _In_ POOL_TYPE PoolType,
+    _In_opt_ ULONG PoolTag,
+    _In_ size_t BufferSize,
+    _Out_ WDFMEMORY* Memory,
+    _Out_opt_ PVOID* Buffer
+    )
+{
+    WDFMEMORY memory;
+
+    UNREFERENCED_PARAMETER(PoolTag);
+
+    if (BufferSize == 0) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    memory = HostWdfObjectAllocate(HostWdfObjectMemory, Attributes);
+    if (memory == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    if ((PoolType & NonPagedPoolCacheAligned) != 0) {
+        memory->u.Memory.Buffer = aligned_alloc(SYSTEM_CACHE_ALIGNMENT_SIZE,
+            (BufferSize + SYSTEM_CACHE_ALIGNMENT_SIZE - 1) & ~(size_t)(SYSTEM_CACHE_ALIGNMENT_SIZE - 1));
+        if (memory->u.Memory.Buffer != NULL) {
+            memset(memory->u.Memory.Buffer, 0, BufferSize);
+        }
+    } else {
+        memory->u.Memory.Buffer = calloc(1, BufferSize);
+    }
+
+    if (memory->u.Memory.Buffer == NULL) {
+        WdfObjectDelete(memory);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    memory->u.Memory.Size = BufferSize;
+
+    *Memory = memory;
+    if (Buffer != NULL) {
+        *Buffer = memory->u.Memory.Buffer;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfMemoryCreatePreallocated(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _In_ PVOID Buffer,
+    _In_ size_t BufferSize,
+    _Out_ WDFMEMORY* Memory
+    )
+{
+    WDFMEMORY memory;
+
+    if (Buffer == NULL || BufferSize == 0) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    memory = HostWdfObjectAllocate(HostWdfObjectMemory, Attributes);
+    if (memory == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    memory->u.Memory.Buffer = Buffer;
+    memory->u.Memory.Size = BufferSize;
+    memory->u.Memory.Preallocated = TRUE;
+
+    *Memory = memory;
+    return STATUS_SUCCESS;
+}
+
+PVOID
+WdfMemoryGetBuffer(
+    _In_ WDFMEMORY Memory,
+    _Out_opt_ size_t* BufferSize
+    )
+{
+    if (BufferSize != NULL) {
+        *BufferSize = Memory->u.Memory.Size;
+    }
+
+    return Memory->u.Memory.Buffer;
+}
+
+NTSTATUS
+WdfRequestCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES RequestAttributes,
+    _In_opt_ WDFIOTARGET IoTarget,
+    _Out_ WDFREQUEST* Request
+    )
+{
+    WDFREQUEST request;
+
+    UNREFERENCED_PARAMETER(IoTarget);
+
+    request = HostWdfObjectAllocate(HostWdfObjectRequest, RequestAttributes);
+    if (request == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    *Request = request;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfRequestReuse(
+    _In_ WDFREQUEST Request,
+    _In_ PWDF_REQUEST_REUSE_PARAMS ReuseParams
+    )
+{
+    UNREFERENCED_PARAMETER(ReuseParams);
+
+    Request->u.Request.Sent = FALSE;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfIoTargetCreate(
+    _In_ WDFDEVICE Device,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES IoTargetAttributes,
+    _Out_ WDFIOTARGET* IoTarget
+    )
+{
+    WDFIOTARGET ioTarget;
+
+    UNREFERENCED_PARAMETER(Device);
+
+    ioTarget = HostWdfObjectAllocate(HostWdfObjectIoTarget, IoTargetAttributes);
+    if (ioTarget == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    *IoTarget = ioTarget;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfIoTargetOpen(
+    _In_ WDFIOTARGET IoTarget,
+    _In_ PWDF_IO_TARGET_OPEN_PARAMS OpenParams
+    )
+{
+    const UNICODE_STRING* name = &OpenParams->TargetDeviceName;
+    size_t cch = name->Length / sizeof(WCHAR);
+    ULONG i;
+
+    if (OpenParams->Type != WdfIoTargetOpenByName) {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    for (i = 0; i < HOST_IO_TARGET_MAX_DEVICES; i++) {
+        const HOST_IO_TARGET_ENTRY* entry = &HostIoTargets[i];
+
+        if (entry->Ops != NULL &&
+            wcslen(entry->Name) == cch &&
+            wmemcmp(entry->Name, name->Buffer, cch) == 0) {
+
+            IoTarget->u.IoTarget.Device = entry;
+            return STATUS_SUCCESS;
+        }
+    }
+
+    return STATUS_NO_SUCH_DEVICE;
+}
+
+static
+NTSTATUS
+HostMemoryDescriptorGetBuffer(
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR Descriptor,
+    _Out_ PVOID* Buffer,
+    _Out_ size_t* Length
+    )
+{
+    WDFMEMORY memory;
+    PWDFMEMORY_OFFSET offsets;
+
+    *Buffer = NULL;
+    *Length = 0;
+
+    if (Descriptor == NULL) {
+        return STATUS_SUCCESS;
+    }
+
+    switch (Descriptor->Type) {
+    case WdfMemoryDescriptorTypeBuffer:
+        *Buffer = Descriptor->u.BufferType.Buffer;
+        *Length = Descriptor->u.BufferType.Length;
+        return STATUS_SUCCESS;
+
+    case WdfMemoryDescriptorTypeHandle:
+        memory = Descriptor->u.HandleType.Memory;
+        offsets = Descriptor->u.HandleType.Offsets;
+
+        if (offsets == NULL) {
+            *Buffer = memory->u.Memory.Buffer;
+            *Length = memory->u.Memory.Size;
+            return STATUS_SUCCESS;
+        }
+
+        if (offsets->BufferOffset > memory->u.Memory.Size ||
+            offsets->BufferLength > memory->u.Memory.Size - offsets->BufferOffset) {
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        *Buffer = (PUCHAR)memory->u.Memory.Buffer + offsets->BufferOffset;
+        *Length = (offsets->BufferLength != 0) ?
+            offsets->BufferLength : memory->u.Memory.Size - offsets->BufferOffset;
+        return STATUS_SUCCESS;
+
+    default:
+        return STATUS_NOT_SUPPORTED;
+    }
+}
+
+//
+// Common front half of the synchronous sends: resolves the device behind the
+// target and claims the request, allocating one when the caller passed none.
+//
+
+static
+NTSTATUS
+HostIoTargetBeginSend(
+    _In_ WDFIOTARGET IoTarget,
+    _In_opt_ WDFREQUEST Request,
+    _Out_ const HOST_IO_TARGET_ENTRY** Device,
+    _Out_ WDFREQUEST* SendRequest
+    )
+{
+    *Device = IoTarget->u.IoTarget.Device;
+    *SendRequest = NULL;
+
+    if (*Device == NULL) {
+        return STATUS_INVALID_DEVICE_REQUEST;
+    }
+
+    if (Request == NULL) {
+        return WdfRequestCreate(WDF_NO_OBJECT_ATTRIBUTES, IoTarget, SendRequest);
+    }
+
+    if (Request->u.Request.Sent) {
+        return STATUS_INVALID_DEVICE_REQUEST;
+    }
+
+    Request->u.Request.Sent = TRUE;
+    *SendRequest = Request;
+    return STATUS_SUCCESS;
+}
+
+static
+VOID
+HostIoTargetEndSend(
+    _In_opt_ WDFREQUEST Request,
+    _In_opt_ WDFREQUEST SendRequest
+    )
+{
+    if (SendRequest != NULL && SendRequest != Request) {
+        WdfObjectDelete(SendRequest);
+    }
+}
+
+static
+NTSTATUS
+HostIoTargetSendTransfer(
+    _In_ WDFIOTARGET IoTarget,
+    _In_opt_ WDFREQUEST Request,
+    _In_ BOOLEAN Read,
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR Descriptor,
+    _Out_opt_ PULONG_PTR BytesTransferred
+    )
+{
+    const HOST_IO_TARGET_ENTRY* device;
+    WDFREQUEST sendRequest;
+    PVOID buffer;
+    size_t length;
+    ULONG_PTR bytes = 0;
+    NTSTATUS status;
+
+    status = HostIoTargetBeginSend(IoTarget, Request, &device, &sendRequest);
+    if (!NT_SUCCESS(status)) {
+        goto Exit;
+    }
+
+    status = HostMemoryDescriptorGetBuffer(Descriptor, &buffer, &length);
+    if (!NT_SUCCESS(status)) {
+        goto Exit;
+    }
+
+    if (device->Ops->Transfer == NULL) {
+        status = STATUS_INVALID_DEVICE_REQUEST;
+        goto Exit;
+    }
+
+    status = device->Ops->Transfer(device->Context, Read, buffer, length, &bytes);
+
+Exit:
+    HostIoTargetEndSend(Request, sendRequest);
+
+    if (BytesTransferred != NULL) {
+        *BytesTransferred = bytes;
+    }
+
+    return status;
+}
+
+NTSTATUS
+WdfIoTargetSendReadSynchronously(
+    _In_ WDFIOTARGET IoTarget,
+    _In_opt_ WDFREQUEST Request,
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR OutputBuffer,
+    _In_opt_ PLONGLONG DeviceOffset,
+    _In_opt_ PWDF_REQUEST_SEND_OPTIONS RequestOptions,
+    _Out_opt_ PULONG_PTR BytesRead
+    )
+{
+    UNREFERENCED_PARAMETER(DeviceOffset);
+    UNREFERENCED_PARAMETER(RequestOptions);
+
+    return HostIoTargetSendTransfer(IoTarget, Request, TRUE, OutputBuffer, BytesRead);
+}
+
+NTSTATUS
+WdfIoTargetSendWriteSynchronously(
+    _In_ WDFIOTARGET IoTarget,
+    _In_opt_ WDFREQUEST Request,
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR InputBuffer,
+    _In_opt_ PLONGLONG DeviceOffset,
+    _In_opt_ PWDF_REQUEST_SEND_OPTIONS RequestOptions,
+    _Out_opt_ PULONG_PTR BytesWritten
+    )
+{
+    UNREFERENCED_PARAMETER(DeviceOffset);
+    UNREFERENCED_PARAMETER(RequestOptions);
+
+    return HostIoTargetSendTransfer(IoTarget, Request, FALSE, InputBuffer, BytesWritten);
+}
+
+NTSTATUS
+WdfIoTargetSendIoctlSynchronously(
+    _In_ WDFIOTARGET IoTarget,
+    _In_opt_ WDFREQUEST Request,
+    _In_ ULONG IoctlCode,
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR InputBuffer,
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR OutputBuffer,
+    _In_opt_ PWDF_REQUEST_SEND_OPTIONS RequestOptions,
+    _Out_opt_ PULONG_PTR BytesReturned
+    )
+{
+    const HOST_IO_TARGET_ENTRY* device;
+    WDFREQUEST sendRequest;
+    PVOID buffer;
+    size_t length;
+    ULONG_PTR bytes = 0;
+    NTSTATUS status;
+
+    UNREFERENCED_PARAMETER(RequestOptions);
+
+    status = HostIoTargetBeginSend(IoTarget, Request, &device, &sendRequest);
+    if (!NT_SUCCESS(status)) {
+        goto Exit;
+    }
+
+    //
+    // Only input-only IOCTLs such as IOCTL_SPB_EXECUTE_SEQUENCE are modelled
+    //
+
+    if (OutputBuffer != NULL || device->Ops->Ioctl == NULL) {
+        status = STATUS_NOT_SUPPORTED;
+        goto Exit;
+    }
+
+    status = HostMemoryDescriptorGetBuffer(InputBuffer, &buffer, &length);
+    if (!NT_SUCCESS(status)) {
+        goto Exit;
+    }
+
+    status = device->Ops->Ioctl(device->Context, IoctlCode, buffer, length, &bytes);
+
+Exit:
+    HostIoTargetEndSend(Request, sendRequest);
+
+    if (BytesReturned != NULL) {
+        *BytesReturned = bytes;
+    }
+
+    return status;
+}
+
+NTSTATUS
+HostIoTargetRegister(
+    _In_ PCUNICODE_STRING DeviceName,
+    _In_ const HOST_IO_TARGET_OPS* Ops,
+    _In_ PVOID Context
+    )
+{
+    size_t cch = DeviceName->Length / sizeof(WCHAR);
+    HOST_IO_TARGET_ENTRY* freeEntry = NULL;
+    ULONG i;
+
+    if (cch >= ARRAYSIZE(HostIoTargets[0].Name)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    for (i = 0; i < HOST_IO_TARGET_MAX_DEVICES; i++) {
+        HOST_IO_TARGET_ENTRY* entry = &HostIoTargets[i];
+
+        if (entry->Ops == NULL) {
+            if (freeEntry == NULL) {
+                freeEntry = entry;
+            }
+            continue;
+        }
+
+        if (wcslen(entry->Name) == cch &&
+            wmemcmp(entry->Name, DeviceName->Buffer, cch) == 0) {
+
+            freeEntry = entry;
+            break;
+        }
+    }
+
+    if (freeEntry == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    wmemcpy(freeEntry->Name, DeviceName->Buffer, cch);
+    freeEntry->Name[cch] = L'\0';
+    freeEntry->Ops = Ops;
+    freeEntry->Context = Context;
+    return STATUS_SUCCESS;
+}
+
+ULONGLONG
+HostWdfGetObjectAllocations(
+    VOID
+    )
+{
+    return __atomic_load_n(&HostObjectAllocations, __ATOMIC_RELAXED);
+}
+
+NTSTATUS
+HostWdfDeviceCreate(
+    _In_ PWDF_OBJECT_ATTRIBUTES DeviceAttributes,
+    _Out_ WDFDEVICE* Device
+    )
+{
+    WDFDEVICE device;
+
+    device = HostWdfObjectAllocate(HostWdfObjectDevice, DeviceAttributes);
+    if (device == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    *Device = device;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS
+BatteryClassStatusNotify(
+    _In_ PVOID ClassData
+    )
+{
+    UNREFERENCED_PARAMETER(ClassData);
+
+    __atomic_fetch_add(&HostStatusNotifications, 1, __ATOMIC_RELAXED);
+    return STATUS_SUCCESS;
+}
+
+ULONGLONG
+HostBatteryClassGetStatusNotifications(
+    VOID
+    )
+{
+    return __atomic_load_n(&HostStatusNotifications, __ATOMIC_RELAXED);
+}
+
+ULONGLONG
+KeQueryInterruptTime(
+    VOID
+    )
+{
+    return __atomic_load_n(&HostInterruptTime, __ATOMIC_RELAXED);
+}
+
+VOID
+HostAdvanceInterruptTime(
+    _In_ ULONGLONG Delta
+    )
+{
+    __atomic_fetch_add(&HostInterruptTime, Delta, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,1482 @@
+/*++
+
+Module Name:
+
+    sm5714_bench.c
+
+Abstract:
+
+    Times each battery class callback against the fuel gauge simulator.
+    Reports CPU time next to the I2C wire time the callback occupies the
+    bus for, since on target the latter dominates.
+
+    The device is bound to the driver's SpbBusOps over the host I/O target,
+    so the framework objects created per callback are counted as well.
+
+    Usage: sm5714_bench [-o results.csv] [-b baseline.csv] [iterations]
+
+    After the rows, one virtual hour of shell polling is replayed in each
+    sampling mode under a jittering load, to show the bus cost per hour
+    and how steady the reported rate and voltage stay. A second hour
+    compares the battery class polling the status with the class waiting
+    for status notifications, and a third counts power state changes of
+    an idle battery whose current wanders around zero. Last, reader
+    threads time QueryTag and QueryStatus on a second device while a
+    charger thread keeps that device's stalling bus busy.
+
+    Along the way the status notification thresholds and the power state
+    debounce are checked; a failed check is printed and makes the bench
+    exit with 4.
+
+    -o writes the rows as CSV. -b compares the run against such a file and
+    exits with 3 when a row needs more bus transactions, bus time or
+    framework objects than the baseline did; CPU time is reported but does
+    not fail the comparison since it depends on the machine.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#include "../inc/sm5714_host.h"
+#include "../../SM5714Battery/inc/SM5714Battery_regs.h"
+#include <pthread.h>
+#include <time.h>
+
+#define BENCH_DEFAULT_ITERATIONS    10000
+#define BENCH_MAX_RESULTS           32
+#define BENCH_NAME_SIZE             48
+
+//
+// Simulated metrics are deterministic, anything above rounding noise in the
+// CSV is a real change
+//
+
+#define BENCH_TOLERANCE             0.005
+
+#define BENCH_CSV_HEADER            "callback,iterations,cpu_ns,xfers,bus_us,objects"
+
+//
+// Sampling mode replay: an hour of 250 ms polls against a 350 mA load
+// whose instantaneous current jitters by up to 200 mA around the average
+// the gauge reports in CURRENT_AVG
+//
+
+#define BENCH_HOUR                  (3600ULL * 10000000ULL)
+#define BENCH_LOAD_MA               350
+#define BENCH_LOAD_JITTER_MA        200
+
+//
+// Idle replay: the current wanders by up to 30 mA around zero
+//
+
+#define BENCH_IDLE_JITTER_MA        30
+
+//
+// Checks give up on a capacity that never reaches its target after this
+// many samples
+//
+
+#define BENCH_CHECK_MAX_STEPS       100000
+
+typedef struct _BENCH_RESULT {
+    CHAR                        Name[BENCH_NAME_SIZE];
+    ULONG                       Iterations;
+    double                      CpuNs;
+    double                      Transactions;
+    double                      BusUs;
+    double                      Objects;
+} BENCH_RESULT, *PBENCH_RESULT;
+
+typedef struct _BENCH_RESULTS {
+    ULONG                       Count;
+    BENCH_RESULT                Rows[BENCH_MAX_RESULTS];
+} BENCH_RESULTS, *PBENCH_RESULTS;
+
+typedef struct _BENCH_CONTEXT {
+    PSM5714_BATTERY_FDO_DATA    DevExt;
+    PSM5714_SIM                 Sim;
+    ULONG                       Tag;
+    BATTERY_QUERY_INFORMATION_LEVEL Level;
+    ULONGLONG                   PollInterval;
+    ULONGLONG                   SamplePeriod;
+    ULONGLONG                   NextSample;
+    BENCH_RESULTS               Results;
+    ULONG                       Failures;
+} BENCH_CONTEXT, *PBENCH_CONTEXT;
+
+typedef NTSTATUS BENCH_ROUTINE(_In_ PBENCH_CONTEXT Context);
+
+static
+NTSTATUS
+BenchQueryTag(
+    _In_ PBENCH_CONTEXT Context
+    )
+{
+    ULONG Tag;
+
+    return SM5714BatteryQueryTag(Context->DevExt, &Tag);
+}
+
+static
+NTSTATUS
+BenchPollStatus(
+    _In_ PBENCH_CONTEXT Context,
+    _Out_ PBATTERY_STATUS BatteryStatus
+    )
+{
+    HostAdvanceInterruptTime(Context->PollInterval);
+
+    //
+    // Stand-in for the sampler timer; its bus time is charged to the row
+    //
+
+    if (Context->SamplePeriod != 0 && KeQueryInterruptTime() >= Context->NextSample) {
+        SM5714TelemetrySample(Context->DevExt, NULL);
+        Context->NextSample = KeQueryInterruptTime() + Context->SamplePeriod;
+    }
+
+    return SM5714BatteryQueryStatus(Context->DevExt, Context->Tag, BatteryStatus);
+}
+
+static
+NTSTATUS
+BenchQueryStatus(
+    _In_ PBENCH_CONTEXT Context
+    )
+{
+    BATTERY_STATUS BatteryStatus;
+
+    return BenchPollStatus(Context, &BatteryStatus);
+}
+
+static
+NTSTATUS
+BenchQueryInformation(
+    _In_ PBENCH_CONTEXT Context
+    )
+{
+    UCHAR Buffer[MAX_BATTERY_STRING_SIZE * sizeof(WCHAR)];
+    ULONG ReturnedLength;
+
+    return SM5714BatteryQueryInformation(Context->DevExt, Context->Tag, Context->Level, 0, Buffer, sizeof(Buffer), &ReturnedLength);
+}
+
+//
+// Bus primitive rather than a callback: one register read through
+// SpbReadDataSynchronously
+//
+
+static
+NTSTATUS
+BenchSpbReadData(
+    _In_ PBENCH_CONTEXT Context
+    )
+{
+    USHORT DeviceId;
+
+    return SpbReadDataSynchronously(&Context->DevExt->I2CContext, SM5714_FG_REG_DEVICE_ID, &DeviceId, sizeof(DeviceId));
+}
+
+//
+// One alert from the gauge raising the line to the battery class being
+// notified: the ISR's INTFG read plus the work item's sample. The driver
+// does not decode INTFG, so any bit will do.
+//
+
+static
+NTSTATUS
+BenchAlert(
+    _In_ PBENCH_CONTEXT Context
+    )
+{
+    if (!Sm5714SimRaiseAlert(Context->Sim, 0x0001)) {
+        return STATUS_UNSUCCESSFUL;
+    }
+
+    if (!SM5714AlertAcknowledge(Context->DevExt)) {
+        return STATUS_UNSUCCESSFUL;
+    }
+
+    SM5714AlertProcess(Context->DevExt);
+    return STATUS_SUCCESS;
+}
+
+static
+ULONGLONG
+BenchNowNs(
+    void
+    )
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ULONGLONG)ts.tv_sec * 1000000000ULL + (ULONGLONG)ts.tv_nsec;
+}
+
+static
+VOID
+BenchRun(
+    _In_ PCSTR Name,
+    _In_ BENCH_ROUTINE* Routine,
+    _In_ PBENCH_CONTEXT Context,
+    _Inout_ PSM5714_SIM Sim,
+    _In_ ULONG Iterations
+    )
+{
+    PBENCH_RESULT Result;
+    ULONGLONG start;
+    ULONGLONG cpuNs;
+    ULONGLONG objects;
+    ULONG i;
+
+    Sm5714SimResetStats(Sim);
+
+    objects = HostWdfGetObjectAllocations();
+    start = BenchNowNs();
+    for (i = 0; i < Iterations; i++) {
+        Routine(Context);
+    }
+    cpuNs = BenchNowNs() - start;
+    objects = HostWdfGetObjectAllocations() - objects;
+
+    if (Context->Results.Count == BENCH_MAX_RESULTS) {
+        fprintf(stderr, "too many benchmark rows, %s not recorded\n", Name);
+        return;
+    }
+
+    Result = &Context->Results.Rows[Context->Results.Count++];
+    snprintf(Result->Name, sizeof(Result->Name), "%s", Name);
+    Result->Iterations = Iterations;
+    Result->CpuNs = (double)cpuNs / Iterations;
+    Result->Transactions = (double)Sim->Stats.Transactions / Iterations;
+    Result->BusUs = (double)Sim->Stats.BusTimeNs / Iterations / 1000.0;
+    Result->Objects = (double)objects / Iterations;
+
+    printf("%-36s %10.1f %8.2f %10.2f %8.2f\n",
+        Result->Name,
+        Result->CpuNs,
+        Result->Transactions,
+        Result->BusUs,
+        Result->Objects);
+}
+
+static
+BOOLEAN
+BenchWriteResults(
+    _In_ PCSTR Path,
+    _In_ const BENCH_RESULTS* Results
+    )
+{
+    FILE* File;
+    ULONG i;
+
+    File = fopen(Path, "w");
+    if (File == NULL) {
+        perror(Path);
+        return FALSE;
+    }
+
+    fprintf(File, "%s\n", BENCH_CSV_HEADER);
+    for (i = 0; i < Results->Count; i++) {
+        const BENCH_RESULT* Result = &Results->Rows[i];
+
+        fprintf(File, "\"%s\",%lu,%.1f,%.4f,%.3f,%.4f\n",
+            Result->Name,
+            (unsigned long)Result->Iterations,
+            Result->CpuNs,
+            Result->Transactions,
+            Result->BusUs,
+            Result->Objects);
+    }
+
+    if (fclose(File) != 0) {
+        perror(Path);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static
+BOOLEAN
+BenchReadResults(
+    _In_ PCSTR Path,
+    _Out_ PBENCH_RESULTS Results
+    )
+{
+    CHAR Line[256];
+    FILE* File;
+    PBENCH_RESULT Result;
+    unsigned long Iterations;
+    int Fields;
+
+    RtlZeroMemory(Results, sizeof(*Results));
+
+    File = fopen(Path, "r");
+    if (File == NULL) {
+        perror(Path);
+        return FALSE;
+    }
+
+    //
+    // Callback names may contain commas but never quotes, the first field
+    // is always quoted
+    //
+
+    while (fgets(Line, sizeof(Line), File) != NULL) {
+        if (strncmp(Line, BENCH_CSV_HEADER, sizeof(BENCH_CSV_HEADER) - 1) == 0 ||
+            Line[0] == '#' || Line[0] == '\n') {
+            continue;
+        }
+
+        if (Results->Count == BENCH_MAX_RESULTS) {
+            break;
+        }
+
+        Result = &Results->Rows[Results->Count];
+        Fields = sscanf(Line, "\"%47[^\"]\",%lu,%lf,%lf,%lf,%lf",
+            Result->Name,
+            &Iterations,
+            &Result->CpuNs,
+            &Result->Transactions,
+            &Result->BusUs,
+            &Result->Objects);
+
+        if (Fields != 6) {
+            fprintf(stderr, "%s: malformed row: %s", Path, Line);
+            fclose(File);
+            return FALSE;
+        }
+
+        Result->Iterations = (ULONG)Iterations;
+        Results->Count += 1;
+    }
+
+    fclose(File);
+    return TRUE;
+}
+
+static
+const BENCH_RESULT*
+BenchFindResult(
+    _In_ const BENCH_RESULTS* Results,
+    _In_ PCSTR Name
+    )
+{
+    ULONG i;
+
+    for (i = 0; i < Results->Count; i++) {
+        if (strcmp(Results->Rows[i].Name, Name) == 0) {
+            return &Results->Rows[i];
+        }
+    }
+
+    return NULL;
+}
+
+static
+PCSTR
+BenchCompareMetric(
+    _In_ double Baseline,
+    _In_ double Current,
+    _Inout_ PULONG Regressions
+    )
+{
+    if (Current > Baseline + BENCH_TOLERANCE) {
+        *Regressions += 1;
+        return "+";
+    }
+
+    if (Current < Baseline - BENCH_TOLERANCE) {
+        return "-";
+    }
+
+    return " ";
+}
+
+//
+// Prints every row next to its baseline. Returns the number of rows that
+// cost more bus transactions, bus time or framework objects than before.
+//
+
+static
+ULONG
+BenchCompareResults(
+    _In_ const BENCH_RESULTS* Baseline,
+    _In_ const BENCH_RESULTS* Results
+    )
+{
+    ULONG Regressions = 0;
+    ULONG i;
+
+    //
+    // Rows averaging cache hits over misses only match at the same count
+    //
+
+    if (Baseline->Count != 0 && Results->Count != 0 &&
+        Baseline->Rows[0].Iterations != Results->Rows[0].Iterations) {
+        printf("\nbaseline ran %lu iterations, this run %lu; polled rows will differ\n",
+            (unsigned long)Baseline->Rows[0].Iterations,
+            (unsigned long)Results->Rows[0].Iterations);
+    }
+
+    printf("\n%-36s %8s %19s %23s %19s\n", "vs baseline", "cpu", "xfers", "bus us", "objects");
+
+    for (i = 0; i < Results->Count; i++) {
+        const BENCH_RESULT* Result = &Results->Rows[i];
+        const BENCH_RESULT* Base = BenchFindResult(Baseline, Result->Name);
+        ULONG RowRegressions = 0;
+        PCSTR XferMark;
+        PCSTR BusMark;
+        PCSTR ObjectMark;
+
+        if (Base == NULL) {
+            printf("%-36s (not in baseline)\n", Result->Name);
+            continue;
+        }
+
+        XferMark = BenchCompareMetric(Base->Transactions, Result->Transactions, &RowRegressions);
+        BusMark = BenchCompareMetric(Base->BusUs, Result->BusUs, &RowRegressions);
+        ObjectMark = BenchCompareMetric(Base->Objects, Result->Objects, &RowRegressions);
+
+        printf("%-36s %+7.0f%% %8.2f ->%6.2f%s %10.2f ->%8.2f%s %8.2f ->%6.2f%s%s\n",
+            Result->Name,
+            (Base->CpuNs > 0) ? (Result->CpuNs - Base->CpuNs) * 100.0 / Base->CpuNs : 0.0,
+            Base->Transactions, Result->Transactions, XferMark,
+            Base->BusUs, Result->BusUs, BusMark,
+            Base->Objects, Result->Objects, ObjectMark,
+            (RowRegressions != 0) ? "  REGRESSED" : "");
+
+        if (RowRegressions != 0) {
+            Regressions += 1;
+        }
+    }
+
+    for (i = 0; i < Baseline->Count; i++) {
+        if (BenchFindResult(Results, Baseline->Rows[i].Name) == NULL) {
+            printf("%-36s (missing from this run)\n", Baseline->Rows[i].Name);
+        }
+    }
+
+    return Regressions;
+}
+
+static
+VOID
+BenchPrintCache(
+    _Inout_ PBENCH_CONTEXT Context
+    )
+{
+    printf("%-36s %llu hits, %llu misses\n",
+        "",
+        (unsigned long long)Context->DevExt->StatusCacheHits,
+        (unsigned long long)Context->DevExt->StatusCacheMisses);
+
+    Context->DevExt->StatusCacheHits = 0;
+    Context->DevExt->StatusCacheMisses = 0;
+}
+
+//
+// Prints the SPB statistics of the whole run, as the
+// SM5714Battery_SpbStatistics WMI block would report them
+//
+
+static
+VOID
+BenchPrintSpbStatistics(
+    _In_ PBENCH_CONTEXT Context
+    )
+{
+    SPB_STATISTICS Statistics;
+    ULONG Bucket;
+
+    SpbGetStatistics(&Context->DevExt->I2CContext, &Statistics);
+
+    printf("\nspb: %lld transactions, %lld bytes, %lld errors, %lld timeouts\n",
+        (long long)Statistics.Transactions,
+        (long long)Statistics.BytesTransferred,
+        (long long)Statistics.Errors,
+        (long long)Statistics.Timeouts);
+
+    for (Bucket = 0; Bucket < SPB_LATENCY_BUCKETS; Bucket++) {
+        if (Statistics.LatencyHistogram[Bucket] != 0) {
+            printf("     %6lu us+ %lld\n",
+                1UL << Bucket,
+                (long long)Statistics.LatencyHistogram[Bucket]);
+        }
+    }
+}
+
+//
+// 2.11 sign-magnitude CURRENT word that decodes back to Current_mA
+//
+
+static
+USHORT
+BenchEncodeCurrent(
+    _In_ LONG Current_mA
+    )
+{
+    ULONG Magnitude = (ULONG)((Current_mA < 0) ? -Current_mA : Current_mA);
+    USHORT Raw = (USHORT)(((Magnitude * 2048 + 999) / 1000) & 0x1FFF);
+
+    return (Current_mA < 0) ? (USHORT)(Raw | 0x8000) : Raw;
+}
+
+static
+VOID
+BenchSamplingModes(
+    _Inout_ PBENCH_CONTEXT Context,
+    _Inout_ PSM5714_SIM Sim
+    )
+{
+    static const struct {
+        PCSTR Name;
+        SM5714_SAMPLING_MODE Mode;
+    } Modes[] = {
+        { "normal", Sm5714SamplingNormal },
+        { "low power", Sm5714SamplingLowPower },
+    };
+
+    USHORT SavedCurrent = Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT];
+    USHORT SavedCurrentAvg = Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT_AVG];
+    BATTERY_STATUS BatteryStatus;
+    ULONGLONG Start;
+    ULONG State = 0x5714;
+    LONG Jitter;
+    ULONG m;
+
+    printf("\n%-10s %9s %9s %10s %6s %14s %13s\n", "sampling", "period ms", "xfers/h", "bus ms/h", "rate", "range mW", "voltage mV");
+
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT_AVG] = BenchEncodeCurrent(-BENCH_LOAD_MA);
+
+    for (m = 0; m < ARRAYSIZE(Modes); m++) {
+        LONGLONG Sum = 0;
+        ULONG Polls = 0;
+        LONG MinRate = MAXLONG;
+        LONG MaxRate = MINLONG;
+        ULONG MinVoltage = MAXULONG;
+        ULONG MaxVoltage = 0;
+
+        SM5714TelemetrySetSamplingMode(Context->DevExt, Modes[m].Mode);
+        SM5714TelemetryReset(Context->DevExt);
+        Sm5714SimResetStats(Sim);
+
+        Context->PollInterval = MILLISECONDS(250);
+        Context->SamplePeriod = MILLISECONDS(SM5714TelemetrySamplePeriodMs(Context->DevExt));
+        Context->NextSample = KeQueryInterruptTime();
+
+        Start = KeQueryInterruptTime();
+        while (KeQueryInterruptTime() - Start < BENCH_HOUR) {
+            State = State * 1664525u + 1013904223u;
+            Jitter = (LONG)((State >> 16) % (2 * BENCH_LOAD_JITTER_MA + 1)) - BENCH_LOAD_JITTER_MA;
+            Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT] = BenchEncodeCurrent(-(BENCH_LOAD_MA + Jitter));
+
+            if (!NT_SUCCESS(BenchPollStatus(Context, &BatteryStatus))) {
+                continue;
+            }
+
+            Sum += BatteryStatus.Rate;
+            MinRate = (BatteryStatus.Rate < MinRate) ? BatteryStatus.Rate : MinRate;
+            MaxRate = (BatteryStatus.Rate > MaxRate) ? BatteryStatus.Rate : MaxRate;
+            MinVoltage = (BatteryStatus.Voltage < MinVoltage) ? BatteryStatus.Voltage : MinVoltage;
+            MaxVoltage = (BatteryStatus.Voltage > MaxVoltage) ? BatteryStatus.Voltage : MaxVoltage;
+            Polls += 1;
+        }
+
+        printf("%-10s %9lu %9llu %10.1f %6lld %6ld..%-6ld %6lu..%lu\n",
+            Modes[m].Name,
+            (unsigned long)SM5714TelemetrySamplePeriodMs(Context->DevExt),
+            (unsigned long long)Sim->Stats.Transactions,
+            Sim->Stats.BusTimeNs / 1000000.0,
+            (long long)((Polls != 0) ? Sum / Polls : 0),
+            (long)MinRate,
+            (long)MaxRate,
+            (unsigned long)MinVoltage,
+            (unsigned long)MaxVoltage);
+    }
+
+    SM5714TelemetrySetSamplingMode(Context->DevExt, Sm5714SamplingNormal);
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT] = SavedCurrent;
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT_AVG] = SavedCurrentAvg;
+    Context->PollInterval = 0;
+    Context->SamplePeriod = 0;
+}
+
+//
+// The battery class either polls QueryStatus every 250 ms, or arms status
+// notification for any change of capacity (the 1 mWh granularity) and
+// only queries when notified, while the sampler runs at its normal period
+//
+
+static
+VOID
+BenchStatusNotify(
+    _Inout_ PBENCH_CONTEXT Context,
+    _Inout_ PSM5714_SIM Sim
+    )
+{
+    USHORT SavedCurrent = Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT];
+    USHORT SavedCurrentAvg = Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT_AVG];
+    BATTERY_STATUS BatteryStatus;
+    BATTERY_NOTIFY BatteryNotify;
+    ULONGLONG Notifications;
+    ULONGLONG First;
+    ULONGLONG Start;
+    ULONG Queries;
+    ULONG Notify;
+
+    printf("\n%-10s %10s %10s %9s %10s\n", "class", "queries/h", "notifies/h", "xfers/h", "bus ms/h");
+
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT] = BenchEncodeCurrent(-BENCH_LOAD_MA);
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT_AVG] = BenchEncodeCurrent(-BENCH_LOAD_MA);
+
+    for (Notify = 0; Notify < 2; Notify++) {
+        SM5714TelemetryReset(Context->DevExt);
+        Sm5714SimResetStats(Sim);
+        Notifications = HostBatteryClassGetStatusNotifications();
+        Queries = 0;
+        First = Notifications;
+
+        Context->PollInterval = MILLISECONDS(250);
+        Context->SamplePeriod = MILLISECONDS(SM5714TelemetrySamplePeriodMs(Context->DevExt));
+        Context->NextSample = KeQueryInterruptTime();
+
+        Start = KeQueryInterruptTime();
+
+        if (Notify == 0) {
+            while (KeQueryInterruptTime() - Start < BENCH_HOUR) {
+                BenchPollStatus(Context, &BatteryStatus);
+                Queries += 1;
+            }
+
+        } else {
+            while (KeQueryInterruptTime() - Start < BENCH_HOUR) {
+                if (Queries == 0 || HostBatteryClassGetStatusNotifications() != Notifications) {
+                    Notifications = HostBatteryClassGetStatusNotifications();
+                    if (!NT_SUCCESS(SM5714BatteryQueryStatus(Context->DevExt, Context->Tag, &BatteryStatus))) {
+                        break;
+                    }
+
+                    Queries += 1;
+                    BatteryNotify.PowerState = BatteryStatus.PowerState;
+                    BatteryNotify.LowCapacity = BatteryStatus.Capacity - 1;
+                    BatteryNotify.HighCapacity = BatteryStatus.Capacity + 1;
+                    SM5714BatterySetStatusNotify(Context->DevExt, Context->Tag, &BatteryNotify);
+                }
+
+                HostAdvanceInterruptTime(Context->SamplePeriod);
+                SM5714TelemetrySample(Context->DevExt, NULL);
+                SM5714TelemetryNotifyStatus(Context->DevExt, FALSE);
+            }
+
+            SM5714BatteryDisableStatusNotify(Context->DevExt);
+        }
+
+        printf("%-10s %10lu %10llu %9llu %10.1f\n",
+            (Notify == 0) ? "polling" : "notify",
+            (unsigned long)Queries,
+            (unsigned long long)(HostBatteryClassGetStatusNotifications() - First),
+            (unsigned long long)Sim->Stats.Transactions,
+            Sim->Stats.BusTimeNs / 1000000.0);
+    }
+
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT] = SavedCurrent;
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT_AVG] = SavedCurrentAvg;
+    Context->PollInterval = 0;
+    Context->SamplePeriod = 0;
+}
+
+static
+VOID
+BenchCheck(
+    _Inout_ PBENCH_CONTEXT Context,
+    _In_ PCSTR Name,
+    _In_ BOOLEAN Condition,
+    _In_ PCSTR What
+    )
+{
+    if (!Condition) {
+        printf("    %s: %s\n", Name, What);
+        Context->Failures += 1;
+    }
+}
+
+//
+// Charger status the checks set themselves; the interface context points
+// to it
+//
+
+static
+VOID
+BenchCopyChargerStatus(
+    _In_ PVOID Context,
+    _Out_ PSM5714_CHARGER_STATUS Status
+    )
+{
+    *Status = *(const SM5714_CHARGER_STATUS*)Context;
+}
+
+static
+VOID
+BenchConnectChargerStatus(
+    _Inout_ PBENCH_CONTEXT Context,
+    _In_ PSM5714_CHARGER_STATUS ChargerStatus
+    )
+{
+    SM5714_PMIC_CHARGER_INTERFACE Charger;
+
+    RtlZeroMemory(&Charger, sizeof(Charger));
+    Charger.InterfaceHeader.Size = sizeof(Charger);
+    Charger.InterfaceHeader.Version = SM5714_PMIC_CHARGER_INTERFACE_VERSION;
+    Charger.InterfaceHeader.Context = ChargerStatus;
+    Charger.GetChargerStatus = BenchCopyChargerStatus;
+    SM5714TelemetryConnectCharger(Context->DevExt, &Charger);
+}
+
+//
+// Takes the next sample with the gauge reading Current_mA and hands it on
+// as the sampler work item does. Returns TRUE when the class was notified.
+//
+
+static
+BOOLEAN
+BenchNotifyStep(
+    _Inout_ PBENCH_CONTEXT Context,
+    _In_ LONG Current_mA,
+    _Inout_ PSM5714_TELEMETRY_SAMPLE Sample
+    )
+{
+    ULONGLONG Notifications = HostBatteryClassGetStatusNotifications();
+
+    Context->Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT] = BenchEncodeCurrent(Current_mA);
+    HostAdvanceInterruptTime(MILLISECONDS(SM5714TelemetrySamplePeriodMs(Context->DevExt)));
+    if (!NT_SUCCESS(SM5714TelemetrySample(Context->DevExt, Sample))) {
+        return FALSE;
+    }
+
+    SM5714TelemetryNotifyStatus(Context->DevExt, FALSE);
+    return (HostBatteryClassGetStatusNotifications() != Notifications) ? TRUE : FALSE;
+}
+
+static
+VOID
+BenchArmStatusNotify(
+    _Inout_ PBENCH_CONTEXT Context,
+    _In_ ULONG PowerState,
+    _In_ ULONG LowCapacity,
+    _In_ ULONG HighCapacity
+    )
+{
+    BATTERY_NOTIFY BatteryNotify;
+
+    BatteryNotify.PowerState = PowerState;
+    BatteryNotify.LowCapacity = LowCapacity;
+    BatteryNotify.HighCapacity = HighCapacity;
+    SM5714BatterySetStatusNotify(Context->DevExt, Context->Tag, &BatteryNotify);
+}
+
+//
+// Drives the capacity with Current_mA until the class is notified and
+// checks the first sample beyond Threshold did it: below Threshold when
+// discharging, above it when charging
+//
+
+static
+VOID
+BenchCheckCrossing(
+    _Inout_ PBENCH_CONTEXT Context,
+    _In_ PCSTR Name,
+    _In_ LONG Current_mA,
+    _In_ ULONG Threshold,
+    _Inout_ PSM5714_TELEMETRY_SAMPLE Sample
+    )
+{
+    BOOLEAN WasBeyond;
+    BOOLEAN Beyond;
+    BOOLEAN Notified;
+    ULONG Step;
+
+    for (Step = 0; Step < BENCH_CHECK_MAX_STEPS; Step++) {
+        WasBeyond = (Current_mA < 0) ? (Sample->Energy < Threshold) : (Sample->Energy > Threshold);
+        Notified = BenchNotifyStep(Context, Current_mA, Sample);
+        Beyond = (Current_mA < 0) ? (Sample->Energy < Threshold) : (Sample->Energy > Threshold);
+
+        if (Notified) {
+            BenchCheck(Context, Name, Beyond && !WasBeyond, "notified off the threshold");
+            return;
+        }
+
+        if (Beyond) {
+            BenchCheck(Context, Name, FALSE, "threshold crossed without a notification");
+            return;
+        }
+    }
+
+    BenchCheck(Context, Name, FALSE, "threshold never reached");
+}
+
+//
+// Drives the capacity with Current_mA until it reaches Target, checking
+// the class is not notified on the way
+//
+
+static
+VOID
+BenchCheckQuiet(
+    _Inout_ PBENCH_CONTEXT Context,
+    _In_ PCSTR Name,
+    _In_ LONG Current_mA,
+    _In_ ULONG Target,
+    _Inout_ PSM5714_TELEMETRY_SAMPLE Sample
+    )
+{
+    ULONG Step;
+
+    for (Step = 0; Step < BENCH_CHECK_MAX_STEPS; Step++) {
+        if ((Current_mA < 0) ? (Sample->Energy <= Target) : (Sample->Energy >= Target)) {
+            return;
+        }
+
+        if (BenchNotifyStep(Context, Current_mA, Sample)) {
+            BenchCheck(Context, Name, FALSE, "notified inside the hysteresis");
+            return;
+        }
+    }
+
+    BenchCheck(Context, Name, FALSE, "target never reached");
+}
+
+//
+// Status notification thresholds, on a charger that neither charges nor
+// is done so the power state stays on line whichever way the current
+// flows. A threshold notifies with the first sample beyond it; re-armed
+// at the same threshold it stays quiet until the capacity came back by
+// the hysteresis, and notifies again once it has.
+//
+
+static
+VOID
+BenchCheckStatusNotify(
+    _Inout_ PBENCH_CONTEXT Context,
+    _Inout_ PSM5714_SIM Sim
+    )
+{
+    USHORT SavedCurrent = Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT];
+    SM5714_CHARGER_STATUS ChargerStatus;
+    SM5714_TELEMETRY_SAMPLE Sample;
+    ULONG Hysteresis;
+    ULONG Threshold;
+
+    RtlZeroMemory(&ChargerStatus, sizeof(ChargerStatus));
+    ChargerStatus.Version = 1;
+    ChargerStatus.Valid = TRUE;
+    ChargerStatus.VbusPresent = TRUE;
+    BenchConnectChargerStatus(Context, &ChargerStatus);
+
+    SM5714TelemetryReset(Context->DevExt);
+    RtlZeroMemory(&Sample, sizeof(Sample));
+    BenchNotifyStep(Context, -BENCH_LOAD_MA, &Sample);
+
+    Hysteresis = (ULONG)((ULONGLONG)Context->DevExt->FullChargedCapacity_mWh * SM5714_STATUS_NOTIFY_HYSTERESIS_PERMILLE / 1000);
+    Threshold = Sample.Energy;
+
+    BenchArmStatusNotify(Context, Sample.PowerState, Threshold, Threshold + 2 * Hysteresis);
+    BenchCheckCrossing(Context, "low capacity", -BENCH_LOAD_MA, Threshold, &Sample);
+
+    BenchArmStatusNotify(Context, Sample.PowerState, Threshold, Threshold + 2 * Hysteresis);
+    BenchCheckQuiet(Context, "low capacity re-armed", -BENCH_LOAD_MA, Threshold - 3, &Sample);
+    BenchCheckQuiet(Context, "low capacity re-armed", BENCH_LOAD_MA, Threshold + Hysteresis - 1, &Sample);
+    BenchCheckQuiet(Context, "low capacity re-armed", -BENCH_LOAD_MA, Threshold - 3, &Sample);
+    BenchCheckQuiet(Context, "low capacity re-armed", BENCH_LOAD_MA, Threshold + Hysteresis, &Sample);
+    BenchCheckCrossing(Context, "low capacity past the hysteresis", -BENCH_LOAD_MA, Threshold, &Sample);
+
+    Threshold = Sample.Energy;
+    BenchArmStatusNotify(Context, Sample.PowerState, Threshold - 2 * Hysteresis, Threshold);
+    BenchCheckCrossing(Context, "high capacity", BENCH_LOAD_MA, Threshold, &Sample);
+
+    SM5714BatteryDisableStatusNotify(Context->DevExt);
+    SM5714TelemetryConnectCharger(Context->DevExt, NULL);
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT] = SavedCurrent;
+    SM5714TelemetryReset(Context->DevExt);
+}
+
+//
+// Power state debounce: a new direction is reported with the
+// SM5714_POWER_STATE_DEBOUNCE-th consecutive sample pointing to it, and a
+// shorter run leaves the state alone. Driven once by the charger status,
+// whose Charging flag sets each sample's direction while VBUS stays, and
+// once by the averaged current alone, as without the PMIC.
+//
+
+static
+VOID
+BenchCheckPowerState(
+    _Inout_ PBENCH_CONTEXT Context,
+    _Inout_ PSM5714_SIM Sim
+    )
+{
+    USHORT SavedCurrent = Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT];
+    USHORT SavedCurrentAvg = Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT_AVG];
+    SM5714_CHARGER_STATUS ChargerStatus;
+    SM5714_TELEMETRY_SAMPLE Sample;
+    BOOLEAN Charging;
+    ULONG Agree;
+    ULONG Step;
+
+    RtlZeroMemory(&ChargerStatus, sizeof(ChargerStatus));
+    ChargerStatus.Version = 1;
+    ChargerStatus.Valid = TRUE;
+    ChargerStatus.VbusPresent = TRUE;
+    BenchConnectChargerStatus(Context, &ChargerStatus);
+
+    SM5714TelemetryReset(Context->DevExt);
+    RtlZeroMemory(&Sample, sizeof(Sample));
+    BenchNotifyStep(Context, 0, &Sample);
+
+    ChargerStatus.Charging = TRUE;
+    for (Step = 1; Step < SM5714_POWER_STATE_DEBOUNCE; Step++) {
+        BenchNotifyStep(Context, 0, &Sample);
+        BenchCheck(Context, "charger debounce", (Sample.PowerState & BATTERY_CHARGING) == 0, "charging reported early");
+    }
+
+    ChargerStatus.Charging = FALSE;
+    BenchNotifyStep(Context, 0, &Sample);
+    BenchCheck(Context, "charger debounce", (Sample.PowerState & BATTERY_CHARGING) == 0, "a short run changed the state");
+
+    ChargerStatus.Charging = TRUE;
+    for (Step = 1; Step <= SM5714_POWER_STATE_DEBOUNCE; Step++) {
+        BenchNotifyStep(Context, 0, &Sample);
+        Charging = ((Sample.PowerState & BATTERY_CHARGING) != 0) ? TRUE : FALSE;
+        if (Step < SM5714_POWER_STATE_DEBOUNCE) {
+            BenchCheck(Context, "charger debounce", !Charging, "charging reported early");
+        } else {
+            BenchCheck(Context, "charger debounce", Charging, "charging not reported");
+        }
+    }
+
+    SM5714TelemetryConnectCharger(Context->DevExt, NULL);
+
+    //
+    // Without a charger the direction follows the average, which takes a
+    // few samples to climb from the discharge to the charge threshold
+    //
+
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT_AVG] = BenchEncodeCurrent(-BENCH_LOAD_MA);
+    SM5714TelemetryReset(Context->DevExt);
+    BenchNotifyStep(Context, -BENCH_LOAD_MA, &Sample);
+    BenchCheck(Context, "current debounce", (Sample.PowerState & BATTERY_DISCHARGING) != 0, "discharge not reported");
+
+    Agree = 0;
+    for (Step = 0; Step < BENCH_CHECK_MAX_STEPS; Step++) {
+        BenchNotifyStep(Context, BENCH_LOAD_MA, &Sample);
+        Agree = (Context->DevExt->PowerState.AverageCurrent >= SM5714_POWER_CHARGING_CURRENT_MA) ? Agree + 1 : 0;
+        Charging = ((Sample.PowerState & BATTERY_CHARGING) != 0) ? TRUE : FALSE;
+
+        if (Charging || Agree >= SM5714_POWER_STATE_DEBOUNCE) {
+            BenchCheck(Context, "current debounce", Agree >= SM5714_POWER_STATE_DEBOUNCE, "charging reported early");
+            BenchCheck(Context, "current debounce", Charging, "charging not reported");
+            break;
+        }
+    }
+
+    BenchCheck(Context, "current debounce", Step < BENCH_CHECK_MAX_STEPS, "charging never reported");
+
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT] = SavedCurrent;
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT_AVG] = SavedCurrentAvg;
+    SM5714TelemetryReset(Context->DevExt);
+}
+
+//
+// Charger status as the PMIC driver would publish it: on the charger, charge
+// terminated
+//
+
+static
+VOID
+BenchGetChargerStatus(
+    _In_ PVOID Context,
+    _Out_ PSM5714_CHARGER_STATUS Status
+    )
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    RtlZeroMemory(Status, sizeof(*Status));
+    Status->Version = 1;
+    Status->Valid = TRUE;
+    Status->VbusPresent = TRUE;
+    Status->Done = TRUE;
+}
+
+//
+// One virtual hour of idle samples every second with the current jittering
+// around zero; counts the changes of the reported power state and of the
+// single-sample Current >= 8 mA rule
+//
+
+static
+VOID
+BenchIdleHour(
+    _Inout_ PBENCH_CONTEXT Context,
+    _Inout_ PSM5714_SIM Sim,
+    _Out_ PULONG StateChanges,
+    _Out_ PULONG RuleChanges
+    )
+{
+    SM5714_TELEMETRY_SAMPLE Sample;
+    ULONG PreviousState = 0;
+    ULONG PreviousRule = 0;
+    ULONG Rule;
+    ULONGLONG Start;
+    ULONG State = 0x5714;
+    LONG Jitter;
+    BOOLEAN First = TRUE;
+
+    *StateChanges = 0;
+    *RuleChanges = 0;
+
+    SM5714TelemetryReset(Context->DevExt);
+    Sm5714SimResetStats(Sim);
+
+    Start = KeQueryInterruptTime();
+    while (KeQueryInterruptTime() - Start < BENCH_HOUR) {
+        State = State * 1664525u + 1013904223u;
+        Jitter = (LONG)((State >> 16) % (2 * BENCH_IDLE_JITTER_MA + 1)) - BENCH_IDLE_JITTER_MA;
+        Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT] = BenchEncodeCurrent(Jitter);
+
+        HostAdvanceInterruptTime(MILLISECONDS(SM5714TelemetrySamplePeriodMs(Context->DevExt)));
+        if (!NT_SUCCESS(SM5714TelemetrySample(Context->DevExt, &Sample))) {
+            continue;
+        }
+
+        Rule = (Sample.Current >= 8) ? BATTERY_POWER_ON_LINE : BATTERY_DISCHARGING;
+
+        if (!First) {
+            *StateChanges += (Sample.PowerState != PreviousState) ? 1 : 0;
+            *RuleChanges += (Rule != PreviousRule) ? 1 : 0;
+        }
+
+        PreviousState = Sample.PowerState;
+        PreviousRule = Rule;
+        First = FALSE;
+    }
+}
+
+//
+// Power state changes per hour at idle, as reported by QueryStatus every
+// second, against the single-sample Current >= 8 mA rule it replaced, and
+// with the PMIC's charger interface connected, which spares the gauge's
+// STATE word
+//
+
+static
+VOID
+BenchPowerState(
+    _Inout_ PBENCH_CONTEXT Context,
+    _Inout_ PSM5714_SIM Sim
+    )
+{
+    USHORT SavedCurrent = Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT];
+    USHORT SavedCurrentAvg = Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT_AVG];
+    SM5714_PMIC_CHARGER_INTERFACE Charger;
+    ULONG StateChanges;
+    ULONG RuleChanges;
+
+    SM5714TelemetrySetSamplingMode(Context->DevExt, Sm5714SamplingNormal);
+
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT_AVG] = BenchEncodeCurrent(2);
+
+    printf("\n%-22s %10s %9s %10s\n", "idle power state", "changes/h", "xfers/h", "bus ms/h");
+
+    BenchIdleHour(Context, Sim, &StateChanges, &RuleChanges);
+    printf("%-22s %10lu\n", "current >= 8 mA", (unsigned long)RuleChanges);
+    printf("%-22s %10lu %9llu %10.1f\n",
+        "debounced",
+        (unsigned long)StateChanges,
+        (unsigned long long)Sim->Stats.Transactions,
+        Sim->Stats.BusTimeNs / 1000000.0);
+
+    RtlZeroMemory(&Charger, sizeof(Charger));
+    Charger.InterfaceHeader.Size = sizeof(Charger);
+    Charger.InterfaceHeader.Version = SM5714_PMIC_CHARGER_INTERFACE_VERSION;
+    Charger.GetChargerStatus = BenchGetChargerStatus;
+    SM5714TelemetryConnectCharger(Context->DevExt, &Charger);
+
+    BenchIdleHour(Context, Sim, &StateChanges, &RuleChanges);
+    printf("%-22s %10lu %9llu %10.1f\n",
+        "PMIC charger status",
+        (unsigned long)StateChanges,
+        (unsigned long long)Sim->Stats.Transactions,
+        Sim->Stats.BusTimeNs / 1000000.0);
+
+    SM5714TelemetryConnectCharger(Context->DevExt, NULL);
+
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT] = SavedCurrent;
+    Sim->Sram[SM5714_FG_ADDR_SRAM_CURRENT_AVG] = SavedCurrentAvg;
+    SM5714TelemetryReset(Context->DevExt);
+}
+
+//
+// Contention: reader threads call QueryTag and QueryStatus while a charger
+// thread keeps reporting attach and detach, each of which samples the
+// gauge, on a bus whose every transfer stalls for real. Readers must not
+// wait for that bus.
+//
+
+#define BENCH_CONTENTION_READERS    8
+#define BENCH_CONTENTION_STALL_US   2000
+#define BENCH_CONTENTION_PAUSE_US   100     // Between a reader's calls
+#define BENCH_CONTENTION_SLOW_US    500     // A call this slow waited
+#define BENCH_CONTENTION_RUN_MS     250
+
+typedef struct _BENCH_STALL_BUS {
+    pthread_mutex_t             Lock;       // One transfer at a time, as on the controller
+    PSM5714_SIM                 Sim;
+} BENCH_STALL_BUS, *PBENCH_STALL_BUS;
+
+typedef struct _BENCH_READER {
+    pthread_t                   Thread;
+    PSM5714_BATTERY_FDO_DATA    DevExt;
+    ULONG                       Tag;
+    BOOLEAN                     QueryStatus;
+    volatile BOOLEAN*           Stop;
+    ULONGLONG                   Calls;
+    ULONGLONG                   SlowCalls;
+    ULONGLONG                   TotalNs;
+    ULONGLONG                   MaxNs;
+} BENCH_READER, *PBENCH_READER;
+
+static
+VOID
+BenchSleepUs(
+    _In_ ULONG Microseconds
+    )
+{
+    struct timespec ts = { 0, (long)Microseconds * 1000L };
+
+    nanosleep(&ts, NULL);
+}
+
+static
+NTSTATUS
+BenchStallWriteRead(
+    _In_                        PVOID   BusContext,
+    _In_reads_(SendLength)      PVOID   SendData,
+    _In_                        USHORT  SendLength,
+    _In_reads_(CmdLength)       PVOID   ReadCmd,
+    _In_                        USHORT  CmdLength,
+    _Out_writes_(DataLength)    PVOID   Data,
+    _In_                        USHORT  DataLength,
+    _In_                        ULONG   DelayUs
+    )
+{
+    PBENCH_STALL_BUS Bus = (PBENCH_STALL_BUS)BusContext;
+    NTSTATUS Status;
+
+    pthread_mutex_lock(&Bus->Lock);
+    BenchSleepUs(BENCH_CONTENTION_STALL_US);
+    Status = HostSimBusOps.WriteRead(Bus->Sim, SendData, SendLength, ReadCmd, CmdLength, Data, DataLength, DelayUs);
+    pthread_mutex_unlock(&Bus->Lock);
+
+    return Status;
+}
+
+static
+NTSTATUS
+BenchStallSequence(
+    _In_                            PVOID                       BusContext,
+    _In_reads_(TransferCount)       const SM5714_BUS_TRANSFER*  Transfers,
+    _In_                            ULONG                       TransferCount
+    )
+{
+    PBENCH_STALL_BUS Bus = (PBENCH_STALL_BUS)BusContext;
+    NTSTATUS Status;
+
+    pthread_mutex_lock(&Bus->Lock);
+    BenchSleepUs(BENCH_CONTENTION_STALL_US);
+    Status = HostSimBusOps.Sequence(Bus->Sim, Transfers, TransferCount);
+    pthread_mutex_unlock(&Bus->Lock);
+
+    return Status;
+}
+
+static const SM5714_BUS_OPS BenchStallBusOps = {
+    BenchStallWriteRead,
+    BenchStallSequence,
+};
+
+static
+void*
+BenchReaderThread(
+    void* Argument
+    )
+{
+    PBENCH_READER Reader = (PBENCH_READER)Argument;
+    BATTERY_STATUS BatteryStatus;
+    ULONGLONG Start;
+    ULONGLONG Elapsed;
+    ULONG Tag;
+
+    while (!__atomic_load_n(Reader->Stop, __ATOMIC_RELAXED)) {
+        Start = BenchNowNs();
+        if (Reader->QueryStatus) {
+            SM5714BatteryQueryStatus(Reader->DevExt, Reader->Tag, &BatteryStatus);
+        } else {
+            SM5714BatteryQueryTag(Reader->DevExt, &Tag);
+        }
+        Elapsed = BenchNowNs() - Start;
+
+        Reader->Calls += 1;
+        Reader->SlowCalls += (Elapsed >= BENCH_CONTENTION_SLOW_US * 1000ULL) ? 1 : 0;
+        Reader->TotalNs += Elapsed;
+        if (Elapsed > Reader->MaxNs) {
+            Reader->MaxNs = Elapsed;
+        }
+
+        BenchSleepUs(BENCH_CONTENTION_PAUSE_US);
+    }
+
+    return NULL;
+}
+
+static
+VOID
+BenchContention(
+    VOID
+    )
+{
+    static SM5714_SIM Sim;
+    static BENCH_STALL_BUS Bus;
+    static BENCH_READER Readers[BENCH_CONTENTION_READERS];
+    volatile BOOLEAN Stop = FALSE;
+    BATTERY_CHARGING_SOURCE ChargingSource;
+    PSM5714_BATTERY_FDO_DATA DevExt;
+    WDFDEVICE Device;
+    ULONGLONG Start;
+    ULONG Changes = 0;
+    ULONG Tag;
+    ULONG Kind;
+    ULONG i;
+
+    Sm5714SimInitialize(&Sim);
+    pthread_mutex_init(&Bus.Lock, NULL);
+    Bus.Sim = &Sim;
+
+    if (!NT_SUCCESS(HostBatteryCreate(&BenchStallBusOps, &Bus, &Device))) {
+        return;
+    }
+
+    DevExt = GetDeviceExtension(Device);
+    SM5714BatteryQueryTag(DevExt, &Tag);
+    SM5714TelemetrySample(DevExt, NULL);
+
+    for (i = 0; i < BENCH_CONTENTION_READERS; i++) {
+        Readers[i].DevExt = DevExt;
+        Readers[i].Tag = Tag;
+        Readers[i].QueryStatus = (i & 1) != 0;
+        Readers[i].Stop = &Stop;
+        pthread_create(&Readers[i].Thread, NULL, BenchReaderThread, &Readers[i]);
+    }
+
+    ChargingSource.Type = BatteryChargingSourceType_USB;
+    Start = BenchNowNs();
+    while (BenchNowNs() - Start < BENCH_CONTENTION_RUN_MS * 1000000ULL) {
+        ChargingSource.MaxCurrent = (Changes & 1) ? 0 : 500;
+        SM5714BatterySetInformation(DevExt, Tag, BatteryChargingSource, &ChargingSource);
+        Changes += 1;
+    }
+
+    __atomic_store_n(&Stop, TRUE, __ATOMIC_RELAXED);
+    for (i = 0; i < BENCH_CONTENTION_READERS; i++) {
+        pthread_join(Readers[i].Thread, NULL);
+    }
+
+    printf("\n%-22s %8s %8s %8s %10s   (%u readers, %u charger changes, %u us bus stall)\n",
+        "contention", "calls", "slow", "mean us", "max us",
+        BENCH_CONTENTION_READERS, (unsigned)Changes, BENCH_CONTENTION_STALL_US);
+
+    for (Kind = 0; Kind < 2; Kind++) {
+        ULONGLONG Calls = 0;
+        ULONGLONG SlowCalls = 0;
+        ULONGLONG TotalNs = 0;
+        ULONGLONG MaxNs = 0;
+
+        for (i = 0; i < BENCH_CONTENTION_READERS; i++) {
+            if (Readers[i].QueryStatus != (Kind != 0)) {
+                continue;
+            }
+
+            Calls += Readers[i].Calls;
+            SlowCalls += Readers[i].SlowCalls;
+            TotalNs += Readers[i].TotalNs;
+            MaxNs = (Readers[i].MaxNs > MaxNs) ? Readers[i].MaxNs : MaxNs;
+        }
+
+        printf("%-22s %8llu %8llu %8.2f %10.1f\n",
+            (Kind == 0) ? "QueryTag" : "QueryStatus",
+            (unsigned long long)Calls,
+            (unsigned long long)SlowCalls,
+            (Calls != 0) ? TotalNs / 1000.0 / Calls : 0.0,
+            MaxNs / 1000.0);
+    }
+
+    HostBatteryDestroy(Device);
+    pthread_mutex_destroy(&Bus.Lock);
+}
+
+int
+main(
+    int argc,
+    char** argv
+    )
+{
+    static const struct {
+        PCSTR Name;
+        BATTERY_QUERY_INFORMATION_LEVEL Level;
+    } Levels[] = {
+        { "QueryInformation(Information)", BatteryInformation },
+        { "QueryInformation(Granularity)", BatteryGranularityInformation },
+        { "QueryInformation(Temperature)", BatteryTemperature },
+        { "QueryInformation(EstimatedTime)", BatteryEstimatedTime },
+        { "QueryInformation(DeviceName)", BatteryDeviceName },
+        { "QueryInformation(ManufactureDate)", BatteryManufactureDate },
+        { "QueryInformation(ManufactureName)", BatteryManufactureName },
+        { "QueryInformation(UniqueID)", BatteryUniqueID },
+        { "QueryInformation(SerialNumber)", BatterySerialNumber },
+    };
+
+    SM5714_SIM Sim;
+    BENCH_CONTEXT Context;
+    LARGE_INTEGER ConnectionId;
+    WDFDEVICE Device;
+    static BENCH_RESULTS Baseline;
+    PCSTR OutputPath = NULL;
+    PCSTR BaselinePath = NULL;
+    ULONG Iterations = BENCH_DEFAULT_ITERATIONS;
+    ULONG Regressions;
+    int Arg;
+    ULONG i;
+    NTSTATUS Status;
+
+    for (Arg = 1; Arg < argc; Arg++) {
+        if (strcmp(argv[Arg], "-o") == 0 && Arg + 1 < argc) {
+            OutputPath = argv[++Arg];
+        } else if (strcmp(argv[Arg], "-b") == 0 && Arg + 1 < argc) {
+            BaselinePath = argv[++Arg];
+        } else {
+            Iterations = (ULONG)strtoul(argv[Arg], NULL, 0);
+            if (Iterations == 0) {
+                fprintf(stderr, "usage: %s [-o results.csv] [-b baseline.csv] [iterations]\n", argv[0]);
+                return 2;
+            }
+        }
+    }
+
+    if (BaselinePath != NULL && !BenchReadResults(BaselinePath, &Baseline)) {
+        return 2;
+    }
+
+    Sm5714SimInitialize(&Sim);
+
+    ConnectionId.QuadPart = HOST_SIM_SPB_CONNECTION_ID;
+
+    Status = HostSimSpbRegister(&Sim, ConnectionId);
+    if (!NT_SUCCESS(Status)) {
+        fprintf(stderr, "HostSimSpbRegister failed 0x%08X\n", (unsigned)Status);
+        return 1;
+    }
+
+    Status = HostBatteryCreateOnSpb(ConnectionId, &Device);
+    if (!NT_SUCCESS(Status)) {
+        fprintf(stderr, "HostBatteryCreateOnSpb failed 0x%08X\n", (unsigned)Status);
+        return 1;
+    }
+
+    RtlZeroMemory(&Context, sizeof(Context));
+    Context.DevExt = GetDeviceExtension(Device);
+    Context.Sim = &Sim;
+    SM5714BatteryQueryTag(Context.DevExt, &Context.Tag);
+
+    printf("%-36s %10s %8s %10s %8s\n", "callback", "cpu ns", "xfers", "bus us", "objects");
+
+    BenchRun("QueryTag", BenchQueryTag, &Context, &Sim, Iterations);
+
+    //
+    // QueryStatus with the cache disabled, as seen by pollers spaced 250 ms
+    // apart against the default cache age, and the same with the background
+    // sampler running at its default period
+    //
+
+    Context.DevExt->StatusCacheMaxAge = 0;
+    BenchRun("QueryStatus(uncached)", BenchQueryStatus, &Context, &Sim, Iterations);
+    BenchPrintCache(&Context);
+
+    Context.DevExt->StatusCacheMaxAge = MILLISECONDS(SM5714_STATUS_CACHE_DEFAULT_MAX_AGE_MS);
+    Context.PollInterval = MILLISECONDS(250);
+    BenchRun("QueryStatus(250 ms poll)", BenchQueryStatus, &Context, &Sim, Iterations);
+    BenchPrintCache(&Context);
+
+    Context.SamplePeriod = MILLISECONDS(SM5714TelemetrySamplePeriodMs(Context.DevExt));
+    Context.NextSample = KeQueryInterruptTime();
+    BenchRun("QueryStatus(sampler, 250 ms poll)", BenchQueryStatus, &Context, &Sim, Iterations);
+    BenchPrintCache(&Context);
+
+    SM5714TelemetrySetSamplingMode(Context.DevExt, Sm5714SamplingLowPower);
+    Context.SamplePeriod = MILLISECONDS(SM5714TelemetrySamplePeriodMs(Context.DevExt));
+    Context.NextSample = KeQueryInterruptTime();
+    BenchRun("QueryStatus(low power, 250 ms poll)", BenchQueryStatus, &Context, &Sim, Iterations);
+    BenchPrintCache(&Context);
+    SM5714TelemetrySetSamplingMode(Context.DevExt, Sm5714SamplingNormal);
+
+    Context.PollInterval = 0;
+    Context.SamplePeriod = 0;
+
+    for (i = 0; i < ARRAYSIZE(Levels); i++) {
+        Context.Level = Levels[i].Level;
+        BenchRun(Levels[i].Name, BenchQueryInformation, &Context, &Sim, Iterations);
+    }
+
+    BenchRun("SpbReadDataSynchronously", BenchSpbReadData, &Context, &Sim, Iterations);
+
+    Status = SM5714AlertEnable(Context.DevExt);
+    if (NT_SUCCESS(Status)) {
+        ULONGLONG Notifications = HostBatteryClassGetStatusNotifications();
+
+        BenchRun("Alert", BenchAlert, &Context, &Sim, Iterations);
+        printf("    %llu alerts, %llu status notifications\n",
+            (unsigned long long)Context.DevExt->AlertCount,
+            (unsigned long long)(HostBatteryClassGetStatusNotifications() - Notifications));
+    }
+
+    BenchPrintSpbStatistics(&Context);
+
+    BenchSamplingModes(&Context, &Sim);
+    BenchStatusNotify(&Context, &Sim);
+    BenchCheckStatusNotify(&Context, &Sim);
+    BenchPowerState(&Context, &Sim);
+    BenchCheckPowerState(&Context, &Sim);
+    BenchContention();
+
+    HostBatteryDestroy(Device);
+
+    if (OutputPath != NULL && !BenchWriteResults(OutputPath, &Context.Results)) {
+        return 1;
+    }
+
+    if (Context.Failures != 0) {
+        printf("\n%lu check(s) failed\n", (unsigned long)Context.Failures);
+        return 4;
+    }
+
+    if (BaselinePath != NULL) {
+        Regressions = BenchCompareResults(&Baseline, &Context.Results);
+        if (Regressions != 0) {
+            printf("\n%lu row(s) regressed against %s\n", (unsigned long)Regressions, BaselinePath);
+            return 3;
+        }
+    }
+
+    return 0;
+}
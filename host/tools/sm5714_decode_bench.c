@@ -0,0 +1,251 @@
+/*++
+
+Module Name:
+
+    sm5714_decode_bench.c
+
+Abstract:
+
+    Checks and times the bulk trace decoder (sm5714_decode.h).
+
+    Every kernel the CPU supports is first checked bit for bit against the
+    per-word reference sm5714_Codec_Decode on all 65536 raw values of every
+    field, from misaligned buffers and with lengths that leave a scalar
+    tail. Any mismatch fails the run before anything is timed.
+
+    Each kernel then decodes a pseudo-random trace of the four telemetry
+    fields; the table reports decoded words per second and the speedup over
+    the per-word reference loop.
+
+    Usage: sm5714_decode_bench [words]
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#include "../inc/sm5714_decode.h"
+#include <time.h>
+
+#define DECODE_BENCH_DEFAULT_WORDS  (1u << 24)
+#define DECODE_BENCH_REPEATS        5
+#define DECODE_BENCH_ALL_WORDS      0x10000
+
+static const SM5714_FG_FIELD_ID DecodeBenchFields[] = {
+    Sm5714FgFieldSoc,
+    Sm5714FgFieldOcv,
+    Sm5714FgFieldCurrent,
+    Sm5714FgFieldTemperature,
+};
+
+static
+ULONGLONG
+DecodeBenchNowNs(
+    void
+    )
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ULONGLONG)ts.tv_sec * 1000000000ULL + (ULONGLONG)ts.tv_nsec;
+}
+
+static
+VOID
+DecodeBenchReference(
+    _In_ SM5714_FG_FIELD_ID FieldId,
+    _In_reads_(Count) const USHORT* Raw,
+    _In_ SIZE_T Count,
+    _Out_writes_(Count) LONG* Values
+    )
+{
+    SIZE_T i;
+
+    for (i = 0; i < Count; i++) {
+        Values[i] = sm5714_Codec_Decode(FieldId, Raw[i]);
+    }
+}
+
+//
+// Decodes every raw value with Kernel at each offset 0..3 into the buffers,
+// which breaks vector alignment, trimming the length so the vector loops
+// leave different tails, and compares with the reference. Returns the
+// number of mismatching words.
+//
+
+static
+ULONG
+DecodeBenchVerify(
+    _In_ SM5714_DECODE_KERNEL Kernel,
+    _In_ SM5714_FG_FIELD_ID FieldId,
+    _Inout_updates_(DECODE_BENCH_ALL_WORDS + 4) USHORT* Raw,
+    _Inout_updates_(DECODE_BENCH_ALL_WORDS + 4) LONG* Values
+    )
+{
+    ULONG Mismatches = 0;
+    ULONG Offset;
+    ULONG Length;
+    ULONG i;
+
+    for (Offset = 0; Offset < 4; Offset++) {
+        for (i = 0; i < DECODE_BENCH_ALL_WORDS; i++) {
+            Raw[Offset + i] = (USHORT)i;
+        }
+
+        Length = DECODE_BENCH_ALL_WORDS - Offset * 5;
+        RtlZeroMemory(Values, (DECODE_BENCH_ALL_WORDS + 4) * sizeof(LONG));
+        Sm5714DecodeTraceWithKernel(Kernel, FieldId, Raw + Offset, Length, Values + Offset);
+
+        for (i = 0; i < Length; i++) {
+            LONG Expected = sm5714_Codec_Decode(FieldId, Raw[Offset + i]);
+
+            if (Values[Offset + i] != Expected) {
+                if (Mismatches < 4) {
+                    fprintf(stderr, "%s field %u raw 0x%04X: got %d expected %d\n",
+                        Sm5714DecodeKernelName(Kernel),
+                        (unsigned)FieldId,
+                        (unsigned)Raw[Offset + i],
+                        (int)Values[Offset + i],
+                        (int)Expected);
+                }
+
+                Mismatches += 1;
+            }
+        }
+    }
+
+    return Mismatches;
+}
+
+//
+// Best of DECODE_BENCH_REPEATS passes over the four telemetry fields, in ns
+//
+
+static
+ULONGLONG
+DecodeBenchTime(
+    _In_ SM5714_DECODE_KERNEL Kernel,
+    _In_ BOOLEAN Reference,
+    _In_reads_(Count) const USHORT* Raw,
+    _In_ SIZE_T Count,
+    _Out_writes_(Count) LONG* Values
+    )
+{
+    ULONGLONG Best = ~0ULL;
+    ULONGLONG Start;
+    ULONGLONG Elapsed;
+    ULONG Repeat;
+    ULONG f;
+
+    for (Repeat = 0; Repeat < DECODE_BENCH_REPEATS; Repeat++) {
+        Start = DecodeBenchNowNs();
+        for (f = 0; f < ARRAYSIZE(DecodeBenchFields); f++) {
+            if (Reference) {
+                DecodeBenchReference(DecodeBenchFields[f], Raw, Count, Values);
+            } else {
+                Sm5714DecodeTraceWithKernel(Kernel, DecodeBenchFields[f], Raw, Count, Values);
+            }
+        }
+
+        Elapsed = DecodeBenchNowNs() - Start;
+        if (Elapsed < Best) {
+            Best = Elapsed;
+        }
+    }
+
+    return Best;
+}
+
+int
+main(
+    int argc,
+    char** argv
+    )
+{
+    static USHORT AllRaw[DECODE_BENCH_ALL_WORDS + 4];
+    static LONG AllValues[DECODE_BENCH_ALL_WORDS + 4];
+    SIZE_T Words = DECODE_BENCH_DEFAULT_WORDS;
+    SIZE_T TotalWords;
+    USHORT* Raw;
+    LONG* Values;
+    ULONGLONG ReferenceNs;
+    ULONGLONG KernelNs;
+    ULONG Mismatches = 0;
+    ULONG State = 0x5714;
+    ULONG Kernel;
+    ULONG f;
+    SIZE_T i;
+
+    if (argc > 1) {
+        Words = (SIZE_T)strtoull(argv[1], NULL, 0);
+        if (Words == 0) {
+            fprintf(stderr, "usage: %s [words]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    for (Kernel = 0; Kernel < Sm5714DecodeKernelCount; Kernel++) {
+        ULONG KernelMismatches = 0;
+
+        if (!Sm5714DecodeKernelSupported((SM5714_DECODE_KERNEL)Kernel)) {
+            printf("%-8s not supported on this CPU\n", Sm5714DecodeKernelName((SM5714_DECODE_KERNEL)Kernel));
+            continue;
+        }
+
+        for (f = 0; f < Sm5714FgFieldCount; f++) {
+            KernelMismatches += DecodeBenchVerify((SM5714_DECODE_KERNEL)Kernel, (SM5714_FG_FIELD_ID)f, AllRaw, AllValues);
+        }
+
+        printf("%-8s %s\n",
+            Sm5714DecodeKernelName((SM5714_DECODE_KERNEL)Kernel),
+            (KernelMismatches == 0) ? "bit-exact on all raw values" : "MISMATCH");
+
+        Mismatches += KernelMismatches;
+    }
+
+    if (Mismatches != 0) {
+        fprintf(stderr, "%lu mismatching words\n", (unsigned long)Mismatches);
+        return 1;
+    }
+
+    Raw = malloc(Words * sizeof(*Raw));
+    Values = malloc(Words * sizeof(*Values));
+    if (Raw == NULL || Values == NULL) {
+        fprintf(stderr, "cannot allocate %zu words\n", Words);
+        return 1;
+    }
+
+    for (i = 0; i < Words; i++) {
+        State = State * 1664525u + 1013904223u;
+        Raw[i] = (USHORT)(State >> 16);
+    }
+
+    TotalWords = Words * ARRAYSIZE(DecodeBenchFields);
+
+    printf("\n%zu words x %u fields, best of %u\n",
+        Words,
+        (unsigned)ARRAYSIZE(DecodeBenchFields),
+        (unsigned)DECODE_BENCH_REPEATS);
+
+    printf("%-10s %12s %10s\n", "kernel", "Mwords/s", "speedup");
+
+    ReferenceNs = DecodeBenchTime(Sm5714DecodeKernelScalar, TRUE, Raw, Words, Values);
+    printf("%-10s %12.1f %9.2fx\n", "reference", TotalWords * 1000.0 / ReferenceNs, 1.0);
+
+    for (Kernel = 0; Kernel < Sm5714DecodeKernelCount; Kernel++) {
+        if (!Sm5714DecodeKernelSupported((SM5714_DECODE_KERNEL)Kernel)) {
+            continue;
+        }
+
+        KernelNs = DecodeBenchTime((SM5714_DECODE_KERNEL)Kernel, FALSE, Raw, Words, Values);
+        printf("%-10s %12.1f %9.2fx\n",
+            Sm5714DecodeKernelName((SM5714_DECODE_KERNEL)Kernel),
+            TotalWords * 1000.0 / KernelNs,
+            (double)ReferenceNs / KernelNs);
+    }
+
+    free(Raw);
+    free(Values);
+    return 0;
+}
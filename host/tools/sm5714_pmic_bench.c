@@ -0,0 +1,617 @@
+/*++
+
+Module Name:
+
+    sm5714_pmic_bench.c
+
+Abstract:
+
+    Counts the bus cost of reading the PMIC's contiguous register banks
+    register by register with read_reg against one burst with the bank
+    reads of spbhelper.c, over the driver's own spb.c and the PMIC
+    simulator.
+
+    read_reg moves two registers per transaction, so the five INT
+    registers took three reads (INT1/2, INT3/4, INT5) and the status
+    registers one read each. The last rows add up what the charger and
+    USBPD interrupts read per event.
+
+    Every row also checks that both ways return the same bytes and that
+    reading an INT bank cleared it.
+
+    The second table runs the charger's register updates once without and
+    once with the register cache of spbhelper.c, from the same register
+    state. update_reg read every register before writing it; with the
+    cache a masked update of a control register is one write, or none
+    when the value does not change. The last row is D0 entry after the
+    PMIC lost its registers: reg_cache_sync writes back what the driver
+    set before charger_probe runs. Both passes must leave the charger
+    control registers the same. The resume row starts from settings
+    firmware made and reset values that differ from them, and both passes
+    must leave the whole charger register file the same.
+
+    Exits with 3 when a check fails, a bank read is not cheaper than the
+    reads it replaces or the cache does not save what it should.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#include "../inc/sm5714_pmic_host.h"
+
+#define BENCH_CHARGER   0
+#define BENCH_USBPD     1
+
+#define BENCH_BANK_SIZE 5
+
+typedef struct _BENCH_COST {
+    ULONGLONG   Transactions;
+    ULONGLONG   Bytes;
+    ULONGLONG   BusTimeNs;
+} BENCH_COST, *PBENCH_COST;
+
+typedef struct _BENCH_CONTEXT {
+    PDEVICE_CONTEXT     pDevice;
+    PSM5714_PMIC_SIM    Sims[2];
+    ULONG               Failures;
+} BENCH_CONTEXT, *PBENCH_CONTEXT;
+
+static
+VOID
+BenchResetStats(
+    _Inout_ PBENCH_CONTEXT Context
+    )
+{
+    RtlZeroMemory(&Context->Sims[BENCH_CHARGER]->Stats, sizeof(SM5714_SIM_STATS));
+    RtlZeroMemory(&Context->Sims[BENCH_USBPD]->Stats, sizeof(SM5714_SIM_STATS));
+}
+
+static
+VOID
+BenchAddStats(
+    _In_ PBENCH_CONTEXT Context,
+    _Inout_ PBENCH_COST Cost
+    )
+{
+    ULONG i;
+
+    for (i = 0; i < ARRAYSIZE(Context->Sims); i++) {
+        Cost->Transactions += Context->Sims[i]->Stats.Transactions;
+        Cost->Bytes += Context->Sims[i]->Stats.BytesWritten + Context->Sims[i]->Stats.BytesRead;
+        Cost->BusTimeNs += Context->Sims[i]->Stats.BusTimeNs;
+    }
+}
+
+//
+// Loads a recognizable pattern into a bank, so a misplaced byte shows
+//
+
+static
+VOID
+BenchFillBank(
+    _Inout_ PBENCH_CONTEXT Context,
+    _In_ ULONG SpbIndex,
+    _In_ UCHAR Reg
+    )
+{
+    ULONG i;
+
+    for (i = 0; i < BENCH_BANK_SIZE; i++) {
+        Context->Sims[SpbIndex]->Registers[Reg + i] = (UCHAR)(0xA0 + Reg + i);
+    }
+}
+
+//
+// The register by register way: read_reg every Step registers up to
+// Count, keeping both bytes when Step is 2
+//
+
+static
+NTSTATUS
+BenchReadEach(
+    _In_ PBENCH_CONTEXT Context,
+    _In_ ULONG SpbIndex,
+    _In_ UCHAR Reg,
+    _In_ ULONG Count,
+    _In_ ULONG Step,
+    _Out_writes_(Count) PUCHAR Data
+    )
+{
+    unsigned short pair;
+    NTSTATUS Status = STATUS_SUCCESS;
+    ULONG i;
+
+    for (i = 0; i < Count && NT_SUCCESS(Status); i += Step) {
+        Status = read_reg(Context->pDevice, SpbIndex, (unsigned char)(Reg + i), &pair);
+        Data[i] = (UCHAR)(pair & 0xFF);
+        if (Step == 2 && i + 1 < Count) {
+            Data[i + 1] = (UCHAR)(pair >> 8);
+        }
+    }
+
+    return Status;
+}
+
+static
+NTSTATUS
+BenchReadBank(
+    _In_ PBENCH_CONTEXT Context,
+    _In_ ULONG SpbIndex,
+    _In_ UCHAR Reg,
+    _In_ BOOLEAN Int,
+    _Out_writes_(BENCH_BANK_SIZE) PUCHAR Data
+    )
+{
+    if (Int) {
+        return read_int_bank(Context->pDevice, SpbIndex, Reg, (SM5714_INT_BANK*)Data);
+    }
+
+    return read_status_bank(Context->pDevice, SpbIndex, Reg, (SM5714_STATUS_BANK*)Data);
+}
+
+static
+VOID
+BenchCheck(
+    _Inout_ PBENCH_CONTEXT Context,
+    _In_ PCSTR Name,
+    _In_ BOOLEAN Condition,
+    _In_ PCSTR What
+    )
+{
+    if (!Condition) {
+        printf("    %s: %s\n", Name, What);
+        Context->Failures += 1;
+    }
+}
+
+static
+VOID
+BenchPrintRow(
+    _Inout_ PBENCH_CONTEXT Context,
+    _In_ PCSTR Name,
+    _In_ const BENCH_COST* Each,
+    _In_ const BENCH_COST* Bank,
+    _In_ BOOLEAN Cheaper
+    )
+{
+    printf("%-34s %5llu %5llu %8.2f   %5llu %5llu %8.2f   %5.1f %%\n",
+        Name,
+        (unsigned long long)Each->Transactions,
+        (unsigned long long)Each->Bytes,
+        Each->BusTimeNs / 1000.0,
+        (unsigned long long)Bank->Transactions,
+        (unsigned long long)Bank->Bytes,
+        Bank->BusTimeNs / 1000.0,
+        100.0 * (1.0 - (double)Bank->BusTimeNs / (double)Each->BusTimeNs));
+
+    if (Cheaper) {
+        BenchCheck(Context, Name,
+            Bank->Transactions < Each->Transactions && Bank->BusTimeNs < Each->BusTimeNs,
+            "not cheaper");
+    } else {
+        BenchCheck(Context, Name, Bank->Transactions <= Each->Transactions, "more transfers");
+    }
+}
+
+//
+// Reads a bank in one transfer and the first EachCount of its registers
+// with read_reg, checks both agree and adds what each cost to the totals.
+// Prints a row for the bank when Name is given.
+//
+
+static
+VOID
+BenchBank(
+    _Inout_ PBENCH_CONTEXT Context,
+    _In_opt_ PCSTR Name,
+    _In_ ULONG SpbIndex,
+    _In_ UCHAR Reg,
+    _In_ BOOLEAN Int,
+    _In_ ULONG EachCount,
+    _Inout_ PBENCH_COST EachTotal,
+    _Inout_ PBENCH_COST BankTotal
+    )
+{
+    UCHAR EachData[BENCH_BANK_SIZE];
+    UCHAR BankData[BENCH_BANK_SIZE];
+    BENCH_COST Each = { 0 };
+    BENCH_COST Bank = { 0 };
+    PCSTR Label = (Name != NULL) ? Name : "per event";
+    ULONG i;
+
+    BenchFillBank(Context, SpbIndex, Reg);
+    BenchResetStats(Context);
+    BenchCheck(Context, Label,
+        NT_SUCCESS(BenchReadEach(Context, SpbIndex, Reg, EachCount, Int ? 2 : 1, EachData)),
+        "read_reg failed");
+    BenchAddStats(Context, &Each);
+
+    BenchFillBank(Context, SpbIndex, Reg);
+    BenchResetStats(Context);
+    BenchCheck(Context, Label,
+        NT_SUCCESS(BenchReadBank(Context, SpbIndex, Reg, Int, BankData)),
+        "bank read failed");
+    BenchAddStats(Context, &Bank);
+
+    BenchCheck(Context, Label, memcmp(EachData, BankData, EachCount) == 0, "bank differs from read_reg");
+    BenchCheck(Context, Label, BankData[0] == (UCHAR)(0xA0 + Reg), "bank starts at the wrong register");
+
+    if (Int) {
+        for (i = 0; i < BENCH_BANK_SIZE; i++) {
+            BenchCheck(Context, Label, Context->Sims[SpbIndex]->Registers[Reg + i] == 0, "INT bank not cleared");
+        }
+    }
+
+    if (Name != NULL) {
+        BenchPrintRow(Context, Name, &Each, &Bank, TRUE);
+    }
+
+    EachTotal->Transactions += Each.Transactions;
+    EachTotal->Bytes += Each.Bytes;
+    EachTotal->BusTimeNs += Each.BusTimeNs;
+    BankTotal->Transactions += Bank.Transactions;
+    BankTotal->Bytes += Bank.Bytes;
+    BankTotal->BusTimeNs += Bank.BusTimeNs;
+}
+
+//
+// Register cache steps, in the order the driver runs them
+//
+
+#define BENCH_STEP_PROBE        0
+#define BENCH_STEP_PROBE_AGAIN  1
+#define BENCH_STEP_TOGGLE       2
+#define BENCH_STEP_INTERRUPT    3
+#define BENCH_STEP_D0_ENTRY     4
+#define BENCH_STEP_COUNT        5
+
+static const PCSTR BenchStepNames[BENCH_STEP_COUNT] = {
+    "charger_probe",
+    "charger_probe again",
+    "enable_charging off and on",
+    "Charger interrupt off and on",
+    "D0 entry after power loss"
+};
+
+//
+// Charger control registers charger_probe and enable_charging set
+//
+
+static const UCHAR BenchControlRegs[] = {
+    SM5714_CHG_REG_CNTL1,
+    SM5714_CHG_REG_VBUSCNTL,
+    SM5714_CHG_REG_CHGCNTL2,
+    SM5714_CHG_REG_CHGCNTL4,
+    SM5714_CHG_REG_CHGCNTL5
+};
+
+static
+VOID
+BenchStepCost(
+    _In_ PBENCH_CONTEXT Context,
+    _Out_ PBENCH_COST Cost
+    )
+{
+    RtlZeroMemory(Cost, sizeof(*Cost));
+    BenchAddStats(Context, Cost);
+    BenchResetStats(Context);
+}
+
+//
+// Runs the steps from zeroed registers and returns what each cost and the
+// control registers they left. Checks that D0 entry brings back every
+// register the driver wrote when Cached.
+//
+
+static
+VOID
+BenchCachePass(
+    _Inout_ PBENCH_CONTEXT Context,
+    _In_ BOOLEAN Cached,
+    _Out_writes_(BENCH_STEP_COUNT) PBENCH_COST Costs,
+    _Out_writes_(ARRAYSIZE(BenchControlRegs)) PUCHAR Control
+    )
+{
+    PDEVICE_CONTEXT pDevice = Context->pDevice;
+    PSM5714_PMIC_SIM Charger = Context->Sims[BENCH_CHARGER];
+    PCSTR Label = Cached ? "cached" : "uncached";
+    UCHAR Before[sizeof(Charger->Registers)];
+    ULONG i;
+
+    RtlZeroMemory(Charger->Registers, sizeof(Charger->Registers));
+    RtlZeroMemory(Charger->Defaults, sizeof(Charger->Defaults));
+
+    if (Cached) {
+        BenchCheck(Context, Label, NT_SUCCESS(charger_reg_cache_init(pDevice)), "charger_reg_cache_init failed");
+    }
+
+    BenchResetStats(Context);
+
+    BenchCheck(Context, Label, charger_probe(pDevice) == 0, "charger_probe failed");
+    BenchStepCost(Context, &Costs[BENCH_STEP_PROBE]);
+
+    BenchCheck(Context, Label, charger_probe(pDevice) == 0, "charger_probe failed");
+    BenchStepCost(Context, &Costs[BENCH_STEP_PROBE_AGAIN]);
+
+    //
+    // OnD0Entry enables charging after the probe
+    //
+
+    BenchCheck(Context, Label, NT_SUCCESS(enable_charging(pDevice, true)), "enable_charging failed");
+    BenchResetStats(Context);
+
+    BenchCheck(Context, Label,
+        NT_SUCCESS(enable_charging(pDevice, false)) && NT_SUCCESS(enable_charging(pDevice, true)),
+        "enable_charging failed");
+    BenchStepCost(Context, &Costs[BENCH_STEP_TOGGLE]);
+
+    BenchCheck(Context, Label,
+        NT_SUCCESS(charger_interrupt_disable(pDevice)) && NT_SUCCESS(charger_interrupt_enable(pDevice)),
+        "charger interrupt mask failed");
+    BenchStepCost(Context, &Costs[BENCH_STEP_INTERRUPT]);
+
+    //
+    // The PMIC comes back from power loss with its registers cleared, and
+    // OnD0Entry syncs the caches before configuring the charger
+    //
+
+    RtlCopyMemory(Before, Charger->Registers, sizeof(Before));
+    Sm5714PmicSimPowerLoss(Charger);
+
+    BenchCheck(Context, Label, NT_SUCCESS(reg_cache_sync(pDevice, BENCH_CHARGER)), "reg_cache_sync failed");
+    BenchCheck(Context, Label,
+        charger_probe(pDevice) == 0 && NT_SUCCESS(enable_charging(pDevice, true)),
+        "charger configuration failed");
+    BenchStepCost(Context, &Costs[BENCH_STEP_D0_ENTRY]);
+
+    if (Cached) {
+        BenchCheck(Context, Label, memcmp(Before, Charger->Registers, sizeof(Before)) == 0, "registers not restored");
+    }
+
+    for (i = 0; i < ARRAYSIZE(BenchControlRegs); i++) {
+        Control[i] = Charger->Registers[BenchControlRegs[i]];
+    }
+}
+
+//
+// Resume after firmware configured the charger. Firmware already set part
+// of what charger_probe and enable_charging ask for, CNTL1's charge enable
+// among it, so those updates find nothing to write; the reset values
+// differ from all of it. Returns the register file D0 entry left and what
+// D0 entry cost.
+//
+
+typedef struct _BENCH_REG_VALUE {
+    UCHAR   Reg;
+    UCHAR   Firmware;
+    UCHAR   Default;
+} BENCH_REG_VALUE;
+
+static const BENCH_REG_VALUE BenchResumeRegs[] = {
+    { SM5714_CHG_REG_INTMSK1,   0xFF, 0xFF },
+    { SM5714_CHG_REG_INTMSK2,   0xFF, 0xFF },
+    { SM5714_CHG_REG_INTMSK3,   0xFF, 0xFF },
+    { SM5714_CHG_REG_INTMSK4,   0xFF, 0xFF },
+    { SM5714_CHG_REG_INTMSK5,   0xFF, 0xFF },
+    { SM5714_CHG_REG_CNTL1,     0x09, 0x01 },   // Charging on
+    { SM5714_CHG_REG_VBUSCNTL,  0x30, 0x10 },   // 1300 mA already
+    { SM5714_CHG_REG_CHGCNTL2,  0x40, 0x20 },
+    { SM5714_CHG_REG_CHGCNTL4,  0x45, 0x05 },   // Autostop on already
+    { SM5714_CHG_REG_CHGCNTL5,  0x02, 0x04 }
+};
+
+static
+BOOLEAN
+BenchD0Entry(
+    _In_ PDEVICE_CONTEXT pDevice
+    )
+{
+    return (NT_SUCCESS(reg_cache_sync(pDevice, BENCH_CHARGER)) &&
+            charger_probe(pDevice) == 0 &&
+            NT_SUCCESS(enable_charging(pDevice, true)) &&
+            NT_SUCCESS(charger_interrupt_enable(pDevice))) ? TRUE : FALSE;
+}
+
+static
+VOID
+BenchResumePass(
+    _Inout_ PBENCH_CONTEXT Context,
+    _In_ BOOLEAN Cached,
+    _Out_ PBENCH_COST Cost,
+    _Out_writes_(sizeof(Context->Sims[BENCH_CHARGER]->Registers)) PUCHAR Registers
+    )
+{
+    PDEVICE_CONTEXT pDevice = Context->pDevice;
+    PSM5714_PMIC_SIM Charger = Context->Sims[BENCH_CHARGER];
+    PCSTR Label = Cached ? "cached resume" : "uncached resume";
+    ULONG i;
+
+    RtlZeroMemory(Charger->Registers, sizeof(Charger->Registers));
+    RtlZeroMemory(Charger->Defaults, sizeof(Charger->Defaults));
+
+    for (i = 0; i < ARRAYSIZE(BenchResumeRegs); i++) {
+        Charger->Registers[BenchResumeRegs[i].Reg] = BenchResumeRegs[i].Firmware;
+        Charger->Defaults[BenchResumeRegs[i].Reg] = BenchResumeRegs[i].Default;
+    }
+
+    //
+    // Without cacheable registers every access goes to the bus
+    //
+
+    if (Cached) {
+        BenchCheck(Context, Label, NT_SUCCESS(charger_reg_cache_init(pDevice)), "charger_reg_cache_init failed");
+    } else {
+        BenchCheck(Context, Label, NT_SUCCESS(reg_cache_init(pDevice, BENCH_CHARGER, NULL, 0)), "reg_cache_init failed");
+    }
+
+    BenchCheck(Context, Label, BenchD0Entry(pDevice), "first D0 entry failed");
+
+    Sm5714PmicSimPowerLoss(Charger);
+    BenchResetStats(Context);
+
+    BenchCheck(Context, Label, BenchD0Entry(pDevice), "D0 entry failed");
+    BenchStepCost(Context, Cost);
+
+    BenchCheck(Context, Label,
+        (Charger->Registers[SM5714_CHG_REG_CNTL1] & (1 << 3)) != 0,
+        "charging left off");
+
+    RtlCopyMemory(Registers, Charger->Registers, sizeof(Charger->Registers));
+}
+
+static
+VOID
+BenchRegCache(
+    _Inout_ PBENCH_CONTEXT Context
+    )
+{
+    BENCH_COST Uncached[BENCH_STEP_COUNT];
+    BENCH_COST Cached[BENCH_STEP_COUNT];
+    UCHAR UncachedControl[ARRAYSIZE(BenchControlRegs)];
+    UCHAR CachedControl[ARRAYSIZE(BenchControlRegs)];
+    PDEVICE_CONTEXT pDevice = Context->pDevice;
+    SPB_REG_CACHE* Cache = &pDevice->SpbContexts[BENCH_CHARGER].RegCache;
+    UCHAR UncachedRegisters[sizeof(Context->Sims[BENCH_CHARGER]->Registers)];
+    UCHAR CachedRegisters[sizeof(Context->Sims[BENCH_CHARGER]->Registers)];
+    BENCH_COST UncachedResume;
+    BENCH_COST CachedResume;
+    ULONG Hits;
+    ULONG Misses;
+    ULONG i;
+
+    pDevice->Autostop = TRUE;
+    pDevice->InputCurrentLimit = 1300;
+    pDevice->ChargingCurrent = 1300;
+    pDevice->TopoffCurrent = 225;
+
+    BenchCachePass(Context, FALSE, Uncached, UncachedControl);
+    BenchCachePass(Context, TRUE, Cached, CachedControl);
+    Hits = Cache->Hits;
+    Misses = Cache->Misses;
+
+    BenchResumePass(Context, FALSE, &UncachedResume, UncachedRegisters);
+    BenchResumePass(Context, TRUE, &CachedResume, CachedRegisters);
+
+    printf("\n%-34s %22s   %22s\n", "", "uncached", "cached");
+    printf("%-34s %5s %5s %8s   %5s %5s %8s   %7s\n",
+        "charger step", "xfers", "bytes", "bus us", "xfers", "bytes", "bus us", "saved");
+
+    //
+    // The first probe has nothing cached yet and reads what it updates
+    //
+
+    for (i = 0; i < BENCH_STEP_COUNT; i++) {
+        BenchPrintRow(Context, BenchStepNames[i], &Uncached[i], &Cached[i], (i != BENCH_STEP_PROBE) ? TRUE : FALSE);
+    }
+
+    BenchPrintRow(Context, "D0 entry, firmware settings", &UncachedResume, &CachedResume, TRUE);
+
+    BenchCheck(Context, BenchStepNames[BENCH_STEP_PROBE_AGAIN],
+        Cached[BENCH_STEP_PROBE_AGAIN].Transactions == 0, "unchanged values reached the bus");
+
+    //
+    // Each enable_charging is one CNTL1 write and the status read after it
+    //
+
+    BenchCheck(Context, BenchStepNames[BENCH_STEP_TOGGLE],
+        Cached[BENCH_STEP_TOGGLE].Transactions == 4, "masked update is not one write");
+
+    BenchCheck(Context, "charger control registers",
+        memcmp(UncachedControl, CachedControl, sizeof(CachedControl)) == 0, "passes disagree");
+
+    //
+    // A cached value the driver did not write is the one before the power
+    // loss; neither updates nor the sync may rely on it
+    //
+
+    BenchCheck(Context, "charger registers after resume",
+        memcmp(UncachedRegisters, CachedRegisters, sizeof(CachedRegisters)) == 0, "passes disagree");
+
+    printf("register cache: %lu hits, %lu misses\n", (unsigned long)Hits, (unsigned long)Misses);
+}
+
+int
+main(
+    void
+    )
+{
+    static SM5714_PMIC_SIM Charger;
+    static SM5714_PMIC_SIM Usbpd;
+    BENCH_CONTEXT Context;
+    BENCH_COST Each;
+    BENCH_COST Bank;
+    LARGE_INTEGER ConnectionId;
+    WDFDEVICE Device;
+    NTSTATUS Status;
+
+    Sm5714PmicSimInitialize(&Charger);
+    Sm5714PmicSimInitialize(&Usbpd);
+
+    ConnectionId.QuadPart = HOST_PMIC_CHARGER_CONNECTION_ID;
+    Status = HostPmicSimSpbRegister(&Charger, ConnectionId);
+    if (NT_SUCCESS(Status)) {
+        ConnectionId.QuadPart = HOST_PMIC_USBPD_CONNECTION_ID;
+        Status = HostPmicSimSpbRegister(&Usbpd, ConnectionId);
+    }
+
+    if (!NT_SUCCESS(Status)) {
+        fprintf(stderr, "HostPmicSimSpbRegister failed 0x%08X\n", (unsigned)Status);
+        return 1;
+    }
+
+    Status = HostPmicCreate(&Device);
+    if (!NT_SUCCESS(Status)) {
+        fprintf(stderr, "HostPmicCreate failed 0x%08X\n", (unsigned)Status);
+        return 1;
+    }
+
+    RtlZeroMemory(&Context, sizeof(Context));
+    Context.pDevice = GetDeviceContext(Device);
+    Context.Sims[BENCH_CHARGER] = &Charger;
+    Context.Sims[BENCH_USBPD] = &Usbpd;
+
+    printf("%-34s %22s   %22s\n", "", "read_reg", "bank read");
+    printf("%-34s %5s %5s %8s   %5s %5s %8s   %7s\n",
+        "bank", "xfers", "bytes", "bus us", "xfers", "bytes", "bus us", "saved");
+
+    RtlZeroMemory(&Each, sizeof(Each));
+    RtlZeroMemory(&Bank, sizeof(Bank));
+    BenchBank(&Context, "Charger INT1..INT5", BENCH_CHARGER, SM5714_CHG_REG_INT1, TRUE, BENCH_BANK_SIZE, &Each, &Bank);
+    BenchBank(&Context, "Charger STATUS1..STATUS5", BENCH_CHARGER, SM5714_CHG_REG_STATUS1, FALSE, BENCH_BANK_SIZE, &Each, &Bank);
+    BenchBank(&Context, "USBPD INT1..INT5", BENCH_USBPD, SM5714_REG_INT1, TRUE, BENCH_BANK_SIZE, &Each, &Bank);
+    BenchBank(&Context, "USBPD STATUS1..STATUS5", BENCH_USBPD, SM5714_REG_STATUS1, FALSE, BENCH_BANK_SIZE, &Each, &Bank);
+
+    //
+    // Per event: the charger ISR reads its INT bank and the work item the
+    // status (STATUS1 and STATUS2 before); the USBPD ISR reads its INT
+    // bank, the work item STATUS1 and then the charger status
+    //
+
+    printf("\n");
+
+    RtlZeroMemory(&Each, sizeof(Each));
+    RtlZeroMemory(&Bank, sizeof(Bank));
+    BenchBank(&Context, NULL, BENCH_CHARGER, SM5714_CHG_REG_INT1, TRUE, BENCH_BANK_SIZE, &Each, &Bank);
+    BenchBank(&Context, NULL, BENCH_CHARGER, SM5714_CHG_REG_STATUS1, FALSE, 2, &Each, &Bank);
+    BenchPrintRow(&Context, "Charger interrupt", &Each, &Bank, TRUE);
+
+    RtlZeroMemory(&Each, sizeof(Each));
+    RtlZeroMemory(&Bank, sizeof(Bank));
+    BenchBank(&Context, NULL, BENCH_USBPD, SM5714_REG_INT1, TRUE, BENCH_BANK_SIZE, &Each, &Bank);
+    BenchBank(&Context, NULL, BENCH_USBPD, SM5714_REG_STATUS1, FALSE, 1, &Each, &Bank);
+    BenchBank(&Context, NULL, BENCH_CHARGER, SM5714_CHG_REG_STATUS1, FALSE, 2, &Each, &Bank);
+    BenchPrintRow(&Context, "USBPD interrupt", &Each, &Bank, TRUE);
+
+    BenchRegCache(&Context);
+
+    HostPmicDestroy(Device);
+
+    if (Context.Failures != 0) {
+        printf("\n%lu check(s) failed\n", (unsigned long)Context.Failures);
+        return 3;
+    }
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*++
+
+Module Name:
+
+    sm5714_query.c
+
+Abstract:
+
+    Runs the battery class callbacks once against the fuel gauge simulator
+    and prints what the battery class driver would receive, together with
+    the bus transactions and wire time each callback cost.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#include "../inc/sm5714_host.h"
+
+static
+VOID
+PrintBus(
+    _Inout_ PSM5714_SIM Sim
+    )
+{
+    printf("    bus: %llu transactions, %llu.%03llu us\n",
+        (unsigned long long)Sim->Stats.Transactions,
+        (unsigned long long)(Sim->Stats.BusTimeNs / 1000),
+        (unsigned long long)(Sim->Stats.BusTimeNs % 1000));
+
+    Sm5714SimResetStats(Sim);
+}
+
+int
+main(
+    void
+    )
+{
+    static const BATTERY_QUERY_INFORMATION_LEVEL Levels[] = {
+        BatteryInformation,
+        BatteryGranularityInformation,
+        BatteryTemperature,
+        BatteryEstimatedTime,
+        BatteryDeviceName,
+        BatteryManufactureDate,
+        BatteryManufactureName,
+        BatteryUniqueID,
+        BatterySerialNumber,
+    };
+
+    SM5714_SIM Sim;
+    PSM5714_BATTERY_FDO_DATA DevExt;
+    WDFDEVICE Device;
+    BATTERY_STATUS BatteryStatus;
+    UCHAR Buffer[MAX_BATTERY_STRING_SIZE * sizeof(WCHAR)];
+    ULONG ReturnedLength;
+    ULONG Tag;
+    ULONG i;
+    NTSTATUS Status;
+
+    Sm5714SimInitialize(&Sim);
+
+    Status = HostBatteryCreate(&HostSimBusOps, &Sim, &Device);
+    if (!NT_SUCCESS(Status)) {
+        fprintf(stderr, "HostBatteryCreate failed 0x%08X\n", (unsigned)Status);
+        return 1;
+    }
+
+    DevExt = GetDeviceExtension(Device);
+    Sm5714SimResetStats(&Sim);
+
+    Status = SM5714BatteryQueryTag(DevExt, &Tag);
+    printf("QueryTag: status=0x%08X tag=%u\n", (unsigned)Status, Tag);
+    PrintBus(&Sim);
+
+    Status = SM5714BatteryQueryStatus(DevExt, Tag, &BatteryStatus);
+    printf("QueryStatus: status=0x%08X power=0x%X capacity=%u mWh voltage=%u mV rate=%d mW\n",
+        (unsigned)Status,
+        BatteryStatus.PowerState,
+        BatteryStatus.Capacity,
+        BatteryStatus.Voltage,
+        BatteryStatus.Rate);
+    PrintBus(&Sim);
+
+    for (i = 0; i < ARRAYSIZE(Levels); i++) {
+        RtlZeroMemory(Buffer, sizeof(Buffer));
+        ReturnedLength = 0;
+        Status = SM5714BatteryQueryInformation(DevExt, Tag, Levels[i], 0, Buffer, sizeof(Buffer), &ReturnedLength);
+        printf("QueryInformation(%u): status=0x%08X length=%u\n", (unsigned)Levels[i], (unsigned)Status, ReturnedLength);
+        PrintBus(&Sim);
+    }
+
+    HostBatteryDestroy(Device);
+    return 0;
+}
@@ -0,0 +1,228 @@
+/*++
+
+Module Name:
+
+    sm5714_snapshot_stress.c
+
+Abstract:
+
+    Hammers the lock-free telemetry snapshot behind the direct-call
+    interface. A writer thread samples the fuel gauge simulator with
+    random SRAM words and records every published record by version;
+    reader threads call GetTelemetry as fast as they can and compare what
+    they got with the record of the same version. A torn read shows up as
+    a mismatch, a version going backwards as a regression.
+
+    Usage: sm5714_snapshot_stress [readers]
+
+    Readers default to one per online CPU, at least two. Torn reads only
+    have a fair chance to show when readers run alongside the writer, so
+    the run is of little use on a single CPU and says so.
+
+    Exits with 3 when any read was torn or went backwards.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#include "../inc/sm5714_host.h"
+#include "../../SM5714Battery/inc/SM5714Battery_regs.h"
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define STRESS_MIN_DEFAULT_READERS  2
+#define STRESS_MAX_READERS          64
+
+//
+// Versions recorded by the writer; the run ends when they are used up
+//
+
+#define STRESS_VERSIONS             (1 << 14)
+
+//
+// The writer yields after this many samples so that, on a single CPU,
+// readers get to run while it publishes
+//
+
+#define STRESS_YIELD_INTERVAL       8
+
+typedef struct _STRESS_ENTRY {
+    volatile BOOLEAN            Recorded;
+    SM5714_BATTERY_TELEMETRY    Telemetry;
+} STRESS_ENTRY, *PSTRESS_ENTRY;
+
+typedef struct _STRESS_READER {
+    pthread_t                   Thread;
+    PSM5714_BATTERY_FDO_DATA    DevExt;
+    ULONGLONG                   Reads;
+    ULONGLONG                   Checked;
+    ULONGLONG                   Torn;
+    ULONGLONG                   Backwards;
+} STRESS_READER, *PSTRESS_READER;
+
+static STRESS_ENTRY StressTable[STRESS_VERSIONS];
+static volatile BOOLEAN StressDone;
+
+static
+BOOLEAN
+StressSameTelemetry(
+    _In_ const SM5714_BATTERY_TELEMETRY* Left,
+    _In_ const SM5714_BATTERY_TELEMETRY* Right
+    )
+{
+    return Left->Version == Right->Version &&
+        Left->Valid == Right->Valid &&
+        Left->Timestamp == Right->Timestamp &&
+        Left->Capacity == Right->Capacity &&
+        Left->Voltage == Right->Voltage &&
+        Left->Current == Right->Current &&
+        Left->Temperature == Right->Temperature &&
+        Left->Energy == Right->Energy &&
+        Left->PowerState == Right->PowerState &&
+        Left->DischargeRate == Right->DischargeRate;
+}
+
+static
+void*
+StressReaderThread(
+    void* Argument
+    )
+{
+    PSTRESS_READER Reader = (PSTRESS_READER)Argument;
+    SM5714_BATTERY_TELEMETRY Telemetry;
+    ULONG Previous = 0;
+
+    while (!__atomic_load_n(&StressDone, __ATOMIC_RELAXED)) {
+        SM5714TelemetryInterfaceGetTelemetry(Reader->DevExt, &Telemetry);
+        Reader->Reads += 1;
+
+        if (Telemetry.Version < Previous) {
+            Reader->Backwards += 1;
+        }
+
+        Previous = Telemetry.Version;
+
+        if (Telemetry.Version < STRESS_VERSIONS &&
+            __atomic_load_n(&StressTable[Telemetry.Version].Recorded, __ATOMIC_ACQUIRE)) {
+
+            Reader->Checked += 1;
+            if (!StressSameTelemetry(&Telemetry, &StressTable[Telemetry.Version].Telemetry)) {
+                Reader->Torn += 1;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+int
+main(
+    int argc,
+    char** argv
+    )
+{
+    static STRESS_READER Readers[STRESS_MAX_READERS];
+    static SM5714_SIM Sim;
+    SM5714_BATTERY_TELEMETRY Telemetry;
+    PSM5714_BATTERY_FDO_DATA DevExt;
+    WDFDEVICE Device;
+    ULONGLONG Reads = 0;
+    ULONGLONG Checked = 0;
+    ULONGLONG Torn = 0;
+    ULONGLONG Backwards = 0;
+    ULONG ReaderCount;
+    long Cpus;
+    ULONG Samples = 0;
+    ULONG State = 0x5714;
+    ULONG i;
+    NTSTATUS Status;
+
+    Cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    ReaderCount = (Cpus > STRESS_MIN_DEFAULT_READERS) ? (ULONG)Cpus : STRESS_MIN_DEFAULT_READERS;
+    if (ReaderCount > STRESS_MAX_READERS) {
+        ReaderCount = STRESS_MAX_READERS;
+    }
+
+    if (argc > 1) {
+        ReaderCount = (ULONG)strtoul(argv[1], NULL, 0);
+        if (ReaderCount == 0 || ReaderCount > STRESS_MAX_READERS) {
+            fprintf(stderr, "usage: %s [readers, 1..%u]\n", argv[0], STRESS_MAX_READERS);
+            return 2;
+        }
+    }
+
+    if (Cpus <= 1) {
+        printf("only one CPU online, readers cannot overlap the writer\n");
+    }
+
+    Sm5714SimInitialize(&Sim);
+
+    Status = HostBatteryCreate(&HostSimBusOps, &Sim, &Device);
+    if (!NT_SUCCESS(Status)) {
+        fprintf(stderr, "HostBatteryCreate failed 0x%08X\n", (unsigned)Status);
+        return 1;
+    }
+
+    DevExt = GetDeviceExtension(Device);
+
+    for (i = 0; i < ReaderCount; i++) {
+        Readers[i].DevExt = DevExt;
+        pthread_create(&Readers[i].Thread, NULL, StressReaderThread, &Readers[i]);
+    }
+
+    //
+    // Only this thread samples, so the record it reads back right after a
+    // sample is the one that sample published
+    //
+
+    for (;;) {
+        State = State * 1664525u + 1013904223u;
+        Sim.Sram[SM5714_FG_ADDR_SRAM_SOC] = (USHORT)(State >> 16);
+        Sim.Sram[SM5714_FG_ADDR_SRAM_OCV] = (USHORT)State;
+        State = State * 1664525u + 1013904223u;
+        Sim.Sram[SM5714_FG_ADDR_SRAM_CURRENT] = (USHORT)(State >> 16);
+        Sim.Sram[SM5714_FG_ADDR_SRAM_TEMPERATURE] = (USHORT)State;
+
+        HostAdvanceInterruptTime(MILLISECONDS(SM5714TelemetrySamplePeriodMs(DevExt)));
+        if (!NT_SUCCESS(SM5714TelemetrySample(DevExt, NULL))) {
+            continue;
+        }
+
+        SM5714TelemetryInterfaceGetTelemetry(DevExt, &Telemetry);
+        if (Telemetry.Version >= STRESS_VERSIONS) {
+            break;
+        }
+
+        StressTable[Telemetry.Version].Telemetry = Telemetry;
+        __atomic_store_n(&StressTable[Telemetry.Version].Recorded, TRUE, __ATOMIC_RELEASE);
+
+        Samples += 1;
+        if ((Samples % STRESS_YIELD_INTERVAL) == 0) {
+            sched_yield();
+        }
+    }
+
+    __atomic_store_n(&StressDone, TRUE, __ATOMIC_RELAXED);
+
+    for (i = 0; i < ReaderCount; i++) {
+        pthread_join(Readers[i].Thread, NULL);
+        Reads += Readers[i].Reads;
+        Checked += Readers[i].Checked;
+        Torn += Readers[i].Torn;
+        Backwards += Readers[i].Backwards;
+    }
+
+    HostBatteryDestroy(Device);
+
+    printf("%lu samples published, %lu readers\n", (unsigned long)Samples, (unsigned long)ReaderCount);
+    printf("%llu reads, %llu checked, %llu torn, %llu went backwards\n",
+        (unsigned long long)Reads,
+        (unsigned long long)Checked,
+        (unsigned long long)Torn,
+        (unsigned long long)Backwards);
+
+    return (Torn != 0 || Backwards != 0) ? 3 : 0;
+}
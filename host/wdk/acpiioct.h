@@ -0,0 +1,20 @@
+/*++
+
+Module Name:
+
+    acpiioct.h
+
+Abstract:
+
+    Host (Linux) stand-in for the ACPI IOCTL definitions. The host harness does not evaluate
+    ACPI methods, so only the include is satisfied.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
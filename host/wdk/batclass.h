@@ -0,0 +1,205 @@
+/*++
+
+Module Name:
+
+    batclass.h
+
+Abstract:
+
+    Host (Linux) stand-in for the battery class definitions used by the
+    SM5714 battery miniclass driver.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+
+//------------------------------------------------------------------- Literals
+
+#define BATTERY_CLASS_MAJOR_VERSION     0x0001
+#define BATTERY_CLASS_MINOR_VERSION     0x0000
+#define BATTERY_CLASS_MINOR_VERSION_1   0x0001
+
+#define BATTERY_TAG_INVALID             0
+
+#define MAX_BATTERY_STRING_SIZE         128
+
+#define BATTERY_SYSTEM_BATTERY          0x80000000
+#define BATTERY_CAPACITY_RELATIVE       0x40000000
+#define BATTERY_IS_SHORT_TERM           0x20000000
+#define BATTERY_SET_CHARGE_SUPPORTED    0x00000001
+#define BATTERY_SET_DISCHARGE_SUPPORTED 0x00000002
+
+#define BATTERY_POWER_ON_LINE           0x00000001
+#define BATTERY_DISCHARGING             0x00000002
+#define BATTERY_CHARGING                0x00000004
+#define BATTERY_CRITICAL                0x00000008
+
+#define BATTERY_UNKNOWN_CAPACITY        0xFFFFFFFF
+#define BATTERY_UNKNOWN_VOLTAGE         0xFFFFFFFF
+#define BATTERY_UNKNOWN_RATE            0x80000000
+#define BATTERY_UNKNOWN_TIME            0xFFFFFFFF
+
+//---------------------------------------------------------------------- Types
+
+typedef enum {
+    BatteryInformation,
+    BatteryGranularityInformation,
+    BatteryTemperature,
+    BatteryEstimatedTime,
+    BatteryDeviceName,
+    BatteryManufactureDate,
+    BatteryManufactureName,
+    BatteryUniqueID,
+    BatterySerialNumber
+} BATTERY_QUERY_INFORMATION_LEVEL;
+
+typedef enum {
+    BatteryCriticalBias,
+    BatteryCharge,
+    BatteryDischarge,
+    BatteryChargingSource,
+    BatteryChargerId,
+    BatteryChargerStatus
+} BATTERY_SET_INFORMATION_LEVEL;
+
+typedef struct _BATTERY_INFORMATION {
+    ULONG   Capabilities;
+    UCHAR   Technology;
+    UCHAR   Reserved[3];
+    UCHAR   Chemistry[4];
+    ULONG   DesignedCapacity;
+    ULONG   FullChargedCapacity;
+    ULONG   DefaultAlert1;
+    ULONG   DefaultAlert2;
+    ULONG   CriticalBias;
+    ULONG   CycleCount;
+} BATTERY_INFORMATION, *PBATTERY_INFORMATION;
+
+typedef struct _BATTERY_STATUS {
+    ULONG   PowerState;
+    ULONG   Capacity;
+    ULONG   Voltage;
+    LONG    Rate;
+} BATTERY_STATUS, *PBATTERY_STATUS;
+
+typedef struct _BATTERY_NOTIFY {
+    ULONG   PowerState;
+    ULONG   LowCapacity;
+    ULONG   HighCapacity;
+} BATTERY_NOTIFY, *PBATTERY_NOTIFY;
+
+typedef struct _BATTERY_REPORTING_SCALE {
+    ULONG   Granularity;
+    ULONG   Capacity;
+} BATTERY_REPORTING_SCALE, *PBATTERY_REPORTING_SCALE;
+
+typedef struct _BATTERY_MANUFACTURE_DATE {
+    UCHAR   Day;
+    UCHAR   Month;
+    USHORT  Year;
+} BATTERY_MANUFACTURE_DATE, *PBATTERY_MANUFACTURE_DATE;
+
+typedef enum _BATTERY_CHARGING_SOURCE_TYPE {
+    BatteryChargingSourceType_AC = 1,
+    BatteryChargingSourceType_USB,
+    BatteryChargingSourceType_Wireless,
+    BatteryChargingSourceType_Max
+} BATTERY_CHARGING_SOURCE_TYPE;
+
+typedef struct _BATTERY_CHARGING_SOURCE {
+    BATTERY_CHARGING_SOURCE_TYPE    Type;
+    ULONG                           MaxCurrent;
+} BATTERY_CHARGING_SOURCE, *PBATTERY_CHARGING_SOURCE;
+
+typedef GUID BATTERY_CHARGER_ID, *PBATTERY_CHARGER_ID;
+
+typedef struct _BATTERY_CHARGER_STATUS {
+    BATTERY_CHARGING_SOURCE_TYPE    Type;
+    ULONG                           VaData[1];
+} BATTERY_CHARGER_STATUS, *PBATTERY_CHARGER_STATUS;
+
+typedef struct _BATTERY_USB_CHARGER_STATUS {
+    BATTERY_CHARGING_SOURCE_TYPE    Type;
+    ULONG                           Reserved;
+    ULONG                           Flags;
+    ULONG                           MaxCurrent;
+    ULONG                           Voltage;
+    ULONG                           PortType;
+    ULONG64                         PortId;
+    PVOID                           PowerSourceInformation;
+    GUID                            OemCharger;
+} BATTERY_USB_CHARGER_STATUS, *PBATTERY_USB_CHARGER_STATUS;
+
+//------------------------------------------------------------------ Callbacks
+
+typedef
+NTSTATUS
+BCLASS_QUERY_TAG_CALLBACK(
+    _In_ PVOID Context,
+    _Out_ PULONG BatteryTag
+    );
+
+typedef
+NTSTATUS
+BCLASS_QUERY_INFORMATION_CALLBACK(
+    _In_ PVOID Context,
+    _In_ ULONG BatteryTag,
+    _In_ BATTERY_QUERY_INFORMATION_LEVEL Level,
+    _In_ LONG AtRate,
+    _Out_writes_bytes_to_(BufferLength, *ReturnedLength) PVOID Buffer,
+    _In_ ULONG BufferLength,
+    _Out_ PULONG ReturnedLength
+    );
+
+typedef
+NTSTATUS
+BCLASS_QUERY_STATUS_CALLBACK(
+    _In_ PVOID Context,
+    _In_ ULONG BatteryTag,
+    _Out_ PBATTERY_STATUS BatteryStatus
+    );
+
+typedef
+NTSTATUS
+BCLASS_SET_STATUS_NOTIFY_CALLBACK(
+    _In_ PVOID Context,
+    _In_ ULONG BatteryTag,
+    _In_ PBATTERY_NOTIFY BatteryNotify
+    );
+
+typedef
+NTSTATUS
+BCLASS_SET_INFORMATION_CALLBACK(
+    _In_ PVOID Context,
+    _In_ ULONG BatteryTag,
+    _In_ BATTERY_SET_INFORMATION_LEVEL Level,
+    _In_opt_ PVOID Buffer
+    );
+
+typedef
+NTSTATUS
+BCLASS_DISABLE_STATUS_NOTIFY_CALLBACK(
+    _In_ PVOID Context
+    );
+
+//------------------------------------------------------------------ Functions
+
+//
+// Only counts the calls; see HostBatteryClassGetStatusNotifications
+//
+
+NTSTATUS
+BatteryClassStatusNotify(
+    _In_ PVOID ClassData
+    );
+
+ULONGLONG
+HostBatteryClassGetStatusNotifications(
+    VOID
+    );
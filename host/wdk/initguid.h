@@ -0,0 +1,20 @@
+/*++
+
+Module Name:
+
+    initguid.h
+
+Abstract:
+
+    Host (Linux) stand-in for initguid.h. DEFINE_GUID in wdm.h always defines
+    the GUID, with internal linkage.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
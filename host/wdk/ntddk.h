@@ -0,0 +1,20 @@
+/*++
+
+Module Name:
+
+    ntddk.h
+
+Abstract:
+
+    Host (Linux) stand-in for the NT DDK header. Everything the drivers use from it is
+    declared in wdm.h.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
@@ -0,0 +1,48 @@
+/*++
+
+Module Name:
+
+    ntstrsafe.h
+
+Abstract:
+
+    Host (Linux) stand-in for the safe string routines used by the drivers.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+
+#define NTSTRSAFE_MAX_CCH 2147483647
+
+#define swprintf_s swprintf
+
+FORCEINLINE
+NTSTATUS
+RtlStringCbLengthW(
+    _In_ PCWSTR String,
+    _In_ size_t MaxBytes,
+    _Out_opt_ size_t* Length
+    )
+{
+    size_t cch = wcsnlen(String, MaxBytes / sizeof(WCHAR));
+
+    if (cch == MaxBytes / sizeof(WCHAR)) {
+        if (Length != NULL) {
+            *Length = 0;
+        }
+
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if (Length != NULL) {
+        *Length = cch * sizeof(WCHAR);
+    }
+
+    return STATUS_SUCCESS;
+}
@@ -0,0 +1,48 @@
+/*++
+
+Module Name:
+
+    reshub.h
+
+Abstract:
+
+    Host (Linux) stand-in for the resource hub helpers. Connection IDs are
+    formatted into the same device path as on target, which is the name
+    the host I/O target registry (see HostIoTargetRegister) matches.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+
+#define RESOURCE_HUB_PATH_SIZE      64
+#define RESOURCE_HUB_DEVICE_PREFIX  L"\\Device\\RESOURCE_HUB\\"
+
+FORCEINLINE
+NTSTATUS
+RESOURCE_HUB_CREATE_PATH_FROM_ID(
+    _Inout_ PUNICODE_STRING RhPath,
+    _In_ ULONG IdLowPart,
+    _In_ ULONG IdHighPart
+    )
+{
+    int cch;
+
+    cch = swprintf(RhPath->Buffer,
+        RhPath->MaximumLength / sizeof(WCHAR),
+        RESOURCE_HUB_DEVICE_PREFIX L"%08x%08x",
+        IdHighPart,
+        IdLowPart);
+
+    if (cch < 0) {
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    RhPath->Length = (USHORT)(cch * sizeof(WCHAR));
+    return STATUS_SUCCESS;
+}
@@ -0,0 +1,109 @@
+/*++
+
+Module Name:
+
+    spb.h
+
+Abstract:
+
+    Host (Linux) stand-in for the SPB transfer list definitions used with
+    IOCTL_SPB_EXECUTE_SEQUENCE. Layouts follow the WDK header.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+
+#define IOCTL_SPB_EXECUTE_SEQUENCE 0x007B0000
+
+typedef enum _SPB_TRANSFER_DIRECTION {
+    SpbTransferDirectionNone,
+    SpbTransferDirectionFromDevice,
+    SpbTransferDirectionToDevice,
+    SpbTransferDirectionMax
+} SPB_TRANSFER_DIRECTION;
+
+typedef enum _SPB_TRANSFER_BUFFER_FORMAT {
+    SpbTransferBufferFormatInvalid,
+    SpbTransferBufferFormatSimple,
+    SpbTransferBufferFormatList,
+    SpbTransferBufferFormatSimpleNonPaged,
+    SpbTransferBufferFormatMdl,
+    SpbTransferBufferFormatMax
+} SPB_TRANSFER_BUFFER_FORMAT;
+
+typedef struct _SPB_TRANSFER_BUFFER_LIST_ENTRY {
+    PVOID   Buffer;
+    ULONG   BufferCb;
+} SPB_TRANSFER_BUFFER_LIST_ENTRY, *PSPB_TRANSFER_BUFFER_LIST_ENTRY;
+
+typedef struct _SPB_TRANSFER_BUFFER {
+    SPB_TRANSFER_BUFFER_FORMAT Format;
+    union {
+        struct {
+            PVOID   Buffer;
+            ULONG   BufferCb;
+        } Simple;
+        struct {
+            SPB_TRANSFER_BUFFER_LIST_ENTRY* List;
+            ULONG   ListCe;
+        } BufferList;
+    };
+} SPB_TRANSFER_BUFFER, *PSPB_TRANSFER_BUFFER;
+
+typedef struct _SPB_TRANSFER_LIST_ENTRY {
+    SPB_TRANSFER_DIRECTION  Direction;
+    ULONG                   DelayInUs;
+    SPB_TRANSFER_BUFFER     Buffer;
+} SPB_TRANSFER_LIST_ENTRY, *PSPB_TRANSFER_LIST_ENTRY;
+
+typedef struct _SPB_TRANSFER_LIST {
+    ULONG                   Size;
+    ULONG                   Reserved;
+    ULONG                   TransferCount;
+    SPB_TRANSFER_LIST_ENTRY Transfers[1];
+} SPB_TRANSFER_LIST, *PSPB_TRANSFER_LIST;
+
+#define SPB_TRANSFER_LIST_AND_ENTRIES(NUMBER_OF_ENTRIES) \
+    struct { \
+        SPB_TRANSFER_LIST List; \
+        SPB_TRANSFER_LIST_ENTRY MoreEntries[(NUMBER_OF_ENTRIES) - 1]; \
+    }
+
+FORCEINLINE
+VOID
+SPB_TRANSFER_LIST_INIT(
+    _Out_ PSPB_TRANSFER_LIST List,
+    _In_ ULONG TransferCount
+    )
+{
+    List->Size = sizeof(SPB_TRANSFER_LIST);
+    List->Reserved = 0;
+    List->TransferCount = TransferCount;
+}
+
+FORCEINLINE
+SPB_TRANSFER_LIST_ENTRY
+SPB_TRANSFER_LIST_ENTRY_INIT_SIMPLE(
+    _In_ SPB_TRANSFER_DIRECTION Direction,
+    _In_ ULONG DelayInUs,
+    _In_ PVOID Buffer,
+    _In_ ULONG BufferCb
+    )
+{
+    SPB_TRANSFER_LIST_ENTRY entry;
+
+    RtlZeroMemory(&entry, sizeof(entry));
+    entry.Direction = Direction;
+    entry.DelayInUs = DelayInUs;
+    entry.Buffer.Format = SpbTransferBufferFormatSimple;
+    entry.Buffer.Simple.Buffer = Buffer;
+    entry.Buffer.Simple.BufferCb = BufferCb;
+
+    return entry;
+}
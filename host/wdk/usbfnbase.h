@@ -0,0 +1,27 @@
+/*++
+
+Module Name:
+
+    usbfnbase.h
+
+Abstract:
+
+    Host (Linux) stand-in for the USB function port type definitions.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+typedef enum _USBFN_PORT_TYPE {
+    UsbfnUnknownPort = 0,
+    UsbfnStandardDownstreamPort,
+    UsbfnChargingDownstreamPort,
+    UsbfnDedicatedChargingPort,
+    UsbfnInvalidDedicatedChargingPort,
+    UsbfnProprietaryDedicatedChargingPort,
+    UsbfnPortTypeMaximum
+} USBFN_PORT_TYPE, *PUSBFN_PORT_TYPE;
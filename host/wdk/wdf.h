@@ -0,0 +1,461 @@
+/*++
+
+Module Name:
+
+    wdf.h
+
+Abstract:
+
+    Host (Linux) stand-in for the subset of KMDF used by the SM5714 drivers.
+    Framework objects are plain heap allocations carrying an optional typed
+    context; see host/src/wdfhost.c for the implementation.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+
+//------------------------------------------------------------------- Handles
+
+typedef struct _HOST_WDF_OBJECT* WDFOBJECT;
+
+typedef WDFOBJECT WDFDRIVER;
+typedef WDFOBJECT WDFDEVICE;
+typedef WDFOBJECT WDFWAITLOCK;
+typedef WDFOBJECT WDFMEMORY;
+typedef WDFOBJECT WDFIOTARGET;
+typedef WDFOBJECT WDFQUEUE;
+typedef WDFOBJECT WDFINTERRUPT;
+typedef WDFOBJECT WDFCMRESLIST;
+typedef WDFOBJECT WDFTIMER;
+typedef WDFOBJECT WDFWORKITEM;
+typedef WDFOBJECT WDFREQUEST;
+typedef WDFOBJECT WDFSTRING;
+
+#define WDF_NO_OBJECT_ATTRIBUTES NULL
+#define WDF_NO_HANDLE NULL
+
+//------------------------------------------------------------ Object attributes
+
+typedef VOID EVT_WDF_OBJECT_CONTEXT_CLEANUP(_In_ WDFOBJECT Object);
+typedef EVT_WDF_OBJECT_CONTEXT_CLEANUP* PFN_WDF_OBJECT_CONTEXT_CLEANUP;
+
+typedef VOID EVT_WDF_OBJECT_CONTEXT_DESTROY(_In_ WDFOBJECT Object);
+typedef EVT_WDF_OBJECT_CONTEXT_DESTROY* PFN_WDF_OBJECT_CONTEXT_DESTROY;
+
+typedef enum _WDF_EXECUTION_LEVEL {
+    WdfExecutionLevelInvalid = 0,
+    WdfExecutionLevelInheritFromParent,
+    WdfExecutionLevelPassive,
+    WdfExecutionLevelDispatch,
+} WDF_EXECUTION_LEVEL;
+
+typedef enum _WDF_SYNCHRONIZATION_SCOPE {
+    WdfSynchronizationScopeInvalid = 0,
+    WdfSynchronizationScopeInheritFromParent,
+    WdfSynchronizationScopeDevice,
+    WdfSynchronizationScopeQueue,
+    WdfSynchronizationScopeNone,
+} WDF_SYNCHRONIZATION_SCOPE;
+
+typedef struct _WDF_OBJECT_CONTEXT_TYPE_INFO {
+    ULONG   Size;
+    PCSTR   ContextName;
+    size_t  ContextSize;
+} WDF_OBJECT_CONTEXT_TYPE_INFO, *PWDF_OBJECT_CONTEXT_TYPE_INFO;
+
+typedef const WDF_OBJECT_CONTEXT_TYPE_INFO* PCWDF_OBJECT_CONTEXT_TYPE_INFO;
+
+typedef struct _WDF_OBJECT_ATTRIBUTES {
+    ULONG                           Size;
+    PFN_WDF_OBJECT_CONTEXT_CLEANUP  EvtCleanupCallback;
+    PFN_WDF_OBJECT_CONTEXT_DESTROY  EvtDestroyCallback;
+    WDF_EXECUTION_LEVEL             ExecutionLevel;
+    WDF_SYNCHRONIZATION_SCOPE       SynchronizationScope;
+    WDFOBJECT                       ParentObject;
+    size_t                          ContextSizeOverride;
+    PCWDF_OBJECT_CONTEXT_TYPE_INFO  ContextTypeInfo;
+} WDF_OBJECT_ATTRIBUTES, *PWDF_OBJECT_ATTRIBUTES;
+
+FORCEINLINE
+VOID
+WDF_OBJECT_ATTRIBUTES_INIT(
+    _Out_ PWDF_OBJECT_ATTRIBUTES Attributes
+    )
+{
+    RtlZeroMemory(Attributes, sizeof(WDF_OBJECT_ATTRIBUTES));
+    Attributes->Size = sizeof(WDF_OBJECT_ATTRIBUTES);
+    Attributes->ExecutionLevel = WdfExecutionLevelInheritFromParent;
+    Attributes->SynchronizationScope = WdfSynchronizationScopeInheritFromParent;
+}
+
+#define WDF_TYPE_NAME_TO_TYPE_INFO(_contexttype) \
+    WDF_##_contexttype##_TYPE_INFO
+
+#define WDF_OBJECT_ATTRIBUTES_SET_CONTEXT_TYPE(_attributes, _contexttype) \
+    (_attributes)->ContextTypeInfo = &WDF_TYPE_NAME_TO_TYPE_INFO(_contexttype)
+
+#define WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(_attributes, _contexttype) \
+    WDF_OBJECT_ATTRIBUTES_INIT(_attributes); \
+    WDF_OBJECT_ATTRIBUTES_SET_CONTEXT_TYPE(_attributes, _contexttype)
+
+PVOID
+WdfObjectGetTypedContextWorker(
+    _In_ WDFOBJECT Handle,
+    _In_ PCWDF_OBJECT_CONTEXT_TYPE_INFO TypeInfo
+    );
+
+#define WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(_contexttype, _castingfunction) \
+    __attribute__((unused)) \
+    static const WDF_OBJECT_CONTEXT_TYPE_INFO WDF_TYPE_NAME_TO_TYPE_INFO(_contexttype) = \
+    { sizeof(WDF_OBJECT_CONTEXT_TYPE_INFO), #_contexttype, sizeof(_contexttype) }; \
+    static inline _contexttype* _castingfunction(_In_ WDFOBJECT Handle) \
+    { \
+        return (_contexttype*)WdfObjectGetTypedContextWorker( \
+            Handle, &WDF_TYPE_NAME_TO_TYPE_INFO(_contexttype)); \
+    }
+
+VOID
+WdfObjectDelete(
+    _In_ WDFOBJECT Object
+    );
+
+//--------------------------------------------------------------------- Waitlock
+
+NTSTATUS
+WdfWaitLockCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES LockAttributes,
+    _Out_ WDFWAITLOCK* Lock
+    );
+
+NTSTATUS
+WdfWaitLockAcquire(
+    _In_ WDFWAITLOCK Lock,
+    _In_opt_ PLONGLONG Timeout
+    );
+
+VOID
+WdfWaitLockRelease(
+    _In_ WDFWAITLOCK Lock
+    );
+
+//----------------------------------------------------------------------- Memory
+
+typedef struct _WDFMEMORY_OFFSET {
+    size_t  BufferOffset;
+    size_t  BufferLength;
+} WDFMEMORY_OFFSET, *PWDFMEMORY_OFFSET;
+
+typedef enum _WDF_MEMORY_DESCRIPTOR_TYPE {
+    WdfMemoryDescriptorTypeInvalid = 0,
+    WdfMemoryDescriptorTypeBuffer,
+    WdfMemoryDescriptorTypeMdl,
+    WdfMemoryDescriptorTypeHandle,
+} WDF_MEMORY_DESCRIPTOR_TYPE;
+
+typedef struct _WDF_MEMORY_DESCRIPTOR {
+    WDF_MEMORY_DESCRIPTOR_TYPE Type;
+    union {
+        struct {
+            PVOID   Buffer;
+            ULONG   Length;
+        } BufferType;
+        struct {
+            WDFMEMORY           Memory;
+            PWDFMEMORY_OFFSET   Offsets;
+        } HandleType;
+    } u;
+} WDF_MEMORY_DESCRIPTOR, *PWDF_MEMORY_DESCRIPTOR;
+
+FORCEINLINE
+VOID
+WDF_MEMORY_DESCRIPTOR_INIT_BUFFER(
+    _Out_ PWDF_MEMORY_DESCRIPTOR Descriptor,
+    _In_ PVOID Buffer,
+    _In_ ULONG BufferLength
+    )
+{
+    RtlZeroMemory(Descriptor, sizeof(WDF_MEMORY_DESCRIPTOR));
+    Descriptor->Type = WdfMemoryDescriptorTypeBuffer;
+    Descriptor->u.BufferType.Buffer = Buffer;
+    Descriptor->u.BufferType.Length = BufferLength;
+}
+
+FORCEINLINE
+VOID
+WDF_MEMORY_DESCRIPTOR_INIT_HANDLE(
+    _Out_ PWDF_MEMORY_DESCRIPTOR Descriptor,
+    _In_ WDFMEMORY Memory,
+    _In_opt_ PWDFMEMORY_OFFSET Offsets
+    )
+{
+    RtlZeroMemory(Descriptor, sizeof(WDF_MEMORY_DESCRIPTOR));
+    Descriptor->Type = WdfMemoryDescriptorTypeHandle;
+    Descriptor->u.HandleType.Memory = Memory;
+    Descriptor->u.HandleType.Offsets = Offsets;
+}
+
+NTSTATUS
+WdfMemoryCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _In_ POOL_TYPE PoolType,
+    _In_opt_ ULONG PoolTag,
+    _In_ size_t BufferSize,
+    _Out_ WDFMEMORY* Memory,
+    _Out_opt_ PVOID* Buffer
+    );
+
+NTSTATUS
+WdfMemoryCreatePreallocated(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES Attributes,
+    _In_ PVOID Buffer,
+    _In_ size_t BufferSize,
+    _Out_ WDFMEMORY* Memory
+    );
+
+PVOID
+WdfMemoryGetBuffer(
+    _In_ WDFMEMORY Memory,
+    _Out_opt_ size_t* BufferSize
+    );
+
+//--------------------------------------------------------------------- Requests
+
+#define WDF_REQUEST_SEND_OPTION_TIMEOUT             0x00000001
+#define WDF_REQUEST_SEND_OPTION_SYNCHRONOUS         0x00000002
+
+#define WDF_REL_TIMEOUT_IN_SEC(Time)    ((LONGLONG)(Time) * -10000000LL)
+#define WDF_REL_TIMEOUT_IN_MS(Time)     ((LONGLONG)(Time) * -10000LL)
+
+typedef struct _WDF_REQUEST_SEND_OPTIONS {
+    ULONG       Size;
+    ULONG       Flags;
+    LONGLONG    Timeout;
+} WDF_REQUEST_SEND_OPTIONS, *PWDF_REQUEST_SEND_OPTIONS;
+
+FORCEINLINE
+VOID
+WDF_REQUEST_SEND_OPTIONS_INIT(
+    _Out_ PWDF_REQUEST_SEND_OPTIONS Options,
+    _In_ ULONG Flags
+    )
+{
+    RtlZeroMemory(Options, sizeof(WDF_REQUEST_SEND_OPTIONS));
+    Options->Size = sizeof(WDF_REQUEST_SEND_OPTIONS);
+    Options->Flags = Flags;
+}
+
+#define WDF_REQUEST_REUSE_NO_FLAGS                  0x00000000
+
+typedef struct _WDF_REQUEST_REUSE_PARAMS {
+    ULONG       Size;
+    ULONG       Flags;
+    NTSTATUS    Status;
+    PIRP        NewIrp;
+} WDF_REQUEST_REUSE_PARAMS, *PWDF_REQUEST_REUSE_PARAMS;
+
+FORCEINLINE
+VOID
+WDF_REQUEST_REUSE_PARAMS_INIT(
+    _Out_ PWDF_REQUEST_REUSE_PARAMS Params,
+    _In_ ULONG Flags,
+    _In_ NTSTATUS Status
+    )
+{
+    RtlZeroMemory(Params, sizeof(WDF_REQUEST_REUSE_PARAMS));
+    Params->Size = sizeof(WDF_REQUEST_REUSE_PARAMS);
+    Params->Flags = Flags;
+    Params->Status = Status;
+}
+
+NTSTATUS
+WdfRequestCreate(
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES RequestAttributes,
+    _In_opt_ WDFIOTARGET IoTarget,
+    _Out_ WDFREQUEST* Request
+    );
+
+NTSTATUS
+WdfRequestReuse(
+    _In_ WDFREQUEST Request,
+    _In_ PWDF_REQUEST_REUSE_PARAMS ReuseParams
+    );
+
+//------------------------------------------------------------------- I/O target
+
+typedef enum _WDF_IO_TARGET_OPEN_TYPE {
+    WdfIoTargetOpenUndefined = 0,
+    WdfIoTargetOpenUseExistingDevice,
+    WdfIoTargetOpenByName,
+    WdfIoTargetOpenReopen,
+    WdfIoTargetOpenLocalTargetByFile,
+} WDF_IO_TARGET_OPEN_TYPE;
+
+typedef struct _WDF_IO_TARGET_OPEN_PARAMS {
+    ULONG                   Size;
+    WDF_IO_TARGET_OPEN_TYPE Type;
+    UNICODE_STRING          TargetDeviceName;
+    ULONG                   DesiredAccess;
+    ULONG                   ShareAccess;
+    ULONG                   FileAttributes;
+    ULONG                   CreateDisposition;
+    ULONG                   CreateOptions;
+} WDF_IO_TARGET_OPEN_PARAMS, *PWDF_IO_TARGET_OPEN_PARAMS;
+
+FORCEINLINE
+VOID
+WDF_IO_TARGET_OPEN_PARAMS_INIT_OPEN_BY_NAME(
+    _Out_ PWDF_IO_TARGET_OPEN_PARAMS Params,
+    _In_ PUNICODE_STRING TargetDeviceName,
+    _In_ ULONG DesiredAccess
+    )
+{
+    RtlZeroMemory(Params, sizeof(WDF_IO_TARGET_OPEN_PARAMS));
+    Params->Size = sizeof(WDF_IO_TARGET_OPEN_PARAMS);
+    Params->Type = WdfIoTargetOpenByName;
+    Params->TargetDeviceName = *TargetDeviceName;
+    Params->DesiredAccess = DesiredAccess;
+}
+
+NTSTATUS
+WdfIoTargetCreate(
+    _In_ WDFDEVICE Device,
+    _In_opt_ PWDF_OBJECT_ATTRIBUTES IoTargetAttributes,
+    _Out_ WDFIOTARGET* IoTarget
+    );
+
+NTSTATUS
+WdfIoTargetOpen(
+    _In_ WDFIOTARGET IoTarget,
+    _In_ PWDF_IO_TARGET_OPEN_PARAMS OpenParams
+    );
+
+NTSTATUS
+WdfIoTargetSendReadSynchronously(
+    _In_ WDFIOTARGET IoTarget,
+    _In_opt_ WDFREQUEST Request,
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR OutputBuffer,
+    _In_opt_ PLONGLONG DeviceOffset,
+    _In_opt_ PWDF_REQUEST_SEND_OPTIONS RequestOptions,
+    _Out_opt_ PULONG_PTR BytesRead
+    );
+
+NTSTATUS
+WdfIoTargetSendWriteSynchronously(
+    _In_ WDFIOTARGET IoTarget,
+    _In_opt_ WDFREQUEST Request,
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR InputBuffer,
+    _In_opt_ PLONGLONG DeviceOffset,
+    _In_opt_ PWDF_REQUEST_SEND_OPTIONS RequestOptions,
+    _Out_opt_ PULONG_PTR BytesWritten
+    );
+
+NTSTATUS
+WdfIoTargetSendIoctlSynchronously(
+    _In_ WDFIOTARGET IoTarget,
+    _In_opt_ WDFREQUEST Request,
+    _In_ ULONG IoctlCode,
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR InputBuffer,
+    _In_opt_ PWDF_MEMORY_DESCRIPTOR OutputBuffer,
+    _In_opt_ PWDF_REQUEST_SEND_OPTIONS RequestOptions,
+    _Out_opt_ PULONG_PTR BytesReturned
+    );
+
+//------------------------------------------------------------ Driver callbacks
+
+//
+// Declared by the drivers' headers; the host harness never calls them
+//
+
+typedef struct _WDFDEVICE_INIT* PWDFDEVICE_INIT;
+
+typedef VOID EVT_WDF_DRIVER_UNLOAD(_In_ WDFDRIVER Driver);
+typedef NTSTATUS EVT_WDF_DRIVER_DEVICE_ADD(_In_ WDFDRIVER Driver, _Inout_ PWDFDEVICE_INIT DeviceInit);
+typedef NTSTATUS EVT_WDFDEVICE_WDM_IRP_PREPROCESS(_In_ WDFDEVICE Device, _Inout_ PIRP Irp);
+typedef VOID EVT_WDF_IO_QUEUE_IO_INTERNAL_DEVICE_CONTROL(
+    _In_ WDFQUEUE Queue,
+    _In_ WDFREQUEST Request,
+    _In_ size_t OutputBufferLength,
+    _In_ size_t InputBufferLength,
+    _In_ ULONG IoControlCode
+    );
+
+//------------------------------------------------------------- Host extensions
+
+//
+// Creates a stand-alone device object with the context described by
+// DeviceAttributes; the host harness uses this in place of WdfDeviceCreate.
+//
+
+NTSTATUS
+HostWdfDeviceCreate(
+    _In_ PWDF_OBJECT_ATTRIBUTES DeviceAttributes,
+    _Out_ WDFDEVICE* Device
+    );
+
+//
+// Device behind an I/O target opened by name. Read and Write are plain
+// transfers; Ioctl receives the input buffer of the request.
+//
+
+typedef
+NTSTATUS
+HOST_IO_TARGET_TRANSFER(
+    _In_ PVOID Context,
+    _In_ BOOLEAN Read,
+    _Inout_updates_bytes_(Length) PVOID Buffer,
+    _In_ size_t Length,
+    _Out_ PULONG_PTR BytesTransferred
+    );
+
+typedef
+NTSTATUS
+HOST_IO_TARGET_IOCTL(
+    _In_ PVOID Context,
+    _In_ ULONG IoctlCode,
+    _In_reads_bytes_(InputLength) PVOID InputBuffer,
+    _In_ size_t InputLength,
+    _Out_ PULONG_PTR BytesReturned
+    );
+
+typedef struct _HOST_IO_TARGET_OPS {
+    HOST_IO_TARGET_TRANSFER*    Transfer;
+    HOST_IO_TARGET_IOCTL*       Ioctl;
+} HOST_IO_TARGET_OPS, *PHOST_IO_TARGET_OPS;
+
+//
+// Makes DeviceName openable through WdfIoTargetOpen. Registering a name
+// again replaces the previous device.
+//
+
+NTSTATUS
+HostIoTargetRegister(
+    _In_ PCUNICODE_STRING DeviceName,
+    _In_ const HOST_IO_TARGET_OPS* Ops,
+    _In_ PVOID Context
+    );
+
+//
+// Number of framework objects created so far. Like KMDF, a synchronous send
+// that is not given a request allocates one internally, and that counts.
+//
+
+ULONGLONG
+HostWdfGetObjectAllocations(
+    VOID
+    );
+
+//
+// Moves the virtual interrupt time returned by KeQueryInterruptTime forward
+// by Delta 100ns units.
+//
+
+VOID
+HostAdvanceInterruptTime(
+    _In_ ULONGLONG Delta
+    );
@@ -0,0 +1,289 @@
+/*++
+
+Module Name:
+
+    wdm.h
+
+Abstract:
+
+    Host (Linux) stand-in for the subset of the WDM headers used by the
+    SM5714 drivers. Types keep their Windows LLP64 widths so structure
+    layouts and arithmetic match the ARM64 driver build.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+//------------------------------------------------------------------------ Types
+
+#define VOID void
+
+typedef char                CHAR, *PCHAR;
+typedef unsigned char       UCHAR, *PUCHAR, BYTE, *PBYTE;
+typedef int16_t             SHORT, *PSHORT, INT16;
+typedef uint16_t            USHORT, *PUSHORT, UINT16, WORD;
+typedef int32_t             LONG, *PLONG, INT, INT32;
+typedef uint32_t            ULONG, *PULONG, UINT, UINT32, DWORD;
+typedef int64_t             LONGLONG, *PLONGLONG, INT64, LONG64;
+typedef uint64_t            ULONGLONG, *PULONGLONG, UINT64, ULONG64;
+typedef uintptr_t           ULONG_PTR, *PULONG_PTR;
+typedef intptr_t            LONG_PTR;
+typedef size_t              SIZE_T, *PSIZE_T;
+typedef void*               PVOID;
+typedef const void*         PCVOID;
+typedef wchar_t             WCHAR, *PWCHAR, *PWSTR;
+typedef const wchar_t*      PCWSTR;
+typedef const char*         PCSTR;
+typedef UCHAR               BOOLEAN, *PBOOLEAN;
+typedef LONG                NTSTATUS;
+typedef UCHAR               KIRQL;
+
+#define MINLONG     ((LONG)0x80000000)
+#define MAXLONG     0x7fffffff
+#define MAXULONG    0xffffffff
+
+#define __int64 long long
+#define __inline inline
+#define FORCEINLINE static inline
+#define DECLSPEC_ALIGN(x) __attribute__((aligned(x)))
+#define DECLSPEC_NOINLINE __attribute__((noinline))
+#define SYSTEM_CACHE_ALIGNMENT_SIZE 64
+#define DECLSPEC_CACHEALIGN DECLSPEC_ALIGN(SYSTEM_CACHE_ALIGNMENT_SIZE)
+#define UNALIGNED
+
+#define TRUE  1
+#define FALSE 0
+
+#ifndef NULL
+#define NULL ((void*)0)
+#endif
+
+typedef union _LARGE_INTEGER {
+    struct {
+        ULONG LowPart;
+        LONG HighPart;
+    };
+    LONGLONG QuadPart;
+} LARGE_INTEGER, *PLARGE_INTEGER;
+
+typedef struct _UNICODE_STRING {
+    USHORT Length;
+    USHORT MaximumLength;
+    PWSTR  Buffer;
+} UNICODE_STRING, *PUNICODE_STRING;
+
+typedef const UNICODE_STRING* PCUNICODE_STRING;
+
+typedef struct _GUID {
+    ULONG  Data1;
+    USHORT Data2;
+    USHORT Data3;
+    UCHAR  Data4[8];
+} GUID, *PGUID, *LPGUID;
+
+typedef const GUID* LPCGUID;
+
+//
+// Every host translation unit gets its own copy, as if it included
+// initguid.h
+//
+
+#define DEFINE_GUID(name, l, w1, w2, b1, b2, b3, b4, b5, b6, b7, b8) \
+    static const GUID name __attribute__((unused)) = { l, w1, w2, { b1, b2, b3, b4, b5, b6, b7, b8 } }
+
+typedef VOID (*PINTERFACE_REFERENCE)(PVOID Context);
+typedef VOID (*PINTERFACE_DEREFERENCE)(PVOID Context);
+
+typedef struct _INTERFACE {
+    USHORT                  Size;
+    USHORT                  Version;
+    PVOID                   Context;
+    PINTERFACE_REFERENCE    InterfaceReference;
+    PINTERFACE_DEREFERENCE  InterfaceDereference;
+} INTERFACE, *PINTERFACE;
+
+typedef struct _DEVICE_OBJECT DEVICE_OBJECT, *PDEVICE_OBJECT;
+typedef struct _DRIVER_OBJECT DRIVER_OBJECT, *PDRIVER_OBJECT;
+typedef struct _IRP IRP, *PIRP;
+
+typedef enum _POOL_TYPE {
+    NonPagedPool,
+    PagedPool,
+    NonPagedPoolCacheAligned = 4,
+    NonPagedPoolNx = 512,
+    NonPagedPoolNxCacheAligned = NonPagedPoolNx + NonPagedPoolCacheAligned,
+} POOL_TYPE;
+
+typedef enum _MODE {
+    KernelMode,
+    UserMode,
+} MODE;
+
+//----------------------------------------------------------------- Annotations
+
+#define IN
+#define OUT
+#define OPTIONAL
+#define __in
+#define __out
+#define _In_
+#define _In_opt_
+#define _Out_
+#define _Out_opt_
+#define _Inout_
+#define _Inout_opt_
+#define _Inout_updates_bytes_(x)
+#define _Inout_updates_(x)
+#define _In_reads_(x)
+#define _In_reads_bytes_(x)
+#define _In_reads_opt_(x)
+#define _Out_writes_(x)
+#define _Out_writes_bytes_(x)
+#define _Out_writes_bytes_opt_(x)
+#define _Out_writes_opt_(x)
+#define _Out_writes_to_(x, y)
+#define _Out_writes_bytes_to_(x, y)
+#define _Outptr_result_maybenull_
+#define _Use_decl_annotations_
+#define _Must_inspect_result_
+#define _IRQL_requires_same_
+#define _IRQL_requires_(x)
+#define _IRQL_requires_max_(x)
+#define _Function_class_(x)
+#define _Requires_lock_held_(x)
+#define _Requires_lock_not_held_(x)
+#define _Acquires_lock_(x)
+#define _Releases_lock_(x)
+#define _Guarded_by_(x)
+#define _Interlocked_
+#define _When_(x, y)
+#define _Field_size_(x)
+#define _Field_size_bytes_(x)
+#define _Analysis_assume_(x)
+
+typedef NTSTATUS DRIVER_INITIALIZE(_In_ PDRIVER_OBJECT DriverObject, _In_ PUNICODE_STRING RegistryPath);
+
+//---------------------------------------------------------------- Status codes
+
+#define STATUS_SUCCESS                   ((NTSTATUS)0x00000000L)
+#define STATUS_TIMEOUT                   ((NTSTATUS)0x00000102L)
+#define STATUS_PENDING                   ((NTSTATUS)0x00000103L)
+#define STATUS_DEVICE_BUSY               ((NTSTATUS)0x80000011L)
+#define STATUS_UNSUCCESSFUL              ((NTSTATUS)0xC0000001L)
+#define STATUS_NOT_IMPLEMENTED           ((NTSTATUS)0xC0000002L)
+#define STATUS_INVALID_PARAMETER         ((NTSTATUS)0xC000000DL)
+#define STATUS_NO_SUCH_DEVICE            ((NTSTATUS)0xC000000EL)
+#define STATUS_INVALID_DEVICE_REQUEST    ((NTSTATUS)0xC0000010L)
+#define STATUS_BUFFER_TOO_SMALL          ((NTSTATUS)0xC0000023L)
+#define STATUS_INSUFFICIENT_RESOURCES    ((NTSTATUS)0xC000009AL)
+#define STATUS_DEVICE_NOT_READY          ((NTSTATUS)0xC00000A3L)
+#define STATUS_IO_TIMEOUT                ((NTSTATUS)0xC00000B5L)
+#define STATUS_NOT_SUPPORTED             ((NTSTATUS)0xC00000BBL)
+#define STATUS_INVALID_PARAMETER_4       ((NTSTATUS)0xC00000F2L)
+#define STATUS_CANCELLED                 ((NTSTATUS)0xC0000120L)
+#define STATUS_DEVICE_PROTOCOL_ERROR     ((NTSTATUS)0xC0000186L)
+#define STATUS_NOT_FOUND                 ((NTSTATUS)0xC0000225L)
+#define STATUS_WMI_GUID_NOT_FOUND        ((NTSTATUS)0xC0000295L)
+#define STATUS_ACPI_INVALID_DATA         ((NTSTATUS)0xC014000FL)
+
+#define NT_SUCCESS(Status) (((NTSTATUS)(Status)) >= 0)
+
+//------------------------------------------------------------- Access / create
+
+#define GENERIC_READ            0x80000000UL
+#define GENERIC_WRITE           0x40000000UL
+#define FILE_OPEN               0x00000001UL
+#define FILE_ATTRIBUTE_NORMAL   0x00000080UL
+
+//---------------------------------------------------------------------- Macros
+
+#define UNREFERENCED_PARAMETER(P) ((void)(P))
+#define C_ASSERT(e) _Static_assert(e, #e)
+
+#define FIELD_OFFSET(type, field) ((LONG)offsetof(type, field))
+#define RTL_NUMBER_OF(A) (sizeof(A) / sizeof((A)[0]))
+#define ARRAYSIZE(A) RTL_NUMBER_OF(A)
+#define CONTAINING_RECORD(address, type, field) \
+    ((type*)((PCHAR)(address) - offsetof(type, field)))
+
+#define RtlCopyMemory(Destination, Source, Length) memcpy((Destination), (Source), (Length))
+#define RtlMoveMemory(Destination, Source, Length) memmove((Destination), (Source), (Length))
+#define RtlZeroMemory(Destination, Length) memset((Destination), 0, (Length))
+#define RtlFillMemory(Destination, Length, Fill) memset((Destination), (Fill), (Length))
+#define RtlEqualMemory(Destination, Source, Length) (!memcmp((Destination), (Source), (Length)))
+
+FORCEINLINE
+VOID
+RtlInitEmptyUnicodeString(
+    _Out_ PUNICODE_STRING UnicodeString,
+    _In_ PWCHAR Buffer,
+    _In_ USHORT BufferSize
+    )
+{
+    UnicodeString->Length = 0;
+    UnicodeString->MaximumLength = BufferSize;
+    UnicodeString->Buffer = Buffer;
+}
+
+#define PASSIVE_LEVEL  0
+#define APC_LEVEL      1
+#define DISPATCH_LEVEL 2
+
+#define KeGetCurrentIrql() ((KIRQL)PASSIVE_LEVEL)
+#define KeRaiseIrql(NewIrql, OldIrql) ((VOID)(NewIrql), *(OldIrql) = KeGetCurrentIrql())
+#define KeLowerIrql(NewIrql) ((VOID)(NewIrql))
+
+#define InterlockedIncrement(Addend) __atomic_add_fetch((Addend), 1, __ATOMIC_SEQ_CST)
+#define InterlockedIncrement64(Addend) __atomic_add_fetch((Addend), 1, __ATOMIC_SEQ_CST)
+#define InterlockedAdd64(Addend, Value) __atomic_add_fetch((Addend), (Value), __ATOMIC_SEQ_CST)
+#define InterlockedExchange(Target, Value) __atomic_exchange_n((Target), (Value), __ATOMIC_SEQ_CST)
+#define InterlockedOr(Destination, Value) __atomic_fetch_or((Destination), (Value), __ATOMIC_SEQ_CST)
+#define InterlockedExchange64(Target, Value) __atomic_exchange_n((Target), (Value), __ATOMIC_SEQ_CST)
+#define InterlockedOr64(Destination, Value) __atomic_fetch_or((Destination), (Value), __ATOMIC_SEQ_CST)
+#define ReadNoFence64(Source) __atomic_load_n((Source), __ATOMIC_RELAXED)
+#define ReadNoFence(Source) __atomic_load_n((Source), __ATOMIC_RELAXED)
+#define ReadAcquire(Source) __atomic_load_n((Source), __ATOMIC_ACQUIRE)
+#define KeMemoryBarrier() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#if defined(__x86_64__) || defined(__i386__)
+#define YieldProcessor() __builtin_ia32_pause()
+#else
+#define YieldProcessor() __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#endif
+
+//
+// Interrupt time in 100ns units. The host clock is virtual and only moves
+// through HostAdvanceInterruptTime (wdf.h), so runs are reproducible.
+//
+
+ULONGLONG
+KeQueryInterruptTime(
+    VOID
+    );
+#define PAGED_CODE()
+#define NT_ASSERT(e) ((void)0)
+#define ASSERT(e) ((void)0)
+#define ASSERTMSG(msg, e) ((void)0)
+
+#define DPFLTR_IHVDRIVER_ID 77
+#define DPFLTR_ERROR_LEVEL  0
+#define DPFLTR_INFO_LEVEL   3
+
+#define DbgPrintEx(ComponentId, Level, ...) ((void)0)
+
+#define TRACE_LEVEL_NONE        0
+#define TRACE_LEVEL_CRITICAL    1
+#define TRACE_LEVEL_ERROR       2
+#define TRACE_LEVEL_WARNING     3
+#define TRACE_LEVEL_INFORMATION 4
+#define TRACE_LEVEL_VERBOSE     5
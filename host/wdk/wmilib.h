@@ -0,0 +1,73 @@
+/*++
+
+Module Name:
+
+    wmilib.h
+
+Abstract:
+
+    Host (Linux) stand-in for the WMI library context used by the battery
+    class registration. None of the callbacks are invoked on the host.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#include <wmistr.h>
+
+typedef struct {
+    LPCGUID Guid;
+    ULONG   InstanceCount;
+    ULONG   Flags;
+} WMIGUIDREGINFO, *PWMIGUIDREGINFO;
+
+typedef enum {
+    WmiEventControl,
+    WmiDataBlockControl
+} WMIENABLEDISABLECONTROL;
+
+typedef enum {
+    IrpProcessed,
+    IrpNotCompleted,
+    IrpNotWmi,
+    IrpForward
+} SYSCTL_IRP_DISPOSITION;
+
+typedef
+NTSTATUS
+WMI_QUERY_REGINFO_CALLBACK(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _Out_ PULONG RegFlags,
+    _Out_ PUNICODE_STRING InstanceName,
+    _Outptr_result_maybenull_ PUNICODE_STRING* RegistryPath,
+    _Out_ PUNICODE_STRING MofResourceName,
+    _Outptr_result_maybenull_ PDEVICE_OBJECT* Pdo
+    );
+
+typedef
+NTSTATUS
+WMI_QUERY_DATABLOCK_CALLBACK(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp,
+    _In_ ULONG GuidIndex,
+    _In_ ULONG InstanceIndex,
+    _In_ ULONG InstanceCount,
+    _Out_writes_opt_(InstanceCount) PULONG InstanceLengthArray,
+    _In_ ULONG BufferAvail,
+    _Out_writes_bytes_opt_(BufferAvail) PUCHAR Buffer
+    );
+
+typedef struct _WMILIB_CONTEXT {
+    ULONG                           GuidCount;
+    PWMIGUIDREGINFO                 GuidList;
+    WMI_QUERY_REGINFO_CALLBACK*     QueryWmiRegInfo;
+    WMI_QUERY_DATABLOCK_CALLBACK*   QueryWmiDataBlock;
+    PVOID                           SetWmiDataBlock;
+    PVOID                           SetWmiDataItem;
+    PVOID                           ExecuteWmiMethod;
+    PVOID                           WmiFunctionControl;
+} WMILIB_CONTEXT, *PWMILIB_CONTEXT;
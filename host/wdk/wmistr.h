@@ -0,0 +1,25 @@
+/*++
+
+Module Name:
+
+    wmistr.h
+
+Abstract:
+
+    Host (Linux) stand-in for the WMI structure definitions.
+
+Environment:
+
+    User mode, host build only
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+
+#define WMIREG_FLAG_EXPENSIVE       0x00000001
+#define WMIREG_FLAG_INSTANCE_PDO    0x00000020
+
+#define WMIREG_ACTION_REGISTER      1
+#define WMIREG_ACTION_DEREGISTER    2